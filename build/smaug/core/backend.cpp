@@ -0,0 +1 @@
+/root/repo/smaug/core/backend.cpp
\ No newline at end of file
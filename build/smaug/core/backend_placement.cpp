@@ -0,0 +1 @@
+/root/repo/smaug/core/backend_placement.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/core/backend_placement.h
\ No newline at end of file
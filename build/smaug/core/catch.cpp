@@ -0,0 +1 @@
+/root/repo/smaug/core/catch.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/core/data_movement_benchmark.cpp
\ No newline at end of file
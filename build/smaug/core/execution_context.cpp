@@ -0,0 +1 @@
+/root/repo/smaug/core/execution_context.cpp
\ No newline at end of file
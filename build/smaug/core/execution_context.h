@@ -0,0 +1 @@
+/root/repo/smaug/core/execution_context.h
\ No newline at end of file
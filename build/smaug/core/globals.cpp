@@ -0,0 +1 @@
+/root/repo/smaug/core/globals.cpp
\ No newline at end of file
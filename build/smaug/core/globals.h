@@ -0,0 +1 @@
+/root/repo/smaug/core/globals.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/core/network.cpp
\ No newline at end of file
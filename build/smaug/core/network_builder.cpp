@@ -0,0 +1 @@
+/root/repo/smaug/core/network_builder.cpp
\ No newline at end of file
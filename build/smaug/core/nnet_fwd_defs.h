@@ -0,0 +1 @@
+/root/repo/smaug/core/nnet_fwd_defs.h
\ No newline at end of file
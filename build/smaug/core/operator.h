@@ -0,0 +1 @@
+/root/repo/smaug/core/operator.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/core/scheduler.cpp
\ No newline at end of file
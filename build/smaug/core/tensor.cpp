@@ -0,0 +1 @@
+/root/repo/smaug/core/tensor.cpp
\ No newline at end of file
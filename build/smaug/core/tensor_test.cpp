@@ -0,0 +1 @@
+/root/repo/smaug/core/tensor_test.cpp
\ No newline at end of file
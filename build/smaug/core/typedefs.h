@@ -0,0 +1 @@
+/root/repo/smaug/core/typedefs.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/common.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/convert_op.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/depthwise_convolution_op.h
\ No newline at end of file
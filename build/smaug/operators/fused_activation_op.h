@@ -0,0 +1 @@
+/root/repo/smaug/operators/fused_activation_op.h
\ No newline at end of file
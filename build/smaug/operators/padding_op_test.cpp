@@ -0,0 +1 @@
+/root/repo/smaug/operators/padding_op_test.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/ref/ref_batch_norm_op_test.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/ref/ref_tanh_op.cpp
\ No newline at end of file
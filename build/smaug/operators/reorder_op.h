@@ -0,0 +1 @@
+/root/repo/smaug/operators/reorder_op.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/reorder_op_test.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smiv/arch/inner_product.c
\ No newline at end of file
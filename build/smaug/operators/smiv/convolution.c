@@ -0,0 +1 @@
+/root/repo/smaug/operators/smiv/convolution.c
\ No newline at end of file
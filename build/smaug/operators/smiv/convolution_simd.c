@@ -0,0 +1 @@
+/root/repo/smaug/operators/smiv/convolution_simd.c
\ No newline at end of file
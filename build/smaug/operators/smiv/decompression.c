@@ -0,0 +1 @@
+/root/repo/smaug/operators/smiv/decompression.c
\ No newline at end of file
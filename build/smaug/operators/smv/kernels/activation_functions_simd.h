@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/kernels/activation_functions_simd.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/kernels/compare.c
\ No newline at end of file
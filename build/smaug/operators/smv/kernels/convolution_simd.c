@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/kernels/convolution_simd.c
\ No newline at end of file
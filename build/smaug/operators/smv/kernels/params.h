@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/kernels/params.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/kernels/pooling.c
\ No newline at end of file
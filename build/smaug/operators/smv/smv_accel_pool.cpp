@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_accel_pool.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_batch_norm_op_test.cpp
\ No newline at end of file
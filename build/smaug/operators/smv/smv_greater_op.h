@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_greater_op.h
\ No newline at end of file
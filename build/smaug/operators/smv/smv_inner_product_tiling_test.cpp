@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_inner_product_tiling_test.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_less_op.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_pooling_op.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_softmax_op.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_tiling_base.cpp
\ No newline at end of file
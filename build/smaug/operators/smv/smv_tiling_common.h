@@ -0,0 +1 @@
+/root/repo/smaug/operators/smv/smv_tiling_common.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/__init__.py
\ No newline at end of file
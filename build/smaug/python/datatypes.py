@@ -0,0 +1 @@
+/root/repo/smaug/python/datatypes.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/global_vars.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/node.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/ops/activation_ops_test.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/ops/array_ops.py
\ No newline at end of file
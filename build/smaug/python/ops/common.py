@@ -0,0 +1 @@
+/root/repo/smaug/python/ops/common.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/ops/control_flow_ops.py
\ No newline at end of file
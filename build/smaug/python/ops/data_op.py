@@ -0,0 +1 @@
+/root/repo/smaug/python/ops/data_op.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/ops/ops_test.py
\ No newline at end of file
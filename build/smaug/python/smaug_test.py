@@ -0,0 +1 @@
+/root/repo/smaug/python/smaug_test.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/subgraph_test.py
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/python/tensor.py
\ No newline at end of file
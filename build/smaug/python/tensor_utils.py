@@ -0,0 +1 @@
+/root/repo/smaug/python/tensor_utils.py
\ No newline at end of file
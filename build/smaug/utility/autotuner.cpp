@@ -0,0 +1 @@
+/root/repo/smaug/utility/autotuner.cpp
\ No newline at end of file
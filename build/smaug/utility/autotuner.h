@@ -0,0 +1 @@
+/root/repo/smaug/utility/autotuner.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/utility/autotuner_test.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/utility/debug_stream.h
\ No newline at end of file
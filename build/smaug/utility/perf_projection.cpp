@@ -0,0 +1 @@
+/root/repo/smaug/utility/perf_projection.cpp
\ No newline at end of file
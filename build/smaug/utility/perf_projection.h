@@ -0,0 +1 @@
+/root/repo/smaug/utility/perf_projection.h
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/utility/perf_projection_test.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+/root/repo/smaug/utility/thread_pool.h
\ No newline at end of file
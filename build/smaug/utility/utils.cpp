@@ -0,0 +1 @@
+/root/repo/smaug/utility/utils.cpp
\ No newline at end of file
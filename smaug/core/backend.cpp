@@ -1,7 +1,9 @@
 #include "smaug/core/backend.h"
+#include "smaug/operators/attention_op.h"
 #include "smaug/operators/batch_norm_op.h"
 #include "smaug/operators/concat_op.h"
 #include "smaug/operators/control_flow_ops.h"
+#include "smaug/operators/convert_op.h"
 #include "smaug/operators/convolution_op.h"
 #include "smaug/operators/data_op.h"
 #include "smaug/operators/depthwise_convolution_op.h"
@@ -18,6 +20,7 @@
 #include "smaug/operators/repeat_op.h"
 #include "smaug/operators/reshape_op.h"
 #include "smaug/operators/sigmoid_op.h"
+#include "smaug/operators/smv/smv_attention_op.h"
 #include "smaug/operators/smv/smv_batch_norm_op.h"
 #include "smaug/operators/smv/smv_convolution_op.h"
 #include "smaug/operators/smv/smv_eltwise_add_op.h"
@@ -81,6 +84,8 @@ DEF_CREATE_OP(SeluOp, ReferenceBackend)
 DEF_CREATE_OP(TanhOp, ReferenceBackend)
 DEF_CREATE_OP(HardTanhOp, ReferenceBackend)
 DEF_CREATE_OP(PaddingOp, ReferenceBackend)
+DEF_CREATE_OP(ConvertOp, ReferenceBackend)
+DEF_CREATE_OP(AttentionOp, ReferenceBackend)
 
 DEF_CREATE_SMV_OP(ConvolutionOp)
 DEF_CREATE_SMV_OP(InnerProductOp)
@@ -100,6 +105,7 @@ DEF_CREATE_SMV_OP(LessOp)
 DEF_CREATE_SMV_OP(LessEqualOp)
 DEF_CREATE_SMV_OP(GreaterOp)
 DEF_CREATE_SMV_OP(GreaterEqualOp)
+DEF_CREATE_SMV_OP(AttentionOp)
 DEF_CREATE_OP(DataOp, SmvBackend)
 DEF_CREATE_OP(DepthwiseConvolutionOp, SmvBackend)
 DEF_CREATE_OP(ReorderOp, SmvBackend)
@@ -111,6 +117,7 @@ DEF_CREATE_OP(FlattenOp, SmvBackend)
 DEF_CREATE_OP(SwitchOp, SmvBackend)
 DEF_CREATE_OP(MergeOp, SmvBackend)
 DEF_CREATE_OP(PaddingOp, SmvBackend)
+DEF_CREATE_OP(ConvertOp, SmvBackend)
 
 // for simple tracing.
 namespace ref {
@@ -122,7 +129,7 @@ const unsigned kPoolingHw = 0x0005;
 }  // namespace ref
 
 namespace smv {
-int kSpadSize;
+thread_local int kSpadSize;
 // Use the same accelerator id for all hardware blocks. This means we will
 // simulate only ONE datapath instead of multiple, which means that the two
 // blocks can share the scratchpads (without any infrastructure
@@ -139,9 +146,9 @@ const unsigned kPoolingHw = 0x0003;
 // The systolic array is implemented in gem5 instead of Aladdin, so it needs to
 // have a different accelerator id.
 const unsigned kSystolicArrayHw = 0x0004;
-float* spad0;
-float* spad1;
-float* spad2;
+thread_local float* spad0;
+thread_local float* spad1;
+thread_local float* spad2;
 }  // namespace smv
 
 }  // namespace smaug
@@ -59,6 +59,8 @@ template <typename Backend> class SeluOp;
 template <typename Backend> class TanhOp;
 template <typename Backend> class HardTanhOp;
 template <typename Backend> class PaddingOp;
+template <typename Backend> class ConvertOp;
+template <typename Backend> class AttentionOp;
 
 #endif
 
@@ -126,6 +128,8 @@ class ReferenceBackend {
     DECL_CREATE_OP(TanhOp);
     DECL_CREATE_OP(HardTanhOp);
     DECL_CREATE_OP(PaddingOp);
+    DECL_CREATE_OP(ConvertOp);
+    DECL_CREATE_OP(AttentionOp);
 
 #undef DECL_CREATE_OP
 };
@@ -134,7 +138,9 @@ class ReferenceBackend {
  * The smv namespace contains all code specific to the Smv backend.
  */
 namespace smv {
-extern int kSpadSize;
+// The scratchpads and their size are thread-local like the other runtime
+// globals (see globals.h), so every thread running a network has its own.
+extern thread_local int kSpadSize;
 extern const unsigned kConvolutionHw;
 extern const unsigned kInnerProductHw;
 extern const unsigned kEltwiseOpHw;
@@ -143,9 +149,9 @@ extern const unsigned kPoolingHw;
 extern const unsigned kSystolicArrayHw;
 // Note that these naked pointers are never to be used except when invoking the
 // kernels themselves.
-extern float* spad0;
-extern float* spad1;
-extern float* spad2;
+extern thread_local float* spad0;
+extern thread_local float* spad1;
+extern thread_local float* spad2;
 }  // namespace smv
 
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
@@ -167,6 +173,7 @@ class SmvLessOp;
 class SmvLessEqualOp;
 class SmvGreaterOp;
 class SmvGreaterEqualOp;
+class SmvAttentionOp;
 #endif
 
 /**
@@ -230,6 +237,7 @@ class SmvBackend {
     DECL_CREATE_SMV_OP(LessEqualOp);
     DECL_CREATE_SMV_OP(GreaterOp);
     DECL_CREATE_SMV_OP(GreaterEqualOp);
+    DECL_CREATE_SMV_OP(AttentionOp);
     DECL_CREATE_OP(DataOp);
     DECL_CREATE_OP(DepthwiseConvolutionOp);
     DECL_CREATE_OP(ReorderOp);
@@ -241,6 +249,7 @@ class SmvBackend {
     DECL_CREATE_OP(SwitchOp);
     DECL_CREATE_OP(MergeOp);
     DECL_CREATE_OP(PaddingOp);
+    DECL_CREATE_OP(ConvertOp);
 
 #undef DECL_SMV_OP
 #undef DECL_CREATE_OP
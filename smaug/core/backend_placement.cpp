@@ -0,0 +1,355 @@
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
+
+#include "smaug/core/backend.h"
+#include "smaug/core/backend_placement.h"
+#include "smaug/core/tensor.pb.h"
+#include "smaug/operators/convert_op.h"
+
+namespace smaug {
+
+namespace {
+
+const double kInfiniteCost = std::numeric_limits<double>::infinity();
+
+// The data formats that the operators of a backend expect.
+struct BackendFormat {
+    DataLayout activationLayout;
+    DataLayout fcWeightLayout;
+    DataType floatType;
+    int alignment;
+};
+
+BackendFormat getBackendFormat(const std::string& backend) {
+    if (backend == ReferenceBackend::Name) {
+        return { ReferenceBackend::DefaultInputDataLayout, CN, Float32,
+                 ReferenceBackend::Alignment };
+    } else if (backend == SmvBackend::Name) {
+        return { SmvBackend::DefaultInputDataLayout, NC, Float16,
+                 SmvBackend::Alignment };
+    }
+    std::cerr << "[ERROR]: Unknown backend " << backend << "!\n";
+    exit(1);
+}
+
+double getNumElements(const TensorProto& tensor) {
+    double elements = 1;
+    for (int dim : tensor.shape().dims())
+        elements *= dim;
+    return elements;
+}
+
+int getNumChannels(const TensorProto& tensor) {
+    const TensorShapeProto& shape = tensor.shape();
+    if (shape.layout() == NHWC)
+        return shape.dims(3);
+    if (shape.layout() == CN)
+        return shape.dims(0);
+    return shape.dims(1);
+}
+
+// Rewrites a tensor from the data formats of one backend to those of another,
+// without changing its logical contents.
+void convertTensorProto(TensorProto* tensor,
+                        const BackendFormat& format,
+                        bool isFcWeight) {
+    if (tensor->data_type() == Float16 || tensor->data_type() == Float32)
+        tensor->set_data_type(format.floatType);
+    TensorShapeProto* shape = tensor->mutable_shape();
+    DataLayout layout = shape->layout();
+    if (shape->dims_size() == 4 && (layout == NCHW || layout == NHWC))
+        layout = format.activationLayout;
+    else if (isFcWeight && (layout == NC || layout == CN))
+        layout = format.fcWeightLayout;
+    std::vector<int> perm = getLayoutPermutation(
+            shape->layout(), layout, shape->dims_size());
+    std::vector<int> dims(shape->dims().begin(), shape->dims().end());
+    for (int i = 0; i < dims.size(); i++)
+        shape->set_dims(i, dims[perm[i]]);
+    shape->set_layout(layout);
+    shape->set_alignment(format.alignment);
+}
+
+// The generic templates of some operators don't do anything, so those
+// operators can't be placed on a backend that doesn't specialize them.
+bool canRunOn(OpType type, const std::string& backend) {
+    return !(backend == SmvBackend::Name &&
+             type == OpType::ConvolutionDepthwise);
+}
+
+std::set<std::string> getStateUpdateNodes(const GraphProto& graph) {
+    std::set<std::string> nodes;
+    for (const auto& var : graph.state_variables())
+        nodes.insert(var.update_node());
+    return nodes;
+}
+
+const std::string& getNodeBackend(const NodeProto& node,
+                                  const GraphProto& graph) {
+    return node.backend().empty() ? graph.backend() : node.backend();
+}
+
+}  // namespace
+
+bool isPlacementSupported(OpType type) {
+    switch (type) {
+        case OpType::Convolution3d:
+        case OpType::ConvolutionDepthwise:
+        case OpType::MaxPooling:
+        case OpType::AveragePooling:
+        case OpType::InnerProduct:
+        case OpType::BatchNorm:
+        case OpType::EltwiseAdd:
+        case OpType::EltwiseMul:
+        case OpType::ReLU:
+        case OpType::LReLU:
+        case OpType::ELU:
+        case OpType::SELU:
+        case OpType::Tanh:
+        case OpType::HardTanh:
+        case OpType::Sigmoid:
+        case OpType::Softmax:
+        case OpType::Attention:
+            return true;
+        default:
+            return false;
+    }
+}
+
+double getOperatorWork(const NodeProto& node) {
+    double outputElements = 0;
+    for (const auto& output : node.output_tensors())
+        outputElements += getNumElements(output);
+    OpType type = node.op();
+    if ((type == OpType::Convolution3d ||
+         type == OpType::ConvolutionDepthwise ||
+         type == OpType::InnerProduct) &&
+        node.input_tensors_size() == 2 && node.output_tensors_size() == 1) {
+        // Every output element accumulates one weight per output channel.
+        return outputElements * getNumElements(node.input_tensors(1)) /
+               getNumChannels(node.output_tensors(0));
+    }
+    if (type == OpType::Attention && node.input_tensors_size() == 4) {
+        // Both the scores and the context are reductions over the time steps
+        // of the keys.
+        return outputElements * node.input_tensors(1).shape().dims(1);
+    }
+    return outputElements;
+}
+
+PlacementCostTable::PlacementCostTable() {
+    for (int i = OpType_MIN; i <= OpType_MAX; i++) {
+        OpType type = static_cast<OpType>(i);
+        if (!OpType_IsValid(i) || !isPlacementSupported(type))
+            continue;
+        costs[{ type, ReferenceBackend::Name }] = 1e-9;
+        costs[{ type, SmvBackend::Name }] = 5e-10;
+    }
+    costs[{ OpType::Convolution3d, SmvBackend::Name }] = 1.25e-10;
+    costs[{ OpType::InnerProduct, SmvBackend::Name }] = 1.25e-10;
+    costs[{ OpType::ConvolutionDepthwise, SmvBackend::Name }] = kInfiniteCost;
+    costs[{ OpType::Convert, ReferenceBackend::Name }] = 2e-9;
+    costs[{ OpType::Convert, SmvBackend::Name }] = 2e-9;
+}
+
+double PlacementCostTable::getCost(OpType type,
+                                   const std::string& backend) const {
+    auto it = costs.find({ type, backend });
+    if (it == costs.end() || !canRunOn(type, backend))
+        return kInfiniteCost;
+    return it->second;
+}
+
+void PlacementCostTable::setCost(OpType type,
+                                 const std::string& backend,
+                                 double cost) {
+    costs[{ type, backend }] = cost;
+}
+
+double PlacementCostTable::getNodeCost(const NodeProto& node,
+                                       const std::string& backend) const {
+    return getCost(node.op(), backend) * getOperatorWork(node);
+}
+
+void PlacementCostTable::updateFromProfile(
+        const GraphProto& graph,
+        const std::vector<PerfProjection::Record>& records) {
+    GraphProto lowered = graph;
+    lowerBackendPlacement(&lowered);
+    std::map<std::string, const NodeProto*> nodes;
+    for (const auto& node : lowered.nodes())
+        nodes[node.name()] = &node;
+    std::map<std::pair<OpType, std::string>, std::pair<double, double>>
+            totals;
+    for (const auto& record : records) {
+        auto it = nodes.find(record.name);
+        if (it == nodes.end())
+            continue;
+        const NodeProto& node = *it->second;
+        auto& total = totals[{ node.op(), getNodeBackend(node, lowered) }];
+        total.first += record.projected;
+        total.second += getOperatorWork(node);
+    }
+    for (const auto& total : totals) {
+        if (total.second.second > 0)
+            costs[total.first] = total.second.first / total.second.second;
+    }
+}
+
+bool PlacementCostTable::load(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file)
+        return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string typeName, backend, cost;
+        if (!(fields >> typeName) || typeName[0] == '#')
+            continue;
+        OpType type;
+        if (!(fields >> backend >> cost) || !OpType_Parse(typeName, &type))
+            return false;
+        try {
+            costs[{ type, backend }] = std::stod(cost);
+        } catch (const std::exception& e) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PlacementCostTable::save(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file)
+        return false;
+    file << "# <OpType> <backend> <seconds per unit of work>\n";
+    file.precision(6);
+    for (const auto& cost : costs) {
+        file << OpType_Name(cost.first.first) << " " << cost.first.second
+             << " " << std::scientific << cost.second << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+void placeOperators(GraphProto* graph, const PlacementCostTable& costs) {
+    static const std::vector<std::string> kBackends = {
+        ReferenceBackend::Name, SmvBackend::Name
+    };
+    std::map<std::string, const NodeProto*> nodes;
+    std::set<std::string> updateNodes = getStateUpdateNodes(*graph);
+    for (NodeProto& node : *graph->mutable_nodes()) {
+        nodes[node.name()] = &node;
+        if (!node.backend().empty() || !isPlacementSupported(node.op()) ||
+            updateNodes.count(node.name()))
+            continue;
+        std::string bestBackend = graph->backend();
+        double bestCost = kInfiniteCost;
+        for (const auto& backend : kBackends) {
+            double cost = costs.getNodeCost(node, backend);
+            for (int i = 0; i < node.parents_size(); i++) {
+                auto parent = nodes.find(node.parents(i));
+                const std::string& parentBackend =
+                        parent == nodes.end()
+                                ? graph->backend()
+                                : getNodeBackend(*parent->second, *graph);
+                if (parentBackend != backend) {
+                    cost += costs.getCost(OpType::Convert, backend) *
+                            getNumElements(node.input_tensors(i));
+                }
+            }
+            // The graph backend wins any tie.
+            if (cost < bestCost ||
+                (cost == bestCost && backend == graph->backend())) {
+                bestCost = cost;
+                bestBackend = backend;
+            }
+        }
+        node.set_backend(bestBackend);
+    }
+}
+
+void lowerBackendPlacement(GraphProto* graph) {
+    const std::string graphBackend = graph->backend();
+    std::set<std::string> updateNodes = getStateUpdateNodes(*graph);
+    std::map<std::string, int> nodeIndices;
+    for (int i = 0; i < graph->nodes_size(); i++) {
+        NodeProto* node = graph->mutable_nodes(i);
+        nodeIndices[node->name()] = i;
+        if (node->backend().empty())
+            node->set_backend(graphBackend);
+        if (node->backend() == graphBackend)
+            continue;
+        if (node->op() == OpType::Data || !isPlacementSupported(node->op()) ||
+            updateNodes.count(node->name()) ||
+            !canRunOn(node->op(), node->backend())) {
+            std::cerr << "[ERROR]: " << node->name() << " ("
+                      << OpType_Name(node->op())
+                      << ") can't be placed on the " << node->backend()
+                      << " backend!\n";
+            exit(1);
+        }
+        BackendFormat format = getBackendFormat(node->backend());
+        for (int j = 0; j < node->input_tensors_size(); j++) {
+            bool isFcWeight = node->op() == OpType::InnerProduct && j == 1;
+            convertTensorProto(
+                    node->mutable_input_tensors(j), format, isFcWeight);
+        }
+        for (int j = 0; j < node->output_tensors_size(); j++)
+            convertTensorProto(node->mutable_output_tensors(j), format, false);
+    }
+
+    // Insert a Convert node on every edge that crosses backends, right before
+    // its consumer to keep the nodes in topological order. A tensor is only
+    // converted once per backend and layout, however many consumers it has.
+    google::protobuf::RepeatedPtrField<NodeProto> nodes;
+    std::set<std::string> convertNodes;
+    for (const NodeProto& original : graph->nodes()) {
+        NodeProto node = original;
+        for (int i = 0; i < node.parents_size(); i++) {
+            const NodeProto& parent =
+                    graph->nodes(nodeIndices.at(node.parents(i)));
+            if (parent.backend() == node.backend())
+                continue;
+            int srcIdx = node.src_tensors_indices(i);
+            TensorProto* input = node.mutable_input_tensors(i);
+            std::string name = parent.name() + "_" + std::to_string(srcIdx) +
+                               "_to_" + node.backend() + "_" +
+                               DataLayout_Name(input->shape().layout());
+            input->set_name(name);
+            if (convertNodes.insert(name).second) {
+                NodeProto* convert = nodes.Add();
+                convert->set_name(name);
+                convert->set_op(OpType::Convert);
+                convert->set_backend(node.backend());
+                convert->add_parents(parent.name());
+                convert->add_src_tensors_indices(srcIdx);
+                *convert->add_input_tensors() = parent.output_tensors(srcIdx);
+                *convert->add_output_tensors() = *input;
+            }
+            node.set_parents(i, name);
+            node.set_src_tensors_indices(i, 0);
+        }
+        *nodes.Add() = node;
+    }
+    graph->mutable_nodes()->Swap(&nodes);
+}
+
+void lowerReferenceToFp16Storage(GraphProto* graph) {
+    for (NodeProto& node : *graph->mutable_nodes()) {
+        if (node.backend() != ReferenceBackend::Name)
+            continue;
+        for (TensorProto& tensor : *node.mutable_input_tensors()) {
+            if (tensor.data_type() == Float32)
+                tensor.set_data_type(Float16);
+        }
+        for (TensorProto& tensor : *node.mutable_output_tensors()) {
+            if (tensor.data_type() == Float32)
+                tensor.set_data_type(Float16);
+        }
+    }
+}
+
+}  // namespace smaug
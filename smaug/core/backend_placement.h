@@ -0,0 +1,106 @@
+#ifndef _CORE_BACKEND_PLACEMENT_H_
+#define _CORE_BACKEND_PLACEMENT_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "smaug/core/graph.pb.h"
+#include "smaug/core/node.pb.h"
+#include "smaug/core/types.pb.h"
+#include "smaug/utility/perf_projection.h"
+
+namespace smaug {
+
+/**
+ * Returns true if an operator of this type can run on a different backend
+ * than the rest of its graph. These are the operators whose semantics don't
+ * depend on the data formats of their backend.
+ */
+bool isPlacementSupported(OpType type);
+
+/**
+ * Returns the amount of work of a node, which the placement costs are
+ * relative to: the number of multiply-accumulates of a convolution or an
+ * inner product, and the number of output elements of any other operator.
+ */
+double getOperatorWork(const NodeProto& node);
+
+/**
+ * PlacementCostTable estimates how long an operator takes on each backend,
+ * as a cost in seconds per unit of work (see getOperatorWork()). The cost of
+ * moving a tensor between two backends is the cost of a Convert operator on
+ * the destination backend, per element converted.
+ *
+ * The default costs are rough estimates for native runs. They can be
+ * replaced by a table profiled on the target machine, which is stored as a
+ * text file with one "<OpType> <backend> <cost>" entry per line.
+ */
+class PlacementCostTable {
+   public:
+    PlacementCostTable();
+
+    /**
+     * Returns the cost per unit of work of an operator type on a backend.
+     * Returns infinity if the backend can't run this type of operator.
+     */
+    double getCost(OpType type, const std::string& backend) const;
+    void setCost(OpType type, const std::string& backend, double cost);
+
+    /** Returns the estimated runtime of a node on a backend, in seconds. */
+    double getNodeCost(const NodeProto& node,
+                       const std::string& backend) const;
+
+    /**
+     * Replaces the costs of the operators timed in a run of the graph by
+     * their measured costs.
+     *
+     * @param graph The graph that was run, before its backend placement was
+     * lowered.
+     * @param records The runtimes of the operators of the graph.
+     */
+    void updateFromProfile(const GraphProto& graph,
+                           const std::vector<PerfProjection::Record>& records);
+
+    /** Reads costs from a file written by save(). Returns false on error. */
+    bool load(const std::string& fileName);
+    /** Writes all the costs to a text file. Returns false on error. */
+    bool save(const std::string& fileName) const;
+
+   protected:
+    std::map<std::pair<OpType, std::string>, double> costs;
+};
+
+/**
+ * Places every operator of the graph that supports it on the backend where
+ * it is estimated to run fastest, counting the conversions of its inputs
+ * from the backends of their producers. Nodes are placed greedily in the
+ * order of the graph, which the frontend writes in topological order. The
+ * choice is recorded in the backend field of each node.
+ */
+void placeOperators(GraphProto* graph, const PlacementCostTable& costs);
+
+/**
+ * Lowers the backend placement of the graph so it can be built: the tensors
+ * of every node placed on another backend than the graph are rewritten to
+ * the data formats of that backend, and a Convert node is inserted on every
+ * edge between nodes on different backends.
+ *
+ * Data nodes always stay on the backend of the graph. If any other node is
+ * placed on a backend it can't run on, this reports an error and exits.
+ */
+void lowerBackendPlacement(GraphProto* graph);
+
+/**
+ * Stores the floating point tensors of every node on the Reference backend
+ * in fp16 instead of fp32 (see useFp16ReferenceStorage). This runs after
+ * lowerBackendPlacement(), so it also covers the Data nodes of a Reference
+ * graph and the Convert nodes into the Reference backend. Parameters that the
+ * model stores in fp32 are rounded to fp16 when they are loaded.
+ */
+void lowerReferenceToFp16Storage(GraphProto* graph);
+
+}  // namespace smaug
+
+#endif
@@ -0,0 +1,373 @@
+// Microbenchmarks for the data movement primitives of the runtime.
+//
+// Every primitive is measured in isolation across a set of realistic tensor
+// shapes, both alignments used by the backends (0 for the reference backend
+// and 8 for SMV) and the requested thread counts. The bandwidth of each
+// primitive counts the bytes read plus the bytes written, and is compared
+// against a plain memcpy of the same amount of data, which serves as the
+// roofline. The results are printed as a table and written as JSON.
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/format.hpp>
+#include <boost/program_options.hpp>
+
+#include "smaug/core/backend.h"
+#include "smaug/core/globals.h"
+#include "smaug/core/tensor.h"
+#include "smaug/core/tensor_utils.h"
+#include "smaug/core/workspace.h"
+#include "smaug/operators/data_op.h"
+#include "smaug/operators/reorder_op_impl.h"
+#include "smaug/operators/repeat_op.h"
+#include "smaug/operators/smv/smv_kernels.h"
+#include "smaug/utility/thread_pool.h"
+#include "smaug/utility/utils.h"
+
+namespace po = boost::program_options;
+
+using namespace smaug;
+
+namespace {
+
+struct BenchmarkConfig {
+    /** Minimum number of timed iterations of each benchmark. */
+    int minIterations;
+    /** Minimum total time spent on the timed iterations of each benchmark. */
+    double minTime;
+};
+
+struct BenchmarkResult {
+    std::string primitive;
+    std::vector<int> dims;
+    DataLayout layout;
+    int alignment;
+    DataType dataType;
+    int threads;
+    /** Bytes read plus bytes written by one iteration. */
+    size_t bytes;
+    /** Average time of one iteration, in seconds. */
+    double seconds;
+    /** Bandwidth of a memcpy moving the same number of bytes, in GB/s. */
+    double memcpyGbps;
+
+    double gbps() const { return bytes / seconds / 1e9; }
+};
+
+BenchmarkConfig config;
+std::vector<BenchmarkResult> results;
+
+// Returns the average time of one call of body, in seconds. Any per-iteration
+// setup goes in reset, which is not timed.
+double timeIt(const std::function<void()>& body,
+              const std::function<void()>& reset = nullptr) {
+    // Warm up the caches and the page tables.
+    if (reset)
+        reset();
+    body();
+    int iterations = 0;
+    double elapsed = 0;
+    while (iterations < config.minIterations || elapsed < config.minTime) {
+        if (reset)
+            reset();
+        auto start = std::chrono::steady_clock::now();
+        body();
+        elapsed += std::chrono::duration<double>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+        iterations++;
+    }
+    return elapsed / iterations;
+}
+
+// A zeroed, cacheline-aligned buffer of numElems elements, which is freed
+// when it goes out of scope.
+template <typename T>
+std::unique_ptr<T[], decltype(&free)> allocAligned(size_t numElems) {
+    return std::unique_ptr<T[], decltype(&free)>(
+            reinterpret_cast<T*>(malloc_aligned(numElems * sizeof(T), true)),
+            free);
+}
+
+// Measures a memcpy moving the same number of bytes (half read, half
+// written), and returns its bandwidth in GB/s.
+double memcpyRoofline(size_t bytes) {
+    size_t copySize = bytes / 2;
+    auto src = allocAligned<char>(copySize);
+    auto dest = allocAligned<char>(copySize);
+    double seconds = timeIt(
+            [&]() { std::memcpy(dest.get(), src.get(), copySize); });
+    return bytes / seconds / 1e9;
+}
+
+std::string dimsToString(const std::vector<int>& dims) {
+    std::string str;
+    for (int i = 0; i < dims.size(); i++)
+        str += (i == 0 ? "" : "x") + std::to_string(dims[i]);
+    return str;
+}
+
+void record(const std::string& primitive,
+            const TensorShape& shape,
+            DataType dataType,
+            int threads,
+            size_t bytes,
+            double seconds) {
+    results.push_back({ primitive, shape.dims(), shape.getLayout(),
+                        shape.getAlignment(), dataType, threads, bytes,
+                        seconds, memcpyRoofline(bytes) });
+    const BenchmarkResult& result = results.back();
+    std::cout << boost::format("%-22s %-20s %-6s %3d %-8s %3d %10.3f %8.2f "
+                               "%8.2f %6.1f%%\n") %
+                         result.primitive % dimsToString(result.dims) %
+                         DataLayout_Name(result.layout) % result.alignment %
+                         DataType_Name(result.dataType) % result.threads %
+                         (result.seconds * 1e6) % result.gbps() %
+                         result.memcpyGbps %
+                         (result.gbps() / result.memcpyGbps * 100);
+}
+
+template <typename DType>
+Tensor* createTensor(Workspace* workspace,
+                     const std::string& name,
+                     const TensorShape& shape) {
+    Tensor* tensor = workspace->addTensor(new Tensor(name, shape));
+    DType* data = tensor->allocateStorage<DType>();
+    for (int i = 0; i < shape.storageSize(); i++)
+        data[i] = static_cast<DType>(i % 256);
+    return tensor;
+}
+
+size_t storageBytes(Tensor* tensor) {
+    return tensor->getShape().storageSize() * tensor->getDataTypeSize();
+}
+
+void benchmarkCopies(const TensorShape& shape) {
+    Workspace workspace;
+    Tensor* src = createTensor<float>(&workspace, "src", shape);
+    Tensor* dest = createTensor<float>(&workspace, "dest", shape);
+    std::vector<int> origin(shape.ndims(), 0);
+    size_t bytes = 2 * storageBytes(src);
+
+    double seconds = timeIt([&]() {
+        copyTensorRegion(dest, src, origin, origin, shape.dims());
+    });
+    record("copyTensorRegion", shape, Float32, 1, bytes, seconds);
+
+    // Copying half of the rows is what tiling an activation does: the copied
+    // region is no longer one contiguous block.
+    std::vector<int> region = shape.dims();
+    region[1] = std::max(1, region[1] / 2);
+    TensorShape regionShape(region, shape.getLayout(), shape.getAlignment());
+    seconds = timeIt([&]() {
+        copyTensorRegion(dest, src, origin, origin, region);
+    });
+    record("copyTensorRegion/half", shape, Float32, 1,
+           2 * regionShape.storageSize() * sizeof(float), seconds);
+
+    seconds = timeIt([&]() {
+        copyTensorData(dest, src, origin, origin, shape.size());
+    });
+    record("copyTensorData", shape, Float32, 1, bytes, seconds);
+}
+
+void benchmarkTiling(const TensorShape& shape, int threads) {
+    Workspace workspace;
+    Tensor* tensor = createTensor<float>(&workspace, "tensor", shape);
+    DataOp<ReferenceBackend> op("tiling", &workspace);
+    op.setData(tensor);
+    // Four row bands, each split into two channel halves.
+    std::vector<int> tileDims = shape.dims();
+    tileDims[1] = std::max(1, tileDims[1] / 4);
+    tileDims[3] = std::max(1, tileDims[3] / 2);
+    TensorShape tileShape(tileDims, shape.getLayout(), shape.getAlignment());
+    TiledTensor tiledTensor = generateTiledTensor(tensor, tileShape, &op);
+    size_t bytes = 0;
+    for (auto index = tiledTensor.startIndex(); !index.end(); ++index)
+        bytes += 2 * storageBytes(tiledTensor[index]);
+
+    // Bumping the version of the tensor invalidates the tiles, so every
+    // iteration copies all of them again.
+    double seconds = timeIt([&]() { tiledTensor.copyDataToAllTiles(); },
+                            [&]() { tensor->incrDataVersion(); });
+    record("copyDataToAllTiles", shape, Float32, threads, bytes, seconds);
+
+    seconds = timeIt([&]() { tiledTensor.untile(); });
+    record("untile", shape, Float32, threads, bytes, seconds);
+}
+
+template <typename DType>
+void benchmarkReorders(const TensorShape& shape, DataType dataType) {
+    Workspace workspace;
+    const std::vector<int>& dims = shape.dims();
+    TensorShape nchwShape({ dims[0], dims[3], dims[1], dims[2] },
+                          DataLayout::NCHW, shape.getAlignment());
+    Tensor* nchw = createTensor<DType>(&workspace, "nchw", nchwShape);
+    Tensor* nhwc = createTensor<DType>(&workspace, "nhwc", shape);
+    size_t bytes = storageBytes(nchw) + storageBytes(nhwc);
+    double seconds =
+            timeIt([&]() { convertNchwToNhwcImpl<DType>(nchw, nhwc); });
+    record("convertNchwToNhwc", nchwShape, dataType, 1, bytes, seconds);
+
+    TensorShape flatShape({ dims[0], dims[1] * dims[2] * dims[3] },
+                          DataLayout::NC, shape.getAlignment());
+    Tensor* flat = createTensor<DType>(&workspace, "flat", flatShape);
+    bytes = storageBytes(nhwc) + storageBytes(flat);
+    seconds = timeIt([&]() { flattenImpl<DType>(nhwc, flat); });
+    record("flatten", shape, dataType, 1, bytes, seconds);
+}
+
+template <typename Backend>
+void benchmarkRepeat(const TensorShape& shape) {
+    Workspace workspace;
+    Tensor* input = createTensor<float>(&workspace, "input", shape);
+    // Broadcast along the rows, as for an elementwise op with a bias.
+    std::vector<int> multiples(shape.ndims(), 1);
+    multiples[1] = 4;
+    RepeatOp<Backend> op("repeat", &workspace, multiples);
+    op.setInput(input, 0);
+    op.createAllTensors();
+    Tensor* output = op.getOutput(0);
+    output->template allocateStorage<float>();
+    size_t bytes = storageBytes(input) + storageBytes(output);
+    double seconds = timeIt([&]() { op.run(); });
+    record("RepeatOp::run", shape, Float32, 1, bytes, seconds);
+}
+
+void benchmarkFp16Packing(const TensorShape& shape) {
+    Workspace workspace;
+    Tensor* fp16 = createTensor<float16>(&workspace, "fp16", shape);
+    int numElems = shape.storageSize();
+    auto local = allocAligned<float>(numElems);
+    size_t bytes = numElems * (sizeof(float) + sizeof(float16));
+    double seconds = timeIt([&]() {
+        host_load_fp16(local.get(), fp16->data<float16>(), numElems, 0, 0);
+    });
+    record("host_load_fp16", shape, Float16, 1, bytes, seconds);
+
+    seconds = timeIt([&]() {
+        host_store_fp16(local.get(), fp16->data<float16>(), numElems, 0, 0);
+    });
+    record("host_store_fp16", shape, Float16, 1, bytes, seconds);
+}
+
+void writeJson(std::ostream& out) {
+    auto writeList = [&](const std::vector<int>& list) {
+        out << "[";
+        for (int i = 0; i < list.size(); i++)
+            out << (i == 0 ? "" : ", ") << list[i];
+        out << "]";
+    };
+    out << "{\n  \"results\": [\n";
+    for (int i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        out << "    { \"primitive\": \"" << result.primitive << "\", ";
+        out << "\"dims\": ";
+        writeList(result.dims);
+        out << ", \"layout\": \"" << DataLayout_Name(result.layout) << "\", ";
+        out << "\"alignment\": " << result.alignment << ", ";
+        out << "\"data_type\": \"" << DataType_Name(result.dataType) << "\", ";
+        out << "\"threads\": " << result.threads << ", ";
+        out << "\"bytes\": " << result.bytes << ", ";
+        out << "\"seconds\": " << result.seconds << ", ";
+        out << "\"gbps\": " << result.gbps() << ", ";
+        out << "\"memcpy_gbps\": " << result.memcpyGbps << ", ";
+        out << "\"efficiency\": " << result.gbps() / result.memcpyGbps
+            << " }" << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    out << "  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string outputFile = "data_movement_benchmark.json";
+    std::string threadList = "1,2,4";
+    config.minIterations = 5;
+    config.minTime = 0.1;
+    runningInSimulation = false;
+    po::options_description options(
+            "Data movement microbenchmarks. Usage: ./data_movement_benchmark "
+            "[options]");
+    // clang-format off
+    options.add_options()
+        ("help,h", "Display this help message")
+        ("output,o", po::value(&outputFile),
+         "Write the results as JSON to this file.")
+        ("threads", po::value(&threadList),
+         "The thread counts to run the multithreaded primitives with, given "
+         "as a list like 1,2,4 or 1-8.")
+        ("min-iterations", po::value(&config.minIterations),
+         "The minimum number of timed iterations of each benchmark.")
+        ("min-time", po::value(&config.minTime),
+         "The minimum time in seconds spent on each benchmark.");
+    // clang-format on
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, options), vm);
+    po::notify(vm);
+    if (vm.count("help")) {
+        std::cout << options << "\n";
+        return 1;
+    }
+    std::vector<int> threadCounts = parseCpuList(threadList);
+    if (threadCounts.empty()) {
+        std::cerr << "[ERROR]: Invalid list of thread counts: " << threadList
+                  << "\n";
+        exit(1);
+    }
+
+    // Activations of convolutional and fully connected layers, all in NHWC.
+    // The last one has a channel count that is not a multiple of 8, so the
+    // SMV alignment pads it.
+    std::vector<std::vector<int>> shapes = {
+        { 1, 32, 32, 32 },
+        { 1, 56, 56, 64 },
+        { 8, 14, 14, 256 },
+        { 1, 28, 28, 3 },
+    };
+
+    std::cout << boost::format("%-22s %-20s %-6s %3s %-8s %3s %10s %8s %8s "
+                               "%7s\n") %
+                         "Primitive" % "Shape" % "Layout" % "Aln" % "Type" %
+                         "Thr" % "Time (us)" % "GB/s" % "memcpy" % "Eff";
+    for (const auto& dims : shapes) {
+        for (int alignment : { 0, 8 }) {
+            TensorShape shape(dims, DataLayout::NHWC, alignment);
+            benchmarkCopies(shape);
+            fastForwardMode = false;
+            for (int threads : threadCounts) {
+                // A single thread runs the copies on the main thread.
+                if (threads > 1) {
+                    threadPool = new ThreadPool(threads);
+                    threadPool->initThreadPool();
+                }
+                benchmarkTiling(shape, threads);
+                delete threadPool;
+                threadPool = nullptr;
+            }
+            benchmarkReorders<float>(shape, Float32);
+            benchmarkReorders<float16>(shape, Float16);
+            if (alignment == 0)
+                benchmarkRepeat<ReferenceBackend>(shape);
+            else
+                benchmarkRepeat<SmvBackend>(shape);
+            benchmarkFp16Packing(shape);
+        }
+    }
+
+    std::ofstream out(outputFile);
+    if (!out) {
+        std::cerr << "[ERROR]: Unable to open " << outputFile << "\n";
+        exit(1);
+    }
+    writeJson(out);
+    std::cout << "Results written to " << outputFile << "\n";
+    return 0;
+}
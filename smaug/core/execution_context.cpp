@@ -0,0 +1,56 @@
+#include "smaug/core/backend.h"
+#include "smaug/core/execution_context.h"
+#include "smaug/core/globals.h"
+
+namespace smaug {
+
+ExecutionContext::ExecutionContext() { loadFromThread(); }
+
+void ExecutionContext::loadFromThread() {
+    fastForwardMode = smaug::fastForwardMode;
+    numAcceleratorsAvailable = smaug::numAcceleratorsAvailable;
+    useSystolicArrayWhenAvailable = smaug::useSystolicArrayWhenAvailable;
+    useFp16ReferenceStorage = smaug::useFp16ReferenceStorage;
+    threadPool = smaug::threadPool;
+    spad0 = smv::spad0;
+    spad1 = smv::spad1;
+    spad2 = smv::spad2;
+    spadSize = smv::kSpadSize;
+    systolicArrayConfig = smv::SystolicArray::config;
+    systolicArrayRecords = smv::SystolicArray::records;
+    perfProjectionEnabled = PerfProjection::active;
+    perfProjectionRecords = PerfProjection::records;
+}
+
+void ExecutionContext::storeToThread() const {
+    smaug::fastForwardMode = fastForwardMode;
+    smaug::numAcceleratorsAvailable = numAcceleratorsAvailable;
+    smaug::useSystolicArrayWhenAvailable = useSystolicArrayWhenAvailable;
+    smaug::useFp16ReferenceStorage = useFp16ReferenceStorage;
+    smaug::threadPool = threadPool;
+    smv::spad0 = spad0;
+    smv::spad1 = spad1;
+    smv::spad2 = spad2;
+    smv::kSpadSize = spadSize;
+    smv::SystolicArray::config = systolicArrayConfig;
+    smv::SystolicArray::records = systolicArrayRecords;
+    PerfProjection::active = perfProjectionEnabled;
+    PerfProjection::records = perfProjectionRecords;
+}
+
+ExecutionContext::Scope::Scope(ExecutionContext* _context)
+        : context(_context) {
+    if (!context)
+        return;
+    saved.reset(new ExecutionContext());
+    context->storeToThread();
+}
+
+ExecutionContext::Scope::~Scope() {
+    if (!context)
+        return;
+    context->loadFromThread();
+    saved->storeToThread();
+}
+
+}  // namespace smaug
@@ -0,0 +1,84 @@
+#ifndef _CORE_EXECUTION_CONTEXT_H_
+#define _CORE_EXECUTION_CONTEXT_H_
+
+#include <memory>
+#include <vector>
+
+#include "smaug/operators/smv/smv_systolic_array.h"
+#include "smaug/utility/perf_projection.h"
+
+namespace smaug {
+
+class ThreadPool;
+
+/**
+ * ExecutionContext holds the runtime settings and resources of one inference:
+ * the thread pool, the accelerator configuration, the simulation phase, the
+ * scratchpads of the SMV backend, the cycles recorded by the native systolic
+ * array and the performance projection.
+ *
+ * The runtime reads these through the thread-local globals (see globals.h).
+ * Binding a context to a thread with a Scope loads its values into that
+ * thread's globals, and stores any changes back into the context when the
+ * Scope ends. Several inferences can therefore run concurrently, one per
+ * thread, each with its own context and its own Network; the Networks may
+ * share their read-only parameters (see buildNetwork()).
+ *
+ * The context does not own the thread pool or the scratchpads. For example,
+ * the SMV scratchpads of a context are allocated by calling
+ * SmvBackend::initGlobals() while the context is bound, and must be freed the
+ * same way.
+ */
+class ExecutionContext {
+   public:
+    /** Creates a context with the current settings of the calling thread. */
+    ExecutionContext();
+
+    /** True if the simulation is still fast-forwarding. */
+    bool fastForwardMode;
+    /** The number of accelerators an operator's work can be split across. */
+    int numAcceleratorsAvailable;
+    /** Uses the systolic array for applicable operators, if supported. */
+    bool useSystolicArrayWhenAvailable;
+    /** Stores the tensors of the Reference backend in fp16. */
+    bool useFp16ReferenceStorage;
+    /** The thread pool for multithreaded tasks, or null to use none. */
+    ThreadPool* threadPool;
+    /** The scratchpads of the SMV backend and their size. */
+    float* spad0;
+    float* spad1;
+    float* spad2;
+    int spadSize;
+    /** The modeled native systolic array and the cycles of its layers. */
+    smv::SystolicArray::Config systolicArrayConfig;
+    std::vector<smv::SystolicArray::Record> systolicArrayRecords;
+    /** Whether a performance projection is collected, and its times. */
+    bool perfProjectionEnabled;
+    std::vector<PerfProjection::Record> perfProjectionRecords;
+
+    /**
+     * A RAII helper that binds a context to the calling thread. The previous
+     * settings of the thread are restored when the Scope ends. A null context
+     * leaves the settings of the thread untouched.
+     */
+    class Scope {
+       public:
+        Scope(ExecutionContext* _context);
+        ~Scope();
+
+       protected:
+        ExecutionContext* context;
+        /** The settings of the thread before the context was bound. */
+        std::unique_ptr<ExecutionContext> saved;
+    };
+
+   protected:
+    /** Copies the settings of the calling thread into this context. */
+    void loadFromThread();
+    /** Makes this context the settings of the calling thread. */
+    void storeToThread() const;
+};
+
+}  // namespace smaug
+
+#endif
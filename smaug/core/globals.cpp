@@ -2,8 +2,9 @@
 
 namespace smaug {
 bool runningInSimulation;
-bool fastForwardMode = true;
-int numAcceleratorsAvailable;
-ThreadPool* threadPool = nullptr;
-bool useSystolicArrayWhenAvailable;
+thread_local bool fastForwardMode = true;
+thread_local int numAcceleratorsAvailable;
+thread_local ThreadPool* threadPool = nullptr;
+thread_local bool useSystolicArrayWhenAvailable;
+thread_local bool useFp16ReferenceStorage;
 }  // namespace smaug
@@ -1,6 +1,11 @@
 /**
  * \file globals.h
  * \brief SMAUG Global variables.
+ *
+ * Except for runningInSimulation, which describes the whole process, these
+ * are thread-local: each thread has its own copy, so that inferences running
+ * on different threads don't interfere. An ExecutionContext sets them for the
+ * thread that runs a network.
  */
 
 #ifndef _CORE_GLOBALS_H_
@@ -16,7 +21,7 @@ class ThreadPool;
 extern bool runningInSimulation;
 
 /** True if we are simulating in fast-forward mode. */
-extern bool fastForwardMode;
+extern thread_local bool fastForwardMode;
 
 /**
  * The maximum number of accelerators an operator's work can be split across.
@@ -27,18 +32,25 @@ constexpr const int maxNumAccelerators = 8;
 /**
  * The actual number of accelerator complexes currently in use.
  */
-extern int numAcceleratorsAvailable;
+extern thread_local int numAcceleratorsAvailable;
 
 /**
  * The user-space thread pool used by SMAUG to run multithreaded tasks.
  */
-extern ThreadPool* threadPool;
+extern thread_local ThreadPool* threadPool;
 
 /**
  * If true, uses the systolic array for applicable operators when backend
  * support exists.
  */
-extern bool useSystolicArrayWhenAvailable;
+extern thread_local bool useSystolicArrayWhenAvailable;
+
+/**
+ * If true, the tensors of the operators on the Reference backend are stored in
+ * fp16 instead of fp32, as on the SMV backend. The operators still compute in
+ * fp32. This is read when a network is built.
+ */
+extern thread_local bool useFp16ReferenceStorage;
 
 }  // namespace smaug
 
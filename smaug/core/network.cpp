@@ -1,11 +1,21 @@
+#include <algorithm>
+#include <functional>
 #include <list>
+#include <memory>
+#include <map>
 #include <set>
+#include <sstream>
+#include <tuple>
 #include <vector>
 #include <boost/format.hpp>
 
 #include "smaug/core/datatypes.h"
+#include "smaug/core/globals.h"
 #include "smaug/core/typedefs.h"
 #include "smaug/core/network.h"
+#include "smaug/core/tensor_utils.h"
+#include "smaug/operators/pooling_op.h"
+#include "smaug/operators/smv/smv_convolution_op.h"
 #include "smaug/utility/utils.h"
 
 using namespace smaug;
@@ -57,3 +67,348 @@ void Network::printSummary() const {
         std::cout << hline << "\n";
     }
 }
+
+void Network::addStateVariable(Operator* stateOp,
+                               Operator* updateOp,
+                               int updateIdx) {
+    assert(stateOp->getOpType() == OpType::Data &&
+           "A state variable must be held by a Data operator!");
+    Tensor* state = stateOp->getOutput(0);
+    Tensor* update = updateOp->getOutput(updateIdx);
+    assert(state->getShape().storageSize() ==
+                   update->getShape().storageSize() &&
+           state->getDataType() == update->getDataType() &&
+           "The updated state must match the state in size and type!");
+    std::unique_ptr<TensorProto> stateProto(state->asTensorProto());
+    stateVariables.push_back(
+            { stateOp, updateOp, updateIdx, stateProto->data() });
+}
+
+bool Network::isStateUpdate(TensorBase* tensor) const {
+    for (auto& var : stateVariables) {
+        if (var.updateOp->getOutput(var.updateIdx) == tensor)
+            return true;
+    }
+    return false;
+}
+
+void Network::updateStates() {
+    for (auto& var : stateVariables) {
+        Tensor* update = var.updateOp->getOutput(var.updateIdx);
+        // The update is on an untaken branch, so keep the current state.
+        if (update->isDead())
+            continue;
+        Tensor* state = var.stateOp->getOutput(0);
+        copyRawTensorData(
+                state, update, 0, 0, state->getShape().storageSize());
+        state->incrDataVersion();
+    }
+}
+
+void Network::resetStates() {
+    for (auto& var : stateVariables) {
+        Tensor* state = var.stateOp->getOutput(0);
+        state->fillData(var.initialValue);
+        state->incrDataVersion();
+    }
+}
+
+void Network::snapshotStates(TensorProtoArray* snapshot) const {
+    for (auto& var : stateVariables) {
+        Tensor* state = var.stateOp->getOutput(0);
+        snapshot->mutable_tensors()->AddAllocated(state->asTensorProto());
+    }
+}
+
+// Returns the number of elements of the given type serialized in data. Two
+// float16 elements are packed into one element of half_data.
+static int64_t getNumSerializedElements(const TensorData& data,
+                                        DataType dataType) {
+    if (data.has_encoded_data()) {
+        if (data.encoded_data().data_type() != dataType)
+            return -1;
+        return data.encoded_data().num_elements();
+    }
+    switch (dataType) {
+        case Float16:
+            return 2 * static_cast<int64_t>(data.half_data_size());
+        case Float32:
+            return data.float_data_size();
+        case Float64:
+            return data.double_data_size();
+        case Int32:
+            return data.int_data_size();
+        case Int64:
+            return data.int64_data_size();
+        case Bool:
+            return data.bool_data_size();
+        default:
+            return -1;
+    }
+}
+
+// Returns why the snapshot of a state can't be loaded into it, or an empty
+// string if it can.
+static std::string checkStateSnapshot(const TensorProto& proto,
+                                      Tensor* state) {
+    std::ostringstream error;
+    TensorShape shape(proto.shape());
+    const TensorShape& stateShape = state->getShape();
+    if (!(shape == stateShape) ||
+        shape.getAlignment() != stateShape.getAlignment()) {
+        error << "the shape " << shape << " doesn't match " << stateShape;
+        return error.str();
+    }
+    if (proto.data_type() != state->getDataType()) {
+        error << "the data type " << DataType_Name(proto.data_type())
+              << " doesn't match " << DataType_Name(state->getDataType());
+        return error.str();
+    }
+    // float16 data is padded to an even number of elements.
+    int64_t expected = stateShape.storageSize();
+    int64_t actual = getNumSerializedElements(proto.data(), proto.data_type());
+    if (proto.data_type() == Float16 && !proto.data().has_encoded_data())
+        expected = next_multiple(expected, 2);
+    if (actual != expected) {
+        error << "it has " << actual << " elements instead of " << expected;
+        return error.str();
+    }
+    return "";
+}
+
+bool Network::restoreStates(const TensorProtoArray& snapshot) {
+    // Check every state first, so that a bad snapshot restores none of them.
+    std::vector<std::pair<Tensor*, const TensorProto*>> restored;
+    for (auto& var : stateVariables) {
+        Tensor* state = var.stateOp->getOutput(0);
+        for (const TensorProto& proto : snapshot.tensors()) {
+            if (proto.name() != state->getName())
+                continue;
+            std::string error = checkStateSnapshot(proto, state);
+            if (!error.empty()) {
+                std::cerr << "[ERROR]: Can't restore the state "
+                          << state->getName() << " from the snapshot: "
+                          << error << "!\n";
+                return false;
+            }
+            restored.push_back({ state, &proto });
+            break;
+        }
+    }
+    for (auto& stateProto : restored) {
+        stateProto.first->fillData(stateProto.second->data());
+        stateProto.first->incrDataVersion();
+    }
+    return true;
+}
+
+// Identifies a data movement operator by its type, its input tensor and the
+// shape and type of its output. Given the input, the output shape fully
+// determines the parameters of a Reorder (target layout), Reshape (new shape)
+// and Repeat (multiples), so two operators with the same key are identical.
+typedef std::tuple<OpType, TensorBase*, std::vector<int>, DataLayout, int,
+                   DataType>
+        DataMovementKey;
+
+static bool isDataMovementOp(Operator* op) {
+    OpType opType = op->getOpType();
+    if (opType != OpType::Reorder && opType != OpType::Reshape &&
+        opType != OpType::Repeat)
+        return false;
+    return op->getInputs().size() == 1 && op->getInputs()[0] &&
+           op->getOutputs().size() == 1 && op->getOutputs()[0];
+}
+
+int Network::eliminateCommonSubexpressions() {
+    // Visiting the operators in topological order makes sure the inputs of an
+    // operator have been rewired to the surviving duplicates before its key is
+    // computed, so chains of duplicates are merged in a single pass.
+    std::list<Vertex> vertices;
+    boost::topological_sort(graph, std::front_inserter(vertices));
+    MutableEdgeNameMap edges = get(boost::edge_name, graph);
+    std::map<DataMovementKey, Operator*> uniqueOps;
+    std::vector<Operator*> duplicates;
+    for (auto v : vertices) {
+        Operator* op = get(boost::vertex_op, graph, v);
+        if (!isDataMovementOp(op))
+            continue;
+        TensorBase* output = op->getOutputs()[0];
+        const TensorShape& shape = output->getShape();
+        DataMovementKey key(op->getOpType(), op->getInputs()[0], shape.dims(),
+                            shape.getLayout(), shape.getAlignment(),
+                            output->getDataType());
+        auto it = uniqueOps.find(key);
+        if (it == uniqueOps.end()) {
+            uniqueOps[key] = op;
+            continue;
+        }
+        // Move the consumers of the duplicate over to the unique operator.
+        Operator* uniqueOp = it->second;
+        std::vector<std::pair<Vertex, TensorIndices>> consumers;
+        out_edge_iter outEdgeIt, outEdgeEnd;
+        for (boost::tie(outEdgeIt, outEdgeEnd) = out_edges(v, graph);
+             outEdgeIt != outEdgeEnd;
+             ++outEdgeIt) {
+            consumers.push_back(std::make_pair(target(*outEdgeIt, graph),
+                                               edges[*outEdgeIt]));
+        }
+        for (auto& consumer : consumers) {
+            Operator* child = get(boost::vertex_op, graph, consumer.first);
+            const TensorIndices& indices = consumer.second;
+            child->setInput(uniqueOp->getOutputs()[indices.srcIdx],
+                            indices.destIdx);
+            addEdge(uniqueOp, child, indices);
+        }
+        for (auto& var : stateVariables) {
+            if (var.updateOp == op)
+                var.updateOp = uniqueOp;
+        }
+        std::replace(outputOps.begin(), outputOps.end(), op, uniqueOp);
+        duplicates.push_back(op);
+    }
+    removeOperators(duplicates);
+    return duplicates.size();
+}
+
+std::vector<Operator*> Network::getOutputOperators() const {
+    if (!outputOps.empty())
+        return outputOps;
+    // The vertices are numbered in the order the operators were added, which
+    // the builder keeps from the model, so the output comes last.
+    for (int v = num_vertices(graph) - 1; v >= 0; v--) {
+        Operator* op = get(boost::vertex_op, graph, v);
+        if (op->getOpType() != OpType::Data)
+            return { op };
+    }
+    return {};
+}
+
+int Network::eliminateDeadOperators() {
+    std::vector<bool> live(num_vertices(graph), false);
+    std::list<Vertex> worklist;
+    for (Operator* op : getOutputOperators())
+        worklist.push_back(op->getVertex());
+    for (auto& var : stateVariables) {
+        worklist.push_back(var.stateOp->getVertex());
+        worklist.push_back(var.updateOp->getVertex());
+    }
+    // Without any output, everything would be dead. Leave such a network
+    // alone.
+    if (worklist.empty())
+        return 0;
+
+    while (!worklist.empty()) {
+        Vertex v = worklist.front();
+        worklist.pop_front();
+        if (live[v])
+            continue;
+        live[v] = true;
+        in_edge_iter inEdgeIt, inEdgeEnd;
+        for (boost::tie(inEdgeIt, inEdgeEnd) = in_edges(v, graph);
+             inEdgeIt != inEdgeEnd;
+             ++inEdgeIt) {
+            worklist.push_back(source(*inEdgeIt, graph));
+        }
+    }
+    std::vector<Operator*> deadOps;
+    vertex_iter vertexIt, vertexEnd;
+    for (boost::tie(vertexIt, vertexEnd) = boost::vertices(graph);
+         vertexIt != vertexEnd;
+         ++vertexIt) {
+        if (!live[*vertexIt])
+            deadOps.push_back(get(boost::vertex_op, graph, *vertexIt));
+    }
+    removeOperators(deadOps);
+    return deadOps.size();
+}
+
+int Network::fuseConvolutionPooling() {
+    if (useSystolicArrayWhenAvailable)
+        return 0;
+    MutableEdgeNameMap edges = get(boost::edge_name, graph);
+    std::vector<Operator*> fusedOps;
+    vertex_iter vertexIt, vertexEnd;
+    for (boost::tie(vertexIt, vertexEnd) = boost::vertices(graph);
+         vertexIt != vertexEnd;
+         ++vertexIt) {
+        auto conv = dynamic_cast<SmvConvolutionOp*>(
+                get(boost::vertex_op, graph, *vertexIt));
+        if (!conv || conv->hasFusedPooling() ||
+            out_degree(*vertexIt, graph) != 1)
+            continue;
+        out_edge_iter outEdgeIt, outEdgeEnd;
+        boost::tie(outEdgeIt, outEdgeEnd) = out_edges(*vertexIt, graph);
+        Vertex poolVertex = target(*outEdgeIt, graph);
+        auto pool = dynamic_cast<PoolingOp<SmvBackend>*>(
+                get(boost::vertex_op, graph, poolVertex));
+        if (!pool || pool->getPoolingSize() != pool->getPoolingStride())
+            continue;
+        bool isStateUpdate = false;
+        for (auto& var : stateVariables) {
+            if (var.updateOp == conv)
+                isStateUpdate = true;
+        }
+        if (isStateUpdate)
+            continue;
+        // The convolution takes over the pooled output tensor and the
+        // consumers of the pooling operator. The pooling operator is handed
+        // the unpooled output, which gets deleted along with it.
+        TensorBase* convOutput = conv->getOutputs()[0];
+        conv->setFusedPooling(pool->getOpType(), pool->getPoolingSize(),
+                              pool->getPoolingStride());
+        conv->setOutput(pool->getOutputs()[0], 0);
+        pool->setOutput(convOutput, 0);
+        std::vector<std::pair<Vertex, TensorIndices>> consumers;
+        for (boost::tie(outEdgeIt, outEdgeEnd) = out_edges(poolVertex, graph);
+             outEdgeIt != outEdgeEnd;
+             ++outEdgeIt) {
+            consumers.push_back(std::make_pair(target(*outEdgeIt, graph),
+                                               edges[*outEdgeIt]));
+        }
+        for (auto& consumer : consumers) {
+            addEdge(conv, get(boost::vertex_op, graph, consumer.first),
+                    consumer.second);
+        }
+        for (auto& var : stateVariables) {
+            if (var.updateOp == pool)
+                var.updateOp = conv;
+        }
+        std::replace(outputOps.begin(),
+                     outputOps.end(),
+                     static_cast<Operator*>(pool),
+                     static_cast<Operator*>(conv));
+        fusedOps.push_back(pool);
+    }
+    removeOperators(fusedOps);
+    return fusedOps.size();
+}
+
+void Network::removeOperators(const std::vector<Operator*>& ops) {
+    if (ops.empty())
+        return;
+    // The vertices are stored in a vector, so removing one renumbers all the
+    // vertices after it. Remove them from the back and then renumber the
+    // surviving operators.
+    std::vector<Vertex> removed;
+    for (Operator* op : ops) {
+        clear_vertex(op->getVertex(), graph);
+        removed.push_back(op->getVertex());
+    }
+    std::sort(removed.begin(), removed.end(), std::greater<Vertex>());
+    for (Vertex v : removed)
+        remove_vertex(v, graph);
+    vertex_iter vertexIt, vertexEnd;
+    for (boost::tie(vertexIt, vertexEnd) = boost::vertices(graph);
+         vertexIt != vertexEnd;
+         ++vertexIt) {
+        get(boost::vertex_op, graph, *vertexIt)->setVertex(*vertexIt);
+    }
+    for (Operator* op : ops) {
+        for (TensorBase* output : op->getOutputs()) {
+            if (output)
+                op->getWorkspace()->removeTensor(output->getName());
+        }
+        operators.erase(op->getName());
+        delete op;
+    }
+}
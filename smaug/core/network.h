@@ -66,7 +66,108 @@ class Network {
     }
     SamplingInfo& getSamplingInfo() { return sampling; }
 
+    /**
+     * Marks the output of a Data operator as a state variable that persists
+     * across runs of the network. The current contents of the state become
+     * its initial value.
+     *
+     * @param stateOp The Data operator holding the state.
+     * @param updateOp The operator that produces the updated state.
+     * @param updateIdx The output index of the updated state in updateOp.
+     */
+    void addStateVariable(Operator* stateOp, Operator* updateOp, int updateIdx);
+    bool hasStateVariables() const { return !stateVariables.empty(); }
+    /** Returns true if the tensor is the update of a state variable. */
+    bool isStateUpdate(TensorBase* tensor) const;
+
+    /**
+     * Writes the updated value of every state variable back into the state,
+     * so that it is used by the next run.
+     */
+    void updateStates();
+
+    /** Restores every state variable to its initial value. */
+    void resetStates();
+
+    /**
+     * Saves the current value of every state variable into snapshot. Each
+     * entry is the state's tensor, with its name, shape and data type.
+     */
+    void snapshotStates(TensorProtoArray* snapshot) const;
+
+    /**
+     * Loads the value of the state variables from a snapshot previously
+     * taken by snapshotStates(). States missing from the snapshot are left
+     * untouched.
+     *
+     * Returns false, without restoring any state, if the shape, data type
+     * or number of elements of a state in the snapshot doesn't match the
+     * state variable of this network.
+     */
+    bool restoreStates(const TensorProtoArray& snapshot);
+
+    /**
+     * Merges duplicate data movement operators (Reorder, Reshape and Repeat)
+     * that read the same tensor and produce the same output. The consumers of
+     * each duplicate are rewired to the first one, and the duplicates are
+     * removed together with their output tensors.
+     *
+     * This must be called after the inputs of every operator have been set.
+     *
+     * @return The number of operators removed.
+     */
+    int eliminateCommonSubexpressions();
+
+    /**
+     * Marks the operator as an output of the network, so that it is never
+     * eliminated as dead.
+     */
+    void markOutput(Operator* op) { outputOps.push_back(op); }
+
+    /**
+     * Returns the operators producing the outputs of the network: the ones
+     * marked by markOutput(), or if there are none, the last non-Data
+     * operator added to the network.
+     */
+    std::vector<Operator*> getOutputOperators() const;
+
+    /**
+     * Removes the operators whose outputs reach no output of the network. The
+     * liveness starts only from the network outputs (see
+     * getOutputOperators()) and from the state variables and their updates,
+     * so a branch of compute operators nothing consumes is removed too.
+     *
+     * @return The number of operators removed.
+     */
+    int eliminateDeadOperators();
+
+    /**
+     * Fuses each SMV convolution into the max or average pooling operator that
+     * is its only consumer, so that the convolution kernel pools its results
+     * before sending them back. The pooling operators are removed together
+     * with the unpooled outputs of the convolutions. Pooling with overlapping
+     * windows is left alone, as is everything when the systolic array is in
+     * use.
+     *
+     * @return The number of pooling operators fused.
+     */
+    int fuseConvolutionPooling();
+
    protected:
+    struct StateVariable {
+        Operator* stateOp;
+        Operator* updateOp;
+        int updateIdx;
+        /** The value the state gets on a reset. */
+        TensorData initialValue;
+    };
+
+    /**
+     * Removes the operators from the graph, and deletes them and their output
+     * tensors.
+     */
+    void removeOperators(const std::vector<Operator*>& ops);
+
     struct OperatorInsertion {
         Operator* newOp;
         Operator* sourceOp;
@@ -82,6 +183,12 @@ class Network {
     /** The sampling information of the model. */
     SamplingInfo sampling;
 
+    /** State variables that carry their values across runs. */
+    std::vector<StateVariable> stateVariables;
+
+    /** Operators explicitly marked as outputs of the network. */
+    std::vector<Operator*> outputOps;
+
     /** Name of the model. */
     std::string name;
 };
@@ -1,11 +1,16 @@
 #include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <set>
 
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
 
 #include "smaug/core/backend.h"
+#include "smaug/core/backend_placement.h"
+#include "smaug/core/globals.h"
 #include "smaug/core/graph.pb.h"
 #include "smaug/core/network.h"
 #include "smaug/core/network_builder.h"
@@ -14,10 +19,12 @@
 #include "smaug/core/tensor.pb.h"
 #include "smaug/core/types.pb.h"
 #include "smaug/core/workspace.h"
+#include "smaug/operators/attention_op.h"
 #include "smaug/operators/batch_norm_op.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/concat_op.h"
 #include "smaug/operators/control_flow_ops.h"
+#include "smaug/operators/convert_op.h"
 #include "smaug/operators/convolution_op.h"
 #include "smaug/operators/data_op.h"
 #include "smaug/operators/depthwise_convolution_op.h"
@@ -34,6 +41,7 @@
 #include "smaug/operators/repeat_op.h"
 #include "smaug/operators/reshape_op.h"
 #include "smaug/operators/sigmoid_op.h"
+#include "smaug/operators/smv/smv_attention_op.h"
 #include "smaug/operators/smv/smv_batch_norm_op.h"
 #include "smaug/operators/smv/smv_convolution_op.h"
 #include "smaug/operators/smv/smv_eltwise_add_op.h"
@@ -97,29 +105,37 @@ ActivationInfo getActivationInfo(const ActivationParams& params) {
 
 // Create an operator by deserializing a node in the graph, and add it to the
 // network.
+//
+// The tensor of a Data operator is looked up in, or added to, paramsWorkspace,
+// which may be shared with other networks built from the same model.
 template <typename Backend>
 static void createAndAddOperator(const NodeProto& node,
                                  const TensorDataArray& tensorDataArray,
                                  HostMemoryAccessPolicy memPolicy,
                                  Network* network,
-                                 Workspace* workspace) {
+                                 Workspace* workspace,
+                                 Workspace* paramsWorkspace) {
     const std::string& name = node.name();
     OpType type = node.op();
 
     dout(0) << "Adding " << name << " (" << OpType_Name(type) << ").\n";
 
     if (type == OpType::Data) {
-        // Find the tensor data from the tensor data array.
-        TensorData tensorData;
-        for (int i = 0; i < tensorDataArray.data_array_size(); i++) {
-            if (tensorDataArray.data_array(i).name() ==
-                node.input_tensors(0).name()) {
-                tensorData = tensorDataArray.data_array(i);
-                break;
+        Tensor* inputTensor =
+                paramsWorkspace->getTensor(node.input_tensors(0).name());
+        if (!inputTensor) {
+            // Find the tensor data from the tensor data array.
+            TensorData tensorData;
+            for (int i = 0; i < tensorDataArray.data_array_size(); i++) {
+                if (tensorDataArray.data_array(i).name() ==
+                    node.input_tensors(0).name()) {
+                    tensorData = tensorDataArray.data_array(i);
+                    break;
+                }
             }
+            inputTensor = paramsWorkspace->addTensor(
+                    new Tensor(node.input_tensors(0), tensorData));
         }
-        auto inputTensor = workspace->addTensor(
-                new Tensor(node.input_tensors(0), tensorData));
         auto inputTensorOp = Backend::createDataOp(name, workspace);
         inputTensorOp->setData(inputTensor);
         network->addOperator(inputTensorOp);
@@ -271,6 +287,12 @@ static void createAndAddOperator(const NodeProto& node,
     } else if (type == OpType::HardTanh) {
         auto op = Backend::createHardTanhOp(name, workspace);
         network->addOperator(op);
+    } else if (type == OpType::Convert) {
+        auto op = Backend::createConvertOp(name, workspace);
+        network->addOperator(op);
+    } else if (type == OpType::Attention) {
+        auto op = Backend::createAttentionOp(name, workspace);
+        network->addOperator(op);
     } else if (type == OpType::UnknownOp) {
         assert(false && "Invalid operator type!");
     }
@@ -312,22 +334,107 @@ static void createAndAddOperator(const NodeProto& node,
     }
 }
 
+// Returns true if the given input of an operator of this type is one of its
+// parameters (e.g. the weights of a convolution), rather than an activation.
+static bool isParameterInput(OpType type, int index) {
+    switch (type) {
+        case OpType::Convolution3d:
+        case OpType::ConvolutionDepthwise:
+            return index == ConvolutionOp<ReferenceBackend>::Kernels;
+        case OpType::InnerProduct:
+            return index == InnerProductOp<ReferenceBackend>::Weights;
+        case OpType::BatchNorm:
+            return index != BatchNormOp<ReferenceBackend>::Inputs;
+        case OpType::Attention:
+            return index == AttentionOp<ReferenceBackend>::AlignmentWeights;
+        default:
+            return false;
+    }
+}
+
+// Returns the names of the Data nodes that are constant parameters: every
+// consumer of their tensor uses it as a parameter input, either directly or
+// through data movement operators (like the reorders and the conversions that
+// backend placement inserts in front of the weights). State variables are
+// never parameters, as they change from one inference to another.
+static std::set<std::string> findParameterNodes(const GraphProto& graphProto) {
+    std::map<std::string, std::vector<std::pair<const NodeProto*, int>>>
+            consumers;
+    for (int i = 0; i < graphProto.nodes_size(); i++) {
+        const NodeProto& node = graphProto.nodes(i);
+        for (int j = 0; j < node.parents_size(); j++)
+            consumers[node.parents(j)].push_back({ &node, j });
+    }
+    std::map<std::string, bool> visited;
+    std::function<bool(const std::string&)> onlyParameters =
+            [&](const std::string& name) {
+                auto it = visited.find(name);
+                if (it != visited.end())
+                    return it->second;
+                auto users = consumers.find(name);
+                // Unused nodes are not known to be parameters.
+                bool result = users != consumers.end();
+                for (int i = 0; result && i < users->second.size(); i++) {
+                    const NodeProto* user = users->second[i].first;
+                    OpType type = user->op();
+                    bool dataMovement = type == OpType::Reorder ||
+                                        type == OpType::Reshape ||
+                                        type == OpType::Repeat ||
+                                        type == OpType::Convert;
+                    result = isParameterInput(type, users->second[i].second) ||
+                             (dataMovement && onlyParameters(user->name()));
+                }
+                visited[name] = result;
+                return result;
+            };
+    std::set<std::string> parameterNodes;
+    for (int i = 0; i < graphProto.nodes_size(); i++) {
+        const NodeProto& node = graphProto.nodes(i);
+        if (node.op() == OpType::Data && onlyParameters(node.name()))
+            parameterNodes.insert(node.name());
+    }
+    for (int i = 0; i < graphProto.state_variables_size(); i++)
+        parameterNodes.erase(graphProto.state_variables(i).state_node());
+    return parameterNodes;
+}
+
 // Create the network by deserializing the graph stored in the
-// protobuf model.
-template <typename Backend>
+// protobuf model. Every node is created on the backend it is placed on, which
+// lowerBackendPlacement() has filled in.
 static Network* createNetworkFromProto(const GraphProto& graphProto,
                                        const TensorDataArray& tensorDataArray,
                                        SamplingInfo& sampling,
-                                       Workspace* workspace) {
+                                       Workspace* workspace,
+                                       Workspace* sharedParams) {
     Network* network = new Network(graphProto.name());
     network->setSamplingInfo(sampling);
+    // Only constant parameters can be shared between networks. Everything
+    // else, like the inputs of the network, changes from one inference to
+    // another.
+    std::set<std::string> parameterNodes;
+    if (sharedParams)
+        parameterNodes = findParameterNodes(graphProto);
     for (int i = 0; i < graphProto.nodes_size(); i++) {
         const NodeProto& node = graphProto.nodes(i);
-        createAndAddOperator<Backend>(node,
-                                      tensorDataArray,
-                                      graphProto.mem_policy(),
-                                      network,
-                                      workspace);
+        bool shared = parameterNodes.count(node.name()) > 0;
+        Workspace* paramsWorkspace = shared ? sharedParams : workspace;
+        if (node.backend() == ReferenceBackend::Name) {
+            createAndAddOperator<ReferenceBackend>(node,
+                                                   tensorDataArray,
+                                                   graphProto.mem_policy(),
+                                                   network,
+                                                   workspace,
+                                                   paramsWorkspace);
+        } else if (node.backend() == SmvBackend::Name) {
+            createAndAddOperator<SmvBackend>(node,
+                                             tensorDataArray,
+                                             graphProto.mem_policy(),
+                                             network,
+                                             workspace,
+                                             paramsWorkspace);
+        } else {
+            assert(false && "Unknown backend!");
+        }
     }
 
     // Now every operator has been added into the network, we can connect them
@@ -364,49 +471,66 @@ static Network* createNetworkFromProto(const GraphProto& graphProto,
         }
     }
 
+    // Bind the state variables to the operators that update them.
+    for (int i = 0; i < graphProto.state_variables_size(); i++) {
+        const StateVariableProto& var = graphProto.state_variables(i);
+        network->addStateVariable(network->getOperator(var.state_node()),
+                                  network->getOperator(var.update_node()),
+                                  var.update_output_index());
+    }
+
+    // The frontend may insert the same layout transformation or broadcast for
+    // several consumers of a tensor. Merge the duplicates, and drop whatever
+    // no longer contributes to the outputs of the network.
+    network->eliminateCommonSubexpressions();
+    network->eliminateDeadOperators();
+    // Pool the results of a convolution in its own kernel, instead of sending
+    // them back and tiling them again for the pooling operator.
+    network->fuseConvolutionPooling();
+
     return network;
 }
 
-Network* smaug::buildNetwork(const std::string& modelTopo,
-                             const std::string& modelParams,
-                             SamplingInfo& sampling,
-                             Workspace* workspace) {
+void smaug::loadModel(const std::string& modelTopo,
+                      const std::string& modelParams,
+                      GraphProto* graph,
+                      TensorDataArray* tensorDataArray) {
     // Parse the network topology from the protobuf text file.
-    GraphProto graph;
     int modelTopoDescriptor = open(modelTopo.c_str(), O_RDONLY);
     if (modelTopoDescriptor < 0) {
         cout << modelTopo << ": network topology file not found." << endl;
         exit(1);
     }
     google::protobuf::io::FileInputStream modelTopoInput(modelTopoDescriptor);
-    if (!google::protobuf::TextFormat::Parse(&modelTopoInput, &graph)) {
+    if (!google::protobuf::TextFormat::Parse(&modelTopoInput, graph)) {
         cout << "Failed to parse the network topology file!" << endl;
         exit(1);
     }
     // Parse the network parameters from the protobuf binary file.
-    TensorDataArray tensorDataArray;
     fstream modelParamsFile(modelParams, ios::in | ios::binary);
     if (!modelParamsFile) {
         cout << modelParams << ": network parameters file not found." << endl;
         exit(1);
-    } else if (!tensorDataArray.ParseFromIstream(&modelParamsFile)) {
+    } else if (!tensorDataArray->ParseFromIstream(&modelParamsFile)) {
         cout << "Failed to parse the network parameters file.\n";
         exit(1);
     }
+}
 
+Network* smaug::buildNetwork(const GraphProto& graph,
+                             const TensorDataArray& tensorDataArray,
+                             SamplingInfo& sampling,
+                             Workspace* workspace,
+                             Workspace* sharedParams) {
     cout << "======================================================\n";
     cout << "      Loading the network model...\n";
     cout << "======================================================\n";
-    Network* network = nullptr;
-    if (graph.backend() == ReferenceBackend::Name) {
-        network = createNetworkFromProto<ReferenceBackend>(
-                graph, tensorDataArray, sampling, workspace);
-    } else if (graph.backend() == SmvBackend::Name) {
-        network = createNetworkFromProto<SmvBackend>(
-                graph, tensorDataArray, sampling, workspace);
-    } else {
-        assert(false && "Unknown backend!");
-    }
+    GraphProto lowered = graph;
+    lowerBackendPlacement(&lowered);
+    if (useFp16ReferenceStorage)
+        lowerReferenceToFp16Storage(&lowered);
+    Network* network = createNetworkFromProto(
+            lowered, tensorDataArray, sampling, workspace, sharedParams);
 
     cout << "======================================================\n";
     cout << "      Summary of the network.\n";
@@ -414,3 +538,13 @@ Network* smaug::buildNetwork(const std::string& modelTopo,
     network->printSummary();
     return network;
 }
+
+Network* smaug::buildNetwork(const std::string& modelTopo,
+                             const std::string& modelParams,
+                             SamplingInfo& sampling,
+                             Workspace* workspace) {
+    GraphProto graph;
+    TensorDataArray tensorDataArray;
+    loadModel(modelTopo, modelParams, &graph, &tensorDataArray);
+    return buildNetwork(graph, tensorDataArray, sampling, workspace);
+}
@@ -3,6 +3,8 @@
 
 #include <string>
 
+#include "smaug/core/graph.pb.h"
+#include "smaug/core/tensor.pb.h"
 #include "smaug/core/workspace.h"
 #include "smaug/core/network.h"
 #include "smaug/operators/common.h"
@@ -25,6 +27,38 @@ Network* buildNetwork(const std::string& modelTopoFile,
                       const std::string& modelParamsFile,
                       SamplingInfo& sampling,
                       Workspace* workspace);
+
+/**
+ * Reads the model topology and parameters protobufs without building a
+ * Network, so that several Networks can be built from one loaded model.
+ */
+void loadModel(const std::string& modelTopoFile,
+               const std::string& modelParamsFile,
+               GraphProto* graph,
+               TensorDataArray* tensorDataArray);
+
+/**
+ * Builds a Network from a loaded model.
+ *
+ * To run several inferences concurrently, build one Network per inference,
+ * each in its own Workspace, all from the same loaded model and with the same
+ * sharedParams. The constant parameters are then loaded once into
+ * sharedParams and only read by the Networks, while the network inputs,
+ * state variables, activations and tiles are private to each Network. The
+ * Networks must be built one at a time, and sharedParams must outlive them.
+ *
+ * @param graph The model topology.
+ * @param tensorDataArray The model parameters.
+ * @param sampling Level of simulation sampling to apply to applicable kernels.
+ * @param workspace The Workspace holding the tensors of this Network.
+ * @param sharedParams If not null, the Workspace holding the parameters shared
+ * by all the Networks built from this model.
+ */
+Network* buildNetwork(const GraphProto& graph,
+                      const TensorDataArray& tensorDataArray,
+                      SamplingInfo& sampling,
+                      Workspace* workspace,
+                      Workspace* sharedParams = nullptr);
 }  // namespace smaug
 
 #endif
@@ -1,8 +1,30 @@
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
 #include "catch.hpp"
 #include "smaug/core/backend.h"
+#include "smaug/core/backend_placement.h"
+#include "smaug/core/execution_context.h"
+#include "smaug/core/globals.h"
+#include "smaug/core/network_builder.h"
+#include "smaug/core/scheduler.h"
 #include "smaug/core/tensor.h"
 #include "smaug/core/smaug_test.h"
+#include "smaug/operators/control_flow_ops.h"
+#include "smaug/operators/convert_op.h"
+#include "smaug/operators/data_op.h"
+#include "smaug/operators/eltwise_add_op.h"
+#include "smaug/operators/pooling_op.h"
+#include "smaug/operators/relu_op.h"
 #include "smaug/operators/reorder_op.h"
+#include "smaug/operators/reshape_op.h"
+#include "smaug/operators/sigmoid_op.h"
+#include "smaug/operators/tanh_op.h"
+#include "smaug/operators/smv/smv_convolution_op.h"
+#include "smaug/operators/smv/smv_pooling_op.h"
+#include "smaug/operators/smv/smv_systolic_array.h"
+#include "smaug/operators/smv/smv_test_common.h"
 
 using namespace smaug;
 
@@ -130,3 +152,864 @@ TEST_CASE_METHOD(SmaugTest, "Network tests", "[network]") {
                 convertFp16ToFp32Tensor(output, workspace()), refOutput);
     }
 }
+
+TEST_CASE_METHOD(SmaugTest, "Network state variables", "[network][state]") {
+    // A running sum: every run adds the input to the state.
+    TensorShape shape({ 1, 8 }, DataLayout::NC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    input->fillData<float>({ 1, 2, 3, 4, 5, 6, 7, 8 });
+    Tensor* state = workspace()->addTensor(new Tensor("state", shape));
+    state->allocateStorage<float>();
+    state->fillData<float>({ 0, 0, 0, 0, 0, 0, 0, 0 });
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    auto stateOp = new DataOp<ReferenceBackend>("state_data", workspace());
+    stateOp->setData(state);
+    auto addOp = new EltwiseAddOp<ReferenceBackend>("add", workspace());
+    addOp->setInput(input, 0);
+    addOp->setInput(state, 1);
+    addOp->createAllTensors();
+    addOp->getOutput(0)->allocateStorage<float>();
+    network()->addOperator(inputOp);
+    network()->addOperator(stateOp);
+    network()->addOperator(addOp);
+    network()->addEdge(inputOp, addOp, { 0, 0 });
+    network()->addEdge(stateOp, addOp, { 0, 1 });
+    network()->addStateVariable(stateOp, addOp, 0);
+
+    // Returns the input scaled by the given factor.
+    int numExpected = 0;
+    auto scaledInput = [&](float factor) {
+        Tensor* expected = new Tensor(
+                "expected" + std::to_string(numExpected++), shape);
+        expected->allocateStorage<float>();
+        float* data = expected->data<float>();
+        for (int i = 0; i < 8; i++)
+            data[i] = (i + 1) * factor;
+        return workspace()->addTensor(expected);
+    };
+
+    Scheduler scheduler(network(), workspace());
+    SECTION("States carry over to the next run") {
+        scheduler.runNetwork();
+        scheduler.runNetwork();
+        Tensor* output = scheduler.runNetwork();
+        verifyOutputs<float>(output, scaledInput(3));
+        verifyOutputs<float>(state, scaledInput(3));
+    }
+
+    SECTION("Reset and snapshot states") {
+        scheduler.runNetwork();
+        scheduler.runNetwork();
+        TensorProtoArray snapshot;
+        network()->snapshotStates(&snapshot);
+        REQUIRE(snapshot.tensors_size() == 1);
+        REQUIRE(snapshot.tensors(0).name() == "state");
+
+        network()->resetStates();
+        verifyOutputs<float>(state, scaledInput(0));
+        Tensor* output = scheduler.runNetwork();
+        verifyOutputs<float>(output, scaledInput(1));
+
+        REQUIRE(network()->restoreStates(snapshot));
+        output = scheduler.runNetwork();
+        verifyOutputs<float>(output, scaledInput(3));
+    }
+
+    SECTION("Snapshots that don't match the states are rejected") {
+        scheduler.runNetwork();
+        TensorProtoArray snapshot;
+        network()->snapshotStates(&snapshot);
+        TensorProto* proto = snapshot.mutable_tensors(0);
+        SECTION("Shape") { proto->mutable_shape()->set_dims(1, 16); }
+        SECTION("Data type") { proto->set_data_type(Float64); }
+        SECTION("Number of elements") {
+            proto->mutable_data()->mutable_float_data()->Add(0);
+        }
+        REQUIRE(!network()->restoreStates(snapshot));
+        verifyOutputs<float>(state, scaledInput(1));
+    }
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Eliminate duplicate data movement operators",
+                 "[network][cse]") {
+    // Two identical chains of reorder and reshape of the same input feed an
+    // addition. An unused Data operator is left dangling.
+    TensorShape shape({ 1, 2, 2, 2 }, DataLayout::NCHW);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    input->fillData<float>({ 0, 1, 2, 3, 4, 5, 6, 7 });
+    Tensor* unused = workspace()->addTensor(new Tensor("unused", shape));
+    unused->allocateStorage<float>();
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    auto unusedOp = new DataOp<ReferenceBackend>("unused_data", workspace());
+    unusedOp->setData(unused);
+    network()->addOperator(inputOp);
+    network()->addOperator(unusedOp);
+    std::vector<Operator*> reshapeOps;
+    for (int i = 0; i < 2; i++) {
+        auto reorderOp = new ReorderOp<ReferenceBackend>(
+                "reorder" + std::to_string(i), DataLayout::NHWC, workspace());
+        reorderOp->setInput(input, 0);
+        reorderOp->createAllTensors();
+        reorderOp->getOutput(0)->allocateStorage<float>();
+        auto reshapeOp = new ReshapeOp<ReferenceBackend>(
+                "reshape" + std::to_string(i), workspace(),
+                std::vector<int>{ 1, 8 }, DataLayout::NC);
+        reshapeOp->setInput(reorderOp->getOutput(0), 0);
+        reshapeOp->createAllTensors();
+        reshapeOp->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(reorderOp);
+        network()->addOperator(reshapeOp);
+        network()->addEdge(inputOp, reorderOp, { 0, 0 });
+        network()->addEdge(reorderOp, reshapeOp, { 0, 0 });
+        reshapeOps.push_back(reshapeOp);
+    }
+    auto addOp = new EltwiseAddOp<ReferenceBackend>("add", workspace());
+    addOp->setInput(reshapeOps[0]->getOutput(0), 0);
+    addOp->setInput(reshapeOps[1]->getOutput(0), 1);
+    addOp->createAllTensors();
+    addOp->getOutput(0)->allocateStorage<float>();
+    network()->addOperator(addOp);
+    network()->addEdge(reshapeOps[0], addOp, { 0, 0 });
+    network()->addEdge(reshapeOps[1], addOp, { 0, 1 });
+
+    REQUIRE(network()->eliminateCommonSubexpressions() == 2);
+    // Only one of each duplicate survives, along with its output tensor.
+    const auto& ops = network()->getOperators();
+    REQUIRE(ops.count("reorder0") + ops.count("reorder1") == 1);
+    REQUIRE(ops.count("reshape0") + ops.count("reshape1") == 1);
+    REQUIRE((workspace()->getTensor("reorder0") == nullptr) !=
+            (workspace()->getTensor("reorder1") == nullptr));
+    REQUIRE(addOp->getInput(0) == addOp->getInput(1));
+    REQUIRE(network()->eliminateDeadOperators() == 1);
+    REQUIRE(ops.count("unused_data") == 0);
+    REQUIRE(num_vertices(network()->getGraph()) == 4);
+    for (auto& iter : ops) {
+        Operator* op = iter.second;
+        REQUIRE(get(boost::vertex_op, network()->getGraph(),
+                    op->getVertex()) == op);
+    }
+
+    Scheduler scheduler(network(), workspace());
+    Tensor* output = scheduler.runNetwork();
+    Tensor* expected = workspace()->addTensor(
+            new Tensor("expected", TensorShape({ 1, 8 }, DataLayout::NC)));
+    expected->allocateStorage<float>();
+    expected->fillData<float>({ 0, 8, 2, 10, 4, 12, 6, 14 });
+    verifyOutputs<float>(output, expected);
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Eliminate operators that don't reach the output",
+                 "[network][dce]") {
+    // A tanh and a ReLU hang off the input without feeding the sigmoid, which
+    // is the last operator and thus the output of the network.
+    TensorShape shape({ 1, 8 }, DataLayout::NC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    input->fillData<float>({ -4, -3, -2, -1, 0, 1, 2, 3 });
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    network()->addOperator(inputOp);
+    auto addOperator = [&](Operator* op, Operator* producer) {
+        op->setInput(producer->getOutput(0), 0);
+        op->createAllTensors();
+        op->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(op);
+        network()->addEdge(producer, op, { 0, 0 });
+        return op;
+    };
+    Operator* tanhOp = addOperator(
+            new TanhOp<ReferenceBackend>("tanh", workspace()), inputOp);
+    Operator* reluOp = addOperator(
+            new ReluOp<ReferenceBackend>("relu", workspace()), tanhOp);
+    Operator* sigmoidOp = addOperator(
+            new SigmoidOp<ReferenceBackend>("sigmoid", workspace()), inputOp);
+    const auto& ops = network()->getOperators();
+
+    SECTION("The unused branch is removed") {
+        REQUIRE(network()->getOutputOperators() ==
+                std::vector<Operator*>{ sigmoidOp });
+        REQUIRE(network()->eliminateDeadOperators() == 2);
+        REQUIRE(ops.count("tanh") == 0);
+        REQUIRE(ops.count("relu") == 0);
+        REQUIRE(workspace()->getTensor("tanh") == nullptr);
+        REQUIRE(workspace()->getTensor("relu") == nullptr);
+        REQUIRE(num_vertices(network()->getGraph()) == 2);
+
+        Scheduler scheduler(network(), workspace());
+        REQUIRE(scheduler.runNetwork() == sigmoidOp->getOutput(0));
+    }
+
+    SECTION("Marked outputs are kept") {
+        network()->markOutput(reluOp);
+        network()->markOutput(sigmoidOp);
+        REQUIRE(network()->eliminateDeadOperators() == 0);
+        REQUIRE(num_vertices(network()->getGraph()) == 4);
+    }
+
+    SECTION("Only the marked outputs are live") {
+        network()->markOutput(tanhOp);
+        REQUIRE(network()->eliminateDeadOperators() == 2);
+        REQUIRE(ops.count("tanh") == 1);
+        REQUIRE(ops.count("relu") == 0);
+        REQUIRE(ops.count("sigmoid") == 0);
+    }
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Fuse pooling into SMV convolutions",
+                 "[network][fusion]") {
+    TensorShape shape({ 1, 8, 8, 8 }, DataLayout::NHWC, SmvBackend::Alignment);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float16>();
+    fillTensorWithRandomData(input);
+    auto inputOp = new DataOp<SmvBackend>("input_data", workspace());
+    inputOp->setData(input);
+    auto convOp = new SmvConvolutionOp("conv", workspace());
+    convOp->setActivation(ActivationInfo(activation_type::RELU));
+    convOp->setStride(1, 1);
+    convOp->setPadding(SamePadding);
+    convOp->setWeightDims(3, 3, 8);
+    convOp->setInput(input, 0);
+    createAndFillTensorsWithData<float16>(convOp, fillTensorWithRandomData);
+    auto poolOp = new SmvMaxPoolingOp("pool", workspace());
+    poolOp->setPoolingSize(2, 2);
+    poolOp->setPoolingStride(2, 2);
+    poolOp->setInput(convOp->getOutput(0), 0);
+    poolOp->createAllTensors();
+    poolOp->getOutput(0)->allocateStorage<float16>();
+    network()->addOperator(inputOp);
+    network()->addOperator(convOp);
+    network()->addOperator(poolOp);
+    network()->addEdge(inputOp, convOp, { 0, 0 });
+    network()->addEdge(convOp, poolOp, { 0, 0 });
+
+    Scheduler unfused(network(), workspace());
+    Tensor* expected =
+            convertFp16ToFp32Tensor(unfused.runNetwork(), workspace());
+
+    REQUIRE(network()->fuseConvolutionPooling() == 1);
+    // The convolution writes the pooled outputs, and its unpooled outputs are
+    // gone with the pooling operator.
+    REQUIRE(network()->getOperators().count("pool") == 0);
+    REQUIRE(convOp->hasFusedPooling());
+    REQUIRE(workspace()->getTensor("conv") == nullptr);
+    REQUIRE(convOp->getOutput(0)->getShape().dims() ==
+            std::vector<int>{ 1, 4, 4, 8 });
+    REQUIRE(num_vertices(network()->getGraph()) == 2);
+
+    Scheduler fused(network(), workspace());
+    Tensor* output = fused.runNetwork();
+    verifyOutputs<float>(convertFp16ToFp32Tensor(output, workspace()),
+                         expected);
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Memory-minimizing scheduling policies",
+                 "[network][scheduling]") {
+    // Four branches of a large ReLU output pooled down to a small one, summed
+    // up in a chain. Running the branches breadth-first keeps all the ReLU
+    // outputs live at once.
+    TensorShape shape({ 1, 8, 8, 8 }, DataLayout::NHWC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    std::vector<float> inputData(shape.size());
+    for (int i = 0; i < inputData.size(); i++)
+        inputData[i] = (i % 7) - 3;
+    input->fillData(inputData.data(), inputData.size());
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    network()->addOperator(inputOp);
+    Operator* sumOp = nullptr;
+    for (int i = 0; i < 4; i++) {
+        auto reluOp = new ReluOp<ReferenceBackend>(
+                "relu" + std::to_string(i), workspace());
+        reluOp->setInput(input, 0);
+        reluOp->createAllTensors();
+        reluOp->getOutput(0)->allocateStorage<float>();
+        auto poolOp = new MaxPoolingOp<ReferenceBackend>(
+                "pool" + std::to_string(i), workspace());
+        poolOp->setPoolingSize(2, 2);
+        poolOp->setPoolingStride(2, 2);
+        poolOp->setInput(reluOp->getOutput(0), 0);
+        poolOp->createAllTensors();
+        poolOp->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(reluOp);
+        network()->addOperator(poolOp);
+        network()->addEdge(inputOp, reluOp, { 0, 0 });
+        network()->addEdge(reluOp, poolOp, { 0, 0 });
+        if (!sumOp) {
+            sumOp = poolOp;
+            continue;
+        }
+        auto addOp = new EltwiseAddOp<ReferenceBackend>(
+                "add" + std::to_string(i), workspace());
+        addOp->setInput(sumOp->getOutput(0), 0);
+        addOp->setInput(poolOp->getOutput(0), 1);
+        addOp->createAllTensors();
+        addOp->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(addOp);
+        network()->addEdge(sumOp, addOp, { 0, 0 });
+        network()->addEdge(poolOp, addOp, { 0, 1 });
+        sumOp = addOp;
+    }
+
+    // A ReLU output is 2048 bytes, and a pooled or summed output is 512.
+    Scheduler scheduler(network(), workspace());
+    REQUIRE(scheduler.estimatePeakLiveBytes(FifoScheduling) == 4 * 2048 + 512);
+    REQUIRE(scheduler.estimatePeakLiveBytes(GreedyMemoryScheduling) ==
+            2048 + 2 * 512);
+    REQUIRE(scheduler.estimatePeakLiveBytes(MinMemoryScheduling) ==
+            2048 + 2 * 512);
+
+    Tensor* output = scheduler.runNetwork();
+    REQUIRE(scheduler.getPeakLiveBytes() == 4 * 2048 + 512);
+    float* outputData = output->data<float>();
+    std::vector<float> expected(
+            outputData, outputData + output->getShape().size());
+    for (SchedulingPolicy policy :
+         { GreedyMemoryScheduling, MinMemoryScheduling }) {
+        scheduler.setPolicy(policy);
+        output = scheduler.runNetwork();
+        REQUIRE(output == sumOp->getOutput(0));
+        REQUIRE(scheduler.getPeakLiveBytes() ==
+                scheduler.estimatePeakLiveBytes(policy));
+        verifyOutputs(output, expected);
+    }
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Recomputing activations under a memory budget",
+                 "[network][scheduling]") {
+    // The ReLU output skips over a branch that keeps three other outputs live
+    // at once, and is only added back at the end. Every output is 2048 bytes.
+    TensorShape shape({ 1, 8, 8, 8 }, DataLayout::NHWC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    std::vector<float> inputData(shape.size());
+    for (int i = 0; i < inputData.size(); i++)
+        inputData[i] = ((i % 9) - 4) * 0.25;
+    input->fillData(inputData.data(), inputData.size());
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    network()->addOperator(inputOp);
+    auto addOperator = [&](Operator* op, std::vector<Operator*> producers) {
+        for (int i = 0; i < producers.size(); i++)
+            op->setInput(producers[i]->getOutput(0), i);
+        op->createAllTensors();
+        op->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(op);
+        for (int i = 0; i < producers.size(); i++)
+            network()->addEdge(producers[i], op, { 0, i });
+        return op;
+    };
+    Operator* reluOp = addOperator(
+            new ReluOp<ReferenceBackend>("relu", workspace()), { inputOp });
+    Operator* tanhOp = addOperator(
+            new TanhOp<ReferenceBackend>("tanh", workspace()), { inputOp });
+    Operator* sigmoidOp0 = addOperator(
+            new SigmoidOp<ReferenceBackend>("sigmoid0", workspace()),
+            { tanhOp });
+    Operator* addOp0 = addOperator(
+            new EltwiseAddOp<ReferenceBackend>("add0", workspace()),
+            { tanhOp, sigmoidOp0 });
+    Operator* sigmoidOp1 = addOperator(
+            new SigmoidOp<ReferenceBackend>("sigmoid1", workspace()),
+            { addOp0 });
+    Operator* addOp1 = addOperator(
+            new EltwiseAddOp<ReferenceBackend>("add1", workspace()),
+            { reluOp, sigmoidOp1 });
+
+    Scheduler scheduler(network(), workspace());
+    REQUIRE(scheduler.estimatePeakLiveBytes(FifoScheduling) == 4 * 2048);
+    Tensor* output = scheduler.runNetwork();
+    float* outputData = output->data<float>();
+    std::vector<float> expected(
+            outputData, outputData + output->getShape().size());
+
+    SECTION("The ReLU output is recomputed before the last addition") {
+        scheduler.setMemoryBudget(3 * 2048);
+        const RecomputePlan& plan = scheduler.getRecomputePlan();
+        // Run twice, since the storage is managed across runs.
+        for (int run = 0; run < 2; run++) {
+            output = scheduler.runNetwork();
+            REQUIRE(plan.withinBudget());
+            REQUIRE(plan.peakBytesBefore == 4 * 2048);
+            REQUIRE(plan.peakBytesAfter == 3 * 2048);
+            REQUIRE(plan.numRecomputedOutputs == 1);
+            REQUIRE(plan.extraFlops == shape.size());
+            REQUIRE(plan.recomputeBefore.at(addOp1->getVertex()) ==
+                    std::vector<Operator*>{ reluOp });
+            REQUIRE(scheduler.getPeakLiveBytes() == 3 * 2048);
+            REQUIRE(output == addOp1->getOutput(0));
+            verifyOutputs(output, expected);
+            // Only the output of the network is still allocated.
+            REQUIRE(!reluOp->getOutput(0)->containsData());
+            REQUIRE(!sigmoidOp1->getOutput(0)->containsData());
+        }
+    }
+
+    SECTION("A budget that can't be met is reported") {
+        scheduler.setMemoryBudget(2 * 2048);
+        output = scheduler.runNetwork();
+        const RecomputePlan& plan = scheduler.getRecomputePlan();
+        REQUIRE(!plan.withinBudget());
+        REQUIRE(plan.peakBytesAfter == 3 * 2048);
+        REQUIRE(scheduler.getPeakLiveBytes() == 3 * 2048);
+        verifyOutputs(output, expected);
+    }
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Converted weights under a memory budget",
+                 "[network][scheduling]") {
+    // An SMV weight in float16 is converted for a Reference addition. The
+    // conversion is cached across runs, so it must never be released.
+    TensorShape shape({ 1, 8, 8, 8 }, DataLayout::NHWC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    std::vector<float> inputData(shape.size());
+    for (int i = 0; i < inputData.size(); i++)
+        inputData[i] = ((i % 9) - 4) * 0.25;
+    input->fillData(inputData.data(), inputData.size());
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    network()->addOperator(inputOp);
+    TensorShape weightShape(
+            { 1, 8, 8, 8 }, DataLayout::NHWC, SmvBackend::Alignment);
+    Tensor* weight = workspace()->addTensor(new Tensor("weight", weightShape));
+    weight->allocateStorage<float16>();
+    fillTensorWithFixedData(weight);
+    auto weightOp = new DataOp<SmvBackend>("weight_data", workspace());
+    weightOp->setData(weight);
+    network()->addOperator(weightOp);
+    auto convertOp = new ConvertOp<ReferenceBackend>("convert", workspace());
+    Tensor* converted =
+            workspace()->addTensor(new Tensor("converted", shape));
+    converted->allocateStorage<float>();
+    convertOp->setInput(weight, 0);
+    convertOp->setOutput(converted, 0);
+    network()->addOperator(convertOp);
+    network()->addEdge(weightOp, convertOp, { 0, 0 });
+    auto reluOp = new ReluOp<ReferenceBackend>("relu", workspace());
+    reluOp->setInput(input, 0);
+    reluOp->createAllTensors();
+    reluOp->getOutput(0)->allocateStorage<float>();
+    network()->addOperator(reluOp);
+    network()->addEdge(inputOp, reluOp, { 0, 0 });
+    auto addOp = new EltwiseAddOp<ReferenceBackend>("add", workspace());
+    addOp->setInput(reluOp->getOutput(0), 0);
+    addOp->setInput(converted, 1);
+    addOp->createAllTensors();
+    addOp->getOutput(0)->allocateStorage<float>();
+    network()->addOperator(addOp);
+    network()->addEdge(reluOp, addOp, { 0, 0 });
+    network()->addEdge(convertOp, addOp, { 0, 1 });
+
+    Scheduler scheduler(network(), workspace());
+    Tensor* output = scheduler.runNetwork();
+    float* outputData = output->data<float>();
+    std::vector<float> expected(
+            outputData, outputData + output->getShape().size());
+
+    scheduler.setMemoryBudget(2048);
+    for (int run = 0; run < 2; run++) {
+        output = scheduler.runNetwork();
+        REQUIRE(!scheduler.getRecomputePlan().releases(converted));
+        REQUIRE(converted->containsData());
+        REQUIRE(!reluOp->getOutput(0)->containsData());
+        verifyOutputs(output, expected);
+    }
+}
+
+TEST_CASE("Execution contexts bind to the calling thread",
+          "[network][context]") {
+    int prevNumAccels = numAcceleratorsAvailable;
+    bool prevFastForward = fastForwardMode;
+    ExecutionContext context;
+    context.numAcceleratorsAvailable = 3;
+    context.fastForwardMode = true;
+    {
+        auto scope = ExecutionContext::Scope(&context);
+        REQUIRE(numAcceleratorsAvailable == 3);
+        // Other threads keep their own settings.
+        int otherNumAccels = -1;
+        std::thread other([&]() { otherNumAccels = numAcceleratorsAvailable; });
+        other.join();
+        REQUIRE(otherNumAccels != 3);
+        fastForwardMode = false;
+    }
+    // Changes made while bound are kept by the context.
+    REQUIRE(context.fastForwardMode == false);
+    REQUIRE(numAcceleratorsAvailable == prevNumAccels);
+    REQUIRE(fastForwardMode == prevFastForward);
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Systolic array cycles are recorded per context",
+                 "[network][context]") {
+    ExecutionContext context0;
+    ExecutionContext context1;
+    context0.systolicArrayRecords.clear();
+    context1.systolicArrayRecords.clear();
+    context1.systolicArrayConfig.rows = 16;
+    {
+        auto scope = ExecutionContext::Scope(&context0);
+        smv::SystolicArray::recordLayer("conv0", smv::SystolicArray::Cycles());
+        // A context bound on another thread has its own configuration and
+        // records.
+        int otherRows = -1;
+        std::thread other([&]() {
+            auto otherScope = ExecutionContext::Scope(&context1);
+            otherRows = smv::SystolicArray::getConfig().rows;
+            smv::SystolicArray::recordLayer(
+                    "conv1", smv::SystolicArray::Cycles());
+        });
+        other.join();
+        REQUIRE(otherRows == 16);
+        REQUIRE(smv::SystolicArray::getConfig().rows == 8);
+        REQUIRE(smv::SystolicArray::getRecords().size() == 1);
+    }
+    REQUIRE(context0.systolicArrayRecords.size() == 1);
+    REQUIRE(context0.systolicArrayRecords[0].name == "conv0");
+    REQUIRE(context1.systolicArrayRecords.size() == 1);
+    REQUIRE(context1.systolicArrayRecords[0].name == "conv1");
+
+    // A run starts without the records of the previous runs.
+    TensorShape shape({ 1, 8 }, DataLayout::NC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    auto reluOp = new ReluOp<ReferenceBackend>("relu", workspace());
+    reluOp->setInput(input, 0);
+    reluOp->createAllTensors();
+    reluOp->getOutput(0)->allocateStorage<float>();
+    network()->addOperator(inputOp);
+    network()->addOperator(reluOp);
+    network()->addEdge(inputOp, reluOp, { 0, 0 });
+    Scheduler scheduler(network(), workspace(), &context0);
+    scheduler.runNetwork();
+    REQUIRE(context0.systolicArrayRecords.empty());
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Concurrent runs of networks sharing parameters",
+                 "[network][context]") {
+    // Each network adds its own input to a shared weight.
+    TensorShape shape({ 1, 8 }, DataLayout::NC);
+    Workspace sharedParams;
+    Tensor* weights = sharedParams.addTensor(new Tensor("weights", shape));
+    weights->allocateStorage<float>();
+    weights->fillData<float>({ 1, 2, 3, 4, 5, 6, 7, 8 });
+
+    constexpr int kNumNetworks = 4;
+    std::vector<std::unique_ptr<Workspace>> workspaces;
+    std::vector<std::unique_ptr<Network>> networks;
+    std::vector<Tensor*> expected;
+    for (int n = 0; n < kNumNetworks; n++) {
+        workspaces.emplace_back(new Workspace());
+        networks.emplace_back(new Network("network" + std::to_string(n)));
+        Workspace* ws = workspaces.back().get();
+        Network* net = networks.back().get();
+        Tensor* input = ws->addTensor(new Tensor("input", shape));
+        input->allocateStorage<float>();
+        Tensor* result = ws->addTensor(new Tensor("expected", shape));
+        result->allocateStorage<float>();
+        for (int i = 0; i < 8; i++) {
+            input->data<float>()[i] = n * 10;
+            result->data<float>()[i] = n * 10 + i + 1;
+        }
+        expected.push_back(result);
+        auto inputOp = new DataOp<ReferenceBackend>("input_data", ws);
+        inputOp->setData(input);
+        auto weightsOp = new DataOp<ReferenceBackend>("weights_data", ws);
+        weightsOp->setData(weights);
+        auto addOp = new EltwiseAddOp<ReferenceBackend>("add", ws);
+        addOp->setInput(input, 0);
+        addOp->setInput(weights, 1);
+        addOp->createAllTensors();
+        addOp->getOutput(0)->allocateStorage<float>();
+        net->addOperator(inputOp);
+        net->addOperator(weightsOp);
+        net->addOperator(addOp);
+        net->addEdge(inputOp, addOp, { 0, 0 });
+        net->addEdge(weightsOp, addOp, { 0, 1 });
+    }
+
+    std::vector<Tensor*> outputs(kNumNetworks, nullptr);
+    std::vector<std::thread> threads;
+    for (int n = 0; n < kNumNetworks; n++) {
+        threads.emplace_back([&, n]() {
+            ExecutionContext context;
+            context.threadPool = nullptr;
+            Scheduler scheduler(
+                    networks[n].get(), workspaces[n].get(), &context);
+            for (int run = 0; run < 10; run++)
+                outputs[n] = scheduler.runNetwork();
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (int n = 0; n < kNumNetworks; n++)
+        verifyOutputs<float>(outputs[n], expected[n]);
+}
+
+// Builds a small SMV graph: a convolution followed by a ReLU.
+static void buildConvReluGraph(GraphProto* graph,
+                               TensorDataArray* tensorDataArray,
+                               Workspace* workspace) {
+    graph->set_name("conv_relu");
+    graph->set_backend(SmvBackend::Name);
+    graph->set_mem_policy(HostMemoryAccessPolicy::AllDma);
+    auto addTensor = [&](const std::string& name, std::vector<int> dims) {
+        Tensor* tensor = workspace->addTensor(new Tensor(
+                name, TensorShape(dims, DataLayout::NHWC, 8)));
+        tensor->allocateStorage<float16>();
+        fillTensorWithRandomData(tensor);
+        TensorProto* tensorProto = tensor->asTensorProto();
+        TensorData* data = tensorDataArray->add_data_array();
+        *data = tensorProto->data();
+        data->set_name(name);
+        tensorProto->clear_data();
+        return tensorProto;
+    };
+    std::unique_ptr<TensorProto> input(addTensor("input", { 1, 4, 4, 8 }));
+    std::unique_ptr<TensorProto> weights(
+            addTensor("weights", { 8, 3, 3, 8 }));
+    TensorProto convOutput = *input;
+    convOutput.set_name("conv_output");
+    TensorProto reluOutput = *input;
+    reluOutput.set_name("relu_output");
+
+    for (const TensorProto* data : { input.get(), weights.get() }) {
+        NodeProto* node = graph->add_nodes();
+        node->set_name(data->name());
+        node->set_op(OpType::Data);
+        *node->add_input_tensors() = *data;
+        *node->add_output_tensors() = *data;
+    }
+    NodeProto* conv = graph->add_nodes();
+    conv->set_name("conv");
+    conv->set_op(OpType::Convolution3d);
+    conv->add_parents("input");
+    conv->add_parents("weights");
+    conv->add_src_tensors_indices(0);
+    conv->add_src_tensors_indices(0);
+    *conv->add_input_tensors() = *input;
+    *conv->add_input_tensors() = *weights;
+    *conv->add_output_tensors() = convOutput;
+    ConvParams* convParams = conv->mutable_params()->mutable_conv_params();
+    convParams->set_padding(SamePadding);
+    convParams->add_stride(1);
+    convParams->add_stride(1);
+    NodeProto* relu = graph->add_nodes();
+    relu->set_name("relu");
+    relu->set_op(OpType::ReLU);
+    relu->add_parents("conv");
+    relu->add_src_tensors_indices(0);
+    *relu->add_input_tensors() = convOutput;
+    *relu->add_output_tensors() = reluOutput;
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Per-node backend placement",
+                 "[network][placement]") {
+    GraphProto graph;
+    TensorDataArray tensorDataArray;
+    buildConvReluGraph(&graph, &tensorDataArray, workspace());
+    SamplingInfo sampling;
+    sampling.level = NoSampling;
+    sampling.num_sample_iterations = 1;
+    Workspace smvWorkspace;
+    std::unique_ptr<Network> smvNetwork(smaug::buildNetwork(
+            graph, tensorDataArray, sampling, &smvWorkspace));
+    Tensor* expected = Scheduler(smvNetwork.get(), &smvWorkspace).runNetwork();
+
+    SECTION("Explicit placement") {
+        graph.mutable_nodes(2)->set_backend(ReferenceBackend::Name);
+    }
+    SECTION("Automatic placement") {
+        PlacementCostTable costs;
+        costs.setCost(OpType::Convolution3d, SmvBackend::Name, 1);
+        costs.setCost(OpType::ReLU, ReferenceBackend::Name, 1);
+        placeOperators(&graph, costs);
+        REQUIRE(graph.nodes(2).backend() == ReferenceBackend::Name);
+        REQUIRE(graph.nodes(3).backend() == SmvBackend::Name);
+    }
+
+    GraphProto lowered = graph;
+    lowerBackendPlacement(&lowered);
+    // The input, the weights and the output of the convolution are converted.
+    int numConverts = 0;
+    for (const auto& node : lowered.nodes())
+        numConverts += node.op() == OpType::Convert;
+    REQUIRE(numConverts == 3);
+    REQUIRE(lowered.nodes(4).name() == "conv");
+    const TensorProto& weights = lowered.nodes(4).input_tensors(1);
+    REQUIRE(weights.data_type() == Float32);
+    REQUIRE(weights.shape().layout() == NCHW);
+    REQUIRE(weights.shape().dims(1) == 8);
+
+    Workspace mixedWorkspace;
+    std::unique_ptr<Network> mixedNetwork(smaug::buildNetwork(
+            graph, tensorDataArray, sampling, &mixedWorkspace));
+    REQUIRE(mixedNetwork->validate());
+    Tensor* output =
+            Scheduler(mixedNetwork.get(), &mixedWorkspace).runNetwork();
+    REQUIRE(output->getDataType() == Float16);
+    verifyOutputs<float>(convertFp16ToFp32Tensor(output, workspace()),
+                         convertFp16ToFp32Tensor(expected, &smvWorkspace));
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Only parameters are shared between networks",
+                 "[network][context]") {
+    GraphProto graph;
+    TensorDataArray tensorDataArray;
+    buildConvReluGraph(&graph, &tensorDataArray, workspace());
+    // Add a bias to the output, which is a second input of the network that
+    // does not feed the first input of its operator.
+    Tensor* bias = workspace()->addTensor(new Tensor(
+            "bias", TensorShape({ 1, 4, 4, 8 }, DataLayout::NHWC, 8)));
+    bias->allocateStorage<float16>();
+    fillTensorWithRandomData(bias);
+    std::unique_ptr<TensorProto> biasProto(bias->asTensorProto());
+    TensorData* biasData = tensorDataArray.add_data_array();
+    *biasData = biasProto->data();
+    biasData->set_name("bias");
+    biasProto->clear_data();
+    NodeProto* biasNode = graph.add_nodes();
+    biasNode->set_name("bias");
+    biasNode->set_op(OpType::Data);
+    *biasNode->add_input_tensors() = *biasProto;
+    *biasNode->add_output_tensors() = *biasProto;
+    const TensorProto& reluOutput = graph.nodes(3).output_tensors(0);
+    NodeProto* add = graph.add_nodes();
+    add->set_name("add");
+    add->set_op(OpType::EltwiseAdd);
+    add->add_parents("relu");
+    add->add_parents("bias");
+    add->add_src_tensors_indices(0);
+    add->add_src_tensors_indices(0);
+    *add->add_input_tensors() = reluOutput;
+    *add->add_input_tensors() = *biasProto;
+    *add->add_output_tensors() = reluOutput;
+    add->mutable_output_tensors(0)->set_name("add_output");
+
+    SamplingInfo sampling;
+    sampling.level = NoSampling;
+    sampling.num_sample_iterations = 1;
+    Workspace sharedParams, workspace0, workspace1;
+    std::unique_ptr<Network> network0(smaug::buildNetwork(
+            graph, tensorDataArray, sampling, &workspace0, &sharedParams));
+    std::unique_ptr<Network> network1(smaug::buildNetwork(
+            graph, tensorDataArray, sampling, &workspace1, &sharedParams));
+    REQUIRE(sharedParams.getTensor("weights") != nullptr);
+    REQUIRE(workspace0.getTensor("weights") == nullptr);
+    for (const std::string& name : { "input", "bias" }) {
+        REQUIRE(sharedParams.getTensor(name) == nullptr);
+        REQUIRE(workspace0.getTensor(name) != nullptr);
+        REQUIRE(workspace1.getTensor(name) != nullptr);
+    }
+    Tensor* output = Scheduler(network0.get(), &workspace0).runNetwork();
+    REQUIRE(output->getName() == "add_output");
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Lazy tiling of the branches of a switch",
+                 "[network][branches]") {
+    // An early exit: the true branch is a ReLU, the false branch a deeper
+    // stack of activations. The merged result is added to the output of an
+    // independent sigmoid.
+    TensorShape shape({ 1, 8 }, DataLayout::NC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    input->fillData<float>({ -4, -3, -2, -1, 1, 2, 3, 4 });
+    Tensor* pred = workspace()->addTensor(
+            new Tensor("pred", TensorShape({ 1 }, DataLayout::N)));
+    pred->allocateStorage<bool>();
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    auto predOp = new DataOp<ReferenceBackend>("pred_data", workspace());
+    predOp->setData(pred);
+    network()->addOperator(inputOp);
+    network()->addOperator(predOp);
+    auto addOperator = [&](Operator* op,
+                           std::vector<std::pair<Operator*, int>> producers) {
+        for (int i = 0; i < producers.size(); i++) {
+            op->setInput(producers[i].first->getOutput(producers[i].second),
+                         i);
+        }
+        op->createAllTensors();
+        for (auto output : op->getOutputs())
+            dynamic_cast<Tensor*>(output)->allocateStorage<float>();
+        network()->addOperator(op);
+        for (int i = 0; i < producers.size(); i++) {
+            network()->addEdge(
+                    producers[i].first, op, { producers[i].second, i });
+        }
+        return op;
+    };
+    Operator* sigmoid = addOperator(
+            new SigmoidOp<ReferenceBackend>("sigmoid", workspace()),
+            { { inputOp, 0 } });
+    Operator* switchOp = addOperator(
+            new SwitchOp<ReferenceBackend>("switch", workspace()),
+            { { inputOp, 0 }, { predOp, 0 } });
+    Operator* relu =
+            addOperator(new ReluOp<ReferenceBackend>("relu", workspace()),
+                        { { switchOp, 1 } });
+    Operator* deep0 =
+            addOperator(new TanhOp<ReferenceBackend>("deep0", workspace()),
+                        { { switchOp, 0 } });
+    Operator* deep1 =
+            addOperator(new TanhOp<ReferenceBackend>("deep1", workspace()),
+                        { { deep0, 0 } });
+    auto mergeOp = new MergeOp<ReferenceBackend>("merge", workspace());
+    mergeOp->setNumInputs(2);
+    addOperator(mergeOp, { { relu, 0 }, { deep1, 0 } });
+    addOperator(new EltwiseAddOp<ReferenceBackend>("add", workspace()),
+                { { mergeOp, 0 }, { sigmoid, 0 } });
+
+    const std::string statsFile = "branch_stats_test.txt";
+    Scheduler scheduler(network(), workspace());
+    // The switch runs before the sigmoid, which became ready first.
+    std::vector<Operator*> order = scheduler.computeRunOrder(FifoScheduling);
+    REQUIRE(std::find(order.begin(), order.end(), switchOp) <
+            std::find(order.begin(), order.end(), sigmoid));
+
+    // The branch that is not taken is never tiled.
+    pred->fillData({ true });
+    for (int run = 0; run < 3; run++)
+        scheduler.runNetwork();
+    REQUIRE(scheduler.isTiled(sigmoid));
+    REQUIRE(scheduler.isTiled(relu));
+    REQUIRE(!scheduler.isTiled(deep0));
+    REQUIRE(!scheduler.isTiled(deep1));
+    // It is tiled the first time it is taken.
+    pred->fillData({ false });
+    scheduler.runNetwork();
+    REQUIRE(scheduler.isTiled(deep0));
+    REQUIRE(scheduler.isTiled(deep1));
+    REQUIRE(scheduler.getBranchStats().at("switch").numTrue == 3);
+    REQUIRE(scheduler.getBranchStats().at("switch").numFalse == 1);
+    REQUIRE(scheduler.saveBranchStats(statsFile));
+
+    // The likely branch is tiled up front by the next runs, even by one that
+    // doesn't take it.
+    Scheduler nextScheduler(network(), workspace());
+    REQUIRE(nextScheduler.loadBranchStats("missing_branch_stats.txt"));
+    REQUIRE(nextScheduler.getBranchStats().empty());
+    REQUIRE(nextScheduler.loadBranchStats(statsFile));
+    std::remove(statsFile.c_str());
+    nextScheduler.runNetwork();
+    REQUIRE(nextScheduler.isTiled(relu));
+    REQUIRE(nextScheduler.isTiled(deep0));
+    REQUIRE(nextScheduler.getBranchStats().at("switch").numFalse == 2);
+}
@@ -28,8 +28,7 @@ constexpr const char* kLayerFormat = "%-40s %-25s %=15d\n";
 class Operator {
    public:
     Operator(const std::string& _name, OpType _opType, Workspace* _workspace)
-            : name(_name), opType(_opType), workspace(_workspace),
-              numPendingInputs(-1) {}
+            : name(_name), opType(_opType), workspace(_workspace) {}
     virtual ~Operator() {}
 
     virtual void tile() {};
@@ -94,13 +93,6 @@ class Operator {
     void setInput(TensorBase* op, int index) { inputs[index] = op; }
     void setOutput(TensorBase* op, int index) { outputs[index] = op; }
 
-    /**
-     * Set the number of input tensors that this operator is waiting on. When
-     * this value drops to zero, this operator is ready to be scheduled.
-     * */
-    void setNumPendingInputs(int num) { numPendingInputs = num; }
-    int getNumPendingInputs() const { return numPendingInputs; }
-    void decrNumPendingInputs() { numPendingInputs--; }
     const std::string& getName() const { return name; }
     Vertex getVertex() const { return vertex; }
     void setVertex(Vertex v) { vertex = v; }
@@ -145,9 +137,6 @@ class Operator {
     /** The BGL Vertex corresponding to this Operator. */
     Vertex vertex;
     Workspace* workspace;
-    /** The number of tensors that this operator is waiting on before it can be
-     * scheduled. */
-    int numPendingInputs;
     /** The memory interface over which input activations are expected to arrive. */
     MemoryType inputsMemType;
     /** The memory interface over which weights are expected to arrive. */
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "smaug/core/param_codec.h"
+#include "smaug/core/datatypes.h"
+#include "smaug/core/globals.h"
+#include "smaug/utility/thread_pool.h"
+
+namespace smaug {
+
+namespace {
+
+// The shortest run worth a run token, and the longest run one token covers.
+constexpr int kMinRun = 3;
+constexpr int kMaxRun = 130;
+// The longest literal sequence one token covers.
+constexpr int kMaxLiterals = 128;
+
+int getElementSize(DataType dataType) {
+    switch (dataType) {
+        case Float16:
+            return sizeof(float16);
+        case Int32:
+            return sizeof(int32_t);
+        case Float32:
+            return sizeof(float);
+        case Int64:
+            return sizeof(int64_t);
+        case Float64:
+            return sizeof(double);
+        case Bool:
+            return sizeof(bool);
+        default:
+            assert(false && "UnknownDataType has no size!");
+            return 0;
+    }
+}
+
+void rleEncode(const uint8_t* src, int64_t size, std::string* out) {
+    int64_t literalStart = 0;
+    auto flushLiterals = [&](int64_t end) {
+        while (literalStart < end) {
+            int n = std::min<int64_t>(kMaxLiterals, end - literalStart);
+            out->push_back(static_cast<char>(n - 1));
+            out->append(reinterpret_cast<const char*>(src + literalStart), n);
+            literalStart += n;
+        }
+    };
+    int64_t i = 0;
+    while (i < size) {
+        int run = 1;
+        while (i + run < size && run < kMaxRun && src[i + run] == src[i])
+            run++;
+        if (run >= kMinRun) {
+            flushLiterals(i);
+            out->push_back(static_cast<char>(run + kMaxLiterals - kMinRun));
+            out->push_back(static_cast<char>(src[i]));
+            literalStart = i + run;
+        }
+        i += run;
+    }
+    flushLiterals(size);
+}
+
+void rleDecode(const std::string& src, uint8_t* dst, int64_t dstSize) {
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src.data());
+    const uint8_t* inEnd = in + src.size();
+    uint8_t* out = dst;
+    uint8_t* outEnd = dst + dstSize;
+    while (in < inEnd) {
+        int control = *in++;
+        if (control < kMaxLiterals) {
+            int n = control + 1;
+            assert(in + n <= inEnd && out + n <= outEnd &&
+                   "Corrupted run-length encoded parameters!");
+            memcpy(out, in, n);
+            in += n;
+            out += n;
+        } else {
+            int n = control - kMaxLiterals + kMinRun;
+            assert(in < inEnd && out + n <= outEnd &&
+                   "Corrupted run-length encoded parameters!");
+            memset(out, *in++, n);
+            out += n;
+        }
+    }
+    assert(out == outEnd && "Run-length encoded parameters are truncated!");
+}
+
+// Decodes one chunk of numElements elements and writes the first numKept of
+// them to dst. scratch is reused across the chunks decoded by a thread.
+void decodeChunk(ParamEncoding encoding,
+                 const std::string& chunk,
+                 int elemSize,
+                 int64_t numElements,
+                 int64_t numKept,
+                 uint8_t* dst,
+                 std::vector<uint8_t>& scratch) {
+    int64_t chunkBytes = numElements * elemSize;
+    const uint8_t* shuffled;
+    if (encoding == ShuffleEncoding) {
+        assert(chunk.size() == chunkBytes && "Corrupted shuffled parameters!");
+        shuffled = reinterpret_cast<const uint8_t*>(chunk.data());
+    } else {
+        scratch.resize(chunkBytes);
+        rleDecode(chunk, scratch.data(), chunkBytes);
+        if (encoding == ShuffleDeltaRleEncoding) {
+            for (int64_t i = 1; i < chunkBytes; i++)
+                scratch[i] += scratch[i - 1];
+        }
+        shuffled = scratch.data();
+    }
+    for (int b = 0; b < elemSize; b++) {
+        const uint8_t* plane = shuffled + b * numElements;
+        for (int64_t j = 0; j < numKept; j++)
+            dst[j * elemSize + b] = plane[j];
+    }
+}
+
+struct DecodeChunksArgs {
+    const EncodedTensorData* encoded;
+    uint8_t* dst;
+    int64_t dstElements;
+    int start;
+    int numChunks;
+
+    DecodeChunksArgs(const EncodedTensorData* _encoded,
+                     uint8_t* _dst,
+                     int64_t _dstElements,
+                     int _start,
+                     int _numChunks)
+            : encoded(_encoded), dst(_dst), dstElements(_dstElements),
+              start(_start), numChunks(_numChunks) {}
+};
+
+void decodeChunks(const EncodedTensorData& encoded,
+                  uint8_t* dst,
+                  int64_t dstElements,
+                  int start,
+                  int numChunks) {
+    int elemSize = getElementSize(encoded.data_type());
+    int64_t chunkElements = encoded.chunk_elements();
+    std::vector<uint8_t> scratch;
+    for (int i = start; i < start + numChunks; i++) {
+        int64_t first = i * chunkElements;
+        int64_t numElements =
+                std::min(chunkElements, encoded.num_elements() - first);
+        int64_t numKept =
+                std::max<int64_t>(0, std::min(numElements, dstElements - first));
+        decodeChunk(encoded.encoding(), encoded.chunks(i), elemSize,
+                    numElements, numKept, dst + first * elemSize, scratch);
+    }
+}
+
+void* decodeChunksWorker(void* _args) {
+    auto args = reinterpret_cast<DecodeChunksArgs*>(_args);
+    decodeChunks(*args->encoded, args->dst, args->dstElements, args->start,
+                 args->numChunks);
+    delete args;
+    return nullptr;
+}
+
+}  // namespace
+
+void encodeTensorData(const void* data,
+                      DataType dataType,
+                      int64_t numElements,
+                      ParamEncoding encoding,
+                      EncodedTensorData* encoded,
+                      int chunkElements) {
+    assert(chunkElements > 0 && "The chunks must not be empty!");
+    int elemSize = getElementSize(dataType);
+    encoded->Clear();
+    encoded->set_encoding(encoding);
+    encoded->set_data_type(dataType);
+    encoded->set_num_elements(numElements);
+    encoded->set_chunk_elements(chunkElements);
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+    std::vector<uint8_t> shuffled;
+    for (int64_t first = 0; first < numElements; first += chunkElements) {
+        int64_t n = std::min<int64_t>(chunkElements, numElements - first);
+        const uint8_t* chunkSrc = src + first * elemSize;
+        shuffled.resize(n * elemSize);
+        for (int b = 0; b < elemSize; b++) {
+            for (int64_t j = 0; j < n; j++)
+                shuffled[b * n + j] = chunkSrc[j * elemSize + b];
+        }
+        if (encoding == ShuffleDeltaRleEncoding) {
+            for (int64_t i = shuffled.size() - 1; i > 0; i--)
+                shuffled[i] -= shuffled[i - 1];
+        }
+        std::string* chunk = encoded->add_chunks();
+        if (encoding == ShuffleEncoding) {
+            chunk->assign(shuffled.begin(), shuffled.end());
+        } else {
+            rleEncode(shuffled.data(), shuffled.size(), chunk);
+        }
+    }
+}
+
+void decodeTensorData(const EncodedTensorData& encoded,
+                      void* dst,
+                      int64_t dstElements) {
+    uint8_t* dstPtr = reinterpret_cast<uint8_t*>(dst);
+    int totalNumChunks = encoded.chunks_size();
+    assert(totalNumChunks * (int64_t)encoded.chunk_elements() >=
+                   encoded.num_elements() &&
+           "The encoded parameters are missing chunks!");
+    if (!threadPool || !threadPool->isInitialized() || totalNumChunks == 1) {
+        decodeChunks(encoded, dstPtr, dstElements, 0, totalNumChunks);
+        return;
+    }
+    int numChunksPerThread =
+            std::ceil(totalNumChunks * 1.0 / threadPool->size());
+    int remainingChunks = totalNumChunks;
+    std::vector<void*> args;
+    while (remainingChunks > 0) {
+        int numChunks = std::min(numChunksPerThread, remainingChunks);
+        args.push_back(new DecodeChunksArgs(&encoded, dstPtr, dstElements,
+                                            totalNumChunks - remainingChunks,
+                                            numChunks));
+        remainingChunks -= numChunks;
+    }
+    int numDispatched = threadPool->dispatchThreads(decodeChunksWorker, args);
+    assert(numDispatched == args.size() && "Failed to dispatch thread!");
+    threadPool->joinThreadPool();
+}
+
+}  // namespace smaug
@@ -0,0 +1,50 @@
+#ifndef _CORE_PARAM_CODEC_H_
+#define _CORE_PARAM_CODEC_H_
+
+#include <cstdint>
+
+#include "smaug/core/tensor.pb.h"
+#include "smaug/core/types.pb.h"
+
+namespace smaug {
+
+/**
+ * The default number of elements in a chunk of EncodedTensorData. Chunks are
+ * the unit of parallelism of the decoder.
+ */
+constexpr int kDefaultParamChunkElements = 65536;
+
+/**
+ * Encodes numElements elements of data into encoded.
+ *
+ * Every chunk of chunkElements elements is encoded on its own: the bytes of
+ * its elements are shuffled so that the i-th bytes of all the elements are
+ * stored together, then optionally delta coded, and then optionally
+ * run-length encoded. The run-length encoding is a sequence of control bytes.
+ * A control byte c < 128 is followed by c + 1 literal bytes, and any other
+ * control byte is followed by one byte that is repeated c - 125 times.
+ *
+ * This must produce the same format as smaug/python/param_codec.py.
+ */
+void encodeTensorData(const void* data,
+                      DataType dataType,
+                      int64_t numElements,
+                      ParamEncoding encoding,
+                      EncodedTensorData* encoded,
+                      int chunkElements = kDefaultParamChunkElements);
+
+/**
+ * Decodes encoded into dst, which has room for dstElements elements of the
+ * encoded data type. Any encoded elements beyond that are dropped (e.g., the
+ * float16 element that pads an odd-sized tensor).
+ *
+ * The chunks are decoded in parallel on the thread pool if it has been
+ * initialized, each straight into its slice of dst.
+ */
+void decodeTensorData(const EncodedTensorData& encoded,
+                      void* dst,
+                      int64_t dstElements);
+
+}  // namespace smaug
+
+#endif
@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <set>
+#include <string>
+#include <tuple>
+
+#include "smaug/core/execution_context.h"
+#include "smaug/core/globals.h"
+#include "smaug/core/row_band_scheduler.h"
+#include "smaug/core/tensor_utils.h"
+#include "smaug/core/types.pb.h"
+#include "smaug/operators/batch_norm_op.h"
+#include "smaug/operators/convolution_op.h"
+#include "smaug/operators/eltwise_op.h"
+#include "smaug/operators/pooling_op.h"
+#include "smaug/operators/smv/smv_systolic_array.h"
+#include "smaug/operators/unary_op.h"
+#include "smaug/utility/debug_stream.h"
+#include "smaug/utility/perf_projection.h"
+#include "smaug/utility/thread_pool.h"
+
+namespace smaug {
+
+namespace {
+
+// How the rows of an operator's output map to the rows of its input, as
+// computed by computeInputRowRange(). The input columns are padded with
+// leftPad and rightPad zero columns.
+struct RowGeometry {
+    int fieldRows;
+    int rowStride;
+    int topPad;
+    int leftPad;
+    int rightPad;
+};
+
+bool isStreamable(Operator* op) {
+    switch (op->getOpType()) {
+        case OpType::Convolution3d:
+            return dynamic_cast<ConvolutionOp<ReferenceBackend>*>(op);
+        case OpType::MaxPooling:
+        case OpType::AveragePooling:
+            return dynamic_cast<PoolingOp<ReferenceBackend>*>(op);
+        case OpType::BatchNorm:
+            return dynamic_cast<BatchNormOp<ReferenceBackend>*>(op);
+        case OpType::EltwiseAdd:
+        case OpType::EltwiseMul:
+            return dynamic_cast<EltwiseOp<ReferenceBackend>*>(op);
+        case OpType::ReLU:
+        case OpType::LReLU:
+        case OpType::ELU:
+        case OpType::SELU:
+        case OpType::Tanh:
+        case OpType::HardTanh:
+        case OpType::Sigmoid:
+            return dynamic_cast<UnaryOp<ReferenceBackend>*>(op);
+        default:
+            return false;
+    }
+}
+
+// Returns the indices of the inputs that are read in row bands. The other
+// inputs are parameters.
+std::vector<int> getBandedInputs(Operator* op) {
+    if (op->getOpType() == OpType::EltwiseAdd ||
+        op->getOpType() == OpType::EltwiseMul) {
+        std::vector<int> indices(op->getInputs().size());
+        for (int i = 0; i < indices.size(); i++)
+            indices[i] = i;
+        return indices;
+    }
+    return { 0 };
+}
+
+RowGeometry getRowGeometry(Operator* op) {
+    if (auto conv = dynamic_cast<ConvolutionOp<ReferenceBackend>*>(op)) {
+        std::vector<int> padding = conv->getInputPadding();
+        return { conv->getWeightRows(), conv->getRowStride(), padding[0],
+                 padding[2], padding[3] };
+    }
+    if (auto pool = dynamic_cast<PoolingOp<ReferenceBackend>*>(op)) {
+        return { pool->getPoolingSize().first, pool->getPoolingStride().first,
+                 0, 0, 0 };
+    }
+    return { 1, 1, 0, 0, 0 };
+}
+
+// The steps of a wave that one worker runs.
+struct RunStepsArgs {
+    RowBandScheduler* scheduler;
+    std::vector<int> steps;
+    ExecutionContext context;
+};
+
+}  // namespace
+
+bool RowBandScheduler::canStream(Network* network) {
+    if (network->hasStateVariables())
+        return false;
+    std::set<TensorBase*> dataOutputs;
+    for (auto nameOp : network->getOperators()) {
+        Operator* op = nameOp.second;
+        if (op->getOpType() == OpType::Data)
+            dataOutputs.insert(op->getOutput(0));
+    }
+    auto isNHWC = [](TensorBase* tensor) {
+        return tensor->ndims() == 4 &&
+               tensor->getShape().getLayout() == DataLayout::NHWC;
+    };
+    int numOutputs = 0;
+    for (auto nameOp : network->getOperators()) {
+        Operator* op = nameOp.second;
+        if (op->getOpType() == OpType::Data)
+            continue;
+        if (!isStreamable(op) || op->getOutputs().size() != 1 ||
+            !isNHWC(op->getOutput(0)))
+            return false;
+        if (boost::out_degree(op->getVertex(), network->getGraph()) == 0)
+            numOutputs++;
+        std::vector<int> banded = getBandedInputs(op);
+        for (int i = 0; i < op->getInputs().size(); i++) {
+            TensorBase* input = op->getInputs()[i];
+            if (std::find(banded.begin(), banded.end(), i) == banded.end()) {
+                if (!dataOutputs.count(input))
+                    return false;
+            } else if (!isNHWC(input)) {
+                return false;
+            }
+        }
+        // The Reference kernel of a same-padded convolution only pads like
+        // getInputPadding() with square weights.
+        auto conv = dynamic_cast<ConvolutionOp<ReferenceBackend>*>(op);
+        if (conv && conv->getPadding() == SamePadding &&
+            conv->getWeightRows() != conv->getWeightCols())
+            return false;
+    }
+    return numOutputs == 1;
+}
+
+void RowBandScheduler::planBands() {
+    order.clear();
+    for (Operator* op : computeRunOrder(FifoScheduling)) {
+        if (op->getOpType() != OpType::Data)
+            order.push_back(op);
+    }
+    // Every operator reaches the only output, which therefore runs last.
+    Tensor* output = order.back()->getOutput(0);
+    int outputRows = output->dim(1);
+    bands.clear();
+    for (int first = 0; first < outputRows; first += bandRows) {
+        BandRows rows;
+        rows[output] = { first, std::min(outputRows, first + bandRows) };
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            Operator* op = *it;
+            auto outRows = rows.find(op->getOutput(0));
+            if (outRows == rows.end())
+                continue;
+            RowGeometry geometry = getRowGeometry(op);
+            std::pair<int, int> inRange = computeInputRowRange(
+                    outRows->second.first, outRows->second.second,
+                    geometry.fieldRows, geometry.rowStride, geometry.topPad);
+            for (int index : getBandedInputs(op)) {
+                Tensor* input = op->getInput(index);
+                int inFirst = std::max(0, inRange.first);
+                int inLast = std::min(input->dim(1), inRange.second);
+                auto inRows = rows.find(input);
+                if (inRows == rows.end()) {
+                    rows[input] = { inFirst, inLast };
+                } else {
+                    inRows->second.first =
+                            std::min(inRows->second.first, inFirst);
+                    inRows->second.second =
+                            std::max(inRows->second.second, inLast);
+                }
+            }
+        }
+        bands.push_back(rows);
+    }
+
+    std::map<TensorBase*, Operator*> producers;
+    std::map<TensorBase*, std::vector<Operator*>> consumers;
+    for (Operator* op : order) {
+        producers[op->getOutput(0)] = op;
+        for (int index : getBandedInputs(op))
+            consumers[op->getInput(index)].push_back(op);
+    }
+    // Every band runs the operators on the rows that their windows don't
+    // hold yet, which may be none. A step depends on the previous step of its
+    // operator, on the last steps of its producers, which wrote the rows it
+    // reads, and on the steps of its consumers two bands back, which read the
+    // rows of the ring it overwrites.
+    steps.clear();
+    std::map<Operator*, std::vector<int>> opSteps;
+    std::map<Operator*, int> producedRows;
+    for (int band = 0; band < bands.size(); band++) {
+        for (Operator* op : order) {
+            Tensor* output = op->getOutput(0);
+            auto it = bands[band].find(output);
+            if (it == bands[band].end())
+                continue;
+            int start = std::max(producedRows[op], it->second.first);
+            int end = it->second.second;
+            if (start >= end)
+                continue;
+            producedRows[op] = end;
+            BandStep step = { op, band, start, end, {}, 0 };
+            if (!opSteps[op].empty())
+                step.deps.push_back(opSteps[op].back());
+            for (int index : getBandedInputs(op)) {
+                auto producer = producers.find(op->getInput(index));
+                if (producer != producers.end() &&
+                    !opSteps[producer->second].empty())
+                    step.deps.push_back(opSteps[producer->second].back());
+            }
+            for (Operator* consumer : consumers[output]) {
+                const std::vector<int>& consumerSteps = opSteps[consumer];
+                for (auto s = consumerSteps.rbegin(); s != consumerSteps.rend();
+                     ++s) {
+                    if (steps[*s].band <= band - 2) {
+                        step.deps.push_back(*s);
+                        break;
+                    }
+                }
+            }
+            opSteps[op].push_back(steps.size());
+            steps.push_back(step);
+        }
+    }
+
+    // A step runs in the wave after the last of its dependencies.
+    waves.clear();
+    std::vector<int> stepWaves(steps.size(), 0);
+    for (int s = 0; s < steps.size(); s++) {
+        for (int dep : steps[s].deps)
+            stepWaves[s] = std::max(stepWaves[s], stepWaves[dep] + 1);
+        if (stepWaves[s] == waves.size())
+            waves.emplace_back();
+        waves[stepWaves[s]].push_back(s);
+    }
+    dout(1) << "Planned " << steps.size() << " steps in " << waves.size()
+            << " waves.\n";
+}
+
+int RowBandScheduler::getWindowCapacity(Tensor* tensor) const {
+    // With pipelining, the rows of a band are written while the consumers
+    // still read those of the previous band.
+    int capacity = 0;
+    for (int band = 0; band < bands.size(); band++) {
+        auto it = bands[band].find(tensor);
+        if (it == bands[band].end())
+            continue;
+        int first = it->second.first;
+        if (pipelined && band > 0) {
+            auto prev = bands[band - 1].find(tensor);
+            if (prev != bands[band - 1].end())
+                first = std::min(first, prev->second.first);
+        }
+        capacity = std::max(capacity, it->second.second - first);
+    }
+    return capacity;
+}
+
+Tensor* RowBandScheduler::runNetwork() {
+    auto contextScope = ExecutionContext::Scope(context);
+    assert(canStream(network) && "The network can't run in row bands!");
+    // Only the layers of this run are reported.
+    smv::SystolicArray::clear();
+    PerfProjection::clear();
+    if (!networkTiled) {
+        tileNetwork();
+        networkTiled = true;
+    }
+
+    std::cout << "======================================================\n";
+    std::cout << "      Streaming operators of the network in bands of "
+              << bandRows << " rows...\n";
+    std::cout << "======================================================\n";
+    if (bands.empty())
+        planBands();
+
+    // The windows of the intermediate activations are rings as tall as the
+    // most rows a band needs of them, which replace their full storage. The
+    // inputs of the network and its output are used as they are.
+    Tensor* output = order.back()->getOutput(0);
+    windows.clear();
+    windowBytes = 0;
+    for (Operator* op : order) {
+        Tensor* tensor = op->getOutput(0);
+        RowWindow& window = windows[tensor];
+        window.tensor = tensor;
+        window.capacity = tensor->dim(1);
+        if (tensor == output)
+            continue;
+        window.capacity = getWindowCapacity(tensor);
+        const TensorShape& shape = tensor->getShape();
+        window.ring.reset(new Tensor(
+                tensor->getName() + "/rows",
+                TensorShape({ shape[0], window.capacity, shape[2], shape[3] },
+                            shape.getLayout(),
+                            shape.getAlignment())));
+        window.ring->allocateStorage(tensor->getDataType());
+        windowBytes += getTensorBytes(window.ring.get());
+        tensor->releaseStorage();
+    }
+    for (Operator* op : order) {
+        for (int index : getBandedInputs(op)) {
+            Tensor* input = op->getInput(index);
+            if (windows.count(input))
+                continue;
+            RowWindow& window = windows[input];
+            window.tensor = input;
+            window.capacity = input->dim(1);
+        }
+    }
+    dout(1) << "Row windows of the activations: " << windowBytes
+            << " bytes.\n";
+
+    peakBandBytes = windowBytes;
+    {
+        auto stats =
+                gem5::ScopedStats(stats::kNetworkStart, stats::kNetworkEnd);
+        // Operators that are profiled run one at a time, since the profiler
+        // times them on the main thread.
+        if (pipelined && threadPool && !PerfProjection::enabled()) {
+            runWaves();
+        } else {
+            for (BandStep& step : steps) {
+                dout(0) << "Scheduling " << step.op->getName() << " ("
+                        << OpType_Name(step.op->getOpType()) << ") on rows "
+                        << step.start << " to " << step.end << ".\n";
+                step.bandBytes = runOnRows(step.op, step.start, step.end);
+                peakBandBytes =
+                        std::max(peakBandBytes, windowBytes + step.bandBytes);
+            }
+        }
+    }
+    windows.clear();
+    return output;
+}
+
+void RowBandScheduler::runWaves() {
+    // The operators on the workers run without the thread pool.
+    ExecutionContext workerContext;
+    workerContext.threadPool = nullptr;
+    workerContext.systolicArrayRecords.clear();
+    workerContext.perfProjectionRecords.clear();
+    int numWorkers = std::max(1, threadPool->size());
+    for (const std::vector<int>& wave : waves) {
+        int numChunks = std::min<int>(wave.size(), numWorkers);
+        std::vector<RunStepsArgs> chunks(
+                numChunks, RunStepsArgs{ this, {}, workerContext });
+        for (int i = 0; i < wave.size(); i++) {
+            const BandStep& step = steps[wave[i]];
+            dout(0) << "Scheduling " << step.op->getName() << " ("
+                    << OpType_Name(step.op->getOpType()) << ") on rows "
+                    << step.start << " to " << step.end << ".\n";
+            chunks[i % numChunks].steps.push_back(wave[i]);
+        }
+        std::vector<void*> args;
+        for (RunStepsArgs& chunk : chunks)
+            args.push_back(&chunk);
+        int numDispatched = threadPool->dispatchThreads(runStepsWorker, args);
+        // The chunks that found no idle worker run on this thread.
+        for (int i = numDispatched; i < args.size(); i++)
+            runStepsWorker(args[i]);
+        threadPool->joinThreadPool();
+        // The chunks record the cycles of their layers in their own
+        // contexts.
+        for (RunStepsArgs& chunk : chunks) {
+            for (const auto& record : chunk.context.systolicArrayRecords)
+                smv::SystolicArray::recordLayer(record.name, record.cycles);
+        }
+        int64_t waveBytes = 0;
+        for (int s : wave)
+            waveBytes += steps[s].bandBytes;
+        peakBandBytes = std::max(peakBandBytes, windowBytes + waveBytes);
+    }
+}
+
+void* RowBandScheduler::runStepsWorker(void* _args) {
+    auto args = reinterpret_cast<RunStepsArgs*>(_args);
+    auto contextScope = ExecutionContext::Scope(&args->context);
+    RowBandScheduler* scheduler = args->scheduler;
+    for (int s : args->steps) {
+        BandStep& step = scheduler->steps[s];
+        step.bandBytes = scheduler->runOnRows(step.op, step.start, step.end);
+    }
+    return nullptr;
+}
+
+int64_t RowBandScheduler::runOnRows(Operator* op, int start, int end) {
+    RowGeometry geometry = getRowGeometry(op);
+    std::vector<TensorBase*> inputs = op->getInputs();
+    std::vector<std::unique_ptr<Tensor>> inputBands;
+    int64_t bandBytes = 0;
+    int first, last;
+    std::tie(first, last) = computeInputRowRange(
+            start, end, geometry.fieldRows, geometry.rowStride,
+            geometry.topPad);
+    for (int index : getBandedInputs(op)) {
+        Tensor* input = op->getInput(index);
+        const TensorShape& shape = input->getShape();
+        Tensor* band = new Tensor(
+                input->getName() + "/band",
+                TensorShape({ shape[0], last - first,
+                              shape[2] + geometry.leftPad + geometry.rightPad,
+                              shape[3] },
+                            shape.getLayout(),
+                            shape.getAlignment()));
+        inputBands.emplace_back(band);
+        band->allocateStorage(input->getDataType());
+        // The halo beyond the image borders is the zero padding.
+        if (first < 0 || last > shape[1] ||
+            geometry.leftPad + geometry.rightPad > 0)
+            band->fillZeros();
+        int readFirst = std::max(first, 0);
+        readRows(windows.at(input), readFirst, std::min(last, shape[1]), band,
+                 readFirst - first, geometry.leftPad);
+        op->setInput(band, index);
+        bandBytes += getTensorBytes(band);
+    }
+    Tensor* output = op->getOutput(0);
+    const TensorShape& shape = output->getShape();
+    std::unique_ptr<Tensor> outputBand(new Tensor(
+            output->getName() + "/band",
+            TensorShape({ shape[0], end - start, shape[2], shape[3] },
+                        shape.getLayout(),
+                        shape.getAlignment())));
+    outputBand->allocateStorage(output->getDataType());
+    op->setOutput(outputBand.get(), 0);
+    bandBytes += getTensorBytes(outputBand.get());
+
+    // The padding is part of the input bands.
+    auto conv = dynamic_cast<ConvolutionOp<ReferenceBackend>*>(op);
+    PaddingType padding = conv ? conv->getPadding() : UnknownPadding;
+    if (conv)
+        conv->setPadding(ValidPadding);
+    maybeRunOperator(op);
+    if (conv)
+        conv->setPadding(padding);
+    for (int i = 0; i < inputs.size(); i++)
+        op->setInput(inputs[i], i);
+    op->setOutput(output, 0);
+    writeRows(windows.at(output), outputBand.get(), start, end);
+    return bandBytes;
+}
+
+void RowBandScheduler::readRows(const RowWindow& window,
+                                int start,
+                                int end,
+                                Tensor* dest,
+                                int destRow,
+                                int destCol) {
+    assert(end - start <= window.capacity &&
+           "The rows are not in the window!");
+    const TensorShape& shape = window.tensor->getShape();
+    Tensor* src = window.ring ? window.ring.get() : window.tensor;
+    for (int row = start; row < end;) {
+        int srcRow = window.ring ? row % window.capacity : row;
+        int numRows = std::min(end - row, window.capacity - srcRow);
+        copyTensorRegion(dest, src, { 0, destRow + row - start, destCol, 0 },
+                         { 0, srcRow, 0, 0 },
+                         { shape[0], numRows, shape[2], shape[3] });
+        row += numRows;
+    }
+}
+
+void RowBandScheduler::writeRows(RowWindow& window,
+                                 Tensor* src,
+                                 int start,
+                                 int end) {
+    assert(end - start <= window.capacity &&
+           "The rows don't fit in the window!");
+    const TensorShape& shape = window.tensor->getShape();
+    Tensor* dest = window.ring ? window.ring.get() : window.tensor;
+    dest->allocateStorage(window.tensor->getDataType());
+    for (int row = start; row < end;) {
+        int destRow = window.ring ? row % window.capacity : row;
+        int numRows = std::min(end - row, window.capacity - destRow);
+        copyTensorRegion(dest, src, { 0, destRow, 0, 0 },
+                         { 0, row - start, 0, 0 },
+                         { shape[0], numRows, shape[2], shape[3] });
+        row += numRows;
+    }
+}
+
+}  // namespace smaug
@@ -0,0 +1,165 @@
+#ifndef _CORE_ROW_BAND_SCHEDULER_H_
+#define _CORE_ROW_BAND_SCHEDULER_H_
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "smaug/core/scheduler.h"
+
+namespace smaug {
+
+/**
+ * RowBandScheduler runs a fully convolutional Network in horizontal bands of
+ * the rows of its output, so that an intermediate activation never has to be
+ * resident as a whole. Only a rolling window of its rows is kept: the rows
+ * that the current band needs, including the halo rows of the receptive field
+ * of every consumer. The peak memory of the activations is then proportional
+ * to the band, not to the image.
+ *
+ * For every band, the rows that each tensor must provide are propagated from
+ * the output back to the inputs of the Network. The operators then run in
+ * topological order, each on the rows of its output that its window doesn't
+ * hold yet, as a valid convolution or pooling of a band of its input that
+ * includes the halo rows (and the zero padding at the image borders).
+ *
+ * With pipelining, the bands of different operators overlap in a wavefront:
+ * an operator runs on a band as soon as its producers have written the rows
+ * it needs, including the halos, while they go on with the next bands. The
+ * runs of every wave are independent and are spread across the thread pool.
+ * The rings then hold one more band, so that a producer can write the rows of
+ * the next band while its consumers still read the current one.
+ *
+ * This supports the Reference backend in NHWC, with convolutions, poolings,
+ * batch norms, elementwise additions and multiplications, and elementwise
+ * activations. See canStream().
+ */
+class RowBandScheduler : public Scheduler {
+   public:
+    RowBandScheduler(Network* _network,
+                     Workspace* _workspace,
+                     int _bandRows,
+                     ExecutionContext* _context = nullptr)
+            : Scheduler(_network, _workspace, _context), bandRows(_bandRows),
+              pipelined(false), peakBandBytes(0), windowBytes(0) {}
+
+    /**
+     * Returns true if the Network can run in row bands: all its operators
+     * are supported, it has a single output, and the parameters of its
+     * operators are Data operator outputs.
+     */
+    static bool canStream(Network* network);
+
+    /**
+     * Runs the Network band by band. The storage of the intermediate
+     * activations is released, and only the final output is written in
+     * full.
+     */
+    Tensor* runNetwork() override;
+
+    int getBandRows() const { return bandRows; }
+
+    /**
+     * Overlaps the bands of different operators on the thread pool. Without
+     * a thread pool, or while the operators are profiled, they run one at a
+     * time in the same order.
+     */
+    void setPipelined(bool _pipelined) { pipelined = _pipelined; }
+    bool isPipelined() const { return pipelined; }
+
+    /**
+     * Returns the number of waves of the last run: the length of its critical
+     * path in operator runs on bands.
+     */
+    int getNumWaves() const { return waves.size(); }
+    /** Returns the number of operator runs on bands of the last run. */
+    int getNumSteps() const { return steps.size(); }
+
+    /**
+     * Returns the peak bytes of the row windows of the activations and of the
+     * bands that an operator read and wrote at the same time, in the last
+     * run.
+     */
+    int64_t getPeakBandBytes() const { return peakBandBytes; }
+
+   protected:
+    /**
+     * The resident rows of a tensor. A ring window stores row r at row
+     * r % capacity of its buffer; other windows are the full tensor.
+     */
+    struct RowWindow {
+        Tensor* tensor;
+        std::unique_ptr<Tensor> ring;
+        int capacity;
+    };
+
+    /** The rows [first, second) of every tensor that a band needs. */
+    typedef std::map<TensorBase*, std::pair<int, int>> BandRows;
+
+    /** A run of an operator on the rows [start, end) of its output. */
+    struct BandStep {
+        Operator* op;
+        int band;
+        int start;
+        int end;
+        /** The steps that must finish before this one starts. */
+        std::vector<int> deps;
+        /** The bytes of the input and output bands of the last run. */
+        int64_t bandBytes;
+    };
+
+    /**
+     * Computes the rows needed by every band, the steps that produce them,
+     * and the waves of independent steps.
+     */
+    void planBands();
+
+    /** Returns the rows of its ring that a tensor needs. */
+    int getWindowCapacity(Tensor* tensor) const;
+
+    /** Runs the waves of steps, spreading each across the thread pool. */
+    void runWaves();
+
+    /** Runs a chunk of the steps of a wave on a worker thread. */
+    static void* runStepsWorker(void* args);
+
+    /**
+     * Runs the operator on the rows [start, end) of its output. Returns the
+     * bytes of the bands that it read and wrote.
+     */
+    int64_t runOnRows(Operator* op, int start, int end);
+
+    /**
+     * Copies the rows [start, end) of a window into dest, from its row
+     * destRow and column destCol on.
+     */
+    void readRows(const RowWindow& window,
+                  int start,
+                  int end,
+                  Tensor* dest,
+                  int destRow,
+                  int destCol);
+
+    /** Writes the rows of src, which are rows [start, end), to a window. */
+    void writeRows(RowWindow& window, Tensor* src, int start, int end);
+
+    int bandRows;
+    bool pipelined;
+    int64_t peakBandBytes;
+    /** The bytes of the ring windows of the current run. */
+    int64_t windowBytes;
+
+    /** The non-Data operators in topological order. */
+    std::vector<Operator*> order;
+    std::vector<BandRows> bands;
+    /** The steps of a run in the order that runs them one at a time. */
+    std::vector<BandStep> steps;
+    /** The steps of every wave, whose dependencies are in earlier waves. */
+    std::vector<std::vector<int>> waves;
+    std::map<TensorBase*, RowWindow> windows;
+};
+
+}  // namespace smaug
+
+#endif
@@ -0,0 +1,137 @@
+#include "catch.hpp"
+#include "smaug/core/backend.h"
+#include "smaug/core/globals.h"
+#include "smaug/core/row_band_scheduler.h"
+#include "smaug/core/smaug_test.h"
+#include "smaug/core/tensor.h"
+#include "smaug/operators/convolution_op.h"
+#include "smaug/operators/data_op.h"
+#include "smaug/operators/eltwise_add_op.h"
+#include "smaug/operators/pooling_op.h"
+#include "smaug/operators/relu_op.h"
+#include "smaug/utility/thread_pool.h"
+
+using namespace smaug;
+
+class RowBandSchedulerTest : public SmaugTest {
+   public:
+    // Fills a float tensor with a pattern of values in [-1, 1].
+    void fillData(Tensor* tensor, int seed) {
+        std::vector<float> data(tensor->getShape().storageSize());
+        for (int i = 0; i < data.size(); i++)
+            data[i] = ((i * 7 + seed * 13) % 17 - 8) / 8.0;
+        tensor->fillData(data.data(), data.size());
+    }
+
+    Operator* addOperator(Operator* op, std::vector<Operator*> producers) {
+        for (int i = 0; i < producers.size(); i++)
+            op->setInput(producers[i]->getOutput(0), i);
+        op->createAllTensors();
+        op->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(op);
+        for (int i = 0; i < producers.size(); i++)
+            network()->addEdge(producers[i], op, { 0, i });
+        return op;
+    }
+
+    Operator* addConvolution(const std::string& name,
+                             Operator* producer,
+                             int weightSize,
+                             int stride,
+                             PaddingType padding) {
+        auto convOp = new ConvolutionOp<ReferenceBackend>(name, workspace());
+        convOp->setWeightDims(weightSize, weightSize, 8);
+        convOp->setStride(stride, stride);
+        convOp->setPadding(padding);
+        convOp->setInput(producer->getOutput(0), 0);
+        convOp->createAllTensors();
+        // The weights are parameters of the network.
+        Tensor* weights = convOp->getInput(1);
+        weights->allocateStorage<float>();
+        fillData(weights, network()->getOperators().size());
+        auto weightsOp =
+                new DataOp<ReferenceBackend>(name + "_weights", workspace());
+        weightsOp->setData(weights);
+        network()->addOperator(weightsOp);
+        convOp->getOutput(0)->allocateStorage<float>();
+        network()->addOperator(convOp);
+        network()->addEdge(producer, convOp, { 0, 0 });
+        network()->addEdge(weightsOp, convOp, { 0, 1 });
+        return convOp;
+    }
+};
+
+TEST_CASE_METHOD(RowBandSchedulerTest,
+                 "Streaming a network in row bands",
+                 "[network][bands]") {
+    TensorShape shape({ 1, 125, 11, 8 }, DataLayout::NHWC);
+    Tensor* input = workspace()->addTensor(new Tensor("input", shape));
+    input->allocateStorage<float>();
+    fillData(input, 0);
+    auto inputOp = new DataOp<ReferenceBackend>("input_data", workspace());
+    inputOp->setData(input);
+    network()->addOperator(inputOp);
+    // A residual block between a pooling and a strided convolution.
+    Operator* conv0 = addConvolution("conv0", inputOp, 3, 1, SamePadding);
+    Operator* relu = addOperator(
+            new ReluOp<ReferenceBackend>("relu", workspace()), { conv0 });
+    auto poolOp = new MaxPoolingOp<ReferenceBackend>("pool", workspace());
+    poolOp->setPoolingSize(2, 2);
+    poolOp->setPoolingStride(2, 2);
+    addOperator(poolOp, { relu });
+    Operator* conv1 = addConvolution("conv1", poolOp, 3, 1, SamePadding);
+    Operator* add = addOperator(
+            new EltwiseAddOp<ReferenceBackend>("add", workspace()),
+            { conv1, poolOp });
+    Operator* conv2 = addConvolution("conv2", add, 3, 2, SamePadding);
+    Operator* conv3 = addConvolution("conv3", conv2, 2, 1, ValidPadding);
+
+    SECTION("The output matches a run on whole tensors") {
+        REQUIRE(RowBandScheduler::canStream(network()));
+        Scheduler scheduler(network(), workspace());
+        Tensor* output = scheduler.runNetwork();
+        REQUIRE(output == conv3->getOutput(0));
+        std::vector<float> expected(
+                output->data<float>(),
+                output->data<float>() + output->getShape().storageSize());
+        int64_t activationBytes = 0;
+        for (Operator* op : { conv0, relu, (Operator*)poolOp, conv1, add,
+                              conv2 }) {
+            activationBytes +=
+                    op->getOutput(0)->getShape().storageSize() * sizeof(float);
+        }
+
+        for (int bandRows : { 1, 2, 4 }) {
+            RowBandScheduler bandScheduler(network(), workspace(), bandRows);
+            output = bandScheduler.runNetwork();
+            REQUIRE(output == conv3->getOutput(0));
+            verifyOutputs(output, expected);
+            if (bandRows == 1) {
+                REQUIRE(bandScheduler.getPeakBandBytes() <
+                        activationBytes / 2);
+            }
+            // The full activations are not kept.
+            REQUIRE(!conv0->getOutput(0)->containsData());
+        }
+
+        // The bands of different operators overlap on the thread pool.
+        ThreadPool pool(3);
+        pool.initThreadPool();
+        threadPool = &pool;
+        for (int bandRows : { 1, 4 }) {
+            RowBandScheduler bandScheduler(network(), workspace(), bandRows);
+            bandScheduler.setPipelined(true);
+            output = bandScheduler.runNetwork();
+            verifyOutputs(output, expected);
+            REQUIRE(bandScheduler.getNumWaves() * 2 <
+                    bandScheduler.getNumSteps());
+        }
+        threadPool = nullptr;
+    }
+
+    SECTION("Networks with several outputs run on whole tensors") {
+        addOperator(new ReluOp<ReferenceBackend>("relu2", workspace()),
+                    { conv1 });
+        REQUIRE(!RowBandScheduler::canStream(network()));
+    }
+}
@@ -1,24 +1,536 @@
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
 #include <string>
 #include <vector>
+#include <boost/graph/topological_sort.hpp>
 
 #include "smaug/utility/debug_stream.h"
+#include "smaug/utility/perf_projection.h"
 #include "smaug/utility/thread_pool.h"
 #include "smaug/core/tensor.h"
+#include "smaug/core/tensor_utils.h"
 #include "smaug/core/types.pb.h"
 #include "smaug/core/scheduler.h"
+#include "smaug/operators/control_flow_ops.h"
+#include "smaug/operators/smv/smv_systolic_array.h"
 
 namespace smaug {
 
+namespace {
+
+// The longest chain of operators run again to recompute one output.
+constexpr int kMaxRecomputeDepth = 4;
+
+// An operator output, as the recompute planner sees it: live from the step
+// its operator runs at to the step of its last use, except where it is
+// released between two uses.
+struct Activation {
+    Tensor* tensor;
+    Operator* producer;
+    int64_t bytes;
+    int produced;
+    // The steps of its consumers, in order.
+    std::vector<int> uses;
+    // Whether it is released before each use, since the previous use or its
+    // production.
+    std::vector<bool> released;
+    // False if its storage must be kept once it is produced.
+    bool releasable;
+
+    int getGapStart(int use) const {
+        return use == 0 ? produced : uses[use - 1];
+    }
+    // Outputs without consumers are live until the end of the run.
+    int getLastStep(int numSteps) const {
+        return uses.empty() ? numSteps - 1 : uses.back();
+    }
+    bool isLiveAt(int step, int numSteps) const {
+        if (step < produced || step > getLastStep(numSteps))
+            return false;
+        for (int i = 0; i < uses.size(); i++) {
+            if (released[i] && step > getGapStart(i) && step < uses[i])
+                return false;
+        }
+        return true;
+    }
+};
+
+// An output recomputed before the operator at a step, with the outputs
+// recomputed to get there (inputs first, the output last), and the outputs
+// they read that must stay live.
+struct Recomputation {
+    int step;
+    std::vector<int> chain;
+    std::vector<int> reads;
+};
+
+class RecomputePlanner {
+   public:
+    RecomputePlanner(Network* network, const std::vector<Operator*>& _order)
+            : order(_order), numSteps(_order.size()),
+              transientBytes(_order.size(), 0) {
+        const Graph& graph = network->getGraph();
+        std::vector<int> steps(num_vertices(graph), 0);
+        for (int i = 0; i < numSteps; i++)
+            steps[order[i]->getVertex()] = i;
+        for (Operator* op : order) {
+            if (op->getOpType() == OpType::Data)
+                continue;
+            for (auto output : op->getOutputs()) {
+                if (!output)
+                    continue;
+                indices[output] = activations.size();
+                // A ConvertOp keeps its output across runs to skip converting
+                // an unchanged input (e.g. a weight) again.
+                bool releasable = !network->isStateUpdate(output) &&
+                                  op->getOpType() != OpType::Convert;
+                activations.push_back({ dynamic_cast<Tensor*>(output), op,
+                                        getTensorBytes(output),
+                                        steps[op->getVertex()],
+                                        {},
+                                        {},
+                                        releasable });
+            }
+        }
+        for (Operator* op : order) {
+            for (auto input : op->getInputs()) {
+                auto it = indices.find(input);
+                if (it == indices.end())
+                    continue;
+                std::vector<int>& uses = activations[it->second].uses;
+                int step = steps[op->getVertex()];
+                if (std::find(uses.begin(), uses.end(), step) == uses.end())
+                    uses.push_back(step);
+            }
+        }
+        for (auto& act : activations) {
+            std::sort(act.uses.begin(), act.uses.end());
+            act.released.assign(act.uses.size(), false);
+        }
+    }
+
+    RecomputePlan plan(int64_t budgetBytes) {
+        RecomputePlan plan;
+        plan.budgetBytes = budgetBytes;
+        std::vector<int64_t> liveBytes = getLiveBytesPerStep();
+        plan.peakBytesBefore =
+                *std::max_element(liveBytes.begin(), liveBytes.end());
+        // The releases that made the peak worse, by activation and use.
+        std::set<std::pair<int, int>> rejected;
+        while (true) {
+            auto peak = std::max_element(liveBytes.begin(), liveBytes.end());
+            int peakStep = peak - liveBytes.begin();
+            if (*peak <= budgetBytes)
+                break;
+            int bestAct = -1, bestUse = -1;
+            double bestScore = 0;
+            Recomputation bestRecomputation;
+            for (int a = 0; a < activations.size(); a++) {
+                const Activation& act = activations[a];
+                if (!act.releasable)
+                    continue;
+                for (int i = 0; i < act.uses.size(); i++) {
+                    if (act.released[i] || rejected.count({ a, i }) ||
+                        peakStep <= act.getGapStart(i) ||
+                        peakStep >= act.uses[i] ||
+                        isReadByRecomputation(a, act.getGapStart(i),
+                                              act.uses[i]))
+                        continue;
+                    Recomputation recomputation;
+                    recomputation.step = act.uses[i];
+                    if (!collectChain(a, recomputation, 0))
+                        continue;
+                    int64_t work = 0;
+                    for (int c : recomputation.chain)
+                        work += activations[c].tensor->getShape().size();
+                    double score = double(act.bytes) / work;
+                    if (score > bestScore) {
+                        bestScore = score;
+                        bestAct = a;
+                        bestUse = i;
+                        bestRecomputation = recomputation;
+                    }
+                }
+            }
+            if (bestAct == -1)
+                break;
+            apply(bestAct, bestUse, bestRecomputation, true);
+            std::vector<int64_t> newLiveBytes = getLiveBytesPerStep();
+            if (*std::max_element(newLiveBytes.begin(), newLiveBytes.end()) >
+                *peak) {
+                // The outputs recomputed with it outweigh what it saves.
+                apply(bestAct, bestUse, bestRecomputation, false);
+                rejected.insert({ bestAct, bestUse });
+                continue;
+            }
+            recomputations.push_back(bestRecomputation);
+            liveBytes = newLiveBytes;
+        }
+        plan.peakBytesAfter =
+                *std::max_element(liveBytes.begin(), liveBytes.end());
+
+        for (auto& act : activations) {
+            if (!act.releasable || act.uses.empty())
+                continue;
+            for (int i = 0; i < act.uses.size(); i++) {
+                if (act.released[i]) {
+                    plan.releaseAfter[order[act.getGapStart(i)]->getVertex()]
+                            .push_back(act.tensor);
+                    plan.numRecomputedOutputs++;
+                }
+            }
+            plan.releaseAfter[order[act.uses.back()]->getVertex()].push_back(
+                    act.tensor);
+        }
+        for (auto& recomputation : recomputations) {
+            Vertex vertex = order[recomputation.step]->getVertex();
+            std::vector<Operator*>& ops = plan.recomputeBefore[vertex];
+            for (int c : recomputation.chain) {
+                const Activation& act = activations[c];
+                if (std::find(ops.begin(), ops.end(), act.producer) !=
+                    ops.end())
+                    continue;
+                ops.push_back(act.producer);
+                plan.extraFlops += act.tensor->getShape().size();
+                // The outputs recomputed on the way are released right after
+                // the operator has run.
+                if (c != recomputation.chain.back())
+                    plan.releaseAfter[vertex].push_back(act.tensor);
+            }
+        }
+        return plan;
+    }
+
+   protected:
+    std::vector<int64_t> getLiveBytesPerStep() const {
+        std::vector<int64_t> delta(numSteps + 1, 0);
+        for (auto& act : activations) {
+            int start = act.produced;
+            for (int i = 0; i < act.uses.size(); i++) {
+                if (act.released[i]) {
+                    delta[start] += act.bytes;
+                    delta[act.getGapStart(i) + 1] -= act.bytes;
+                    start = act.uses[i];
+                }
+            }
+            delta[start] += act.bytes;
+            delta[act.getLastStep(numSteps) + 1] -= act.bytes;
+        }
+        std::vector<int64_t> liveBytes(numSteps, 0);
+        int64_t bytes = 0;
+        for (int i = 0; i < numSteps; i++) {
+            bytes += delta[i];
+            liveBytes[i] = bytes + transientBytes[i];
+        }
+        return liveBytes;
+    }
+
+    // Adds the outputs to recompute activation a at the step of the
+    // recomputation to its chain, if they can all be recomputed from live
+    // inputs.
+    bool collectChain(int a, Recomputation& recomputation, int depth) const {
+        const Activation& act = activations[a];
+        if (depth == kMaxRecomputeDepth || !act.releasable ||
+            !isCheapToRecompute(act.producer->getOpType()))
+            return false;
+        std::vector<int>& chain = recomputation.chain;
+        for (auto input : act.producer->getInputs()) {
+            auto it = indices.find(input);
+            // The outputs of Data operators are always resident.
+            if (it == indices.end())
+                continue;
+            int b = it->second;
+            if (activations[b].isLiveAt(recomputation.step, numSteps)) {
+                recomputation.reads.push_back(b);
+            } else if (std::find(chain.begin(), chain.end(), b) ==
+                       chain.end()) {
+                if (!collectChain(b, recomputation, depth + 1))
+                    return false;
+            }
+        }
+        chain.push_back(a);
+        return true;
+    }
+
+    // Returns true if a planned recomputation between the steps relies on
+    // activation a being live.
+    bool isReadByRecomputation(int a, int start, int end) const {
+        for (auto& recomputation : recomputations) {
+            if (recomputation.step > start && recomputation.step < end &&
+                std::find(recomputation.reads.begin(),
+                          recomputation.reads.end(),
+                          a) != recomputation.reads.end())
+                return true;
+        }
+        return false;
+    }
+
+    void apply(int a, int use, const Recomputation& recomputation, bool add) {
+        activations[a].released[use] = add;
+        for (int c : recomputation.chain) {
+            if (c != a) {
+                transientBytes[recomputation.step] +=
+                        add ? activations[c].bytes : -activations[c].bytes;
+            }
+        }
+    }
+
+    const std::vector<Operator*>& order;
+    int numSteps;
+    std::vector<Activation> activations;
+    std::map<TensorBase*, int> indices;
+    // The bytes of the outputs recomputed at each step only to recompute
+    // another one.
+    std::vector<int64_t> transientBytes;
+    std::vector<Recomputation> recomputations;
+};
+
+// The index of the outputs of a SwitchOp for each branch.
+const int kFalseBranch = SwitchOp<ReferenceBackend>::OutputFalse;
+const int kTrueBranch = SwitchOp<ReferenceBackend>::OutputTrue;
+
+// Returns the operators that only run if the branch of the switch is taken:
+// the consumers of its output for the branch, and their consumers up to the
+// merges.
+std::vector<Vertex> getBranchOperators(const Graph& graph,
+                                       Operator* switchOp,
+                                       int branch) {
+    std::vector<bool> visited(num_vertices(graph), false);
+    std::vector<Vertex> worklist;
+    out_edge_iter outEdgeIt, outEdgeEnd;
+    for (boost::tie(outEdgeIt, outEdgeEnd) =
+                 out_edges(switchOp->getVertex(), graph);
+         outEdgeIt != outEdgeEnd;
+         ++outEdgeIt) {
+        if (get(boost::edge_name, graph, *outEdgeIt).srcIdx == branch)
+            worklist.push_back(target(*outEdgeIt, graph));
+    }
+    std::vector<Vertex> branchOps;
+    while (!worklist.empty()) {
+        Vertex v = worklist.back();
+        worklist.pop_back();
+        if (visited[v])
+            continue;
+        visited[v] = true;
+        if (get(boost::vertex_op, graph, v)->getOpType() == OpType::Merge)
+            continue;
+        branchOps.push_back(v);
+        for (boost::tie(outEdgeIt, outEdgeEnd) = out_edges(v, graph);
+             outEdgeIt != outEdgeEnd;
+             ++outEdgeIt)
+            worklist.push_back(target(*outEdgeIt, graph));
+    }
+    return branchOps;
+}
+
+}  // namespace
+
+bool isCheapToRecompute(OpType type) {
+    switch (type) {
+        case OpType::EltwiseAdd:
+        case OpType::EltwiseMul:
+        case OpType::Less:
+        case OpType::LessEqual:
+        case OpType::Greater:
+        case OpType::GreaterEqual:
+        case OpType::ReLU:
+        case OpType::LReLU:
+        case OpType::ELU:
+        case OpType::SELU:
+        case OpType::Tanh:
+        case OpType::HardTanh:
+        case OpType::Sigmoid:
+        case OpType::Reorder:
+            return true;
+        default:
+            return false;
+    }
+}
+
+void RecomputePlan::print(std::ostream& os) const {
+    os << "Recomputation plan for a budget of " << budgetBytes
+       << " live bytes:\n";
+    os << "  Peak live bytes: " << peakBytesBefore << " -> " << peakBytesAfter
+       << " (" << peakBytesBefore - peakBytesAfter << " bytes saved)\n";
+    os << "  Outputs recomputed per run: " << numRecomputedOutputs
+       << ", extra FLOPs per run: " << extraFlops << "\n";
+    if (!withinBudget()) {
+        os << "  The budget can't be met by recomputing the outputs of cheap "
+              "operators.\n";
+    }
+}
+
+const char* getSchedulingPolicyName(SchedulingPolicy policy) {
+    switch (policy) {
+        case FifoScheduling:
+            return "fifo";
+        case GreedyMemoryScheduling:
+            return "greedy";
+        case MinMemoryScheduling:
+            return "min-memory";
+    }
+    return "unknown";
+}
+
+LiveBytesTracker::LiveBytesTracker(Network* network)
+        : liveBytes(0), peakLiveBytes(0) {
+    for (auto nameOp : network->getOperators()) {
+        Operator* op = nameOp.second;
+        if (op->getOpType() == OpType::Data)
+            continue;
+        for (auto output : op->getOutputs()) {
+            if (output)
+                pendingUses[output] = 0;
+        }
+    }
+    for (auto nameOp : network->getOperators()) {
+        for (auto input : nameOp.second->getInputs()) {
+            auto it = pendingUses.find(input);
+            if (it != pendingUses.end())
+                it->second++;
+        }
+    }
+}
+
+int64_t LiveBytesTracker::getBytesFreedBy(Operator* op) const {
+    // An operator can read the same tensor more than once.
+    std::map<TensorBase*, int> uses;
+    for (auto input : op->getInputs()) {
+        if (pendingUses.count(input))
+            uses[input]++;
+    }
+    int64_t bytes = 0;
+    for (auto& use : uses) {
+        if (pendingUses.at(use.first) == use.second)
+            bytes += getTensorBytes(use.first);
+    }
+    return bytes;
+}
+
+int64_t LiveBytesTracker::getBytesAllocatedBy(Operator* op) const {
+    int64_t bytes = 0;
+    for (auto output : op->getOutputs()) {
+        if (output && pendingUses.count(output))
+            bytes += getTensorBytes(output);
+    }
+    return bytes;
+}
+
+void LiveBytesTracker::run(Operator* op) {
+    // The outputs are allocated while the inputs are still being read.
+    for (auto output : op->getOutputs()) {
+        if (output && pendingUses.count(output))
+            restore(output);
+    }
+    for (auto input : op->getInputs()) {
+        auto it = pendingUses.find(input);
+        if (it != pendingUses.end() && --it->second == 0)
+            release(input);
+    }
+}
+
+void LiveBytesTracker::restore(TensorBase* tensor) {
+    if (liveTensors.insert(tensor).second) {
+        liveBytes += getTensorBytes(tensor);
+        peakLiveBytes = std::max(peakLiveBytes, liveBytes);
+    }
+}
+
+void LiveBytesTracker::release(TensorBase* tensor) {
+    if (liveTensors.erase(tensor))
+        liveBytes -= getTensorBytes(tensor);
+}
+
 Tensor* Scheduler::runNetwork() {
+    auto contextScope = ExecutionContext::Scope(context);
+    // Only the layers of this run are reported.
+    smv::SystolicArray::clear();
+    PerfProjection::clear();
+    if (!networkTiled) {
+        tileNetwork();
+        networkTiled = true;
+    }
+
+    std::cout << "======================================================\n";
+    std::cout << "      Scheduling operators of the network...\n";
+    std::cout << "======================================================\n";
+    // Initialize number of pending inputs for every operator and put Data
+    // operators into the ready queue. Tensors marked dead by the control flow
+    // of a previous run are revived. The tensors of Data operators never die,
+    // and they are left alone since they may be shared with other Networks.
+    readyQueue.clear();
+    const Graph& graph = network->getGraph();
+    numPendingInputs.assign(num_vertices(graph), 0);
+    for (auto nameOp : network->getOperators()) {
+        Operator* op = nameOp.second;
+        if (op->getOpType() != OpType::Data) {
+            for (auto output : op->getOutputs())
+                output->setDead(false);
+        }
+        Vertex vertex = op->getVertex();
+        numPendingInputs[vertex] = boost::in_degree(vertex, graph);
+        if (numPendingInputs[vertex] == 0)
+            readyQueue.push_back(op);
+    }
+    if (policy == MinMemoryScheduling)
+        minMemoryRanks = computeMinMemoryRanks();
+    hoistedOps = computeHoistedOps();
+    if (memoryBudget > 0 && !recomputePlanned) {
+        recomputePlan = planRecomputation(policy, memoryBudget);
+        recomputePlanned = true;
+        // The outputs managed by the plan are allocated when they are
+        // produced, instead of all at once when the network is built.
+        for (auto& opTensors : recomputePlan.releaseAfter) {
+            for (Tensor* tensor : opTensors.second)
+                tensor->releaseStorage();
+        }
+    }
+    Tensor* output;
+    {
+        auto stats =
+                gem5::ScopedStats(stats::kNetworkStart, stats::kNetworkEnd);
+        output = scheduleReady();
+    }
+    // Carry the final values of the state variables over to the next run.
+    network->updateStates();
+    return output;
+}
+
+void Scheduler::tileNetwork() {
     std::cout << "======================================================\n";
     std::cout << "      Tiling operators of the network...\n";
     std::cout << "======================================================\n";
+    const Graph& graph = network->getGraph();
+    std::vector<bool> deferred(num_vertices(graph), false);
     for (auto nameOp : network->getOperators()) {
         Operator* op = nameOp.second;
+        if (op->getOpType() != OpType::Switch)
+            continue;
+        for (int branch : { kFalseBranch, kTrueBranch }) {
+            if (isLikelyBranch(op, branch))
+                continue;
+            for (Vertex v : getBranchOperators(graph, op, branch))
+                deferred[v] = true;
+        }
+    }
+    opTiled.assign(num_vertices(graph), false);
+    for (auto nameOp : network->getOperators()) {
+        Operator* op = nameOp.second;
+        if (deferred[op->getVertex()]) {
+            dout(0) << "Deferring the tiling of " << op->getName() << " ("
+                    << OpType_Name(op->getOpType()) << ").\n";
+            continue;
+        }
         dout(0) << "Tiling " << op->getName() << " ("
                 << OpType_Name(op->getOpType()) << ").\n";
         op->tile();
+        opTiled[op->getVertex()] = true;
     }
 
     // We have finished loading the model and building the network, as well as
@@ -30,54 +542,334 @@ Tensor* Scheduler::runNetwork() {
     // The fast-forwarding mode uses simpler CPUs, which will be switched to
     // OoO CPUs after it's done. Therefore, the initialization of the thread
     // pool must be after the fast-forwarding, otherwise the CPU IDs will be
-    // incorrect.
-    if (threadPool)
+    // incorrect. Native runs may have initialized it already, to decode the
+    // parameters in parallel.
+    if (threadPool && !threadPool->isInitialized())
         threadPool->initThreadPool();
+}
 
-    std::cout << "======================================================\n";
-    std::cout << "      Scheduling operators of the network...\n";
-    std::cout << "======================================================\n";
-    // Initialize number of pending inputs for every operator and put Data
-    // operators into the ready queue.
+bool Scheduler::isLikelyBranch(Operator* switchOp, int branch) const {
+    auto it = branchStats.find(switchOp->getName());
+    if (it == branchStats.end())
+        return false;
+    int taken = branch == kTrueBranch ? it->second.numTrue
+                                      : it->second.numFalse;
+    int runs = it->second.numTrue + it->second.numFalse;
+    return runs > 0 && 2 * taken >= runs;
+}
+
+std::vector<bool> Scheduler::computeHoistedOps() const {
+    const Graph& graph = network->getGraph();
+    std::vector<bool> hoisted(num_vertices(graph), false);
+    std::vector<Vertex> worklist;
     for (auto nameOp : network->getOperators()) {
-        Operator* op = nameOp.second;
-        Vertex vertex = op->getVertex();
-        int numPendingInputs = boost::in_degree(vertex, network->getGraph());
-        op->setNumPendingInputs(numPendingInputs);
-        if (numPendingInputs == 0)
-            readyQueue.push_back(op);
+        if (nameOp.second->getOpType() == OpType::Switch)
+            worklist.push_back(nameOp.second->getVertex());
     }
-    Tensor* output;
-    {
-        auto stats =
-                gem5::ScopedStats(stats::kNetworkStart, stats::kNetworkEnd);
-        output = scheduleReady();
+    while (!worklist.empty()) {
+        Vertex v = worklist.back();
+        worklist.pop_back();
+        if (hoisted[v])
+            continue;
+        hoisted[v] = true;
+        in_edge_iter inEdgeIt, inEdgeEnd;
+        for (boost::tie(inEdgeIt, inEdgeEnd) = in_edges(v, graph);
+             inEdgeIt != inEdgeEnd;
+             ++inEdgeIt)
+            worklist.push_back(source(*inEdgeIt, graph));
     }
-    return output;
+    return hoisted;
+}
+
+bool Scheduler::loadBranchStats(const std::string& fileName) {
+    std::ifstream file(fileName);
+    if (!file)
+        return true;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name) || name[0] == '#')
+            continue;
+        BranchStats stats;
+        if (!(fields >> stats.numFalse >> stats.numTrue))
+            return false;
+        branchStats[name].numFalse += stats.numFalse;
+        branchStats[name].numTrue += stats.numTrue;
+    }
+    return true;
+}
+
+bool Scheduler::saveBranchStats(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file)
+        return false;
+    file << "# <switch> <runs taking the false branch> "
+            "<runs taking the true branch>\n";
+    for (const auto& stats : branchStats) {
+        file << stats.first << " " << stats.second.numFalse << " "
+             << stats.second.numTrue << "\n";
+    }
+    return static_cast<bool>(file);
 }
 
 Tensor* Scheduler::scheduleReady() {
     Tensor* output;
-    for (auto op : readyQueue) {
+    LiveBytesTracker tracker(network);
+    while (!readyQueue.empty()) {
+        Operator* op = popNextReady(
+                readyQueue, tracker, policy, minMemoryRanks, hoistedOps);
         dout(0) << "Scheduling " << op->getName() << " ("
                 << OpType_Name(op->getOpType()) << ").\n";
+        if (recomputePlanned)
+            recomputeInputs(op, tracker);
         maybeRunOperator(op);
+        tracker.run(op);
+        if (recomputePlanned)
+            releaseOutputs(op, tracker);
         updateChildren(op);
         output = op->getOutput(0);
         dout(2) << *output << "\n";
     }
+    peakLiveBytes = tracker.getPeakLiveBytes();
     return output;
 }
 
+Operator* Scheduler::popNextReady(std::list<Operator*>& ready,
+                                  const LiveBytesTracker& tracker,
+                                  SchedulingPolicy _policy,
+                                  const std::vector<int>& ranks,
+                                  const std::vector<bool>& hoisted) const {
+    // Evaluating the predicates of the switches early marks the branches that
+    // are not taken dead before anything else on them is considered.
+    for (auto it = ready.begin(); it != ready.end(); ++it) {
+        if (hoisted[(*it)->getVertex()]) {
+            Operator* op = *it;
+            ready.erase(it);
+            return op;
+        }
+    }
+    auto next = ready.begin();
+    if (_policy == GreedyMemoryScheduling) {
+        // Ties go to the operator that became ready first.
+        int64_t bestGain = std::numeric_limits<int64_t>::min();
+        for (auto it = ready.begin(); it != ready.end(); ++it) {
+            int64_t gain = tracker.getBytesFreedBy(*it) -
+                           tracker.getBytesAllocatedBy(*it);
+            if (gain > bestGain) {
+                bestGain = gain;
+                next = it;
+            }
+        }
+    } else if (_policy == MinMemoryScheduling) {
+        for (auto it = ready.begin(); it != ready.end(); ++it) {
+            if (ranks[(*it)->getVertex()] < ranks[(*next)->getVertex()])
+                next = it;
+        }
+    }
+    Operator* op = *next;
+    ready.erase(next);
+    return op;
+}
+
+std::vector<int> Scheduler::computeMinMemoryRanks() const {
+    const Graph& graph = network->getGraph();
+    int numVertices = num_vertices(graph);
+    // For every operator, the bytes of its outputs, and the peak live bytes of
+    // running it together with everything it depends on, each producer
+    // finished before the next one is started.
+    std::vector<int64_t> outBytes(numVertices, 0);
+    std::vector<int64_t> peakBytes(numVertices, 0);
+    std::vector<std::vector<Vertex>> producers(numVertices);
+    // Running first the producer with the largest peak over what it leaves
+    // live minimizes the peak of its consumer (Liu's rule for trees).
+    auto largerResidue = [&](Vertex v0, Vertex v1) {
+        return peakBytes[v0] - outBytes[v0] > peakBytes[v1] - outBytes[v1];
+    };
+    std::list<Vertex> vertices;
+    boost::topological_sort(graph, std::front_inserter(vertices));
+    for (Vertex v : vertices) {
+        Operator* op = get(boost::vertex_op, graph, v);
+        if (op->getOpType() != OpType::Data) {
+            for (auto output : op->getOutputs()) {
+                if (output)
+                    outBytes[v] += getTensorBytes(output);
+            }
+        }
+        in_edge_iter inEdgeIt, inEdgeEnd;
+        for (boost::tie(inEdgeIt, inEdgeEnd) = in_edges(v, graph);
+             inEdgeIt != inEdgeEnd;
+             ++inEdgeIt) {
+            Vertex producer = source(*inEdgeIt, graph);
+            if (std::find(producers[v].begin(), producers[v].end(),
+                          producer) == producers[v].end())
+                producers[v].push_back(producer);
+        }
+        std::stable_sort(
+                producers[v].begin(), producers[v].end(), largerResidue);
+        int64_t heldBytes = 0;
+        for (Vertex producer : producers[v]) {
+            peakBytes[v] =
+                    std::max(peakBytes[v], heldBytes + peakBytes[producer]);
+            heldBytes += outBytes[producer];
+        }
+        peakBytes[v] = std::max(peakBytes[v], heldBytes + outBytes[v]);
+    }
+
+    // The order is the depth-first post-order from the outputs of the network.
+    // A producer shared by several consumers runs with the first of them.
+    std::vector<Vertex> sinks;
+    for (Vertex v : vertices) {
+        if (out_degree(v, graph) == 0)
+            sinks.push_back(v);
+    }
+    std::stable_sort(sinks.begin(), sinks.end(), largerResidue);
+    std::vector<int> ranks(numVertices, -1);
+    int nextRank = 0;
+    std::function<void(Vertex)> visit = [&](Vertex v) {
+        if (ranks[v] != -1)
+            return;
+        for (Vertex producer : producers[v])
+            visit(producer);
+        ranks[v] = nextRank++;
+    };
+    for (Vertex sink : sinks)
+        visit(sink);
+    return ranks;
+}
+
+int64_t Scheduler::estimatePeakLiveBytes(SchedulingPolicy _policy) const {
+    LiveBytesTracker tracker(network);
+    for (Operator* op : computeRunOrder(_policy))
+        tracker.run(op);
+    return tracker.getPeakLiveBytes();
+}
+
+std::vector<Operator*> Scheduler::computeRunOrder(
+        SchedulingPolicy _policy) const {
+    // Replays a run without running any operator.
+    const Graph& graph = network->getGraph();
+    std::vector<int> pendingInputs(num_vertices(graph), 0);
+    std::list<Operator*> ready;
+    for (auto nameOp : network->getOperators()) {
+        Vertex vertex = nameOp.second->getVertex();
+        pendingInputs[vertex] = boost::in_degree(vertex, graph);
+        if (pendingInputs[vertex] == 0)
+            ready.push_back(nameOp.second);
+    }
+    std::vector<int> ranks;
+    if (_policy == MinMemoryScheduling)
+        ranks = computeMinMemoryRanks();
+    std::vector<bool> hoisted = computeHoistedOps();
+    LiveBytesTracker tracker(network);
+    std::vector<Operator*> order;
+    while (!ready.empty()) {
+        Operator* op = popNextReady(ready, tracker, _policy, ranks, hoisted);
+        order.push_back(op);
+        tracker.run(op);
+        out_edge_iter outEdgeIt, outEdgeEnd;
+        for (boost::tie(outEdgeIt, outEdgeEnd) =
+                     out_edges(op->getVertex(), graph);
+             outEdgeIt != outEdgeEnd;
+             ++outEdgeIt) {
+            Vertex child = target(*outEdgeIt, graph);
+            if (--pendingInputs[child] == 0)
+                ready.push_back(get(boost::vertex_op, graph, child));
+        }
+    }
+    return order;
+}
+
+RecomputePlan Scheduler::planRecomputation(SchedulingPolicy _policy,
+                                           int64_t budgetBytes) const {
+    std::vector<Operator*> order = computeRunOrder(_policy);
+    RecomputePlanner planner(network, order);
+    return planner.plan(budgetBytes);
+}
+
+void Scheduler::printMemoryReport(std::ostream& os) const {
+    os << "Peak live bytes of the operator outputs per scheduling policy:\n";
+    for (SchedulingPolicy p :
+         { FifoScheduling, GreedyMemoryScheduling, MinMemoryScheduling }) {
+        os << "  " << getSchedulingPolicyName(p) << ": "
+           << estimatePeakLiveBytes(p) << "\n";
+    }
+}
+
 void Scheduler::maybeRunOperator(Operator* op) {
+    if (op->getOpType() == OpType::Data) {
+        // Data operators only expose their tensor, so there is nothing to run
+        // and the tensor doesn't change.
+        return;
+    }
     if (!op->isDead()) {
-        op->run();
+        // Outputs released by a recompute plan are allocated again.
+        for (auto output : op->getOutputs()) {
+            if (output && !output->containsData() &&
+                recomputePlan.releases(output)) {
+                Tensor* tensor = dynamic_cast<Tensor*>(output);
+                tensor->allocateStorage(tensor->getDataType());
+            }
+        }
+        // Operators on a branch are tiled the first time it is taken.
+        if (!opTiled.empty() && !opTiled[op->getVertex()]) {
+            dout(0) << "Tiling " << op->getName() << " ("
+                    << OpType_Name(op->getOpType()) << ").\n";
+            op->tile();
+            opTiled[op->getVertex()] = true;
+        }
+        {
+            auto projection = PerfProjection::ScopedOperator(
+                    op->getName(), OpType_Name(op->getOpType()));
+            op->run();
+        }
+        for (auto output : op->getOutputs())
+            dynamic_cast<Tensor*>(output)->incrDataVersion();
+        if (op->getOpType() == OpType::Switch) {
+            BranchStats& stats = branchStats[op->getName()];
+            if (op->getOutput(kTrueBranch)->isDead())
+                stats.numFalse++;
+            else
+                stats.numTrue++;
+        }
     } else {
         for (auto output : op->getOutputs())
             output->setDead();
     }
 }
 
+void Scheduler::recomputeInputs(Operator* op, LiveBytesTracker& tracker) {
+    auto it = recomputePlan.recomputeBefore.find(op->getVertex());
+    if (it == recomputePlan.recomputeBefore.end())
+        return;
+    for (Operator* producer : it->second) {
+        const auto& outputs = producer->getOutputs();
+        if (std::all_of(outputs.begin(), outputs.end(), [](TensorBase* t) {
+                return t->containsData();
+            }))
+            continue;
+        for (auto input : producer->getInputs()) {
+            assert(input->containsData() &&
+                   "The inputs of a recomputed operator must be resident!");
+        }
+        dout(1) << "Recomputing " << producer->getName() << " for "
+                << op->getName() << ".\n";
+        maybeRunOperator(producer);
+        for (auto output : outputs)
+            tracker.restore(output);
+    }
+}
+
+void Scheduler::releaseOutputs(Operator* op, LiveBytesTracker& tracker) {
+    auto it = recomputePlan.releaseAfter.find(op->getVertex());
+    if (it == recomputePlan.releaseAfter.end())
+        return;
+    for (Tensor* tensor : it->second) {
+        tensor->releaseStorage();
+        tracker.release(tensor);
+    }
+}
+
 void Scheduler::updateChildren(Operator* op) {
     const Graph& graph = network->getGraph();
     Vertex vertex = op->getVertex();
@@ -87,9 +879,9 @@ void Scheduler::updateChildren(Operator* op) {
          ++outEdgeIt) {
         Vertex childVertex = target(*outEdgeIt, graph);
         Operator* child = get(boost::vertex_op, graph, childVertex);
-        if (child->getNumPendingInputs() > 0) {
-            child->decrNumPendingInputs();
-            if (child->getNumPendingInputs() == 0)
+        if (numPendingInputs[childVertex] > 0) {
+            numPendingInputs[childVertex]--;
+            if (numPendingInputs[childVertex] == 0)
                 readyQueue.push_back(child);
         }
     }
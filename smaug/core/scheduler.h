@@ -1,23 +1,278 @@
+#ifndef _CORE_SCHEDULER_H_
+#define _CORE_SCHEDULER_H_
+
+#include <cstdint>
 #include <list>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
 
+#include "smaug/core/execution_context.h"
 #include "smaug/core/network.h"
 #include "smaug/core/workspace.h"
 #include "smaug/core/operator.h"
 
 namespace smaug {
 
+/**
+ * The order in which the Scheduler runs the operators that are ready. The
+ * policies only change which activations are live at the same time, not the
+ * work done.
+ */
+enum SchedulingPolicy {
+    /** In the order the operators become ready, i.e. breadth-first. */
+    FifoScheduling,
+    /** The ready operator that frees the most bytes, net of its outputs. */
+    GreedyMemoryScheduling,
+    /**
+     * A topological order precomputed to minimize the peak live bytes. It is
+     * optimal for trees of operators (the branches are scheduled one at a
+     * time, the one with the largest peak over its output first), and a
+     * heuristic for other graphs.
+     */
+    MinMemoryScheduling,
+};
+
+/** Returns the name of a policy, as accepted by the --scheduling option. */
+const char* getSchedulingPolicyName(SchedulingPolicy policy);
+
+/**
+ * Returns true if an operator of this type is cheap enough to run again
+ * instead of keeping its output: the elementwise, activation and reorder
+ * operators, which do about one operation per output element.
+ */
+bool isCheapToRecompute(OpType type);
+
+/**
+ * LiveBytesTracker follows the operator outputs that are live while the
+ * operators of a Network run. An output is live from when its operator runs
+ * until its last consumer has run. The outputs of Data operators (the inputs
+ * and parameters of the Network) are always resident and are not counted.
+ */
+class LiveBytesTracker {
+   public:
+    LiveBytesTracker(Network* network);
+
+    /** Returns the bytes of the inputs of the operator it is the last user of. */
+    int64_t getBytesFreedBy(Operator* op) const;
+    /** Returns the bytes of the outputs of the operator. */
+    int64_t getBytesAllocatedBy(Operator* op) const;
+    /** Updates the live outputs after the operator has run. */
+    void run(Operator* op);
+    /** Counts an output as live again, after it has been recomputed. */
+    void restore(TensorBase* tensor);
+    /** Stops counting an output as live, once its storage is released. */
+    void release(TensorBase* tensor);
+
+    int64_t getLiveBytes() const { return liveBytes; }
+    int64_t getPeakLiveBytes() const { return peakLiveBytes; }
+
+   protected:
+    /** The number of consumers each counted output is still waiting on. */
+    std::map<TensorBase*, int> pendingUses;
+    /** The outputs that are currently live. */
+    std::set<TensorBase*> liveTensors;
+    int64_t liveBytes;
+    int64_t peakLiveBytes;
+};
+
+/**
+ * RecomputePlan trades work for memory. It lists the operator outputs that
+ * are released between two of their uses, and the operators that run again
+ * to bring them back just before the later use. Under a plan, the storage of
+ * every other output is also released after its last use and allocated when
+ * its operator runs, so that the resident activations follow the live bytes.
+ */
+struct RecomputePlan {
+    RecomputePlan()
+            : budgetBytes(0), peakBytesBefore(0), peakBytesAfter(0),
+              numRecomputedOutputs(0), extraFlops(0) {}
+
+    /** The outputs to release after an operator has run, by its vertex. */
+    std::map<Vertex, std::vector<Tensor*>> releaseAfter;
+    /** The operators to run again before an operator runs, by its vertex. */
+    std::map<Vertex, std::vector<Operator*>> recomputeBefore;
+
+    int64_t budgetBytes;
+    /** The peak live bytes without and with the recomputations. */
+    int64_t peakBytesBefore;
+    int64_t peakBytesAfter;
+    /** The number of outputs that are recomputed in every run. */
+    int numRecomputedOutputs;
+    /**
+     * The work recomputed in every run, as the number of output elements of
+     * the recomputed operators.
+     */
+    int64_t extraFlops;
+
+    bool withinBudget() const { return peakBytesAfter <= budgetBytes; }
+    /** Returns true if the plan releases this output between its uses. */
+    bool releases(const TensorBase* tensor) const {
+        for (const auto& opTensors : releaseAfter) {
+            for (const Tensor* released : opTensors.second) {
+                if (released == tensor)
+                    return true;
+            }
+        }
+        return false;
+    }
+    void print(std::ostream& os) const;
+};
+
+/** The number of runs that took each branch of a SwitchOp. */
+struct BranchStats {
+    BranchStats() : numFalse(0), numTrue(0) {}
+    int numFalse;
+    int numTrue;
+};
+
 /**
  * Scheduler is responsible for running the Network.
+ *
+ * All the state of a run is kept in the Scheduler and the Network, so
+ * different Networks can be run concurrently on different threads, each by its
+ * own Scheduler with its own ExecutionContext.
  */
 class Scheduler {
    public:
-    Scheduler(Network* _network, Workspace* _workspace)
-            : network(_network), workspace(_workspace) {}
+    /**
+     * Creates a Scheduler for the Network.
+     *
+     * @param _context The context to run the Network in. It is bound to the
+     * calling thread for the duration of every run. If null, the Network runs
+     * with the current settings of the calling thread.
+     */
+    Scheduler(Network* _network,
+              Workspace* _workspace,
+              ExecutionContext* _context = nullptr)
+            : network(_network), workspace(_workspace), context(_context),
+              policy(FifoScheduling), memoryBudget(0), recomputePlanned(false),
+              peakLiveBytes(0), networkTiled(false) {}
     virtual ~Scheduler(){};
-    /** Runs the Network to completion. The final output tensor is returned. */
-    Tensor* runNetwork();
+
+    void setPolicy(SchedulingPolicy _policy) {
+        policy = _policy;
+        recomputePlanned = false;
+    }
+    SchedulingPolicy getPolicy() const { return policy; }
+
+    /**
+     * Sets a budget for the live bytes of the operator outputs. If the
+     * policy alone doesn't keep a run within it, the next run plans which
+     * outputs of cheap operators to recompute (see planRecomputation()). A
+     * budget of zero, the default, keeps every output allocated.
+     */
+    void setMemoryBudget(int64_t bytes) {
+        memoryBudget = bytes;
+        recomputePlanned = false;
+    }
+    int64_t getMemoryBudget() const { return memoryBudget; }
+
+    /** Returns the plan the runs follow under the memory budget. */
+    const RecomputePlan& getRecomputePlan() const { return recomputePlan; }
+
+    /**
+     * Plans the recomputations that bring the peak live bytes of a run with
+     * the given policy down to budgetBytes.
+     *
+     * While the peak is over the budget, one output that is live at the peak
+     * without being used there is released until its next use, which then
+     * recomputes it. Only the outputs of cheap operators (see
+     * isCheapToRecompute()) are recomputed, from inputs that are resident at
+     * that point, or that are recomputed in turn. Among the candidates, the
+     * output that saves the most bytes per recomputed element is picked.
+     * This stops when the peak is within the budget, or when no output live
+     * at the peak can be recomputed.
+     */
+    RecomputePlan planRecomputation(SchedulingPolicy _policy,
+                                    int64_t budgetBytes) const;
+
+    /**
+     * Returns how often each SwitchOp, by name, took each branch. The counts
+     * accumulate over the runs of this Scheduler and the statistics loaded
+     * with loadBranchStats().
+     */
+    const std::map<std::string, BranchStats>& getBranchStats() const {
+        return branchStats;
+    }
+
+    /**
+     * Adds the branch statistics from a file written by saveBranchStats().
+     * They decide which branches are tiled up front by the first run. A
+     * missing file holds no statistics. Returns false if it can't be parsed.
+     */
+    bool loadBranchStats(const std::string& fileName);
+    /**
+     * Writes the branch statistics to a text file, with one
+     * "<switch> <false count> <true count>" entry per line. Returns false on
+     * error.
+     */
+    bool saveBranchStats(const std::string& fileName) const;
+
+    /** Returns true if the operator has been tiled by a run. */
+    bool isTiled(Operator* op) const {
+        return !opTiled.empty() && opTiled.at(op->getVertex());
+    }
+
+    /**
+     * Returns the peak number of bytes of the operator outputs that were live
+     * at the same time in the last run. An output is live from when its
+     * operator runs until its last consumer has run; the outputs of Data
+     * operators are not counted.
+     */
+    int64_t getPeakLiveBytes() const { return peakLiveBytes; }
+
+    /**
+     * Returns the peak live bytes that a run of the Network would have with
+     * the given policy, without running it.
+     */
+    int64_t estimatePeakLiveBytes(SchedulingPolicy _policy) const;
+
+    /**
+     * Returns the order in which a run of the Network with the given policy
+     * runs the operators, without running them.
+     */
+    std::vector<Operator*> computeRunOrder(SchedulingPolicy _policy) const;
+
+    /** Prints the estimated peak live bytes of every policy. */
+    void printMemoryReport(std::ostream& os) const;
+    /**
+     * Runs the Network to completion. The final output tensor is returned.
+     *
+     * The Network can be run repeatedly by the same Scheduler, like a
+     * persistent session: operators are only tiled on the first run, and the
+     * state variables of the Network carry their final values of one run
+     * into the next.
+     */
+    virtual Tensor* runNetwork();
 
    protected:
+    /**
+     * Tiles the operators in the Network and ends the fast-forwarding phase
+     * of the simulation.
+     *
+     * The operators on a branch of a SwitchOp are only tiled when they first
+     * run, so that the weight tiles of a branch that is never taken are never
+     * copied. The branches that the branch statistics say are likely are
+     * still tiled here, which speculatively prefetches their weight tiles.
+     */
+    void tileNetwork();
+
+    /**
+     * Returns true if the branch statistics say the branch of the SwitchOp is
+     * taken at least half of the time.
+     */
+    bool isLikelyBranch(Operator* switchOp, int branch) const;
+
+    /**
+     * Returns the SwitchOps and everything they depend on, indexed by
+     * vertex. These operators run before any other ready operator, so that
+     * the predicates are evaluated as early as their dependencies allow.
+     */
+    std::vector<bool> computeHoistedOps() const;
+
     /**
      * Runs the operators in the ready queue. This may add new operators to
      * the ready queue by calling updateChildren().
@@ -32,6 +287,15 @@ class Scheduler {
      */
     void maybeRunOperator(Operator* op);
 
+    /**
+     * Runs again the operators that the recompute plan schedules before op,
+     * skipping those whose outputs are still allocated.
+     */
+    void recomputeInputs(Operator* op, LiveBytesTracker& tracker);
+
+    /** Releases the outputs that the recompute plan releases after op. */
+    void releaseOutputs(Operator* op, LiveBytesTracker& tracker);
+
     /**
      * After an Operator is run, this updates the number of pending inputs on
      * all its children. Any child Operator with no more pending inputs is then
@@ -39,11 +303,59 @@ class Scheduler {
      */
     void updateChildren(Operator* op);
 
+    /**
+     * Removes the operator that the policy runs next from the ready
+     * operators.
+     */
+    Operator* popNextReady(std::list<Operator*>& ready,
+                           const LiveBytesTracker& tracker,
+                           SchedulingPolicy _policy,
+                           const std::vector<int>& ranks,
+                           const std::vector<bool>& hoisted) const;
+
+    /**
+     * Computes the run order of MinMemoryScheduling, as the rank of every
+     * operator indexed by its vertex.
+     */
+    std::vector<int> computeMinMemoryRanks() const;
+
     Network* network;
     Workspace* workspace;
+    ExecutionContext* context;
 
     /** The queue of all Operators ready to be executed. */
     std::list<Operator*> readyQueue;
+
+    /**
+     * The number of input tensors that each Operator is still waiting on,
+     * indexed by its vertex. An Operator is ready to run when this drops to
+     * zero.
+     */
+    std::vector<int> numPendingInputs;
+
+    SchedulingPolicy policy;
+
+    /** The ranks of the operators under MinMemoryScheduling. */
+    std::vector<int> minMemoryRanks;
+
+    /** The operators that are hoisted, indexed by vertex. */
+    std::vector<bool> hoistedOps;
+    /** Whether each operator has been tiled, indexed by vertex. */
+    std::vector<bool> opTiled;
+    std::map<std::string, BranchStats> branchStats;
+
+    int64_t memoryBudget;
+    /** The plan the runs follow, if the memory budget is set. */
+    RecomputePlan recomputePlan;
+    /** True if recomputePlan is up to date with the policy and budget. */
+    bool recomputePlanned;
+
+    int64_t peakLiveBytes;
+
+    /** True if the operators have been tiled by a previous run. */
+    bool networkTiled;
 };
 
 }  // namespace smaug
+
+#endif
@@ -1,6 +1,11 @@
+#include <algorithm>
+
+#include "fp16.h"
 #include "smaug/core/tensor.h"
+#include "smaug/core/param_codec.h"
 #include "smaug/core/tensor_utils.h"
 #include "smaug/core/globals.h"
+#include "smaug/operators/common.h"
 #include "smaug/utility/thread_pool.h"
 
 namespace smaug {
@@ -13,6 +18,29 @@ TensorShapeProto* TensorShape::asTensorShapeProto() {
     return shapeProto;
 }
 
+void Tensor::fillHalfDataFromFloat(
+        const google::protobuf::RepeatedField<float>& externalData) {
+    allocateStorage<float16>();
+    float16* rawPtr = data<float16>();
+    int size = std::min(externalData.size(), shape.storageSize());
+    for (int i = 0; i < size; i++)
+        rawPtr[i] = fp16_ieee_from_fp32_value(externalData.Get(i));
+}
+
+void Tensor::fillEncodedData(const EncodedTensorData& encoded) {
+    if (dataType == Float16 && encoded.data_type() == Float32) {
+        google::protobuf::RepeatedField<float> floatData;
+        floatData.Resize(encoded.num_elements(), 0);
+        decodeTensorData(encoded, floatData.mutable_data(), floatData.size());
+        fillHalfDataFromFloat(floatData);
+        return;
+    }
+    assert(encoded.data_type() == dataType &&
+           "The encoded data doesn't match the tensor data type!");
+    allocateStorage(dataType);
+    decodeTensorData(encoded, tensorData.get(), shape.storageSize());
+}
+
 TensorProto* Tensor::asTensorProto() {
     TensorProto* tensorProto = new TensorProto();
     tensorProto->set_name(name);
@@ -62,12 +90,107 @@ TensorProto* Tensor::asTensorProto() {
     return tensorProto;
 }
 
+namespace {
+
+bool isNonzero(float16 value) { return (value & 0x7fff) != 0; }
+bool isNonzero(float value) { return value != 0; }
+
+// Marks the blocks that contain a nonzero element of the tensor, row by row
+// along its innermost dimension so that alignment padding is skipped.
+template <typename T>
+void markOccupiedBlocks(const T* data,
+                        const TensorShape& shape,
+                        std::vector<bool>& occupancy) {
+    int rowSize = shape[shape.ndims() - 1];
+    int rowStride = shape.getStorageDim(shape.ndims() - 1);
+    int numRows = shape.size() / rowSize;
+    for (int row = 0; row < numRows; row++) {
+        for (int i = row * rowStride; i < row * rowStride + rowSize; i++) {
+            if (isNonzero(data[i]))
+                occupancy[i / Tensor::kOccupancyBlockSize] = true;
+        }
+    }
+}
+
+}  // namespace
+
+void Tensor::computeOccupancy() {
+    int numBlocks =
+            FRAC_CEIL(shape.storageSize(), Tensor::kOccupancyBlockSize);
+    occupancy.assign(numBlocks, false);
+    switch (dataType) {
+        case Float16:
+            markOccupiedBlocks(data<float16>(), shape, occupancy);
+            break;
+        case Float32:
+            markOccupiedBlocks(data<float>(), shape, occupancy);
+            break;
+        default:
+            // Only activations are tracked.
+            occupancy.clear();
+            return;
+    }
+    // The data becomes visible to consumers under the next version.
+    occupancyVersion = dataVersion + 1;
+}
+
+bool Tensor::isStorageRangeZero(int start, int size) const {
+    if (!hasOccupancy() || size <= 0)
+        return false;
+    int lastBlock = (start + size - 1) / kOccupancyBlockSize;
+    for (int block = start / kOccupancyBlockSize; block <= lastBlock; block++) {
+        if (occupancy[block])
+            return false;
+    }
+    return true;
+}
+
+bool Tensor::isRegionZero(const std::vector<int>& origin,
+                          const std::vector<int>& regionSize) const {
+    if (!hasOccupancy())
+        return false;
+    // Check the region one row of its innermost dimension at a time.
+    std::vector<int> advance(regionSize.size(), 1);
+    advance.back() = regionSize.back();
+    for (auto index = TensorRegionIndexIterator(shape, origin, regionSize);
+         !index.end(); index += advance) {
+        if (!isStorageRangeZero(index, regionSize.back()))
+            return false;
+    }
+    return true;
+}
+
+void Tensor::fillZeros() {
+    memset(tensorData.get(), 0, shape.storageSize() * getDataTypeSize());
+}
+
 Tensor* TiledTensor::getTileWithData(int index) {
+    dropStaleTileData();
     Tile* tile = &tiles[index];
     copyDataToTile(tile);
     return tile->tensor;
 }
 
+bool TiledTensor::isTileZero(int index) const {
+    if (!origTensor || !origTensor->hasOccupancy())
+        return false;
+    const Tile& tile = tiles.at(index);
+    if (!tile.tensor)
+        return false;
+    const TensorShape& tileShape = tile.tensor->getShape();
+    if (tile.tensor == origTensor) {
+        return origTensor->isRegionZero(
+                std::vector<int>(tileShape.ndims(), 0), tileShape.dims());
+    }
+    if (!tile.hasOrigin)
+        return false;
+    if (useRawTensor) {
+        return origTensor->isStorageRangeZero(
+                tile.origin[0], tileShape.storageSize());
+    }
+    return origTensor->isRegionZero(tile.origin, tileShape.dims());
+}
+
 void TiledTensor::setTile(int index,
                           const std::vector<int>& origin,
                           Tensor* tensor,
@@ -101,19 +224,21 @@ void TiledTensor::parallelCopyTileData(TileDataOperation op) {
     int totalNumTiles = tiles.size();
     int numTilesPerThread = std::ceil(totalNumTiles * 1.0 / threadPool->size());
     int remainingTiles = totalNumTiles;
+    std::vector<void*> args;
     while (remainingTiles > 0) {
         int numTiles = std::min(numTilesPerThread, remainingTiles);
-        auto args = new CopyTilesArgs(
-                this, totalNumTiles - remainingTiles, numTiles, op);
-        int cpuid =
-                threadPool->dispatchThread(tileCopyWorker, (void*)args);
-        assert(cpuid != -1 && "Failed to dispatch thread!");
+        args.push_back(new CopyTilesArgs(
+                this, totalNumTiles - remainingTiles, numTiles, op));
         remainingTiles -= numTiles;
     }
+    // Hand out all the chunks in one batch.
+    int numDispatched = threadPool->dispatchThreads(tileCopyWorker, args);
+    assert(numDispatched == args.size() && "Failed to dispatch thread!");
     threadPool->joinThreadPool();
 }
 
 void TiledTensor::copyDataToAllTiles() {
+    dropStaleTileData();
     // Don't copy if all the tiles have data filled.
     if (dataFilled)
         return;
@@ -129,6 +254,44 @@ void TiledTensor::copyDataToAllTiles() {
     dataFilled = true;
 }
 
+void TiledTensor::packTiles() {
+    if (dataFormat == TilePacked)
+        return;
+    assert(origTensor != nullptr &&
+           "TiledTensor must have the original tensor to pack data from!");
+    // A single tile is the original tensor itself, which is already
+    // contiguous.
+    if (tiles.size() == 1 && tiles[0].tensor == origTensor)
+        return;
+
+    // Every tile starts on a cacheline boundary so that the DMA of a tile
+    // never straddles into its neighbor.
+    DataType dataType = origTensor->getDataType();
+    int elemSize = origTensor->getDataTypeSize();
+    std::vector<size_t> offsets(tiles.size());
+    size_t totalSize = 0;
+    for (int i = 0; i < tiles.size(); i++) {
+        offsets[i] = totalSize;
+        totalSize += next_multiple(
+                tiles[i].tensor->getShape().storageSize() * elemSize,
+                CACHELINE_SIZE);
+    }
+    std::shared_ptr<void> packedData(malloc_aligned(totalSize, true), free);
+    char* basePtr = reinterpret_cast<char*>(packedData.get());
+    for (int i = 0; i < tiles.size(); i++) {
+        // Each tile aliases its slot in the packed buffer, which is kept alive
+        // for as long as any tile refers to it.
+        tiles[i].tensor->setStorage(
+                std::shared_ptr<void>(packedData, basePtr + offsets[i]),
+                dataType);
+        tiles[i].tensor->setDataStorageFormat(TilePacked);
+        tiles[i].hasData = false;
+    }
+    dataFilled = false;
+    copyDataToAllTiles();
+    dataFormat = TilePacked;
+}
+
 void TiledTensor::copyDataToTile(Tile* tile) {
     // Don't copy if the tile already has data,  or if the tile is the original
     // tensor (we have only one tile).
@@ -138,7 +301,10 @@ void TiledTensor::copyDataToTile(Tile* tile) {
     // Perform the data copy.
     assert(tile->hasOrigin &&
            "Must set the tile's origin in the original tensor!");
-    if (useRawTensor) {
+    if (isTileZero(tile - tiles.data())) {
+        // Nothing needs to be read from the original tensor.
+        tile->tensor->fillZeros();
+    } else if (useRawTensor) {
         // Use the raw tensor copy function for the unary tile.
         copyRawTensorData(tile->tensor, origTensor, 0, tile->origin[0],
                           tile->tensor->getShape().storageSize());
@@ -150,6 +316,15 @@ void TiledTensor::copyDataToTile(Tile* tile) {
     tile->hasData = true;
 }
 
+void TiledTensor::dropStaleTileData() {
+    if (!origTensor || origTensor->getDataVersion() == origDataVersion)
+        return;
+    for (auto& tile : tiles)
+        tile.hasData = false;
+    dataFilled = false;
+    origDataVersion = origTensor->getDataVersion();
+}
+
 void TiledTensor::untile() {
     assert(origTensor != nullptr &&
            "TiledTensor must have the original tensor to copy data to!");
@@ -288,6 +288,7 @@ class TensorBase {
     int dim(int index) const { return shape[index]; }
     int getTotalDim(int index) const { return shape.getStorageDim(index); }
     int getDataStorageFormat() const { return dataFormat; }
+    void setDataStorageFormat(DataStorageFormat format) { dataFormat = format; }
     DataType getDataType() const { return dataType; }
     int getDataTypeSize() const {
         switch (dataType) {
@@ -343,11 +344,14 @@ class TensorBase {
  */
 class Tensor : public TensorBase {
    public:
-    Tensor() : TensorBase(), tensorData(NULL) {}
+    Tensor()
+            : TensorBase(), tensorData(NULL), dataVersion(0),
+              occupancyVersion(-1) {}
 
     /** Construct a Tensor with the given name and shape. */
     Tensor(const std::string& _name, const TensorShape& _shape)
-            : TensorBase(_name, _shape), tensorData(NULL) {}
+            : TensorBase(_name, _shape), tensorData(NULL), dataVersion(0),
+              occupancyVersion(-1) {}
     virtual ~Tensor() {}
 
     /**
@@ -357,39 +361,57 @@ class Tensor : public TensorBase {
      * @param tensorData The data contents of the Tensor.
      */
     Tensor(const TensorProto& tensorProto, const TensorData& tensorData)
-            : TensorBase(tensorProto), tensorData(NULL) {
-        DataType dataType = tensorProto.data_type();
+            : TensorBase(tensorProto), tensorData(NULL), dataVersion(0),
+              occupancyVersion(-1) {
+        fillData(tensorData);
+    }
+
+    /** Returns an iterator starting at the beginning of the Tensor. */
+    TensorIndexIterator startIndex() const {
+        return TensorIndexIterator(shape);
+    }
+
+    virtual bool containsData() const { return tensorData != nullptr; }
+
+    /**
+     * Fills the Tensor with serialized data. The data type of the Tensor must
+     * already be set, and it selects the field of protoData to read from.
+     */
+    void fillData(const TensorData& protoData) {
+        if (protoData.has_encoded_data()) {
+            fillEncodedData(protoData.encoded_data());
+            return;
+        }
         switch (dataType) {
             case Float16:
-                fillHalfData(tensorData.half_data());
+                // A model emitted in fp32 can be loaded into fp16 storage
+                // (see useFp16ReferenceStorage).
+                if (protoData.half_data_size() == 0 &&
+                    protoData.float_data_size() > 0)
+                    fillHalfDataFromFloat(protoData.float_data());
+                else
+                    fillHalfData(protoData.half_data());
                 break;
             case Float32:
-                fillData<float>(tensorData.float_data());
+                fillData<float>(protoData.float_data());
                 break;
             case Float64:
-                fillData<double>(tensorData.double_data());
+                fillData<double>(protoData.double_data());
                 break;
             case Int32:
-                fillData<int>(tensorData.int_data());
+                fillData<int>(protoData.int_data());
                 break;
             case Int64:
-                fillData<int64_t>(tensorData.int64_data());
+                fillData<int64_t>(protoData.int64_data());
                 break;
             case Bool:
-                fillData<bool>(tensorData.bool_data());
+                fillData<bool>(protoData.bool_data());
                 break;
             default:
                 assert(false && "Unknown data format!");
         }
     }
 
-    /** Returns an iterator starting at the beginning of the Tensor. */
-    TensorIndexIterator startIndex() const {
-        return TensorIndexIterator(shape);
-    }
-
-    virtual bool containsData() const { return tensorData != nullptr; }
-
     /**
      * Fills the Tensor with externalData.
      *
@@ -464,6 +486,16 @@ class Tensor : public TensorBase {
 #endif
     }
 
+    /**
+     * Fills the tensor with data in a compact parameter encoding (see
+     * smaug/core/param_codec.h).
+     */
+    void fillEncodedData(const EncodedTensorData& encoded);
+
+    /** Fills the tensor with float16 data, rounded from float32 data. */
+    void fillHalfDataFromFloat(
+            const google::protobuf::RepeatedField<float>& externalData);
+
     /**
      * Allocates memory to store Tensor data.
      *
@@ -511,9 +543,74 @@ class Tensor : public TensorBase {
         }
     }
 
+    /**
+     * Makes this Tensor use an externally managed buffer for its data. Any
+     * storage previously owned by the Tensor is released.
+     *
+     * @param storage The buffer. It may alias a larger allocation.
+     * @param _dataType The type of data stored in the buffer.
+     */
+    void setStorage(std::shared_ptr<void> storage, DataType _dataType) {
+        tensorData = storage;
+        dataType = _dataType;
+    }
+
+    /**
+     * Releases the storage of this Tensor. The data type is kept, so the
+     * storage can be allocated again with allocateStorage(getDataType()).
+     */
+    void releaseStorage() { tensorData.reset(); }
+
     /** Serializes this Tensor to a TensorProto. */
     TensorProto* asTensorProto();
 
+    /**
+     * Returns the version of the data in this Tensor. The version is bumped
+     * every time the contents are overwritten, which lets TiledTensors know
+     * when the copies in their tiles have gone stale.
+     */
+    int getDataVersion() const { return dataVersion; }
+    void incrDataVersion() { dataVersion++; }
+
+    /**
+     * The number of consecutive elements of storage covered by one entry of
+     * the occupancy bitmap. This is the width of the SMV vector registers.
+     */
+    static const int kOccupancyBlockSize = 8;
+
+    /**
+     * Builds the occupancy bitmap of this Tensor, which records the blocks of
+     * kOccupancyBlockSize elements that contain a nonzero value. Alignment
+     * padding is ignored.
+     *
+     * Operators that produce sparse outputs (e.g. ReLU) call this at the end
+     * of run(). The bitmap describes the data that the scheduler publishes by
+     * bumping the data version once the operator has run, so it only becomes
+     * valid then, and is invalidated by the next write after that.
+     */
+    void computeOccupancy();
+
+    /** Returns true if the occupancy bitmap describes the current data. */
+    bool hasOccupancy() const { return occupancyVersion == dataVersion; }
+
+    /**
+     * Returns true if the occupancy bitmap shows that the given range of the
+     * underlying storage is all zero. Without a valid bitmap, this
+     * conservatively returns false.
+     */
+    bool isStorageRangeZero(int start, int size) const;
+
+    /**
+     * Returns true if the occupancy bitmap shows that the rectangular region
+     * with the given origin and size is all zero. Without a valid bitmap, this
+     * conservatively returns false.
+     */
+    bool isRegionZero(const std::vector<int>& origin,
+                      const std::vector<int>& regionSize) const;
+
+    /** Sets all the storage of this Tensor, including padding, to zero. */
+    void fillZeros();
+
     /**
      * Returns a const pointer to the Tensor data.
      */
@@ -539,6 +636,15 @@ class Tensor : public TensorBase {
 
    protected:
     std::shared_ptr<void> tensorData;
+
+    /** The number of times the data of this Tensor has been overwritten. */
+    int dataVersion;
+
+    /** One entry per storage block; true if the block has a nonzero value. */
+    std::vector<bool> occupancy;
+
+    /** The data version that the occupancy bitmap describes. */
+    int occupancyVersion;
 };
 
 /**
@@ -553,7 +659,8 @@ class TiledTensor : public TensorBase {
   public:
    TiledTensor(Tensor* _origTensor = nullptr, bool _useRawTensor = false)
            : TensorBase(), origTensor(_origTensor), useRawTensor(_useRawTensor),
-             dataFilled(false) {}
+             dataFilled(false),
+             origDataVersion(_origTensor ? _origTensor->getDataVersion() : 0) {}
    /**
     * Construct a TiledTensor.
     *
@@ -568,7 +675,8 @@ class TiledTensor : public TensorBase {
                Tensor* _origTensor = nullptr,
                bool _useRawTensor = false)
            : TensorBase("", shape), origTensor(_origTensor),
-             useRawTensor(_useRawTensor), dataFilled(false) {
+             useRawTensor(_useRawTensor), dataFilled(false),
+             origDataVersion(_origTensor ? _origTensor->getDataVersion() : 0) {
        tiles.resize(shape.size());
    }
 
@@ -582,6 +690,9 @@ class TiledTensor : public TensorBase {
    Tensor*& operator[](int index) { return tiles[index].tensor; }
    int size() const { return shape.size(); }
 
+   /** Returns the Tensor that is being tiled. */
+   Tensor* getOrigTensor() const { return origTensor; }
+
    /**
     * Returns true if this TiledTensor is tiled along the N and H logical
     * dimensions.
@@ -603,6 +714,19 @@ class TiledTensor : public TensorBase {
     */
    Tensor* getTileWithData(int index);
 
+   /**
+    * Returns true if the occupancy bitmap of the original Tensor shows that
+    * the tile at the given index is all zero. Operators can skip such tiles
+    * entirely, including their data transfers.
+    */
+   bool isTileZero(int index) const;
+
+   /** Returns the origin of the tile in the original Tensor. */
+   const std::vector<int>& getTileOrigin(int index) const {
+       assert(tiles.at(index).hasOrigin && "The tile has no origin!");
+       return tiles.at(index).origin;
+   }
+
    /**
     * Set the specified tile to the provided Tensor, and optionally copy data
     * into it.
@@ -615,6 +739,21 @@ class TiledTensor : public TensorBase {
    /** Copies data (if needed) to all the tiles from the original Tensor. */
    void copyDataToAllTiles();
 
+   /**
+    * Packs the tiles back to back into one contiguous buffer and fills them
+    * with data from the original Tensor.
+    *
+    * Tiles are laid out in their linear index order, each starting on a
+    * cacheline boundary. The data within a tile keeps the tile's own dense
+    * layout, which is what the SMV kernels index, so packing only turns the
+    * strided gather of a tile into a single contiguous copy; it does not
+    * reorder elements into kernel panels. This is meant for read-only data
+    * like weights and is done once, at tiling time. Afterwards, the
+    * storage format of this TiledTensor is TilePacked. The tiles don't need
+    * to have storage beforehand; any storage they have is replaced.
+    */
+   void packTiles();
+
    /**
     * Copies data from the TiledTensor into the original Tensor. We name it
     * "untile" because what it does reverses the tiling process.
@@ -677,6 +816,12 @@ class TiledTensor : public TensorBase {
    /** Copy data from this tile to the original Tensor. */
    void gatherDataFromTile(Tile* tile);
 
+   /**
+    * Forgets the data copied into the tiles if the original Tensor has been
+    * overwritten since, so that the next copy refreshes them.
+    */
+   void dropStaleTileData();
+
    /** Split the work (data filling or gathering) across multiple threads. */
    void parallelCopyTileData(TileDataOperation op);
 
@@ -689,6 +834,9 @@ class TiledTensor : public TensorBase {
    /** True if all the tiles have data filled. */
    bool dataFilled;
 
+   /** The data version of the original Tensor the tiles were copied from. */
+   int origDataVersion;
+
    /** The list of Tiles, indexed using a TensorIndexIterator. */
    std::vector<Tile> tiles;
 };
@@ -1,8 +1,11 @@
 #include "catch.hpp"
 #include "smaug/core/backend.h"
 #include "smaug/core/tensor.h"
+#include "smaug/core/tensor_utils.h"
+#include "smaug/core/param_codec.h"
 #include "smaug/core/smaug_test.h"
 #include "smaug/operators/data_op.h"
+#include "smaug/utility/thread_pool.h"
 
 using namespace smaug;
 
@@ -52,3 +55,225 @@ TEST_CASE_METHOD(SmaugTest, "Unpacking of float16 tensor data", "[fp16]") {
     }
 }
 
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Loading float32 data into float16 storage",
+                 "[fp16]") {
+    // A model emitted in fp32 can be loaded into fp16 storage, as with
+    // useFp16ReferenceStorage.
+    TensorProto tensorProto;
+    tensorProto.set_name("input");
+    tensorProto.set_data_type(Float16);
+    tensorProto.mutable_shape()->add_dims(5);
+    tensorProto.mutable_shape()->set_layout(DataLayout::X);
+    TensorData tensorData;
+    for (float value : { 1.1f, -2.2f, 3.3f, 65504.0f, 1e-8f })
+        tensorData.add_float_data(value);
+    Tensor tensor(tensorProto, tensorData);
+    REQUIRE(tensor.getDataType() == Float16);
+    std::vector<float16> expectedValues{ fp16(1.1), fp16(-2.2), fp16(3.3),
+                                         fp16(65504), fp16(1e-8) };
+    verifyOutputs(&tensor, expectedValues);
+}
+
+TEST_CASE("Bulk float16 conversions", "[fp16]") {
+    // Long enough for the F16C path, with a tail converted one at a time.
+    std::vector<float> values{ 1.1f, -2.2f, 3.3f, 65504.0f, 1e-8f, 0, -0.5f,
+                               1e5f, 7.7f, 2049 };
+    std::vector<float16> halfs(values.size());
+    convertFp32ToFp16(values.data(), halfs.data(), values.size());
+    for (int i = 0; i < values.size(); i++)
+        REQUIRE(halfs[i] == fp16(values[i]));
+    std::vector<float> widened(values.size());
+    convertFp16ToFp32(halfs.data(), widened.data(), halfs.size());
+    for (int i = 0; i < values.size(); i++)
+        REQUIRE(widened[i] == fp32(halfs[i]));
+}
+
+TEST_CASE_METHOD(SmaugTest, "Compact parameter encodings", "[params]") {
+    SECTION("Same format as the Python encoder") {
+        std::vector<float> values{ 0, 0, 0, 0, 1, 1, 1, 2 };
+        EncodedTensorData encoded;
+        encodeTensorData(values.data(), Float32, values.size(),
+                         ShuffleRleEncoding, &encoded, 8);
+        REQUIRE(encoded.chunks_size() == 1);
+        REQUIRE(encoded.chunks(0) ==
+                std::string("\x91\x00\x80\x80\x82\x00\x80\x3f\x00\x40", 10));
+        encodeTensorData(values.data(), Float32, values.size(),
+                         ShuffleDeltaRleEncoding, &encoded, 8);
+        REQUIRE(encoded.chunks(0) ==
+                std::string("\x91\x00\x03\x80\x00\x00\x80\x81\x00\x03"
+                            "\x3f\x00\x00\x01",
+                            14));
+    }
+
+    TensorProto tensorProto;
+    tensorProto.set_name("weights");
+    tensorProto.mutable_shape()->add_dims(1000);
+    tensorProto.mutable_shape()->add_dims(37);
+    tensorProto.mutable_shape()->set_layout(DataLayout::NC);
+    int numElements = 1000 * 37;
+    std::vector<float16> values(numElements, 0);
+    for (int i = 0; i < numElements; i += 3)
+        values[i] = fp16(i * 0.01f);
+    auto checkDecoding = [&](const TensorProto& tensorProto,
+                             ParamEncoding encoding) {
+        TensorData tensorData;
+        encodeTensorData(values.data(), Float16, values.size(), encoding,
+                         tensorData.mutable_encoded_data(), 1024);
+        REQUIRE(tensorData.encoded_data().chunks_size() == 37);
+        Tensor tensor(tensorProto, tensorData);
+        verifyOutputs(&tensor, values);
+    };
+    tensorProto.set_data_type(Float16);
+
+    SECTION("Serial decoding") {
+        for (auto encoding : { ShuffleEncoding, ShuffleRleEncoding,
+                               ShuffleDeltaRleEncoding })
+            checkDecoding(tensorProto, encoding);
+    }
+
+    SECTION("Parallel decoding on the thread pool") {
+        ThreadPool pool(3);
+        pool.initThreadPool();
+        threadPool = &pool;
+        for (auto encoding : { ShuffleEncoding, ShuffleRleEncoding,
+                               ShuffleDeltaRleEncoding })
+            checkDecoding(tensorProto, encoding);
+        threadPool = nullptr;
+    }
+
+    SECTION("Padded float16 data") {
+        // The Python frontend pads an odd number of float16 elements.
+        values.push_back(0);
+        tensorProto.mutable_shape()->set_dims(1, 1);
+        TensorData tensorData;
+        encodeTensorData(values.data(), Float16, 1001, ShuffleRleEncoding,
+                         tensorData.mutable_encoded_data(), 64);
+        Tensor tensor(tensorProto, tensorData);
+        verifyOutputs(&tensor,
+                      std::vector<float16>(values.begin(),
+                                           values.begin() + 1000));
+    }
+
+    SECTION("Float32 data into float16 storage") {
+        std::vector<float> floatValues{ 1.1f, -2.2f, 0, 0, 0, 0, 3.3f };
+        tensorProto.mutable_shape()->set_dims(0, 7);
+        tensorProto.mutable_shape()->set_dims(1, 1);
+        TensorData tensorData;
+        encodeTensorData(floatValues.data(), Float32, floatValues.size(),
+                         ShuffleRleEncoding, tensorData.mutable_encoded_data());
+        Tensor tensor(tensorProto, tensorData);
+        std::vector<float16> expectedValues{ fp16(1.1), fp16(-2.2), 0, 0,
+                                             0,         0,          fp16(3.3) };
+        verifyOutputs(&tensor, expectedValues);
+    }
+}
+
+TEST_CASE_METHOD(SmaugTest, "Packing tiles of a TiledTensor", "[tiling]") {
+    auto op = new DataOp<SmvBackend>("weights", workspace());
+    TensorShape shape({ 8, 16 }, DataLayout::NC, SmvBackend::Alignment);
+    Tensor* tensor = new Tensor("weights", shape);
+    workspace()->addTensor(tensor);
+    tensor->allocateStorage<float16>();
+    float16* data = tensor->data<float16>();
+    for (auto idx = tensor->startIndex(); !idx.end(); ++idx)
+        data[idx] = fp16(idx * 0.01);
+    op->setData(tensor);
+
+    TensorShape tileShape({ 4, 8 }, DataLayout::NC, SmvBackend::Alignment);
+    TiledTensor tiledTensor = generateTiledTensor(tensor, tileShape, op);
+    REQUIRE(tiledTensor.size() == 4);
+    tiledTensor.packTiles();
+    REQUIRE(tiledTensor.getDataStorageFormat() == TilePacked);
+
+    // The tiles are laid out back to back in their linear index order.
+    const float16* base = tiledTensor[0]->data<float16>();
+    int offset = 0;
+    for (auto i = tiledTensor.startIndex(); !i.end(); ++i) {
+        Tensor* tile = tiledTensor[i];
+        REQUIRE(tile->getDataStorageFormat() == TilePacked);
+        REQUIRE(tile->data<float16>() == base + offset);
+        offset += tile->getShape().storageSize();
+    }
+
+    // Every tile holds its region of the original tensor.
+    auto tileIdx = tiledTensor.startIndex();
+    auto srcIdx = tensor->startIndex();
+    for (int r = 0; r < 2; r++) {
+        for (int c = 0; c < 2; c++) {
+            Tensor* tile = tiledTensor[tileIdx(r, c)];
+            const float16* tileData = tile->data<float16>();
+            auto idx = tile->startIndex();
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 8; j++) {
+                    REQUIRE(tileData[idx(i, j)] ==
+                            data[srcIdx(r * 4 + i, c * 8 + j)]);
+                }
+            }
+        }
+    }
+
+    // Packed tiling allocates the tiles directly in the packed buffer.
+    TiledTensor packed = generatePackedTiledTensor(tensor, tileShape, op);
+    REQUIRE(packed.getDataStorageFormat() == TilePacked);
+    const float16* packedBase = packed[0]->data<float16>();
+    offset = 0;
+    for (auto i = packed.startIndex(); !i.end(); ++i) {
+        Tensor* tile = packed[i];
+        REQUIRE(tile->data<float16>() == packedBase + offset);
+        int size = tile->getShape().storageSize();
+        for (int j = 0; j < size; j++)
+            REQUIRE(tile->data<float16>()[j] == base[offset + j]);
+        offset += size;
+    }
+}
+
+TEST_CASE_METHOD(SmaugTest, "Occupancy of sparse tensors", "[tiling]") {
+    auto op = new DataOp<SmvBackend>("input", workspace());
+    TensorShape shape({ 4, 20 }, DataLayout::NC, SmvBackend::Alignment);
+    Tensor* tensor = new Tensor("input", shape);
+    workspace()->addTensor(tensor);
+    tensor->allocateStorage<float16>();
+    float16* data = tensor->data<float16>();
+    // Only rows 0 and 3 have nonzero values, in columns 0 and 19. Negative
+    // zeros are zero too.
+    for (auto idx = tensor->startIndex(); !idx.end(); ++idx)
+        data[idx] = fp16(0);
+    data[tensor->startIndex()(1, 10)] = fp16(-0.0);
+    data[tensor->startIndex()(0, 0)] = fp16(1);
+    data[tensor->startIndex()(3, 19)] = fp16(2);
+    op->setData(tensor);
+
+    // The bitmap is only valid once the new data is published.
+    tensor->computeOccupancy();
+    REQUIRE(!tensor->hasOccupancy());
+    REQUIRE(!tensor->isRegionZero({ 1, 0 }, { 2, 20 }));
+    tensor->incrDataVersion();
+    REQUIRE(tensor->hasOccupancy());
+
+    REQUIRE(tensor->isRegionZero({ 1, 0 }, { 2, 20 }));
+    REQUIRE(tensor->isRegionZero({ 0, 8 }, { 4, 8 }));
+    REQUIRE(!tensor->isRegionZero({ 0, 0 }, { 1, 8 }));
+    REQUIRE(!tensor->isRegionZero({ 2, 16 }, { 2, 4 }));
+
+    TensorShape tileShape({ 2, 8 }, DataLayout::NC, SmvBackend::Alignment);
+    TiledTensor tiledTensor = generateTiledTensor(tensor, tileShape, op);
+    REQUIRE(tiledTensor.size() == 6);
+    auto tileIdx = tiledTensor.startIndex();
+    REQUIRE(!tiledTensor.isTileZero(tileIdx(0, 0)));
+    REQUIRE(tiledTensor.isTileZero(tileIdx(0, 1)));
+    REQUIRE(tiledTensor.isTileZero(tileIdx(0, 2)));
+    REQUIRE(tiledTensor.isTileZero(tileIdx(1, 0)));
+    REQUIRE(tiledTensor.isTileZero(tileIdx(1, 1)));
+    REQUIRE(!tiledTensor.isTileZero(tileIdx(1, 2)));
+    // Zero tiles are filled without reading the original tensor.
+    Tensor* tile = tiledTensor.getTileWithData(tileIdx(1, 1));
+    for (auto idx = tile->startIndex(); !idx.end(); ++idx)
+        REQUIRE(tile->data<float16>()[idx] == 0);
+
+    // Overwriting the tensor invalidates the bitmap.
+    tensor->incrDataVersion();
+    REQUIRE(!tensor->hasOccupancy());
+    REQUIRE(!tiledTensor.isTileZero(tileIdx(0, 1)));
+}
@@ -1,10 +1,18 @@
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 
 #include "fp16.h"
+#include "smaug/core/globals.h"
 #include "smaug/core/tensor.h"
 #include "smaug/core/tensor_utils.h"
 #include "smaug/core/workspace.h"
 #include "smaug/utility/debug_stream.h"
+#include "smaug/utility/thread_pool.h"
 
 namespace smaug {
 
@@ -171,7 +179,183 @@ void copyRawTensorData(Tensor* dest,
     }
 }
 
+namespace {
+
+// Runs no longer than this are copied with SIMD registers rather than memcpy.
+const int64_t kMaxShortRunBytes = 256;
+// Copies of fewer bytes than this are not worth dispatching to the threads.
+const int64_t kMinParallelCopyBytes = 1 << 16;
+
+uint8_t* getRawData(Tensor* tensor) {
+    switch (tensor->getDataType()) {
+        case Float16:
+            return reinterpret_cast<uint8_t*>(tensor->data<float16>());
+        case Float32:
+            return reinterpret_cast<uint8_t*>(tensor->data<float>());
+        case Float64:
+            return reinterpret_cast<uint8_t*>(tensor->data<double>());
+        case Int32:
+            return reinterpret_cast<uint8_t*>(tensor->data<int>());
+        case Int64:
+            return reinterpret_cast<uint8_t*>(tensor->data<int64_t>());
+        case Bool:
+            return reinterpret_cast<uint8_t*>(tensor->data<bool>());
+        default:
+            assert(false && "Unknown data type!");
+            return nullptr;
+    }
+}
+
+inline void copyRun(uint8_t* dest, const uint8_t* src, int64_t numBytes) {
+    if (numBytes > kMaxShortRunBytes) {
+        std::memcpy(dest, src, numBytes);
+        return;
+    }
+    int64_t i = 0;
+    for (; i + 16 <= numBytes; i += 16) {
+        _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(dest + i),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    }
+    for (; i < numBytes; i++)
+        dest[i] = src[i];
+}
+
+struct CopyRowsArgs {
+    const std::function<void(int64_t, int64_t)>* copyRows;
+    int64_t start;
+    int64_t numRows;
+
+    CopyRowsArgs(const std::function<void(int64_t, int64_t)>* _copyRows,
+                 int64_t _start,
+                 int64_t _numRows)
+            : copyRows(_copyRows), start(_start), numRows(_numRows) {}
+};
+
+void* copyRowsWorker(void* _args) {
+    auto args = reinterpret_cast<CopyRowsArgs*>(_args);
+    (*args->copyRows)(args->start, args->numRows);
+    delete args;
+    return nullptr;
+}
+
+// Calls copyRows(start, numRows) on chunks of the rows [0, numRows), which
+// run on the thread pool if they copy enough bytes in total.
+void parallelCopyRows(int64_t numRows,
+                      int64_t totalBytes,
+                      const std::function<void(int64_t, int64_t)>& copyRows) {
+    if (fastForwardMode || !threadPool || !threadPool->isInitialized() ||
+        numRows < 2 || totalBytes < kMinParallelCopyBytes) {
+        copyRows(0, numRows);
+        return;
+    }
+    int64_t numRowsPerThread =
+            std::ceil(numRows * 1.0 / threadPool->size());
+    std::vector<void*> args;
+    for (int64_t start = 0; start < numRows; start += numRowsPerThread) {
+        args.push_back(new CopyRowsArgs(
+                &copyRows, start, std::min(numRowsPerThread, numRows - start)));
+    }
+    int numDispatched = threadPool->dispatchThreads(copyRowsWorker, args);
+    assert(numDispatched == args.size() && "Failed to dispatch thread!");
+    threadPool->joinThreadPool();
+}
+
+}  // namespace
+
+void copyTensorSlices(Tensor* dest,
+                      Tensor* src,
+                      int axis,
+                      int destStart,
+                      int srcStart,
+                      int numSlices) {
+    assert(dest->getDataType() == src->getDataType());
+    assert(dest->ndims() == src->ndims());
+    const TensorShape& destShape = dest->getShape();
+    const TensorShape& srcShape = src->getShape();
+    int ndims = srcShape.ndims();
+    // The dimensions after the axis are copied whole, alignment padding
+    // included, so their storage must match.
+    int64_t innerBytes = src->getDataTypeSize();
+    for (int i = axis + 1; i < ndims; i++) {
+        if (destShape.getStorageDim(i) != srcShape.getStorageDim(i)) {
+            std::vector<int> destOrigin(ndims, 0);
+            std::vector<int> srcOrigin(ndims, 0);
+            std::vector<int> regionSize = srcShape.dims();
+            destOrigin[axis] = destStart;
+            srcOrigin[axis] = srcStart;
+            regionSize[axis] = numSlices;
+            copyTensorRegion(dest, src, destOrigin, srcOrigin, regionSize);
+            return;
+        }
+        innerBytes *= srcShape.getStorageDim(i);
+    }
+    int64_t numRuns = 1;
+    for (int i = 0; i < axis; i++)
+        numRuns *= srcShape[i];
+    uint8_t* destPtr = getRawData(dest) + destStart * innerBytes;
+    const uint8_t* srcPtr = getRawData(src) + srcStart * innerBytes;
+    int64_t destStride = destShape.getStorageDim(axis) * innerBytes;
+    int64_t srcStride = srcShape.getStorageDim(axis) * innerBytes;
+    int64_t runBytes = numSlices * innerBytes;
+    parallelCopyRows(
+            numRuns, numRuns * runBytes, [&](int64_t start, int64_t num) {
+                for (int64_t r = start; r < start + num; r++) {
+                    copyRun(destPtr + r * destStride, srcPtr + r * srcStride,
+                            runBytes);
+                }
+            });
+}
+
+void repeatTensorData(Tensor* dest, Tensor* src) {
+    assert(dest->getDataType() == src->getDataType());
+    assert(dest->ndims() == src->ndims());
+    const TensorShape& destShape = dest->getShape();
+    const TensorShape& srcShape = src->getShape();
+    int ndims = srcShape.ndims();
+    int64_t elemBytes = src->getDataTypeSize();
+    // Every row of the innermost dimension of the destination is a number of
+    // back to back copies of a row of the source.
+    int64_t srcRowBytes = srcShape[ndims - 1] * elemBytes;
+    int64_t destRowStride = destShape.getStorageDim(ndims - 1) * elemBytes;
+    int64_t srcRowStride = srcShape.getStorageDim(ndims - 1) * elemBytes;
+    int numCopies = destShape[ndims - 1] / srcShape[ndims - 1];
+    int64_t numRows = 1;
+    for (int i = 0; i < ndims - 1; i++)
+        numRows *= destShape[i];
+    uint8_t* destPtr = getRawData(dest);
+    const uint8_t* srcPtr = getRawData(src);
+    parallelCopyRows(
+            numRows, numRows * numCopies * srcRowBytes,
+            [&](int64_t start, int64_t num) {
+                for (int64_t r = start; r < start + num; r++) {
+                    // The source row is the destination row index modulo the
+                    // source dimensions.
+                    int64_t srcRow = 0;
+                    int64_t rest = r;
+                    int64_t srcRowsPerIndex = 1;
+                    for (int i = ndims - 2; i >= 0; i--) {
+                        srcRow += (rest % destShape[i]) % srcShape[i] *
+                                  srcRowsPerIndex;
+                        rest /= destShape[i];
+                        srcRowsPerIndex *= srcShape[i];
+                    }
+                    uint8_t* destRow = destPtr + r * destRowStride;
+                    const uint8_t* srcRowPtr = srcPtr + srcRow * srcRowStride;
+                    for (int c = 0; c < numCopies; c++)
+                        copyRun(destRow + c * srcRowBytes, srcRowPtr,
+                                srcRowBytes);
+                }
+            });
+}
+
 namespace internal {
+// Compute the number of elements in this dimension that numWindows
+// consecutive filter windows read.
+int computeFieldDim(int numWindows, int weightDim, int stride) {
+    return weightDim + stride * (numWindows - 1);
+}
+
 // Compute the tile size in this dimension with padding accounted for. The goal
 // is to get the tile dimension size that doesn't have any elements unused,
 // given the padding, weight and stride sizes.
@@ -191,11 +375,23 @@ int computePaddedTileDim(int maxTileDim,
     int numStrides = (maxTileDim + padding - weightDim) / stride;
     if (numStrides <= 0)
         return maxTileDim;
-    int tileDim = weightDim + stride * numStrides;
+    int tileDim = computeFieldDim(numStrides + 1, weightDim, stride);
     return tileDim - padding;
 }
 }  // namespace internal
 
+std::pair<int, int> computeInputRowRange(
+        int start, int end, int fieldRows, int rowStride, int topPad) {
+    int first = start * rowStride - topPad;
+    return { first, first + internal::computeFieldDim(
+                                    end - start, fieldRows, rowStride) };
+}
+
+int64_t getTensorBytes(TensorBase* tensor) {
+    return static_cast<int64_t>(tensor->getShape().storageSize()) *
+           tensor->getDataTypeSize();
+}
+
 TiledTensor generateTiledTensorPerBatchNC(Tensor* tensor,
                                           const TensorShape& tileShape,
                                           Operator* op,
@@ -230,16 +426,20 @@ TiledTensor generateTiledTensorPerBatchNC(Tensor* tensor,
     return tiledTensor;
 }
 
-TiledTensor generateTiledTensorWithStrideAndPadding(
-        Tensor* tensor,
-        const TensorShape& tileShape,
-        Operator* op,
-        int fieldRows,
-        int fieldCols,
-        int rowStride,
-        int colStride,
-        PaddingType paddingType,
-        bool copyData) {
+namespace {
+
+// Implements generateTiledTensorWithStrideAndPadding(). If allocateTiles is
+// false, the tiles are created without storage, for the caller to allocate.
+TiledTensor generateTiles(Tensor* tensor,
+                          const TensorShape& tileShape,
+                          Operator* op,
+                          int fieldRows,
+                          int fieldCols,
+                          int rowStride,
+                          int colStride,
+                          PaddingType paddingType,
+                          bool copyData,
+                          bool allocateTiles) {
     const TensorShape& inputShape = tensor->getShape();
     const int ndims = inputShape.ndims();
     DataLayout layout = inputShape.getLayout();
@@ -308,7 +508,8 @@ TiledTensor generateTiledTensorWithStrideAndPadding(
             std::string tileName = op->getName() + ":" + tensor->getName() +
                                    "/tile:" + std::to_string((int)tileIndex);
             Tensor* tile = new Tensor(tileName, currentShape);
-            tile->allocateStorage(tensor->getDataType());
+            if (allocateTiles)
+                tile->allocateStorage(tensor->getDataType());
             tiledTensor.setTile(tileIndex, currentOrigin, tile, false);
             for (int i = ndims - 1; i >= 0; i--) {
                 currentOrigin[i] += currentShape[i];
@@ -332,6 +533,22 @@ TiledTensor generateTiledTensorWithStrideAndPadding(
     return tiledTensor;
 }
 
+}  // namespace
+
+TiledTensor generateTiledTensorWithStrideAndPadding(
+        Tensor* tensor,
+        const TensorShape& tileShape,
+        Operator* op,
+        int fieldRows,
+        int fieldCols,
+        int rowStride,
+        int colStride,
+        PaddingType paddingType,
+        bool copyData) {
+    return generateTiles(tensor, tileShape, op, fieldRows, fieldCols,
+                         rowStride, colStride, paddingType, copyData, true);
+}
+
 TiledTensor generateTiledTensor(Tensor* tensor,
                                 const TensorShape& tileShape,
                                 Operator* op,
@@ -340,6 +557,73 @@ TiledTensor generateTiledTensor(Tensor* tensor,
             tensor, tileShape, op, 0, 0, 1, 1, ValidPadding, copyData);
 }
 
+TiledTensor generatePackedTiledTensor(Tensor* tensor,
+                                      const TensorShape& tileShape,
+                                      Operator* op) {
+    Workspace* workspace = op->getWorkspace();
+    if (const TiledTensor* cached =
+                workspace->getCachedTiledTensor(tensor, tileShape)) {
+        dout(1) << "  Sharing the tiles of " << tensor->getName() << "\n";
+        return *cached;
+    }
+    // The tiles are allocated directly in the packed buffer.
+    TiledTensor tiledTensor = generateTiles(
+            tensor, tileShape, op, 0, 0, 1, 1, ValidPadding, false, false);
+    tiledTensor.packTiles();
+    workspace->cacheTiledTensor(tensor, tileShape, tiledTensor);
+    return tiledTensor;
+}
+
+// The F16C versions are compiled for F16C (and AVX, for the 256-bit
+// registers) regardless of the build flags, and only run if the host has them.
+__attribute__((target("avx,f16c"))) static void convertFp16ToFp32F16c(
+        const float16* src, float* dst, int numElems) {
+    int i = 0;
+    for (; i + 8 <= numElems; i += 8) {
+        __m128i halfs =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(halfs));
+    }
+    for (; i < numElems; i++)
+        dst[i] = fp16_ieee_to_fp32_value(src[i]);
+}
+
+__attribute__((target("avx,f16c"))) static void convertFp32ToFp16F16c(
+        const float* src, float16* dst, int numElems) {
+    int i = 0;
+    for (; i + 8 <= numElems; i += 8) {
+        __m128i halfs = _mm256_cvtps_ph(_mm256_loadu_ps(src + i),
+                                        _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), halfs);
+    }
+    for (; i < numElems; i++)
+        dst[i] = fp16_ieee_from_fp32_value(src[i]);
+}
+
+static bool hostHasF16c() {
+    static const bool hasF16c =
+            __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    return hasF16c;
+}
+
+void convertFp16ToFp32(const float16* src, float* dst, int numElems) {
+    if (hostHasF16c()) {
+        convertFp16ToFp32F16c(src, dst, numElems);
+        return;
+    }
+    for (int i = 0; i < numElems; i++)
+        dst[i] = fp16_ieee_to_fp32_value(src[i]);
+}
+
+void convertFp32ToFp16(const float* src, float16* dst, int numElems) {
+    if (hostHasF16c()) {
+        convertFp32ToFp16F16c(src, dst, numElems);
+        return;
+    }
+    for (int i = 0; i < numElems; i++)
+        dst[i] = fp16_ieee_from_fp32_value(src[i]);
+}
+
 void flattenTiledTensor(TiledTensor& tiledTensor, Tensor* destTensor) {
     const TensorShape& tensorShape = destTensor->getShape();
     int ndims = tensorShape.ndims();
@@ -8,6 +8,7 @@
 
 #include <cstring>
 #include <iostream>
+#include <utility>
 #include <vector>
 
 #include "smaug/core/tensor.h"
@@ -196,6 +197,39 @@ void copyTensorData(Tensor* dest,
 void copyRawTensorData(
         Tensor* dest, Tensor* src, int destOffset, int srcOffset, int copySize);
 
+/**
+ * Copies a range of slices of a source Tensor along an axis to a range of
+ * slices of a destination Tensor. The other dimensions of the two Tensors
+ * must match. This is what Split and Concat do.
+ *
+ * Unlike copyTensorRegion, the strides are computed once: every index of the
+ * dimensions before the axis copies one contiguous run. Short runs (e.g. the
+ * channels of a pixel) are copied with SIMD registers, and the runs are split
+ * across the thread pool if there is enough data.
+ *
+ * @param dest Destination Tensor
+ * @param src Source Tensor
+ * @param axis The axis of the slices.
+ * @param destStart The first slice of the destination to write.
+ * @param srcStart The first slice of the source to read.
+ * @param numSlices The number of slices to copy.
+ */
+void copyTensorSlices(Tensor* dest,
+                      Tensor* src,
+                      int axis,
+                      int destStart,
+                      int srcStart,
+                      int numSlices);
+
+/**
+ * Fills a destination Tensor with copies of a source Tensor, repeated along
+ * every dimension: every destination element at index i is the source
+ * element at index i modulo the source dimensions. Each innermost row is
+ * written directly from the source, with the same copies as
+ * copyTensorSlices.
+ */
+void repeatTensorData(Tensor* dest, Tensor* src);
+
 /**
  * Tile the provided NC Tensor per batch.
  *
@@ -257,6 +291,44 @@ TiledTensor generateTiledTensor(Tensor* tensor,
                                 Operator* op,
                                 bool copyData = false);
 
+/**
+ * Generates a TiledTensor of read-only data, like weights, whose tiles are
+ * packed and filled at tiling time (see TiledTensor::packTiles()).
+ *
+ * The TiledTensor is cached in the operator's Workspace, so all the operators
+ * that tile the same Tensor with the same tile shape (e.g., the timesteps of an
+ * unrolled RNN) share one copy of the tiles.
+ */
+TiledTensor generatePackedTiledTensor(Tensor* tensor,
+                                      const TensorShape& tileShape,
+                                      Operator* op);
+
+/**
+ * Returns the input rows [first, last) that a filter of fieldRows rows,
+ * applied with rowStride, reads to compute the output rows [start, end). The
+ * first output row reads from topPad rows above the input, so the range can
+ * extend into the zero padding around the input. The ranges of consecutive
+ * output rows overlap by the same halo as the DimNH tiles of
+ * generateTiledTensorWithStrideAndPadding().
+ */
+std::pair<int, int> computeInputRowRange(
+        int start, int end, int fieldRows, int rowStride, int topPad);
+
+/** Returns the bytes of storage of a Tensor, including its padding. */
+int64_t getTensorBytes(TensorBase* tensor);
+
+/**
+ * Converts numElems fp16 values to fp32, eight at a time with F16C if the
+ * host supports it.
+ */
+void convertFp16ToFp32(const float16* src, float* dst, int numElems);
+
+/**
+ * Rounds numElems fp32 values to fp16 (round to nearest even), eight at a
+ * time with F16C if the host supports it.
+ */
+void convertFp32ToFp16(const float* src, float16* dst, int numElems);
+
 /**
  * Copies the data from each tile in a TiledTensor into a destination Tensor as
  * a contiguous block of memory, as if only one dimension ever existed.
@@ -2,7 +2,10 @@
 #define _CORE_WORKSPACE_H_
 
 #include <map>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include "smaug/core/tensor.h"
 #include "smaug/core/operator.h"
@@ -30,10 +33,79 @@ class Workspace {
     void addTiledTensor(TiledTensor& tiledTensor) {
         for (auto i = tiledTensor.startIndex(); !i.end(); ++i) {
             Tensor* tensor = tiledTensor[i];
+            // A single tile is the original tensor itself, which belongs to
+            // whichever Workspace it was added to (e.g. shared parameters).
+            if (tensor == tiledTensor.getOrigTensor())
+                continue;
             tensors[tensor->getName()] = static_cast<TensorBase*>(tensor);
         }
     }
 
+    /** Deletes the named tensor, if it exists. */
+    void removeTensor(const std::string& name) {
+        auto it = tensors.find(name);
+        if (it == tensors.end())
+            return;
+        delete it->second;
+        tensors.erase(it);
+    }
+
+    /**
+     * Returns the TiledTensor of read-only data cached for the given Tensor
+     * and tile shape, or nullptr if there is none.
+     */
+    const TiledTensor* getCachedTiledTensor(const Tensor* tensor,
+                                            const TensorShape& tileShape) const {
+        auto it = tiledTensorCache.find(getTiledTensorKey(tensor, tileShape));
+        if (it == tiledTensorCache.end())
+            return nullptr;
+        return &it->second;
+    }
+
+    /**
+     * Caches a TiledTensor of read-only data, so that other operators that
+     * tile the same Tensor with the same tile shape share its tiles.
+     */
+    void cacheTiledTensor(const Tensor* tensor,
+                          const TensorShape& tileShape,
+                          const TiledTensor& tiledTensor) {
+        tiledTensorCache[getTiledTensorKey(tensor, tileShape)] = tiledTensor;
+    }
+
+    /** Drops all the cached TiledTensors of the given Tensor. */
+    void uncacheTiledTensors(const Tensor* tensor) {
+        for (auto it = tiledTensorCache.begin();
+             it != tiledTensorCache.end();) {
+            if (std::get<0>(it->first) == tensor)
+                it = tiledTensorCache.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    /**
+     * Returns the fp32 copy of an fp16 Tensor cached by cacheFp32Copy(), or
+     * nullptr if there is none or the data of the Tensor has changed since.
+     */
+    Tensor* getCachedFp32Copy(const Tensor* tensor) const {
+        auto it = fp32CopyCache.find(tensor);
+        if (it == fp32CopyCache.end() ||
+            it->second.first != tensor->getDataVersion())
+            return nullptr;
+        return it->second.second.get();
+    }
+
+    /**
+     * Caches an fp32 copy of the current data of an fp16 Tensor of read-only
+     * data, like weights, so that it is only widened once. Returns the copy.
+     */
+    Tensor* cacheFp32Copy(const Tensor* tensor, std::unique_ptr<Tensor> fp32) {
+        Tensor* copy = fp32.get();
+        fp32CopyCache[tensor] =
+                std::make_pair(tensor->getDataVersion(), std::move(fp32));
+        return copy;
+    }
+
     Tensor* getTensor(const std::string& name) const {
         if (tensors.find(name) == tensors.end())
             return nullptr;
@@ -45,7 +117,27 @@ class Workspace {
     }
 
    protected:
+    /** The source Tensor, tile dimensions, layout and alignment. */
+    typedef std::tuple<const Tensor*, std::vector<int>, DataLayout, int>
+            TiledTensorKey;
+
+    static TiledTensorKey getTiledTensorKey(const Tensor* tensor,
+                                            const TensorShape& tileShape) {
+        return TiledTensorKey(tensor, tileShape.dims(), tileShape.getLayout(),
+                              tileShape.getAlignment());
+    }
+
     std::map<std::string, TensorBase*> tensors;
+
+    /** TiledTensors of read-only data, shared across operators. */
+    std::map<TiledTensorKey, TiledTensor> tiledTensorCache;
+
+    /**
+     * fp32 copies of fp16 read-only data, with the data version of the Tensor
+     * they were made from.
+     */
+    std::map<const Tensor*, std::pair<int, std::unique_ptr<Tensor>>>
+            fp32CopyCache;
 };
 
 }
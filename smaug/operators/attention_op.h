@@ -0,0 +1,84 @@
+#ifndef _OPERATORS_ATTENTION_OP_H_
+#define _OPERATORS_ATTENTION_OP_H_
+
+#include "smaug/core/backend.h"
+#include "smaug/core/operator.h"
+#include "smaug/core/tensor.h"
+#include "smaug/core/workspace.h"
+#include "smaug/operators/common.h"
+
+namespace smaug {
+
+/** \ingroup Operators
+ *
+ * \brief Implements fused additive (Bahdanau) attention for one decoder step.
+ *
+ * Given a projected query q of shape [N, C], keys k and values v (the
+ * attention memory) of shape [N, T, C] and alignment weights w of shape
+ * [1, C], this computes, for every batch b:
+ *
+ *   score[t] = sum_c(tanh(q[b][c] + k[b][t][c]) * w[c])
+ *   alignment = softmax(score)
+ *   context[b][c] = sum_t(alignment[t] * v[b][t][c])
+ *
+ * All three stages are done in one pass over each batch of the keys and
+ * values, instead of the dozen or so operators the unfused form takes. The
+ * keys and values are consumed in place, so the keys computed once per
+ * sequence by the memory layer are shared by the attention operators of all
+ * the decoder steps without being copied again.
+ *
+ * @tparam Backend The Backend specialization of this Operator.
+ */
+template <typename Backend>
+class AttentionOp : public Operator {
+   public:
+    AttentionOp(const std::string& name, Workspace* workspace)
+            : Operator(name, OpType::Attention, workspace) {
+        inputs.resize(kNumInputs, nullptr);
+        outputs.resize(kNumOutputs, nullptr);
+    }
+
+    void run() override {}
+
+    bool validate() override {
+        if (!Operator::validate())
+            return false;
+        const TensorShape& query = getInput(Query)->getShape();
+        const TensorShape& keys = getInput(Keys)->getShape();
+        const TensorShape& values = getInput(Values)->getShape();
+        const TensorShape& weights = getInput(AlignmentWeights)->getShape();
+        return query.ndims() == 2 && keys.ndims() == 3 && keys == values &&
+               keys[0] == query[0] && keys[2] == query[1] &&
+               weights.ndims() == 2 && weights[0] == 1 &&
+               weights[1] == query[1];
+    }
+
+    void createAllTensors() override {
+        if (outputs.at(Outputs))
+            return;
+        const TensorShape& shape = getInput(Query)->getShape();
+        TensorShape outputShape(
+                { shape[0], shape[1] }, DataLayout::NC, Backend::Alignment);
+        Tensor* output = new Tensor(name, outputShape);
+        workspace->addTensor(output);
+        outputs.at(Outputs) = output;
+    }
+
+    int getNumParameters() const override {
+        return inputs.at(AlignmentWeights)->getShape().size();
+    }
+
+    std::vector<TensorBase*> getParameterizableInputs() override {
+        return { inputs[AlignmentWeights] };
+    }
+
+   public:
+    enum { Query, Keys, Values, AlignmentWeights, kNumInputs };
+    enum { Outputs, kNumOutputs };
+};
+
+REGISTER_SPECIAL_OP(AttentionOp, ReferenceBackend);
+
+}  // namespace smaug
+
+#endif
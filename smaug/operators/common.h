@@ -36,6 +36,7 @@ extern "C" {
 #include <utility>
 #include <memory>
 #include "smaug/core/globals.h"
+#include "smaug/utility/perf_projection.h"
 #include "tracer/trace_logger_aladdin.h"
 
 namespace smaug {
@@ -79,6 +80,7 @@ void invokeKernel(int accelIdx,
 #ifdef TRACE_MODE
         llvmtracer_set_trace_name(getTraceName(accelIdx).c_str());
 #endif
+        auto projection = PerfProjection::ScopedKernel();
         kernel(std::forward<Args>(args)...);
     }
 }
@@ -114,7 +116,10 @@ std::unique_ptr<volatile int> invokeKernelNoBlock(int accelIdx,
 #ifdef TRACE_MODE
         llvmtracer_set_trace_name(getTraceName(accelIdx).c_str());
 #endif
-        kernel(std::forward<Args>(args)...);
+        {
+            auto projection = PerfProjection::ScopedKernel();
+            kernel(std::forward<Args>(args)...);
+        }
         return nullptr;
     }
 }
@@ -163,6 +168,13 @@ extern "C" {
  * Returns the smallest multiple of align that is >= request. */
 size_t next_multiple(size_t request, size_t align);
 
+/**
+ * Folds the sampling factor of a sampled loop into the performance projection
+ * of the kernel invocation that is currently running natively. Use
+ * SET_SAMPLING_FACTOR instead of calling this directly.
+ */
+void accumulateSamplingFactor(float factor);
+
 #ifdef __cplusplus
 }
 #endif
@@ -238,6 +250,16 @@ struct ActivationInfo {
 };
 #endif
 
+/**
+ * The pooling function that a convolution kernel applies to its finished
+ * results before sending them back, when a pooling operator is fused into it.
+ */
+typedef enum _pool_type {
+    NO_POOLING,
+    MAX_POOLING,
+    AVG_POOLING
+} pool_type;
+
 /**
  * Levels of simulation sampling to apply to certain accelerator kernels.
  *
@@ -346,6 +368,17 @@ typedef uint8_t v8bl_t
  */
 #define VEC256_MASK(input, mask) ((v8fp_t)((v8sfx_t)input & mask))
 
+/**
+ * True if any element of a v8fp_t vector is nonzero. The SMV kernels use this
+ * to skip the MACCs of all-zero activation vectors.
+ *
+ * @param input A v8fp_t vector.
+ */
+#define VEC256_ANY_NONZERO(input)                                              \
+    ((input)[0] != 0 || (input)[1] != 0 || (input)[2] != 0 ||                  \
+     (input)[3] != 0 || (input)[4] != 0 || (input)[5] != 0 ||                  \
+     (input)[6] != 0 || (input)[7] != 0)
+
 /**
  * @}
  */
@@ -542,6 +575,22 @@ typedef uint8_t v8bl_t
 
 #define MAYBE_UNUSED __attribute__((__unused__))
 
+/**
+ * Sets the sampling factor of a sampled loop. Aladdin uses it to extrapolate
+ * the loop's latency in simulation; in native runs, it is also accumulated
+ * into the performance projection of the kernel.
+ */
+#ifdef TRACE_MODE
+#define SET_SAMPLING_FACTOR(label, factor) setSamplingFactor(label, factor)
+#else
+#define SET_SAMPLING_FACTOR(label, factor)                                     \
+    do {                                                                       \
+        float _factor = (factor);                                              \
+        setSamplingFactor(label, _factor);                                     \
+        accumulateSamplingFactor(_factor);                                     \
+    } while (0)
+#endif
+
 /**
  * @}
  */
@@ -69,16 +69,13 @@ class ConcatOp : public Operator {
 
     void run() override {
         Tensor* output = getOutput(0);
-        int ndims = output->ndims();
-        std::vector<int> dstOrigin(ndims, 0);
+        int destStart = 0;
         for (int i = 0; i < getInputs().size(); i++) {
             Tensor* input = getInput(i);
-            copyTensorRegion(output,
-                             input,
-                             dstOrigin,
-                             std::vector<int>(ndims, 0),
-                             input->getShape().dims());
-            dstOrigin[concatAxis] += input->dim(concatAxis);
+            int numSlices = input->dim(concatAxis);
+            copyTensorSlices(
+                    output, input, concatAxis, destStart, 0, numSlices);
+            destStart += numSlices;
         }
     }
 
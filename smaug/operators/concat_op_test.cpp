@@ -1,8 +1,10 @@
 #include "catch.hpp"
 #include "smaug/core/backend.h"
+#include "smaug/core/globals.h"
 #include "smaug/core/tensor.h"
 #include "smaug/core/smaug_test.h"
 #include "smaug/operators/concat_op.h"
+#include "smaug/utility/thread_pool.h"
 
 using namespace smaug;
 
@@ -106,3 +108,48 @@ TEST_CASE_METHOD(SmaugTest, "Concatenate 2 tensors", "[refop]") {
         verifyOutputs(outputsTensor, expectedValues);
     }
 }
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Concatenate large tensors on the thread pool",
+                 "[refop]") {
+    ThreadPool pool(4);
+    pool.initThreadPool();
+    threadPool = &pool;
+    // Enough pixels to split the copies across the threads, with channels
+    // that are padded in storage.
+    TensorShape inputShape0({ 1, 64, 64, 5 }, DataLayout::NHWC, 8);
+    TensorShape inputShape1({ 1, 64, 64, 11 }, DataLayout::NHWC, 8);
+    Tensor* input0 = new Tensor("input0", inputShape0);
+    Tensor* input1 = new Tensor("input1", inputShape1);
+    input0->allocateStorage<float>();
+    input1->allocateStorage<float>();
+    std::vector<float> values0(inputShape0.storageSize());
+    std::vector<float> values1(inputShape1.storageSize());
+    for (int i = 0; i < values0.size(); i++)
+        values0[i] = i;
+    for (int i = 0; i < values1.size(); i++)
+        values1[i] = -i;
+    input0->fillData(values0.data(), values0.size());
+    input1->fillData(values1.data(), values1.size());
+    workspace()->addTensor(input0);
+    workspace()->addTensor(input1);
+    auto concatOp = new ConcatOp<ReferenceBackend>("concat", workspace(), 2);
+    concatOp->setInput(input0, 0);
+    concatOp->setInput(input1, 1);
+    concatOp->setConcatAxis(3);
+    concatOp->createAllTensors();
+    allocateAllTensors<float>(concatOp);
+    concatOp->run();
+    threadPool = nullptr;
+
+    Tensor* output = concatOp->getOutput(0);
+    REQUIRE(output->getShape().dims() == std::vector<int>{ 1, 64, 64, 16 });
+    std::vector<float> expectedValues;
+    for (int p = 0; p < 64 * 64; p++) {
+        for (int c = 0; c < 5; c++)
+            expectedValues.push_back(p * 8 + c);
+        for (int c = 0; c < 11; c++)
+            expectedValues.push_back(-(p * 16 + c));
+    }
+    verifyOutputs(output, expectedValues);
+}
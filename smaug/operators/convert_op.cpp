@@ -0,0 +1,104 @@
+#include "fp16.h"
+#include "smaug/operators/convert_op.h"
+
+namespace smaug {
+
+std::vector<int> getLayoutPermutation(DataLayout from,
+                                      DataLayout to,
+                                      int ndims) {
+    if (from == to) {
+        std::vector<int> identity(ndims);
+        for (int i = 0; i < ndims; i++)
+            identity[i] = i;
+        return identity;
+    }
+    if (ndims == 4 && from == NCHW && to == NHWC)
+        return { 0, 2, 3, 1 };
+    if (ndims == 4 && from == NHWC && to == NCHW)
+        return { 0, 3, 1, 2 };
+    if (ndims == 2 && ((from == NC && to == CN) || (from == CN && to == NC)))
+        return { 1, 0 };
+    return {};
+}
+
+template <typename SrcType, typename DstType>
+static DstType convertValue(SrcType value) {
+    return static_cast<DstType>(value);
+}
+
+template <>
+float16 convertValue<float, float16>(float value) {
+    return fp16_ieee_from_fp32_value(value);
+}
+
+template <>
+float convertValue<float16, float>(float16 value) {
+    return fp16_ieee_to_fp32_value(value);
+}
+
+template <>
+float16 convertValue<float16, float16>(float16 value) {
+    return value;
+}
+
+template <typename SrcType, typename DstType>
+static void convertTensorImpl(Tensor* input,
+                              Tensor* output,
+                              const std::vector<int>& perm) {
+    const TensorShape& inputShape = input->getShape();
+    int ndims = inputShape.ndims();
+    // The strides of the input dimensions, permuted into the order of the
+    // output dimensions.
+    std::vector<int> inputStrides(ndims);
+    int stride = 1;
+    for (int i = ndims - 1; i >= 0; i--) {
+        inputStrides[i] = stride;
+        stride *= inputShape.getStorageDim(i);
+    }
+    std::vector<int> strides(ndims);
+    for (int i = 0; i < ndims; i++)
+        strides[i] = inputStrides[perm[i]];
+
+    SrcType* src = input->data<SrcType>();
+    DstType* dst = output->data<DstType>();
+    for (auto outputIdx = output->startIndex(); !outputIdx.end();
+         ++outputIdx) {
+        int srcIdx = 0;
+        for (int i = 0; i < ndims; i++)
+            srcIdx += outputIdx.currentIndex(i) * strides[i];
+        dst[outputIdx] = convertValue<SrcType, DstType>(src[srcIdx]);
+    }
+}
+
+void convertTensor(Tensor* input, Tensor* output) {
+    const TensorShape& inputShape = input->getShape();
+    std::vector<int> perm =
+            getLayoutPermutation(inputShape.getLayout(),
+                                 output->getShape().getLayout(),
+                                 inputShape.ndims());
+    assert(!perm.empty() && "Unsupported layout conversion!");
+    DataType srcType = input->getDataType();
+    DataType dstType = output->getDataType();
+    if (srcType == Float16 && dstType == Float32) {
+        convertTensorImpl<float16, float>(input, output, perm);
+    } else if (srcType == Float32 && dstType == Float16) {
+        convertTensorImpl<float, float16>(input, output, perm);
+    } else if (srcType == Float16 && dstType == Float16) {
+        convertTensorImpl<float16, float16>(input, output, perm);
+    } else if (srcType == Float32 && dstType == Float32) {
+        convertTensorImpl<float, float>(input, output, perm);
+    } else if (srcType == Int32 && dstType == Int32) {
+        convertTensorImpl<int, int>(input, output, perm);
+    } else if (srcType == Int64 && dstType == Int64) {
+        convertTensorImpl<int64_t, int64_t>(input, output, perm);
+    } else if (srcType == Bool && dstType == Bool) {
+        convertTensorImpl<bool, bool>(input, output, perm);
+    } else {
+        std::cerr << "[ERROR]: Cannot convert " << input->getName() << " from "
+                  << DataType_Name(srcType) << " to " << DataType_Name(dstType)
+                  << "!\n";
+        exit(1);
+    }
+}
+
+}  // namespace smaug
@@ -0,0 +1,88 @@
+#ifndef _OPERATORS_CONVERT_OP_H_
+#define _OPERATORS_CONVERT_OP_H_
+
+#include <vector>
+
+#include "smaug/core/backend.h"
+#include "smaug/core/operator.h"
+#include "smaug/core/tensor.h"
+
+namespace smaug {
+
+/**
+ * Returns the input dimension that each output dimension comes from when a
+ * Tensor with ndims dimensions is converted from layout `from` to layout `to`.
+ * Supported conversions are NCHW <-> NHWC and NC <-> CN. Returns an empty
+ * vector if the conversion is not supported.
+ */
+std::vector<int> getLayoutPermutation(DataLayout from,
+                                      DataLayout to,
+                                      int ndims);
+
+/**
+ * Copies the contents of the input Tensor into the output Tensor, converting
+ * the data layout, the data type (between float16 and float32) and the
+ * alignment padding to those of the output.
+ */
+void convertTensor(Tensor* input, Tensor* output);
+
+/** \ingroup Operators
+ *
+ * \brief Converts a Tensor between the data formats of two backends.
+ *
+ * This is inserted between operators placed on different backends, e.g. to
+ * turn the NHWC float16 tensors of the SMV backend into the NCHW float32
+ * tensors of the Reference backend. The output shape, data type and
+ * alignment are set by the Tensor given to setOutput(). An input that hasn't
+ * changed since it was last converted, like a weight, is not converted again.
+ *
+ * @tparam Backend The Backend specialization of this Operator.
+ */
+template <typename Backend>
+class ConvertOp : public Operator {
+   public:
+    ConvertOp(const std::string& name, Workspace* workspace)
+            : Operator(name, OpType::Convert, workspace),
+              convertedVersion(-1) {
+        inputs.resize(1, nullptr);
+        outputs.resize(1, nullptr);
+    }
+
+    void run() override {
+        Tensor* input = getInput(0);
+        if (input->getDataVersion() == convertedVersion)
+            return;
+        convertTensor(input, getOutput(0));
+        convertedVersion = input->getDataVersion();
+    }
+
+    bool validate() override {
+        Tensor* input = getInput(0);
+        Tensor* output = getOutput(0);
+        if (!input || !output)
+            return false;
+        const TensorShape& inputShape = input->getShape();
+        const TensorShape& outputShape = output->getShape();
+        if (inputShape.ndims() != outputShape.ndims() ||
+            inputShape.size() != outputShape.size() ||
+            getLayoutPermutation(inputShape.getLayout(),
+                                 outputShape.getLayout(),
+                                 inputShape.ndims())
+                    .empty()) {
+            std::cerr << "[ERROR]: Cannot convert " << input->getName()
+                      << " from " << DataLayout_Name(inputShape.getLayout())
+                      << " to " << DataLayout_Name(outputShape.getLayout())
+                      << "!\n";
+            return false;
+        }
+        return Operator::validate();
+    }
+
+   protected:
+    /** The data version of the input when it was last converted. */
+    int convertedVersion;
+};
+
+}  // namespace smaug
+
+#endif
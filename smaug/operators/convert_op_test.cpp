@@ -0,0 +1,80 @@
+#include "catch.hpp"
+#include "fp16.h"
+#include "smaug/core/backend.h"
+#include "smaug/core/tensor.h"
+#include "smaug/core/smaug_test.h"
+#include "smaug/operators/convert_op.h"
+
+using namespace smaug;
+
+TEST_CASE_METHOD(SmaugTest, "Convert between backend formats", "[convertop]") {
+    SECTION("NHWC float16 with alignment to NCHW float32") {
+        auto convertOp =
+                new ConvertOp<ReferenceBackend>("convert", workspace());
+        TensorShape inputShape({ 1, 2, 2, 3 }, DataLayout::NHWC, 8);
+        Tensor* input = workspace()->addTensor(new Tensor("input", inputShape));
+        input->allocateStorage<float16>();
+        std::vector<float> inputValues{ 1, 11, 21,  // row 0
+                                        2, 12, 22,
+                                        3, 13, 23,  // row 1
+                                        4, 14, 24 };
+        auto inputIdx = input->startIndex();
+        for (int i = 0; i < inputValues.size(); i++, ++inputIdx) {
+            input->data<float16>()[inputIdx] =
+                    fp16_ieee_from_fp32_value(inputValues[i]);
+        }
+        TensorShape outputShape({ 1, 3, 2, 2 }, DataLayout::NCHW);
+        Tensor* output =
+                workspace()->addTensor(new Tensor("output", outputShape));
+        output->allocateStorage<float>();
+        convertOp->setInput(input, 0);
+        convertOp->setOutput(output, 0);
+        REQUIRE(convertOp->validate());
+        convertOp->run();
+        verifyOutputs<float>(output, { 1, 2, 3, 4,  // chan 0
+                                       11, 12, 13, 14,
+                                       21, 22, 23, 24 });
+
+        // An input that hasn't changed isn't converted again.
+        output->data<float>()[0] = 0;
+        convertOp->run();
+        REQUIRE(output->data<float>()[0] == 0);
+        input->incrDataVersion();
+        convertOp->run();
+        REQUIRE(output->data<float>()[0] == 1);
+    }
+
+    SECTION("CN float32 to NC float16 with alignment") {
+        auto convertOp = new ConvertOp<SmvBackend>("convert", workspace());
+        TensorShape inputShape({ 3, 2 }, DataLayout::CN);
+        Tensor* input = workspace()->addTensor(new Tensor("input", inputShape));
+        input->allocateStorage<float>();
+        input->fillData<float>({ 1, 2, 3, 4, 5, 6 });
+        TensorShape outputShape({ 2, 3 }, DataLayout::NC, 8);
+        Tensor* output =
+                workspace()->addTensor(new Tensor("output", outputShape));
+        output->allocateStorage<float16>();
+        convertOp->setInput(input, 0);
+        convertOp->setOutput(output, 0);
+        REQUIRE(convertOp->validate());
+        convertOp->run();
+        std::vector<float> expectedValues{ 1, 3, 5, 2, 4, 6 };
+        auto outputIdx = output->startIndex();
+        for (int i = 0; i < expectedValues.size(); i++, ++outputIdx) {
+            float16 value = output->data<float16>()[outputIdx];
+            REQUIRE(fp16_ieee_to_fp32_value(value) == expectedValues[i]);
+        }
+    }
+
+    SECTION("Unsupported layouts") {
+        auto convertOp =
+                new ConvertOp<ReferenceBackend>("convert", workspace());
+        Tensor* input = workspace()->addTensor(new Tensor(
+                "input", TensorShape({ 1, 2, 2, 2 }, DataLayout::NCHW)));
+        Tensor* output = workspace()->addTensor(
+                new Tensor("output", TensorShape({ 1, 8 }, DataLayout::NC)));
+        convertOp->setInput(input, 0);
+        convertOp->setOutput(output, 0);
+        REQUIRE(!convertOp->validate());
+    }
+}
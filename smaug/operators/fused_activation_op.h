@@ -29,6 +29,16 @@ class FusedActivationOp : public Operator {
     ActivationInfo getActivation() const { return actInfo; }
 
    protected:
+    /**
+     * A fused ReLU leaves most of the output zero, so this records which
+     * blocks of the output are nonzero for the consumers to skip the rest.
+     * Call it at the end of run().
+     */
+    void updateOutputOccupancy(Tensor* output) {
+        if (actInfo.function == activation_type::RELU)
+            output->computeOccupancy();
+    }
+
     ActivationInfo actInfo;
 };
 
@@ -44,13 +44,7 @@ class PaddingOp : public Operator {
         Tensor* output = getOutput(kOutput);
         int ndims = input->ndims();
         const std::vector<int>& inputDims = input->getShape().dims();
-        const std::vector<int>& outputDims = output->getShape().dims();
-        int total_dim = 1;
-        for (int i : outputDims) {
-            total_dim *= i;
-        }
-        std::vector<float> vf(total_dim, 0);
-        output->fillData(vf.data(), vf.size());
+        output->fillZeros();
         std::vector<int> paddingBegin, srcOrigin;
         for (int i = 0; i < ndims; i++) {
             paddingBegin.push_back(paddingSize.at(2 * i));
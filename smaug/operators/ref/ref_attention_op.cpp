@@ -0,0 +1,125 @@
+#include <cmath>
+#include <vector>
+
+#include "smaug/core/backend.h"
+#include "smaug/operators/common.h"
+#include "smaug/operators/attention_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \ingroup AladdinKernels
+ *
+ * A Reference implementation of fused additive attention.
+ *
+ * For each batch, the scores, their softmax and the context are computed in
+ * one pass over the keys and values of that batch. The softmax uses the max
+ * trick for numerical stability, like ref_softmax_nc.
+ *
+ * @param query Projected queries of size batch x depth.
+ * @param keys Keys of size batch x time_steps x depth.
+ * @param values Values of size batch x time_steps x depth.
+ * @param weights Alignment weights of size depth.
+ * @param scores Scratch buffer of size time_steps.
+ * @param results Context vectors of size batch x depth.
+ * @param batch Batch size.
+ * @param time_steps Number of time steps in the keys and values.
+ * @param depth Number of channels.
+ */
+void ref_attention_nc(float* query,
+                      float* keys,
+                      float* values,
+                      float* weights,
+                      float* scores,
+                      float* results,
+                      int batch,
+                      int time_steps,
+                      int depth) {
+    dmaLoad(query, query, batch * depth * sizeof(float));
+    dmaLoad(keys, keys, batch * time_steps * depth * sizeof(float));
+    dmaLoad(values, values, batch * time_steps * depth * sizeof(float));
+    dmaLoad(weights, weights, depth * sizeof(float));
+    ARRAY_2D(float, _query, query, depth);
+    ARRAY_3D(float, _keys, keys, time_steps, depth);
+    ARRAY_3D(float, _values, values, time_steps, depth);
+    ARRAY_2D(float, _results, results, depth);
+
+    attention_batch:
+    for (int i = 0; i < batch; i++) {
+        float max_score = -FLT_MAX;
+        attention_score:
+        for (int t = 0; t < time_steps; t++) {
+            float score = 0;
+            attention_score_depth:
+            for (int c = 0; c < depth; c++)
+                score += tanh(_query[i][c] + _keys[i][t][c]) * weights[c];
+            scores[t] = score;
+            max_score = max2(max_score, score);
+        }
+
+        float normaliz = 0.0;
+        attention_softmax:
+        for (int t = 0; t < time_steps; t++) {
+            scores[t] = exp(scores[t] - max_score);
+            normaliz += scores[t];
+        }
+        normaliz = 1.0 / (normaliz + 1e-6);  // epsilon for numerical stability.
+
+        attention_context_init:
+        for (int c = 0; c < depth; c++)
+            _results[i][c] = 0;
+        attention_context:
+        for (int t = 0; t < time_steps; t++) {
+            float alignment = scores[t] * normaliz;
+            attention_context_depth:
+            for (int c = 0; c < depth; c++)
+                _results[i][c] += alignment * _values[i][t][c];
+        }
+    }
+    dmaStore(results, results, batch * depth * sizeof(float));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace smaug {
+
+template <>
+void AttentionOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this, { AlignmentWeights });
+    auto query = getInput(Query);
+    auto keys = getInput(Keys);
+    auto values = getInput(Values);
+    auto weights = getInput(AlignmentWeights);
+    auto output = getOutput(Outputs);
+    const TensorShape& keysShape = keys->getShape();
+    assert(keysShape == values->getShape());
+    int batch = keysShape[0];
+    int timeSteps = keysShape[1];
+    int depth = keysShape[2];
+    std::vector<float> scores(timeSteps);
+
+    float* queryData = query->data<float>();
+    float* keysData = keys->data<float>();
+    float* valuesData = values->data<float>();
+    float* weightsData = weights->data<float>();
+    float* outputData = output->data<float>();
+    mapArrayToAccel(ref::kEltwiseOpHw, "query", queryData,
+                    query->getShape().storageSize() * sizeof(float));
+    mapArrayToAccel(ref::kEltwiseOpHw, "keys", keysData,
+                    keysShape.storageSize() * sizeof(float));
+    mapArrayToAccel(ref::kEltwiseOpHw, "values", valuesData,
+                    keysShape.storageSize() * sizeof(float));
+    mapArrayToAccel(ref::kEltwiseOpHw, "weights", weightsData,
+                    weights->getShape().storageSize() * sizeof(float));
+    mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
+                    output->getShape().storageSize() * sizeof(float));
+    invokeKernel(ref::kEltwiseOpHw, ref_attention_nc, queryData, keysData,
+                 valuesData, weightsData, scores.data(), outputData, batch,
+                 timeSteps, depth);
+}
+
+}  // namespace smaug
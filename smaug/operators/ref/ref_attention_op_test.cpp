@@ -0,0 +1,69 @@
+#include <cmath>
+
+#include "catch.hpp"
+#include "smaug/core/backend.h"
+#include "smaug/core/tensor.h"
+#include "smaug/core/smaug_test.h"
+#include "smaug/operators/attention_op.h"
+
+using namespace smaug;
+
+TEST_CASE_METHOD(SmaugTest, "Reference attention operator", "[refop]") {
+    const int batch = 2, timeSteps = 3, depth = 4;
+    std::vector<float> queryData{ 0.1, -0.2, 0.3, 0.0, -0.4, 0.5, 0.2, 0.1 };
+    std::vector<float> keysData, valuesData;
+    for (int i = 0; i < batch * timeSteps * depth; i++) {
+        keysData.push_back(0.05 * (i % 7) - 0.1);
+        valuesData.push_back(0.1 * (i % 5) - 0.2);
+    }
+    std::vector<float> weightsData{ 0.5, -1.0, 1.5, 2.0 };
+
+    auto attentionOp =
+            new AttentionOp<ReferenceBackend>("attention", workspace());
+    TensorShape queryShape({ batch, depth }, DataLayout::NC);
+    TensorShape keysShape({ batch, timeSteps, depth }, DataLayout::NTC);
+    TensorShape weightsShape({ 1, depth }, DataLayout::NC);
+    std::vector<std::pair<TensorShape, std::vector<float>*>> inputs{
+        { queryShape, &queryData },
+        { keysShape, &keysData },
+        { keysShape, &valuesData },
+        { weightsShape, &weightsData },
+    };
+    for (int i = 0; i < inputs.size(); i++) {
+        Tensor* tensor =
+                new Tensor("input" + std::to_string(i), inputs[i].first);
+        tensor->allocateStorage<float>();
+        tensor->fillData(inputs[i].second->data(), inputs[i].second->size());
+        workspace()->addTensor(tensor);
+        attentionOp->setInput(tensor, i);
+    }
+    REQUIRE(attentionOp->validate());
+    attentionOp->createAllTensors();
+    allocateAllTensors<float>(attentionOp);
+    attentionOp->run();
+
+    std::vector<float> expectedValues;
+    for (int b = 0; b < batch; b++) {
+        std::vector<float> scores(timeSteps);
+        float sum = 0;
+        for (int t = 0; t < timeSteps; t++) {
+            float score = 0;
+            for (int c = 0; c < depth; c++) {
+                score += std::tanh(queryData[b * depth + c] +
+                                   keysData[(b * timeSteps + t) * depth + c]) *
+                         weightsData[c];
+            }
+            scores[t] = std::exp(score);
+            sum += scores[t];
+        }
+        for (int c = 0; c < depth; c++) {
+            float context = 0;
+            for (int t = 0; t < timeSteps; t++) {
+                context += scores[t] / sum *
+                           valuesData[(b * timeSteps + t) * depth + c];
+            }
+            expectedValues.push_back(context);
+        }
+    }
+    verifyOutputs(attentionOp->getOutput(0), expectedValues);
+}
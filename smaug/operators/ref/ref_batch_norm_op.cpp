@@ -2,6 +2,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/batch_norm_op.h"
 #include "smaug/operators/ref/ref_activation_fun_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 #include "smaug/utility/debug_stream.h"
 
 #ifdef __cplusplus
@@ -205,6 +206,7 @@ namespace smaug {
 
 template <>
 void BatchNormOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this, { Mean, Variance, Gamma, Beta });
     auto input = getInput(Inputs);
     auto mean = getInput(Mean);
     auto variance = getInput(Variance);
@@ -255,6 +257,7 @@ void BatchNormOp<ReferenceBackend>::run() {
                      inputShape[0], inputShape[1], inputShape.getPadding(1),
                      actInfo.function, actInfo.params);
     }
+    updateOutputOccupancy(output);
 }
 
 }  // namespace smaug
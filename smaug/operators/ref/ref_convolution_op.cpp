@@ -2,6 +2,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/convolution_op.h"
 #include "smaug/operators/ref/ref_activation_fun_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 #include "smaug/utility/debug_stream.h"
 
 #ifdef __cplusplus
@@ -11,7 +12,8 @@ extern "C" {
 /** \ingroup AladdinKernels
  *
  * A Reference implementation of a 3D convolution on NCHW data with valid
- * padding.
+ * padding. Channels of an image whose chan_occupancy flag is zero are all zero
+ * and are skipped.
  */
 void ref_conv3d_nchw_valid_padding(float* input,
                                    float* kernels,
@@ -30,6 +32,7 @@ void ref_conv3d_nchw_valid_padding(float* input,
                                    int res_rows,
                                    int res_cols,
                                    int res_pad,
+                                   uint8_t* chan_occupancy,
                                    activation_type act_function,
                                    activation_param_t act_params) {
     int input_size = img_num * img_chans * img_rows * (img_cols + img_pad);
@@ -62,6 +65,8 @@ void ref_conv3d_nchw_valid_padding(float* input,
                     conv3d_kernel_height:
                     // Convolution loop over the kernel.
                     for (int d = 0; d < img_chans; d++) {
+                        if (!chan_occupancy[img * img_chans + d])
+                            continue;
                         conv3d_kernel_rows:
                         for (int k = 0; k < k_rows; k++) {
                             conv3d_kernel_cols:
@@ -89,7 +94,8 @@ void ref_conv3d_nchw_valid_padding(float* input,
 /** \ingroup AladdinKernels
  *
  * A Reference implementation of a 3D convolution on NCHW data with same
- * padding.
+ * padding. Channels of an image whose chan_occupancy flag is zero are all zero
+ * and are skipped.
  */
 void ref_conv3d_nchw_same_padding(float* input,
                                   float* kernels,
@@ -108,6 +114,7 @@ void ref_conv3d_nchw_same_padding(float* input,
                                   int res_rows,
                                   int res_cols,
                                   int res_pad,
+                                  uint8_t* chan_occupancy,
                                   activation_type act_function,
                                   activation_param_t act_params) {
     int input_size = img_num * img_chans * img_rows * (img_cols + img_pad);
@@ -148,6 +155,8 @@ void ref_conv3d_nchw_same_padding(float* input,
                     conv3d_kernel_height:
                     // Convolution loop over the kernel.
                     for (int d = 0; d < img_chans; d++) {
+                        if (!chan_occupancy[img * img_chans + d])
+                            continue;
                         conv3d_kernel_rows:
                         for (int k = 0; k < k_rows; k++) {
                             bool rowInBounds =
@@ -183,7 +192,8 @@ void ref_conv3d_nchw_same_padding(float* input,
 /** \ingroup AladdinKernels
  *
  * A Reference implementation of a 3D convolution on NHWC data with valid
- * padding.
+ * padding. Channels of an image whose chan_occupancy flag is zero are all zero
+ * and are skipped.
  */
 void ref_conv3d_nhwc_valid_padding(float* input,
                                    float* kernels,
@@ -202,6 +212,7 @@ void ref_conv3d_nhwc_valid_padding(float* input,
                                    int res_rows,
                                    int res_cols,
                                    int res_pad,
+                                   uint8_t* chan_occupancy,
                                    activation_type act_function,
                                    activation_param_t act_params) {
     int input_size = img_num * img_rows * img_cols * (img_chans + img_pad);
@@ -234,6 +245,8 @@ void ref_conv3d_nhwc_valid_padding(float* input,
                     conv3d_kernel_height:
                     // Convolution loop over the kernel.
                     for (int d = 0; d < img_chans; d++) {
+                        if (!chan_occupancy[img * img_chans + d])
+                            continue;
                         conv3d_kernel_rows:
                         for (int k = 0; k < k_rows; k++) {
                             conv3d_kernel_cols:
@@ -261,7 +274,8 @@ void ref_conv3d_nhwc_valid_padding(float* input,
 /** \ingroup AladdinKernels
  *
  * A Reference implementation of a 3D convolution on NHWC data with same
- * padding.
+ * padding. Channels of an image whose chan_occupancy flag is zero are all zero
+ * and are skipped.
  */
 void ref_conv3d_nhwc_same_padding(float* input,
                                   float* kernels,
@@ -280,6 +294,7 @@ void ref_conv3d_nhwc_same_padding(float* input,
                                   int res_rows,
                                   int res_cols,
                                   int res_pad,
+                                  uint8_t* chan_occupancy,
                                   activation_type act_function,
                                   activation_param_t act_params) {
     int input_size = img_num * img_rows * img_cols * (img_chans + img_pad);
@@ -320,6 +335,8 @@ void ref_conv3d_nhwc_same_padding(float* input,
                     conv3d_kernel_height:
                     // Convolution loop over the kernel.
                     for (int d = 0; d < img_chans; d++) {
+                        if (!chan_occupancy[img * img_chans + d])
+                            continue;
                         conv3d_kernel_rows:
                         for (int k = 0; k < k_rows; k++) {
                             bool rowInBounds =
@@ -360,6 +377,7 @@ namespace smaug {
 
 template <>
 void ConvolutionOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this, { Kernels });
     auto input = getInput(Inputs);
     auto kernels = getInput(Kernels);
     auto output = getOutput(Outputs);
@@ -371,29 +389,51 @@ void ConvolutionOp<ReferenceBackend>::run() {
     float* inputData = input->data<float>();
     float* kernelData = kernels->data<float>();
     float* outputData = output->data<float>();
+    bool isNCHW = input->getShape().getLayout() == NCHW;
+    int rowIdx = isNCHW ? 2 : 1;
+    int colIdx = isNCHW ? 3 : 2;
+    int chanIdx = isNCHW ? 1 : 3;
+    // Find the input channels that are all zero, typically after a ReLU.
+    int numImgs = inputShape[0];
+    int numChans = inputShape[chanIdx];
+    std::vector<uint8_t> chanOccupancy(numImgs * numChans, 1);
+    if (input->hasOccupancy()) {
+        std::vector<int> regionSize = inputShape.dims();
+        regionSize[0] = 1;
+        regionSize[chanIdx] = 1;
+        std::vector<int> origin(inputShape.ndims(), 0);
+        for (int img = 0; img < numImgs; img++) {
+            origin[0] = img;
+            for (int chan = 0; chan < numChans; chan++) {
+                origin[chanIdx] = chan;
+                chanOccupancy[img * numChans + chan] =
+                        !input->isRegionZero(origin, regionSize);
+            }
+        }
+    }
     mapArrayToAccel(ref::kConvolutionHw, "input", inputData,
                     inputShape.storageSize() * sizeof(float));
+    mapArrayToAccel(ref::kConvolutionHw, "chan_occupancy",
+                    chanOccupancy.data(), chanOccupancy.size());
     mapArrayToAccel(ref::kConvolutionHw, "kernels", kernelData,
                     kernelShape.storageSize() * sizeof(float));
     mapArrayToAccel(ref::kConvolutionHw, "result", outputData,
                     outputShape.storageSize() * sizeof(float));
-    bool isNCHW = input->getShape().getLayout() == NCHW;
     auto func = isNCHW ? (paddingType == ValidPadding
                                   ? ref_conv3d_nchw_valid_padding
                                   : ref_conv3d_nchw_same_padding)
                        : (paddingType == ValidPadding
                                   ? ref_conv3d_nhwc_valid_padding
                                   : ref_conv3d_nhwc_same_padding);
-    int rowIdx = isNCHW ? 2 : 1;
-    int colIdx = isNCHW ? 3 : 2;
-    int chanIdx = isNCHW ? 1 : 3;
     invokeKernel(ref::kConvolutionHw, func, inputData, kernelData, outputData,
                  inputShape[0], inputShape[chanIdx], inputShape[rowIdx],
                  inputShape[colIdx], inputShape.getPadding(3), kernelShape[0],
                  kernelShape[rowIdx], kernelShape[colIdx],
                  kernelShape.getPadding(3), getRowStride(), getColStride(),
                  outputShape[rowIdx], outputShape[colIdx],
-                 outputShape.getPadding(3), actInfo.function, actInfo.params);
+                 outputShape.getPadding(3), chanOccupancy.data(),
+                 actInfo.function, actInfo.params);
+    updateOutputOccupancy(output);
 }
 
 }  // namespace smaug
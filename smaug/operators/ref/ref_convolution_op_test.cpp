@@ -1,8 +1,12 @@
+#include <limits>
+
 #include "catch.hpp"
 #include "smaug/core/backend.h"
 #include "smaug/core/tensor.h"
+#include "smaug/core/workspace.h"
 #include "smaug/core/smaug_test.h"
 #include "smaug/operators/convolution_op.h"
+#include "smaug/operators/smv/smv_test_common.h"
 
 using namespace smaug;
 
@@ -275,3 +279,93 @@ TEST_CASE_METHOD(SmaugTest, "Reference convolution operator", "[refop]") {
         }
     }
 }
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Reference convolution skipping zero channels",
+                 "[refop]") {
+    auto convOp = new ConvolutionOp<ReferenceBackend>("conv", workspace());
+    // Each channel spans whole occupancy blocks.
+    TensorShape inputShape({ 1, 2, 4, 4 }, DataLayout::NCHW);
+    Tensor* input = new Tensor("input", inputShape);
+    input->allocateStorage<float>();
+    input->fillData<float>({
+            1, 2,  3,  4,  5,  6,  7,  8,  // Channel 0
+            9, 10, 11, 12, 13, 14, 15, 16,
+            0, 0,  0,  0,  0,  0,  0,  0,  // Channel 1
+            0, 0,  0,  0,  0,  0,  0,  0
+    });
+    workspace()->addTensor(input);
+    convOp->setInput(input, 0);
+    convOp->setPadding(ValidPadding);
+    convOp->setWeightDims(3, 3, 1);
+    convOp->setStride(1, 1);
+    convOp->setActivation(ActivationInfo(activation_type::RELU));
+    convOp->createAllTensors();
+    allocateAllTensors<float>(convOp);
+    // The weights of channel 1 are NaN, so the result is only valid if the
+    // all-zero channel is skipped.
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    convOp->getInput(1)->fillData<float>({ 1, 1, 1, 1, 1, 1, 1, 1, 1,
+                                           nan, nan, nan, nan, nan, nan, nan,
+                                           nan, nan });
+    input->computeOccupancy();
+    input->incrDataVersion();
+    convOp->run();
+    auto outputsTensor = convOp->getOutput(0);
+    verifyOutputs(outputsTensor, std::vector<float>{ 54, 63, 90, 99 });
+
+    // The fused ReLU records the occupancy of the output.
+    outputsTensor->incrDataVersion();
+    REQUIRE(outputsTensor->hasOccupancy());
+    REQUIRE(!outputsTensor->isRegionZero({ 0, 0, 0, 0 }, { 1, 1, 1, 1 }));
+}
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Reference convolution with fp16 storage",
+                 "[refop]") {
+    auto convOp = new ConvolutionOp<ReferenceBackend>("conv", workspace());
+    TensorShape inputShape({ 1, 8, 8, 8 }, DataLayout::NCHW);
+    Tensor* input = new Tensor("input", inputShape);
+    workspace()->addTensor(input);
+    input->allocateStorage<float16>();
+    convOp->setInput(input, 0);
+    convOp->setPadding(SamePadding);
+    convOp->setWeightDims(3, 3, 4);
+    convOp->setStride(1, 1);
+    convOp->setActivation(ActivationInfo(activation_type::RELU));
+    createAndFillTensorsWithData<float16>(convOp, fillTensorWithRandomData);
+    Tensor* kernels = convOp->getInput(1);
+
+    // The same convolution on the fp32 values of the fp16 tensors.
+    auto refOp = new ConvolutionOp<ReferenceBackend>("ref_conv", workspace());
+    refOp->setInput(convertFp16ToFp32Tensor(input, workspace()), 0);
+    refOp->setInput(convertFp16ToFp32Tensor(kernels, workspace()), 1);
+    refOp->setPadding(SamePadding);
+    refOp->setWeightDims(3, 3, 4);
+    refOp->setStride(1, 1);
+    refOp->setActivation(ActivationInfo(activation_type::RELU));
+    refOp->createAllTensors();
+    refOp->getOutput(0)->allocateStorage<float>();
+    refOp->run();
+
+    convOp->run();
+    // The operator computes in fp32 and rounds its results to fp16.
+    Tensor* output = convOp->getOutput(0);
+    REQUIRE(output->getDataType() == Float16);
+    verifyOutputs<float16>(
+            output, convertFp32ToFp16Tensor(refOp->getOutput(0), workspace()));
+    // The original tensors are restored after the run.
+    REQUIRE(convOp->getInput(0) == input);
+    REQUIRE(convOp->getInput(1) == kernels);
+
+    // The widened kernels are cached for the next runs, until they change.
+    Tensor* cachedKernels = workspace()->getCachedFp32Copy(kernels);
+    REQUIRE(cachedKernels != nullptr);
+    REQUIRE(workspace()->getCachedFp32Copy(input) == nullptr);
+    convOp->run();
+    REQUIRE(workspace()->getCachedFp32Copy(kernels) == cachedKernels);
+    verifyOutputs<float16>(
+            output, convertFp32ToFp16Tensor(refOp->getOutput(0), workspace()));
+    kernels->incrDataVersion();
+    REQUIRE(workspace()->getCachedFp32Copy(kernels) == nullptr);
+}
@@ -1,6 +1,7 @@
 #include "smaug/core/backend.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/depthwise_convolution_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -166,6 +167,7 @@ namespace smaug {
 
 template <>
 void DepthwiseConvolutionOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this, { Kernels });
     auto input = getInput(Inputs);
     auto kernels = getInput(Kernels);
     auto output = getOutput(Outputs);
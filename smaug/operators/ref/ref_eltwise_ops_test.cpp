@@ -10,6 +10,7 @@
 #include "smaug/operators/elu_op.h"
 #include "smaug/operators/sigmoid_op.h"
 #include "smaug/operators/tanh_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 
 using namespace smaug;
 
@@ -246,3 +247,68 @@ TEST_CASE_METHOD(SmaugTest, "Reference saturating nonlinearities", "[refop]") {
         verifyOutputs(outputsTensor, expectedValues);
     }
 }
+
+TEST_CASE_METHOD(SmaugTest,
+                 "Reference eltwise operators with fp16 storage",
+                 "[refop]") {
+    // More than two blocks of fp16 conversion, the last one partial.
+    int size = 2 * ref::kFp16BlockSize + 100;
+    TensorShape inputShape({ 1, size }, DataLayout::NC);
+    Tensor* input0 = new Tensor("input0", inputShape);
+    Tensor* input1 = new Tensor("input1", inputShape);
+    input0->allocateStorage<float16>();
+    input1->allocateStorage<float16>();
+    workspace()->addTensor(input0);
+    workspace()->addTensor(input1);
+    for (int i = 0; i < size; i++) {
+        input0->data<float16>()[i] = fp16((i % 37) * 0.25 - 4);
+        input1->data<float16>()[i] = fp16((i % 11) * 0.5 - 2);
+    }
+
+    SECTION("Element-wise add operator") {
+        auto addOp = new EltwiseAddOp<ReferenceBackend>("add", workspace());
+        addOp->setInput(input0, 0);
+        addOp->setInput(input1, 1);
+        addOp->createAllTensors();
+        allocateAllTensors<float16>(addOp);
+        addOp->run();
+        std::vector<float16> expectedValues(size);
+        for (int i = 0; i < size; i++) {
+            expectedValues[i] = fp16(fp32(input0->data<float16>()[i]) +
+                                     fp32(input1->data<float16>()[i]));
+        }
+        verifyOutputs(addOp->getOutput(0), expectedValues);
+    }
+
+    SECTION("ReLU operator") {
+        auto reluOp = new ReluOp<ReferenceBackend>("relu", workspace());
+        reluOp->setInput(input0, 0);
+        reluOp->createAllTensors();
+        allocateAllTensors<float16>(reluOp);
+        reluOp->run();
+        std::vector<float16> expectedValues(size);
+        for (int i = 0; i < size; i++) {
+            expectedValues[i] =
+                    fp16(std::max(0.0f, fp32(input0->data<float16>()[i])));
+        }
+        verifyOutputs(reluOp->getOutput(0), expectedValues);
+    }
+
+    SECTION("Greater operator") {
+        auto greaterOp =
+                new GreaterOp<ReferenceBackend>("greater", workspace());
+        greaterOp->setInput(input0, 0);
+        greaterOp->setInput(input1, 1);
+        greaterOp->createAllTensors();
+        greaterOp->getOutput(0)->allocateStorage<bool>();
+        greaterOp->run();
+        std::vector<bool> expectedValues(size);
+        for (int i = 0; i < size; i++) {
+            expectedValues[i] = fp32(input0->data<float16>()[i]) >
+                                fp32(input1->data<float16>()[i]);
+        }
+        bool* outputData = greaterOp->getOutput(0)->data<bool>();
+        for (int i = 0; i < size; i++)
+            REQUIRE(outputData[i] == expectedValues[i]);
+    }
+}
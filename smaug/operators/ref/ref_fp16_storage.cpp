@@ -0,0 +1,82 @@
+#include <algorithm>
+
+#include "smaug/core/tensor_utils.h"
+#include "smaug/core/workspace.h"
+#include "smaug/operators/common.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
+
+namespace smaug {
+namespace ref {
+
+static std::unique_ptr<Tensor> createFp32Tensor(Tensor* tensor) {
+    std::unique_ptr<Tensor> fp32(
+            new Tensor(tensor->getName() + "/fp32", tensor->getShape()));
+    fp32->allocateStorage<float>();
+    return fp32;
+}
+
+static std::unique_ptr<Tensor> widenTensor(Tensor* tensor) {
+    std::unique_ptr<Tensor> fp32 = createFp32Tensor(tensor);
+    convertFp16ToFp32(tensor->data<float16>(), fp32->data<float>(),
+                      tensor->getShape().storageSize());
+    // Keep the occupancy of the input, so that kernels can still skip its
+    // all-zero blocks.
+    if (tensor->hasOccupancy()) {
+        fp32->computeOccupancy();
+        fp32->incrDataVersion();
+    }
+    return fp32;
+}
+
+Fp16StorageScope::Fp16StorageScope(Operator* _op,
+                                   const std::vector<int>& parameters)
+        : op(_op) {
+    Workspace* workspace = op->getWorkspace();
+    for (int i = 0; i < op->getInputs().size(); i++) {
+        Tensor* tensor = op->getInput(i);
+        if (!tensor || tensor->getDataType() != Float16 ||
+            !tensor->containsData())
+            continue;
+        if (std::find(parameters.begin(), parameters.end(), i) ==
+            parameters.end()) {
+            std::unique_ptr<Tensor> fp32 = widenTensor(tensor);
+            op->setInput(fp32.get(), i);
+            inputs.push_back({ i, tensor, std::move(fp32) });
+            continue;
+        }
+        Tensor* fp32 = workspace->getCachedFp32Copy(tensor);
+        if (!fp32)
+            fp32 = workspace->cacheFp32Copy(tensor, widenTensor(tensor));
+        op->setInput(fp32, i);
+        inputs.push_back({ i, tensor, nullptr });
+    }
+    // The kernels overwrite their outputs, so there is nothing to convert.
+    for (int i = 0; i < op->getOutputs().size(); i++) {
+        Tensor* tensor = op->getOutput(i);
+        if (!tensor || tensor->getDataType() != Float16)
+            continue;
+        std::unique_ptr<Tensor> fp32 = createFp32Tensor(tensor);
+        op->setOutput(fp32.get(), i);
+        outputs.push_back({ i, tensor, std::move(fp32) });
+    }
+}
+
+Fp16StorageScope::~Fp16StorageScope() {
+    for (auto& output : outputs) {
+        convertFp32ToFp16(output.fp32->data<float>(),
+                          output.original->data<float16>(),
+                          output.original->getShape().storageSize());
+        // If the operator built the occupancy bitmap of its fp32 output, it
+        // becomes valid once the data version is bumped; rebuild it for the
+        // fp16 output, which may have gained zeros from underflow.
+        output.fp32->incrDataVersion();
+        if (output.fp32->hasOccupancy())
+            output.original->computeOccupancy();
+        op->setOutput(output.original, output.index);
+    }
+    for (auto& input : inputs)
+        op->setInput(input.original, input.index);
+}
+
+}  // namespace ref
+}  // namespace smaug
@@ -0,0 +1,103 @@
+#ifndef _OPERATORS_REF_REF_FP16_STORAGE_H_
+#define _OPERATORS_REF_REF_FP16_STORAGE_H_
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "smaug/core/operator.h"
+#include "smaug/core/tensor.h"
+#include "smaug/core/tensor_utils.h"
+
+namespace smaug {
+namespace ref {
+
+/**
+ * A RAII helper that lets a Reference operator run its fp32 kernel when its
+ * tensors are stored in fp16 (see useFp16ReferenceStorage).
+ *
+ * On construction, every fp16 input of the operator is widened into an fp32
+ * copy, and every fp16 output is replaced by an fp32 buffer. When the scope
+ * ends, the results are rounded back into the fp16 outputs and the original
+ * tensors are restored. Like the SMV backend, this computes in fp32 but
+ * rounds to fp16 at every operator boundary. Operators whose tensors are not
+ * fp16 are left untouched.
+ *
+ * The inputs listed as parameters (e.g. the weights) don't change from one
+ * run to the next. Their fp32 copies are cached in the Workspace of the
+ * operator, and are only widened again if their data changes.
+ *
+ * This is for operators whose kernels index into whole tensors. Elementwise
+ * operators use runElementwise() instead, which never widens a whole tensor.
+ */
+class Fp16StorageScope {
+   public:
+    Fp16StorageScope(Operator* _op, const std::vector<int>& parameters = {});
+    ~Fp16StorageScope();
+
+   protected:
+    struct StagedTensor {
+        int index;
+        Tensor* original;
+        /** The fp32 copy, unless it is cached in the Workspace. */
+        std::unique_ptr<Tensor> fp32;
+    };
+
+    Operator* op;
+    std::vector<StagedTensor> inputs;
+    std::vector<StagedTensor> outputs;
+};
+
+/** The number of elements that runElementwise() widens at a time. */
+constexpr int kFp16BlockSize = 4096;
+
+/**
+ * Runs an elementwise kernel over the inputs and the output of an operator.
+ *
+ * The kernel is called as kernel(inputs, results, size) on fp32 inputs. If
+ * the inputs are stored in fp32, it runs once over the whole tensors.
+ * Otherwise, it runs on one block of kFp16BlockSize elements at a time: each
+ * block of the inputs is widened into an fp32 buffer, and the results of a
+ * block are rounded into the fp16 output before the next one. Outputs that are
+ * not floating point, like the bools of a comparison, are written in place.
+ */
+template <typename OutputType = float, typename Kernel>
+void runElementwise(const std::vector<Tensor*>& inputs,
+                    Tensor* output,
+                    Kernel kernel) {
+    int size = output->getShape().storageSize();
+    std::vector<float*> inputData;
+    if (inputs[0]->getDataType() != Float16) {
+        for (Tensor* input : inputs)
+            inputData.push_back(input->data<float>());
+        kernel(inputData, output->data<OutputType>(), size);
+        return;
+    }
+    std::vector<std::vector<float>> inputBlocks(
+            inputs.size(), std::vector<float>(kFp16BlockSize));
+    for (auto& block : inputBlocks)
+        inputData.push_back(block.data());
+    std::vector<float> resultsBlock;
+    if (std::is_same<OutputType, float>::value)
+        resultsBlock.resize(kFp16BlockSize);
+    for (int start = 0; start < size; start += kFp16BlockSize) {
+        int blockSize = std::min(kFp16BlockSize, size - start);
+        for (int i = 0; i < inputs.size(); i++) {
+            convertFp16ToFp32(inputs[i]->data<float16>() + start,
+                              inputData[i], blockSize);
+        }
+        if constexpr (std::is_same<OutputType, float>::value) {
+            kernel(inputData, resultsBlock.data(), blockSize);
+            convertFp32ToFp16(resultsBlock.data(),
+                              output->data<float16>() + start, blockSize);
+        } else {
+            kernel(inputData, output->data<OutputType>() + start, blockSize);
+        }
+    }
+}
+
+}  // namespace ref
+}  // namespace smaug
+
+#endif
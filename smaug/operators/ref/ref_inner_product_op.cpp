@@ -2,6 +2,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/inner_product_op.h"
 #include "smaug/operators/ref/ref_activation_fun_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 #include "smaug/utility/debug_stream.h"
 
 #ifdef __cplusplus
@@ -134,6 +135,7 @@ namespace smaug {
 
 template <>
 void InnerProductOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this, { Weights });
     auto input = getInput(Inputs);
     auto weights = getInput(Weights);
     auto output = getOutput(Outputs);
@@ -164,6 +166,7 @@ void InnerProductOp<ReferenceBackend>::run() {
                  inputShape[0], weightShape[actIdx], weightShape[neuronIdx],
                  inputShape.getPadding(1), weightShape.getPadding(1),
                  outputShape.getPadding(1), actInfo.function, actInfo.params);
+    updateOutputOccupancy(output);
 }
 
 }  // namespace smaug
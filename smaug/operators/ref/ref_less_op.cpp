@@ -1,6 +1,7 @@
 #include "smaug/core/backend.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/less_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,17 +54,19 @@ void LessOp<ReferenceBackend>::run() {
     const TensorShape& outputShape = output->getShape();
     assert(input0Shape == input1Shape && input0Shape == outputShape);
 
-    float* input0Data = input0->data<float>();
-    float* input1Data = input1->data<float>();
-    bool* outputData = output->data<bool>();
-    mapArrayToAccel(ref::kEltwiseOpHw, "input0", input0Data,
-                    input0Shape.storageSize() * sizeof(float));
-    mapArrayToAccel(ref::kEltwiseOpHw, "input1", input1Data,
-                    input1Shape.storageSize() * sizeof(float));
-    mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
-                    outputShape.storageSize() * sizeof(bool));
-    invokeKernel(ref::kEltwiseOpHw, ref_less, input0Data, input1Data,
-                 outputData, input0Shape.size());
+    ref::runElementwise<bool>(
+            { input0, input1 }, output,
+            [&](const std::vector<float*>& inputData, bool* outputData,
+                int size) {
+                mapArrayToAccel(ref::kEltwiseOpHw, "input0", inputData[0],
+                                size * sizeof(float));
+                mapArrayToAccel(ref::kEltwiseOpHw, "input1", inputData[1],
+                                size * sizeof(float));
+                mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
+                                size * sizeof(bool));
+                invokeKernel(ref::kEltwiseOpHw, ref_less, inputData[0],
+                             inputData[1], outputData, size);
+            });
 }
 
 template <>
@@ -76,17 +79,19 @@ void LessEqualOp<ReferenceBackend>::run() {
     const TensorShape& outputShape = output->getShape();
     assert(input0Shape == input1Shape && input0Shape == outputShape);
 
-    float* input0Data = input0->data<float>();
-    float* input1Data = input1->data<float>();
-    bool* outputData = output->data<bool>();
-    mapArrayToAccel(ref::kEltwiseOpHw, "input0", input0Data,
-                    input0Shape.storageSize() * sizeof(float));
-    mapArrayToAccel(ref::kEltwiseOpHw, "input1", input1Data,
-                    input1Shape.storageSize() * sizeof(float));
-    mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
-                    outputShape.storageSize() * sizeof(bool));
-    invokeKernel(ref::kEltwiseOpHw, ref_less_equal, input0Data, input1Data,
-                 outputData, input0Shape.size());
+    ref::runElementwise<bool>(
+            { input0, input1 }, output,
+            [&](const std::vector<float*>& inputData, bool* outputData,
+                int size) {
+                mapArrayToAccel(ref::kEltwiseOpHw, "input0", inputData[0],
+                                size * sizeof(float));
+                mapArrayToAccel(ref::kEltwiseOpHw, "input1", inputData[1],
+                                size * sizeof(float));
+                mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
+                                size * sizeof(bool));
+                invokeKernel(ref::kEltwiseOpHw, ref_less_equal, inputData[0],
+                             inputData[1], outputData, size);
+            });
 }
 
 }  // namespace smaug
@@ -3,6 +3,7 @@
 #include "smaug/core/backend.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/pooling_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -362,6 +363,7 @@ namespace smaug {
 
 template <>
 void MaxPoolingOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this);
     auto input = getInput(Inputs);
     auto output = getOutput(Outputs);
     const TensorShape& inputShape = input->getShape();
@@ -395,6 +397,7 @@ void MaxPoolingOp<ReferenceBackend>::run() {
 
 template <>
 void AvgPoolingOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this);
     auto input = getInput(Inputs);
     auto output = getOutput(Outputs);
     const TensorShape& inputShape = input->getShape();
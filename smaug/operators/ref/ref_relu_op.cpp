@@ -2,6 +2,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/relu_op.h"
 #include "smaug/operators/ref/ref_activation_fun_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 
 namespace smaug {
 
@@ -10,18 +11,24 @@ void ReluOp<ReferenceBackend>::run() {
     auto inputs = getInput(Inputs);
     auto outputs = getOutput(Outputs);
     assert(inputs->getShape() == outputs->getShape());
-    float* inputData = inputs->data<float>();
-    float* outputData = outputs->data<float>();
-    mapArrayToAccel(ref::kEltwiseOpHw, "inputs", inputData,
-                    inputs->getShape().storageSize() * sizeof(float));
-    mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
-                    inputs->getShape().storageSize() * sizeof(float));
     activation_type function =
             slope == 0 ? activation_type::RELU : activation_type::LRELU;
     activation_param_t params;
     params.slope = slope;
-    invokeKernel(ref::kEltwiseOpHw, ref_activation_fun_nc, inputData,
-                 outputData, inputs->getShape().size(), function, params);
+    ref::runElementwise(
+            { inputs }, outputs,
+            [&](const std::vector<float*>& inputData, float* outputData,
+                int size) {
+                mapArrayToAccel(ref::kEltwiseOpHw, "inputs", inputData[0],
+                                size * sizeof(float));
+                mapArrayToAccel(ref::kEltwiseOpHw, "results", outputData,
+                                size * sizeof(float));
+                invokeKernel(ref::kEltwiseOpHw, ref_activation_fun_nc,
+                             inputData[0], outputData, size, function,
+                             params);
+            });
+    if (function == activation_type::RELU)
+        outputs->computeOccupancy();
 }
 
 }  // namespace smaug
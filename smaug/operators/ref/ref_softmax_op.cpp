@@ -3,6 +3,7 @@
 #include "smaug/core/backend.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/softmax_op.h"
+#include "smaug/operators/ref/ref_fp16_storage.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -100,6 +101,7 @@ namespace smaug {
 
 template <>
 void SoftmaxOp<ReferenceBackend>::run() {
+    ref::Fp16StorageScope fp16Storage(this);
     auto inputs = getInput(Inputs);
     auto outputs = getOutput(Outputs);
     const TensorShape& inputShape = inputs->getShape();
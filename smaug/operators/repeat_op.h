@@ -68,34 +68,7 @@ class RepeatOp : public Operator {
     }
 
     void run() override {
-        Tensor* input = getInput(0);
-        Tensor* output = getOutput(0);
-        int ndims = input->ndims();
-        std::vector<int> inputDims = input->getShape().dims();
-        std::vector<int> outputDims = output->getShape().dims();
-        std::vector<int> srcOrigin = std::vector<int>(ndims, 0);
-        // Copy the first piece of input into output.
-        copyTensorRegion(output, input, srcOrigin, srcOrigin, inputDims);
-        for (int i = ndims - 1; i >= 0; i--) {
-            std::vector<int> currCopyRegion = inputDims;
-            for (int j = i + 1; j < ndims; j++)
-                currCopyRegion[j] = outputDims[j];
-            std::vector<int> dstOrigin(ndims, 0);
-            dstOrigin[i] = inputDims[i];
-            while (dstOrigin[i] + currCopyRegion[i] <= outputDims[i]) {
-                copyTensorRegion(
-                        output, output, dstOrigin, srcOrigin, currCopyRegion);
-                dstOrigin[i] += currCopyRegion[i];
-                // Double the copy size for the next iteration.
-                currCopyRegion[i] *= 2;
-            }
-            // Copy the remaining part if there's any.
-            if (dstOrigin[i] < outputDims[i]) {
-                currCopyRegion[i] = outputDims[i] - dstOrigin[i];
-                copyTensorRegion(
-                        output, output, dstOrigin, srcOrigin, currCopyRegion);
-            }
-        }
+        repeatTensorData(getOutput(0), getInput(0));
     }
 
    protected:
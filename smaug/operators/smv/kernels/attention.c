@@ -0,0 +1,115 @@
+#include <float.h>
+#include <math.h>
+
+#include "smaug/operators/common.h"
+#include "smaug/operators/smv/kernels/params.h"
+#include "smaug/operators/smv/kernels/load_store_fp16_data.h"
+#include "smaug/operators/smv/kernels/activation_functions_simd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \ingroup AladdinKernels
+ *
+ * SMV implementation of fused additive attention for one batch.
+ *
+ * The keys and values of the batch are loaded once and stay in the
+ * scratchpads for all three stages: the scores tanh(query + keys) * weights,
+ * their softmax and the context, which is the alignment-weighted sum of the
+ * values. The local scratchpad holds three rows of depth_size elements (the
+ * alignment weights, the query and the context), followed by time_steps
+ * scores.
+ *
+ * @param host_query Host buffer of the projected query of this batch.
+ * @param host_keys Host buffer of the keys of this batch.
+ * @param host_values Host buffer of the values of this batch.
+ * @param host_weights Host buffer of the alignment weights.
+ * @param host_results Host buffer of the context of this batch.
+ * @param keys Keys scratchpad.
+ * @param values Values scratchpad.
+ * @param local Scratchpad for the weights, query, context and scores.
+ * @param time_steps Number of time steps in the keys and values.
+ * @param depth Number of channels.
+ * @param depth_pad Alignment padding of the channels.
+ * @param read_weights Load the alignment weights. They can be kept in the
+ *        local scratchpad across the batches of one operator.
+ */
+void smv_attention_nc_vec_fxp(float16* host_query,
+                              float16* host_keys,
+                              float16* host_values,
+                              float16* host_weights,
+                              float16* host_results,
+                              float* keys,
+                              float* values,
+                              float* local,
+                              int time_steps,
+                              int depth,
+                              int depth_pad,
+                              bool read_weights) {
+    int depth_size = depth + depth_pad;
+    int depth_vec_size = depth_size / VECTOR_SIZE;
+    int scores_start = 3 * depth_size;
+    if (read_weights) {
+        host_load_fp16(local, host_weights, depth_size, 0, 0);
+        // Zero the padded weights, so that the padded channels don't
+        // contribute to the scores.
+        attention_weights_pad:
+        for (int c = depth; c < depth_size; c++)
+            local[c] = 0;
+    }
+    host_load_fp16(local, host_query, depth_size, depth_size, 0);
+    host_load_fp16(keys, host_keys, time_steps * depth_size, 0, 0);
+    host_load_fp16(values, host_values, time_steps * depth_size, 0, 0);
+
+    VEC_ARRAY_2D(v8fp_t, _local, local, depth_size);
+    VEC_ARRAY_2D(v8fp_t, _keys, keys, depth_size);
+    VEC_ARRAY_2D(v8fp_t, _values, values, depth_size);
+
+    // Compute the scores and their max.
+    float max_score = -FLT_MAX;
+    attention_score:
+    for (int t = 0; t < time_steps; t++) {
+        v8fp_t partial_sums = (v8fp_t){ 0 };
+        attention_score_depth:
+        for (int c = 0; c < depth_vec_size; c++) {
+            partial_sums +=
+                    tanh_vec_unit(_local[1][c] + _keys[t][c]) * _local[0][c];
+        }
+        float score = 0;
+        attention_score_reduce:
+        for (int k = 0; k < VECTOR_SIZE; k++)
+            score += partial_sums[k];
+        local[scores_start + t] = score;
+        max_score = max2(max_score, score);
+    }
+
+    // Subtract the max before exponentiating, so that exp can't overflow.
+    float normaliz = 0.0;
+    attention_softmax:
+    for (int t = 0; t < time_steps; t++) {
+        local[scores_start + t] = exp(local[scores_start + t] - max_score);
+        normaliz += local[scores_start + t];
+    }
+    normaliz = 1.0 / (normaliz + 1e-6);  // epsilon for numerical stability.
+
+    attention_context_init:
+    for (int c = 0; c < depth_vec_size; c++)
+        _local[2][c] = (v8fp_t){ 0 };
+    attention_context:
+    for (int t = 0; t < time_steps; t++) {
+        float alignment = local[scores_start + t] * normaliz;
+        v8fp_t alignment_vec = { alignment, alignment, alignment, alignment,
+                                 alignment, alignment, alignment, alignment };
+        attention_context_depth:
+        for (int c = 0; c < depth_vec_size; c++)
+            _local[2][c] += alignment_vec * _values[t][c];
+    }
+
+    // Store the context to the host memory.
+    host_store_fp16(local, host_results, depth_size, 2 * depth_size, 0);
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -242,10 +242,10 @@ void smv_batch_norm_post_conv_nhwc_vec_fxp(float16* host_inputs,
         row_sample = min2(row_sample, sample_num);
         col_sample = min2(col_sample, sample_num);
     }
-    setSamplingFactor("bn_batch", inputs_nums * 1.0 / batch_sample);
-    setSamplingFactor("bn_chan", inputs_chans_vec * 1.0 / chan_sample);
-    setSamplingFactor("bn_row", inputs_rows * 1.0 / row_sample);
-    setSamplingFactor("bn_col", inputs_cols * 1.0 / col_sample);
+    SET_SAMPLING_FACTOR("bn_batch", inputs_nums * 1.0 / batch_sample);
+    SET_SAMPLING_FACTOR("bn_chan", inputs_chans_vec * 1.0 / chan_sample);
+    SET_SAMPLING_FACTOR("bn_row", inputs_rows * 1.0 / row_sample);
+    SET_SAMPLING_FACTOR("bn_col", inputs_cols * 1.0 / col_sample);
 
     bn_batch:
     for (int i = 0; i < batch_sample; i++) {
@@ -10,6 +10,77 @@
 extern "C" {
 #endif
 
+/**
+ * Reduces the finished results in the scratchpad with a pooling function, in
+ * place. The pooling windows must not overlap, i.e. the pooling strides equal
+ * the pooling sizes. Each pooled pixel is written at or before the first pixel
+ * of its window, so no window is overwritten before it is read.
+ *
+ * @param results Local results buffer in NHWC.
+ * @param results_dims Dimensions of the results before pooling.
+ * @param results_pad Alignment padding size on the channel dimension of the
+ *        results.
+ * @param pool_function Max or average pooling.
+ * @param pool_rows Row size of the pooling function.
+ * @param pool_cols Column size of the pooling function.
+ * @returns The number of elements of the pooled results.
+ */
+int smv_pool_results_vec(float* results,
+                         int results_dims[4],
+                         int results_pad,
+                         pool_type pool_function,
+                         int pool_rows,
+                         int pool_cols) {
+    int result_cols = results_dims[2];
+    int result_height = results_dims[3];
+    int pooled_rows = results_dims[1] / pool_rows;
+    int pooled_cols = result_cols / pool_cols;
+    int chan_groups = (result_height + results_pad) / VECTOR_SIZE;
+    float scale = 1.0 / (pool_rows * pool_cols);
+    v8fp_t scale_vec = { scale, scale, scale, scale,
+                         scale, scale, scale, scale };
+    VEC_ARRAY_3D(
+            v8fp_t, _result, results, result_cols, result_height + results_pad);
+    VEC_ARRAY_3D(
+            v8fp_t, _pooled, results, pooled_cols, result_height + results_pad);
+
+    pool_results_row:
+    for (int row = 0; row < pooled_rows; row++) {
+        pool_results_col:
+        for (int col = 0; col < pooled_cols; col++) {
+            pool_results_chan_grp:
+            for (int chan_grp = 0; chan_grp < chan_groups; chan_grp++) {
+                v8fp_t curr_results =
+                        _result[row * pool_rows][col * pool_cols][chan_grp];
+                pool_results_window_row:
+                for (int pool_i = 0; pool_i < pool_rows; pool_i++) {
+                    pool_results_window_col:
+                    for (int pool_j = 0; pool_j < pool_cols; pool_j++) {
+                        v8fp_t next_pixels =
+                                _result[row * pool_rows + pool_i]
+                                       [col * pool_cols + pool_j][chan_grp];
+                        if (pool_function == AVG_POOLING) {
+                            if (pool_i != 0 || pool_j != 0)
+                                curr_results += next_pixels;
+                            continue;
+                        }
+                        pool_results_compare:
+                        for (int px = 0; px < VECTOR_SIZE; px++) {
+                            if (curr_results[px] < next_pixels[px])
+                                curr_results[px] = next_pixels[px];
+                        }
+                    }
+                }
+                if (pool_function == AVG_POOLING)
+                    curr_results *= scale_vec;
+                _pooled[row][col][chan_grp] = curr_results;
+            }
+        }
+    }
+    return results_dims[0] * pooled_rows * pooled_cols *
+           (result_height + results_pad);
+}
+
 /** \ingroup AladdinKernels
  *
  * Perform a 3D convolution with one kernel on an image, with reduction in NHWC
@@ -43,11 +114,22 @@ extern "C" {
  *        for non-first weight tiles.
  * @param read_inputs Load inputs from the host. Set to false if the input
  *        activations can be reused from the last invocation.
+ * @param retained_start The row of the inputs of the last invocation from which
+ *        they overlap with these inputs, when the two are consecutive row
+ *        tiles.
+ * @param retained_rows The number of overlapping rows. They are moved to the
+ *        top of the local inputs buffer, and only the rows after them are
+ *        loaded from the host.
  * @param read_weights Load weights from the host. Set to false if the weights
  *        can be reused from the last invocation.
  * @param send_results Send the results to the host memory if this is true.
  * @param act_function Activation function the operator runs.
  * @param act_params Parameters for the activation function.
+ * @param pool_function Pooling function fused into the output stage. The
+ *        results are pooled after the activation function, and only the
+ *        pooled results are sent back to the host.
+ * @param pool_rows Row size (and stride) of the fused pooling function.
+ * @param pool_cols Column size (and stride) of the fused pooling function.
  * @param sampling Simulation samplng settings.
  */
 void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
@@ -69,10 +151,15 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
                              int kern_start,
                              bool accumulate,
                              bool read_inputs,
+                             int retained_start,
+                             int retained_rows,
                              bool read_weights,
                              bool send_results,
                              activation_type act_function,
                              activation_param_t act_params,
+                             pool_type pool_function,
+                             int pool_rows,
+                             int pool_cols,
                              SamplingInfo* sampling) {
     int result_rows = results_dims[1];
     int result_cols = results_dims[2];
@@ -121,9 +208,19 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
     int num_eff_kernels = min2(weights_dims[0], result_height);
     int num_kernel_blocks = (num_eff_kernels - 1) / NUM_PE_INSTS;
 
-    // Load inputs and weights if needed.
-    if (read_inputs)
-        host_load_fp16(inputs, host_inputs, inputs_size, 0, 0);
+    // Load inputs and weights if needed. The halo rows shared with the last
+    // row tile are shifted up in the scratchpad instead of being reloaded.
+    if (read_inputs) {
+        int row_size = a_cols * (a_height + a_pad);
+        int retained_size = retained_rows * row_size;
+        VEC_ARRAY_1D(v8fp_t, _inputs_vec, inputs);
+        int retained_offset_vec = retained_start * row_size / VECTOR_SIZE;
+        shift_retained_rows:
+        for (int v = 0; v < retained_size / VECTOR_SIZE; v++)
+            _inputs_vec[v] = _inputs_vec[retained_offset_vec + v];
+        host_load_fp16(inputs, host_inputs, inputs_size - retained_size,
+                       retained_size, retained_size);
+    }
     if (read_weights)
         host_load_fp16(weights, host_weights, weights_size, 0, 0);
 
@@ -155,16 +252,18 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
                 min2(output_col_sample_iters, max2(2, sample_num));
         output_col_sample = output_col_sample_iters * col_stride;
     }
-    setSamplingFactor("ofmap_block_iteration",
-                      (num_kernel_blocks + 1) * 1.0 / pe_block_sample);
-    setSamplingFactor("k_row", k_rows * 1.0 / kern_row_sample);
-    setSamplingFactor("k_col", k_cols * 1.0 / kern_col_sample);
-    setSamplingFactor(
+    SET_SAMPLING_FACTOR("ofmap_block_iteration",
+                        (num_kernel_blocks + 1) * 1.0 / pe_block_sample);
+    SET_SAMPLING_FACTOR("k_row", k_rows * 1.0 / kern_row_sample);
+    SET_SAMPLING_FACTOR("k_col", k_cols * 1.0 / kern_col_sample);
+    SET_SAMPLING_FACTOR(
             "pe_iteration", (num_chan_blocks + 1) * 1.0 / chan_block_sample);
-    setSamplingFactor("conv3d_row",
-                      output_row_total_iters * 1.0 / output_row_sample_iters);
-    setSamplingFactor("conv3d_col",
-                      output_col_total_iters * 1.0 / output_col_sample_iters);
+    SET_SAMPLING_FACTOR(
+            "conv3d_row",
+            output_row_total_iters * 1.0 / output_row_sample_iters);
+    SET_SAMPLING_FACTOR(
+            "conv3d_col",
+            output_col_total_iters * 1.0 / output_col_sample_iters);
 
     ofmap_block_iteration:
     for (int ofmap_iters = 0; ofmap_iters < pe_block_sample;
@@ -267,6 +366,7 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
 
                             // Load in the activations first, then broadcast
                             // them to all the PEs.
+                            bool act_nonzero = false;
                             load_act_mu:
                             for (int macc_idx = 0; macc_idx < NUM_MACC_INSTS;
                                  macc_idx++) {
@@ -278,6 +378,17 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
                                                 ? zero
                                                 : _a[in_row][in_col]
                                                     [ifmap_offset + macc_idx];
+                                act_nonzero = act_nonzero ||
+                                              VEC256_ANY_NONZERO(
+                                                      act_reg[macc_idx]);
+                            }
+                            // Zero activations (e.g. after a ReLU) don't
+                            // change the partial sums.
+                            if (!act_nonzero) {
+                                _result[out_i][out_j][ofmap_iters] =
+                                        results_buffer;
+                                out_j++;
+                                continue;
                             }
 
                             // v8fp_t accum_vec_reg[NUM_PE_INSTS] = {
@@ -336,6 +447,13 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
         activation_fun_vec(
                 results, results, results_size, act_function, act_params);
     }
+    // Pool the finished results in the scratchpad, so that only the pooled
+    // results are sent back.
+    if (pool_function != NO_POOLING && send_results) {
+        results_size = smv_pool_results_vec(results, results_dims, results_pad,
+                                            pool_function, pool_rows,
+                                            pool_cols);
+    }
     // Store results to the host memory if needed.
     if (send_results)
         host_store_fp16(results, host_results, results_size, 0, 0);
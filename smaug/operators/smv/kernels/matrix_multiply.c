@@ -51,6 +51,8 @@ extern "C" {
  *        for knon-first b tiles.
  * @param read_inputs Load inputs from the host. Set to false if the input
  *        activations can be reused from the last invocation.
+ * @param read_weights Load weights from the host. Set to false if the weight
+ *        tile can be reused from the last invocation.
  * @param send_results Send the results to the host memory if this is true.
  * @param act_function Activation function the operator runs.
  * @param act_params Parameters for the activation function.
@@ -72,6 +74,7 @@ void smv_matrix_multiply_transpose_nc_vec_fxp(float16* host_a,
                                               int result_start,
                                               bool accumulate,
                                               bool read_inputs,
+                                              bool read_weights,
                                               bool send_results,
                                               activation_type act_function,
                                               activation_param_t act_params,
@@ -99,7 +102,8 @@ void smv_matrix_multiply_transpose_nc_vec_fxp(float16* host_a,
     // Load a and b if needed.
     if (read_inputs)
         host_load_fp16(a, host_a, a_size, 0, 0);
-    host_load_fp16(b, host_b, b_size, 0, 0);
+    if (read_weights)
+        host_load_fp16(b, host_b, b_size, 0, 0);
 
     // We sample on the FC kernel only if the highest sampling level is used.
     int b_col_sample = b_width_vec;
@@ -111,7 +115,7 @@ void smv_matrix_multiply_transpose_nc_vec_fxp(float16* host_a,
         b_col_sample_iters = min2(b_col_sample_iters, max2(2, sample_num));
         b_col_sample = b_col_sample_iters * NUM_MACC_INSTS;
     }
-    setSamplingFactor("b_col", b_col_total_iters * 1.0 / b_col_sample_iters);
+    SET_SAMPLING_FACTOR("b_col", b_col_total_iters * 1.0 / b_col_sample_iters);
 
     a_act:
     for (int a_act = 0; a_act < a_height; a_act++) {
@@ -139,12 +143,18 @@ void smv_matrix_multiply_transpose_nc_vec_fxp(float16* host_a,
                 };
 
                 v8fp_t a_reg[NUM_MACC_INSTS];
+                bool a_nonzero = false;
                 a_reg_load:
                 for (int a_vec = 0; a_vec < NUM_MACC_INSTS; a_vec++) {
                     int a_col = a_start / VECTOR_SIZE + b_col + a_vec;
                     a_reg[a_vec] =
                             a_col >= a_width_vec ? zero : _a[a_act][a_col];
+                    a_nonzero = a_nonzero || VEC256_ANY_NONZERO(a_reg[a_vec]);
                 }
+                // Zero activations (e.g. after a ReLU) don't change the
+                // partial sums.
+                if (!a_nonzero)
+                    continue;
 
                 pe_insts:
                 for (int pe_id = 0; pe_id < NUM_PE_INSTS; pe_id++) {
@@ -92,11 +92,12 @@ void smv_maxpooling_nhwc_vec_fxp(float16* host_inputs,
         input_col_sample = input_col_sample_iters * col_stride;
         chan_grp_sample = min2(chan_grp_sample, sample_num);
     }
-    setSamplingFactor("maxpool_input_row",
-                      input_row_total_iters * 1.0 / input_row_sample_iters);
-    setSamplingFactor("maxpool_input_col",
-                      input_col_total_iters * 1.0 / input_col_sample_iters);
-    setSamplingFactor("maxpool_chan_grp", chan_groups * 1.0 / chan_grp_sample);
+    SET_SAMPLING_FACTOR("maxpool_input_row",
+                        input_row_total_iters * 1.0 / input_row_sample_iters);
+    SET_SAMPLING_FACTOR("maxpool_input_col",
+                        input_col_total_iters * 1.0 / input_col_sample_iters);
+    SET_SAMPLING_FACTOR(
+            "maxpool_chan_grp", chan_groups * 1.0 / chan_grp_sample);
 
     int out_row = 0;
     maxpool_input_row:
@@ -227,11 +228,12 @@ void smv_avgpooling_nhwc_vec_fxp(float16* host_inputs,
         input_col_sample = input_col_sample_iters * col_stride;
         chan_grp_sample = min2(chan_grp_sample, sample_num);
     }
-    setSamplingFactor("avgpool_input_row",
-                      input_row_total_iters * 1.0 / input_row_sample_iters);
-    setSamplingFactor("avgpool_input_col",
-                      input_col_total_iters * 1.0 / input_col_sample_iters);
-    setSamplingFactor("avgpool_chan_grp", chan_groups * 1.0 / chan_grp_sample);
+    SET_SAMPLING_FACTOR("avgpool_input_row",
+                        input_row_total_iters * 1.0 / input_row_sample_iters);
+    SET_SAMPLING_FACTOR("avgpool_input_col",
+                        input_col_total_iters * 1.0 / input_col_sample_iters);
+    SET_SAMPLING_FACTOR(
+            "avgpool_chan_grp", chan_groups * 1.0 / chan_grp_sample);
 
     int out_row = 0;
     avgpool_input_row:
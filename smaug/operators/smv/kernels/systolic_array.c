@@ -0,0 +1,140 @@
+#include <stdbool.h>
+
+#include "smaug/operators/common.h"
+#include "smaug/operators/smv/kernels/params.h"
+#include "smaug/operators/smv/kernels/activation_functions_simd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \ingroup AladdinKernels
+ *
+ * Native implementation of the convolution of the gem5 systolic array, with
+ * the semantics of systolic_array_params_t. Unlike the other kernels, this
+ * one is never traced by Aladdin: the systolic array is modeled in gem5, and
+ * this only runs in native mode. The local buffers stand for the scratchpads
+ * of the array and are loaded and stored by the caller, so that they persist
+ * across invocations like in gem5.
+ *
+ * Every output pixel of every effective kernel is a dot product over the
+ * kernel window, vectorized over the input channels. The partial sums are
+ * accumulated in fp32.
+ *
+ * @param inputs Local inputs buffer in NHWC.
+ * @param weights Local weights buffer in NHWC.
+ * @param results Local results buffer in NHWC.
+ * @param inputs_dims Dimensions of the inputs, including the alignment
+ *        padding of the channels.
+ * @param weights_dims Dimensions of the weights, including the alignment
+ *        padding of the channels.
+ * @param results_dims Dimensions of the results, including the alignment
+ *        padding of the channels.
+ * @param inputs_halo_pad Padding sizes on top, bottom, left and right of the
+ *        input 2D feature maps.
+ * @param stride Stride size on both the row and the col dimensions.
+ * @param ifmap_start If the input contains more channels than the weights,
+ *        start from this one. Otherwise this should always be zero.
+ * @param kern_start If the weights contain more kernels than the results
+ *        buffer can fit, start from this one. Otherwise this should always be
+ *        zero.
+ * @param accumulate Add to the results of the last invocation instead of
+ *        resetting them, for the non-first channelwise weight tiles.
+ * @param send_results If true, the results are finished, and the activation
+ *        function is applied to them.
+ * @param act_function Activation function the operator runs.
+ * @param act_params Parameters for the activation function.
+ */
+void smv_systolic_array_conv3d_nhwc_vec(float* inputs,
+                                        float* weights,
+                                        float* results,
+                                        int inputs_dims[4],
+                                        int weights_dims[4],
+                                        int results_dims[4],
+                                        int inputs_halo_pad[4],
+                                        int stride,
+                                        int ifmap_start,
+                                        int kern_start,
+                                        bool accumulate,
+                                        bool send_results,
+                                        activation_type act_function,
+                                        activation_param_t act_params) {
+    int a_rows = inputs_dims[1];
+    int a_cols = inputs_dims[2];
+    int a_height = inputs_dims[3];
+    int k_rows = weights_dims[1];
+    int k_cols = weights_dims[2];
+    int k_height = weights_dims[3];
+    int result_rows = results_dims[1];
+    int result_cols = results_dims[2];
+    int result_height = results_dims[3];
+    int results_size = results_dims[0] * result_rows * result_cols *
+                       result_height;
+    int top_pad = inputs_halo_pad[0];
+    int left_pad = inputs_halo_pad[2];
+    const v8fp_t zero = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    VEC_ARRAY_4D(v8fp_t, _kernels, weights, k_rows, k_cols, k_height);
+    VEC_ARRAY_4D(v8fp_t, _a, inputs, a_rows, a_cols, a_height);
+    ARRAY_4D(float, _result, results, result_rows, result_cols, result_height);
+
+    int ifmap_offset = ifmap_start / VECTOR_SIZE;
+    int chan_groups = min2(k_height, a_height - ifmap_start) / VECTOR_SIZE;
+    // The weights can contain more kernels than the results, and the results
+    // can have more channels (the alignment padding) than there are kernels.
+    int num_eff_kernels = min2(weights_dims[0] - kern_start, result_height);
+
+    sa_batch:
+    for (int img = 0; img < results_dims[0]; img++) {
+        sa_row:
+        for (int out_row = 0; out_row < result_rows; out_row++) {
+            sa_col:
+            for (int out_col = 0; out_col < result_cols; out_col++) {
+                sa_kernel:
+                for (int kern = 0; kern < result_height; kern++) {
+                    float partial_sum =
+                            accumulate ? _result[img][out_row][out_col][kern]
+                                       : 0;
+                    if (kern >= num_eff_kernels) {
+                        _result[img][out_row][out_col][kern] = partial_sum;
+                        continue;
+                    }
+                    v8fp_t accum = zero;
+                    sa_k_row:
+                    for (int kern_row = 0; kern_row < k_rows; kern_row++) {
+                        int in_row = out_row * stride - top_pad + kern_row;
+                        if (in_row < 0 || in_row >= a_rows)
+                            continue;
+                        sa_k_col:
+                        for (int kern_col = 0; kern_col < k_cols;
+                             kern_col++) {
+                            int in_col = out_col * stride - left_pad + kern_col;
+                            if (in_col < 0 || in_col >= a_cols)
+                                continue;
+                            sa_chan_grp:
+                            for (int grp = 0; grp < chan_groups; grp++) {
+                                accum += _a[img][in_row][in_col]
+                                           [ifmap_offset + grp] *
+                                         _kernels[kern_start + kern][kern_row]
+                                                 [kern_col][grp];
+                            }
+                        }
+                    }
+                    sa_reduce:
+                    for (int i = 0; i < VECTOR_SIZE; i++)
+                        partial_sum += accum[i];
+                    _result[img][out_row][out_col][kern] = partial_sum;
+                }
+            }
+        }
+    }
+    // Only run activation functions when the results are finished.
+    if (act_function != NO_ACTIVATION && send_results) {
+        activation_fun_vec(
+                results, results, results_size, act_function, act_params);
+    }
+}
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
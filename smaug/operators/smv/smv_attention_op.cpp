@@ -0,0 +1,83 @@
+#include <iostream>
+
+#include "smaug/core/backend.h"
+#include "smaug/operators/common.h"
+#include "smaug/operators/smv/smv_attention_op.h"
+#include "smaug/operators/smv/smv_kernels.h"
+#include "smaug/utility/debug_stream.h"
+
+namespace smaug {
+
+void SmvAttentionOp::tile() {
+    // Nothing is tiled. Instead, check that the keys and values of one batch
+    // fit in their scratchpads, and the weights, query, context and scores in
+    // the third one.
+    auto keys = getInput(Keys);
+    const TensorShape& shape = keys->getShape();
+    int spadElems = SmvBackend::SpadSize() / keys->getDataTypeSize();
+    int depthSize = shape.getStorageDim(2);
+    if (shape[1] * depthSize > spadElems ||
+        3 * depthSize + shape[1] > spadElems) {
+        std::cerr << "[ERROR]: For attention, the keys and values of a batch "
+                     "must fit in the local scratchpad size, but "
+                  << getName() << " has keys of shape " << shape << "!\n";
+        exit(1);
+    }
+}
+
+void SmvAttentionOp::run() {
+    auto query = getInput(Query);
+    auto keys = getInput(Keys);
+    auto values = getInput(Values);
+    auto weights = getInput(AlignmentWeights);
+    auto output = getOutput(Outputs);
+    const TensorShape& keysShape = keys->getShape();
+    assert(keysShape == values->getShape());
+    int timeSteps = keysShape[1];
+    int depth = keysShape[2];
+    int depthPad = keysShape.getPadding(2);
+    int depthSize = depth + depthPad;
+    assert(query->getShape().getStorageDim(1) == depthSize &&
+           output->getShape().getStorageDim(1) == depthSize);
+
+    setArrayMemTypeIfSimulating(
+            smv::kEltwiseOpHw, "host_query", getInputsMemType());
+    setArrayMemTypeIfSimulating(
+            smv::kEltwiseOpHw, "host_keys", getInputsMemType());
+    setArrayMemTypeIfSimulating(
+            smv::kEltwiseOpHw, "host_values", getInputsMemType());
+    setArrayMemTypeIfSimulating(
+            smv::kEltwiseOpHw, "host_weights", getWeightsMemType());
+    setArrayMemTypeIfSimulating(
+            smv::kEltwiseOpHw, "host_results", getOutputsMemType());
+    float16* queryData = query->data<float16>();
+    float16* keysData = keys->data<float16>();
+    float16* valuesData = values->data<float16>();
+    float16* weightsData = weights->data<float16>();
+    float16* outputData = output->data<float16>();
+    int batchSize = timeSteps * depthSize;
+    for (int i = 0; i < keysShape[0]; i++) {
+        dout(1) << "Batch: " << i << "\n";
+        mapArrayToAccel(smv::kEltwiseOpHw, "host_query",
+                        queryData + i * depthSize,
+                        depthSize * sizeof(float16));
+        mapArrayToAccel(smv::kEltwiseOpHw, "host_keys",
+                        keysData + i * batchSize,
+                        batchSize * sizeof(float16));
+        mapArrayToAccel(smv::kEltwiseOpHw, "host_values",
+                        valuesData + i * batchSize,
+                        batchSize * sizeof(float16));
+        mapArrayToAccel(smv::kEltwiseOpHw, "host_weights", weightsData,
+                        depthSize * sizeof(float16));
+        mapArrayToAccel(smv::kEltwiseOpHw, "host_results",
+                        outputData + i * depthSize,
+                        depthSize * sizeof(float16));
+        invokeKernel(smv::kEltwiseOpHw, smv_attention_nc_vec_fxp,
+                     queryData + i * depthSize, keysData + i * batchSize,
+                     valuesData + i * batchSize, weightsData,
+                     outputData + i * depthSize, smv::spad0, smv::spad1,
+                     smv::spad2, timeSteps, depth, depthPad, i == 0);
+    }
+}
+
+}  // namespace smaug
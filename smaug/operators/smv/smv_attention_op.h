@@ -0,0 +1,27 @@
+#ifndef _OPERATORS_SMV_SMV_ATTENTION_OP_H_
+#define _OPERATORS_SMV_SMV_ATTENTION_OP_H_
+
+#include "smaug/core/backend.h"
+#include "smaug/operators/common.h"
+#include "smaug/operators/attention_op.h"
+
+namespace smaug {
+
+/**
+ * Fused additive attention on SMV.
+ *
+ * The operator runs one kernel invocation per batch. The keys and values of a
+ * batch are contiguous in the NTC layout, so the kernel reads them straight
+ * from the input tensors instead of from per-operator tiled copies: the keys
+ * shared by all the decoder steps are never re-tiled.
+ */
+class SmvAttentionOp : public AttentionOp<SmvBackend> {
+   public:
+    using AttentionOp<SmvBackend>::AttentionOp;
+    void tile() override;
+    void run() override;
+};
+
+}  // namespace smaug
+
+#endif
@@ -0,0 +1,100 @@
+#include "catch.hpp"
+#include "smaug/core/backend.h"
+#include "smaug/core/smaug_test.h"
+#include "smaug/core/tensor.h"
+#include "smaug/operators/smv/smv_attention_op.h"
+#include "smaug/operators/smv/smv_test_common.h"
+
+using namespace smaug;
+
+namespace smaug {
+
+class SmvAttentionOpTest : public SmaugTest {
+   public:
+    using SmaugTest::SmaugTest;
+
+    // Converts an SMV tensor into an unpadded float32 tensor, which is what
+    // the Reference backend expects.
+    Tensor* convertToRefTensor(Tensor* tensor) {
+        const TensorShape& shape = tensor->getShape();
+        Tensor* refTensor = new Tensor(
+                tensor->getName() + "/ref",
+                TensorShape(shape.dims(), shape.getLayout()));
+        refTensor->allocateStorage<float>();
+        workspace()->addTensor(refTensor);
+        float16* data = tensor->data<float16>();
+        float* refData = refTensor->data<float>();
+        auto idx = tensor->startIndex();
+        auto refIdx = refTensor->startIndex();
+        for (; !idx.end(); ++idx, ++refIdx)
+            refData[refIdx] = fp32(data[idx]);
+        return refTensor;
+    }
+
+    // A reference operator is used to get the 'correct' output.
+    Tensor* getReferenceOutput(Operator* attentionOp) {
+        auto refOp = new AttentionOp<ReferenceBackend>(
+                attentionOp->getName() + "/ref", workspace());
+        for (int i = 0; i < attentionOp->getInputs().size(); i++)
+            refOp->setInput(convertToRefTensor(attentionOp->getInput(i)), i);
+        refOp->createAllTensors();
+        refOp->getOutput(0)->allocateStorage<float>();
+        refOp->run();
+        return convertFp32ToFp16Tensor(refOp->getOutput(0), workspace());
+    }
+
+    Tensor* createInput(const std::string& name,
+                        const std::vector<int>& dims,
+                        DataLayout layout) {
+        TensorShape shape(dims, layout, SmvBackend::Alignment);
+        Tensor* tensor = new Tensor(name, shape);
+        tensor->allocateStorage<float16>();
+        fillTensorWithRandomData(tensor);
+        workspace()->addTensor(tensor);
+        return tensor;
+    }
+
+    // Runs numSteps attention operators, one per decoder step, that share the
+    // keys, values and alignment weights. The weights are multiplied by
+    // weightsScale, which scales the scores.
+    void doTest(int batch,
+                int timeSteps,
+                int depth,
+                int numSteps,
+                float weightsScale = 1) {
+        Tensor* keys =
+                createInput("keys", { batch, timeSteps, depth }, NTC);
+        Tensor* values =
+                createInput("values", { batch, timeSteps, depth }, NTC);
+        Tensor* weights = createInput("weights", { 1, depth }, NC);
+        float16* weightsData = weights->data<float16>();
+        for (int i = 0; i < weights->getShape().storageSize(); i++)
+            weightsData[i] = fp16(fp32(weightsData[i]) * weightsScale);
+        for (int i = 0; i < numSteps; i++) {
+            std::string name = "attention" + std::to_string(i);
+            auto attentionOp = new SmvAttentionOp(name, workspace());
+            attentionOp->setInput(
+                    createInput(name + "/query", { batch, depth }, NC),
+                    SmvAttentionOp::Query);
+            attentionOp->setInput(keys, SmvAttentionOp::Keys);
+            attentionOp->setInput(values, SmvAttentionOp::Values);
+            attentionOp->setInput(weights, SmvAttentionOp::AlignmentWeights);
+            REQUIRE(attentionOp->validate());
+            attentionOp->createAllTensors();
+            attentionOp->getOutput(0)->allocateStorage<float16>();
+            attentionOp->tile();
+            attentionOp->run();
+            verifyOutputs<float16>(attentionOp->getOutput(0),
+                                   getReferenceOutput(attentionOp));
+        }
+    }
+};
+
+}  // namespace smaug
+
+TEST_CASE_METHOD(SmvAttentionOpTest, "SMV fused attention", "[smvattention]") {
+    SECTION("Aligned depth") { doTest(2, 8, 32, 1); }
+    SECTION("Padded depth") { doTest(3, 5, 20, 1); }
+    SECTION("Keys shared across decoder steps") { doTest(2, 16, 64, 3); }
+    SECTION("Scores that overflow exp") { doTest(2, 8, 64, 1, 1000); }
+}
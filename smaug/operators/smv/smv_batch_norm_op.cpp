@@ -220,6 +220,7 @@ void SmvBatchNormOp::run() {
                 stats::kTensorFinalStart, stats::kTensorFinalEnd);
         tiledTensors[2].untile();
     }
+    updateOutputOccupancy(output);
 }
 
 }  // namespace smaug
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "smaug/core/backend.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/smv/smv_convolution_op.h"
@@ -16,6 +18,38 @@ const int kNumMaccsPerPE = 64;//used to be 32 increase this
 }  // namespace conv
 }  // namespace smv
 
+namespace {
+
+// An input channelwise tile and the weight channelwise tile it is convolved
+// with, accumulating into the same output tile.
+struct ChannelTiles {
+    int iC;
+    int wC;
+    int ifmapStart;
+};
+
+// Returns the number of rows at the top of an input tile that overlap with the
+// bottom of the previous input tile, and sets retainedStart to the row of the
+// previous tile from which they start. Both are tiles of the same channels.
+int getRetainedRows(TiledTensor& inputs,
+                    int prevTileIdx,
+                    int tileIdx,
+                    int* retainedStart) {
+    const TensorShape& prevShape = inputs[prevTileIdx]->getShape();
+    const TensorShape& shape = inputs[tileIdx]->getShape();
+    if (shape[0] != 1 || prevShape[0] != 1)
+        return 0;
+    int prevFirstRow = inputs.getTileOrigin(prevTileIdx)[1];
+    int firstRow = inputs.getTileOrigin(tileIdx)[1];
+    int overlap = prevFirstRow + prevShape[1] - firstRow;
+    if (firstRow <= prevFirstRow || overlap <= 0)
+        return 0;
+    *retainedStart = firstRow - prevFirstRow;
+    return std::min(overlap, shape[1]);
+}
+
+}  // namespace
+
 void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
                                TiledTensor& weights,
                                TiledTensor& outputs) {
@@ -37,6 +71,11 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
     unsigned accelId = useSystolicArrayWhenAvailable ? smv::kSystolicArrayHw
                                                      : smv::kConvolutionHw;
     SmvAcceleratorPool accelPool(numAcceleratorsAvailable);
+    // Outside of simulation, every accelerator has its own native systolic
+    // array, whose scratchpads persist across the tiles.
+    std::vector<smv::SystolicArray> nativeArrays;
+    if (useSystolicArrayWhenAvailable && !runningInSimulation)
+        nativeArrays.resize(numAcceleratorsAvailable);
     std::vector<int> lastReadInputTileIdx(numAcceleratorsAvailable, -1);
     std::vector<int> lastReadWeightTileIdx(numAcceleratorsAvailable, -1);
     for (int i = 0; i < numAcceleratorsAvailable; i++) {
@@ -102,9 +141,6 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
                 // in parallel technically, but we will need to reload too much
                 // weights for that and therefore I choose not to.
                 for (int oC = 0; oC < numOutputInvocations; oC++) {
-                    int iC = 0, wC = 0;
-                    // This keeps track of the channel offset of the input.
-                    int ifmapOffset = 0;
                     int outputTileIdx = outputIdx(N, H, 0, W + oC);
                     Tensor* outputTile = outputs[outputTileIdx];
                     const TensorShape& outputShape = outputTile->getShape();
@@ -122,9 +158,43 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
                     // finish the weight channelwise tiles, with the same input
                     // channel tile, producing results for the same output
                     // channels.
+                    std::vector<ChannelTiles> chanTiles;
+                    int iC = 0, wC = 0;
+                    // This keeps track of the channel offset of the input.
+                    int ifmapOffset = 0;
                     while (iC < inputChanTiles && wC < weightChanTiles) {
-                        int inputTileIdx = inputIdx(N, H, 0, iC);
-                        int weightTileIdx = weightIdx(W, 0, 0, wC);
+                        // The 'ifmap_start' argument of the kernel is for
+                        // handling when inputChanTiles < weightChanTiles. It
+                        // provides the starting channel of the input tile that
+                        // will be effective for computation in the invocation.
+                        int ifmapStart = (iC == wC) ? 0 : ifmapOffset;
+                        // An all-zero input tile (e.g. after a ReLU) adds
+                        // nothing to the results, so we skip it along with the
+                        // transfer of its data.
+                        if (!inputs.isTileZero(inputIdx(N, H, 0, iC)))
+                            chanTiles.push_back({ iC, wC, ifmapStart });
+                        ifmapOffset += weights[weightIdx(W, 0, 0, wC)]
+                                               ->getShape()[3];
+                        if (inputChanTiles == weightChanTiles) {
+                            iC++;
+                            wC++;
+                        } else if (inputChanTiles == 1) {
+                            wC++;
+                        } else {
+                            assert(false &&
+                                   "The input/weight tiles can have different "
+                                   "number of channels only when the inputs "
+                                   "don't need channelwise tiling.");
+                        }
+                    }
+                    // We still need one invocation to reset the results, run
+                    // the activation function and send them back.
+                    if (chanTiles.empty())
+                        chanTiles.push_back({ 0, 0, 0 });
+
+                    for (int i = 0; i < chanTiles.size(); i++) {
+                        int inputTileIdx = inputIdx(N, H, 0, chanTiles[i].iC);
+                        int weightTileIdx = weightIdx(W, 0, 0, chanTiles[i].wC);
                         dout(1) << "Input: " << inputTileIdx
                                 << ", weights: " << weightTileIdx
                                 << ", output: " << outputTileIdx << "\n";
@@ -150,22 +220,46 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
                                                weightsShape[3] };
                         int outputDims[4] = { outputShape[0], outputShape[1],
                                               outputShape[2], outputShape[3] };
-                        // The 'ifmap_start' argument of the kernel is for
-                        // handling when inputChanTiles < weightChanTiles. It
-                        // provides the starting channel of the input tile that
-                        // will be effective for computation in the invocation.
-                        int ifmapStart = (iC == wC) ? 0 : ifmapOffset;
+                        // With a fused pooling operator, the kernel produces
+                        // the unpooled results of the input tile in the
+                        // scratchpad and only sends back the pooled ones.
+                        if (hasFusedPooling()) {
+                            outputDims[1] = computeOutputDim(
+                                    inputShape[1] + currentTileTopPad +
+                                            currentTileBottomPad,
+                                    getWeightRows(), getRowStride(),
+                                    ValidPadding);
+                            outputDims[2] = computeOutputDim(
+                                    inputShape[2] + leftPad + rightPad,
+                                    getWeightCols(), getColStride(),
+                                    ValidPadding);
+                        }
+                        int ifmapStart = chanTiles[i].ifmapStart;
                         // Since multiple weight channelwise tiles produce the
                         // same output channels, 'accumulate' is set to true to
-                        // avoid resetting the result for non-first (wC > 0)
-                        // weight channelwise tiles.
-                        bool accumulate = wC > 0;
+                        // avoid resetting the result for non-first weight
+                        // tiles.
+                        bool accumulate = i > 0;
                         // If this is a new input/weight tile, then we need to
-                        // read it.
+                        // read it. If the accelerator last read the previous
+                        // row tile of the same channels, the rows they share
+                        // are kept in its scratchpad and only the new rows are
+                        // read.
                         bool readInputs = false;
-                        if (inputTileIdx !=
-                            lastReadInputTileIdx[currAccelIdx]) {
+                        int retainedStart = 0;
+                        int retainedRows = 0;
+                        int lastInputTileIdx =
+                                lastReadInputTileIdx[currAccelIdx];
+                        if (inputTileIdx != lastInputTileIdx) {
                             readInputs = true;
+                            if (H > 0 && !useSystolicArrayWhenAvailable &&
+                                lastInputTileIdx ==
+                                        inputIdx(N, H - 1, 0,
+                                                 chanTiles[i].iC)) {
+                                retainedRows = getRetainedRows(
+                                        inputs, lastInputTileIdx,
+                                        inputTileIdx, &retainedStart);
+                            }
                             lastReadInputTileIdx[currAccelIdx] = inputTileIdx;
                         }
                         bool readWeights = false;
@@ -177,13 +271,19 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
                         // If we reach the last invocation for the weight
                         // channelwise tiles, the results are finished and need
                         // to be sent back to the host.
-                        bool sendResults = wC == weightChanTiles - 1;
+                        bool sendResults = i == chanTiles.size() - 1;
 
                         std::unique_ptr<volatile int> finishFlag;
                         if (useSystolicArrayWhenAvailable) {
+                            assert(!hasFusedPooling() &&
+                                   "The systolic array doesn't support fused "
+                                   "pooling!");
                             // Invoke the systolic array if specified.
                             finishFlag = invokeSystolicArrayKernel(
                                     accelId + currAccelIdx,
+                                    nativeArrays.empty()
+                                            ? nullptr
+                                            : &nativeArrays[currAccelIdx],
                                     inputTile->data<float16>(),
                                     weightsTile->data<float16>(),
                                     outputTile->data<float16>(), inputDims,
@@ -209,24 +309,13 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
                                     outputShape.getPadding(3), inputHaloPad,
                                     getRowStride(), getColStride(), ifmapStart,
                                     kernStart, accumulate, readInputs,
-                                    readWeights, sendResults, actInfo.function,
-                                    actInfo.params, &sampling);
+                                    retainedStart, retainedRows, readWeights,
+                                    sendResults, actInfo.function,
+                                    actInfo.params, poolType, poolRows,
+                                    poolCols, &sampling);
                         }
                         accelPool.addFinishFlag(
                                 currAccelIdx, std::move(finishFlag));
-
-                        ifmapOffset += weightsTile->getShape()[3];
-                        if (inputChanTiles == weightChanTiles) {
-                            iC++;
-                            wC++;
-                        } else if (inputChanTiles == 1) {
-                            wC++;
-                        } else {
-                            assert(false &&
-                                   "The input/weight tiles can have different "
-                                   "number of channels only when the inputs "
-                                   "don't need channelwise tiling.");
-                        }
                     }
                     if (needOutputIteration)
                         kernStart += outputShape[3];
@@ -242,6 +331,7 @@ void SmvConvolutionOp::runNHWC(TiledTensor& inputs,
 
 std::unique_ptr<volatile int> SmvConvolutionOp::invokeSystolicArrayKernel(
         unsigned accelId,
+        smv::SystolicArray* nativeArray,
         float16* inputs,
         float16* weights,
         float16* outputs,
@@ -262,8 +352,6 @@ std::unique_ptr<volatile int> SmvConvolutionOp::invokeSystolicArrayKernel(
         ActivationInfo* actInfo) {
     // Note that if we are in trace mode, we should skip this gem5 accelerator.
 #ifndef TRACE_MODE
-    assert(runningInSimulation && "The systolic array must be invoked in "
-                                  "simuation.");
     systolic_array_params_t params;
     params.input_base_addr = inputs;
     params.weight_base_addr = weights;
@@ -286,6 +374,11 @@ std::unique_ptr<volatile int> SmvConvolutionOp::invokeSystolicArrayKernel(
     // activation type/params structures.
     memcpy(&params.act_type, &(actInfo->function), sizeof(activation_type));
     memcpy(&params.act_params, &(actInfo->params), sizeof(activation_param_t));
+    if (!runningInSimulation) {
+        auto projection = PerfProjection::ScopedKernel();
+        systolicArrayCycles += nativeArray->invoke(params);
+        return nullptr;
+    }
     return std::unique_ptr<volatile int>(
             invokeSystolicArrayAndReturn(accelId, params));
 #else
@@ -293,6 +386,17 @@ std::unique_ptr<volatile int> SmvConvolutionOp::invokeSystolicArrayKernel(
 #endif
 }
 
+TensorShape SmvConvolutionOp::inferOutputShape() const {
+    TensorShape shape = inferConvOutputShape();
+    if (!hasFusedPooling())
+        return shape;
+    // The pooling windows don't overlap, so the partial windows at the end of
+    // the rows and columns are dropped, as PoolingOp does.
+    return TensorShape(
+            { shape[0], shape[1] / poolRows, shape[2] / poolCols, shape[3] },
+            shape.getLayout(), SmvBackend::Alignment);
+}
+
 void SmvConvolutionOp::tile() {
     // This function will tile (if necessary) the input/weight/output tensors
     // of the convolution operator into smaller tensor tiles so that each tile
@@ -325,13 +429,17 @@ void SmvConvolutionOp::run() {
         tiledTensors[1].copyDataToAllTiles();
     }
 
+    systolicArrayCycles = smv::SystolicArray::Cycles();
     runNHWC(tiledTensors[0], tiledTensors[1], tiledTensors[2]);
+    if (useSystolicArrayWhenAvailable && !runningInSimulation)
+        smv::SystolicArray::recordLayer(name, systolicArrayCycles);
 
     {
         auto stats = gem5::ScopedStats(
                 stats::kTensorFinalStart, stats::kTensorFinalEnd);
         tiledTensors[2].untile();
     }
+    updateOutputOccupancy(output);
 }
 
 }  // namespace smaug
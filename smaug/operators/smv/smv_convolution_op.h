@@ -4,6 +4,7 @@
 #include "smaug/core/backend.h"
 #include "smaug/operators/common.h"
 #include "smaug/operators/convolution_op.h"
+#include "smaug/operators/smv/smv_systolic_array.h"
 
 namespace smaug {
 
@@ -22,7 +23,9 @@ class TilingOptimizer;
 /**
  * SMV backend implementation of convolution.
  *
- * The dataflow is inspired by the NVDLA convolution engine.
+ * The dataflow is inspired by the NVDLA convolution engine. With
+ * useSystolicArrayWhenAvailable, the tiles run on the systolic array instead:
+ * the gem5 model in simulation, or smv::SystolicArray in native runs.
  */
 class SmvConvolutionOp : public ConvolutionOp<SmvBackend> {
   public:
@@ -31,6 +34,46 @@ class SmvConvolutionOp : public ConvolutionOp<SmvBackend> {
     void run() override;
     friend class smv::conv::TilingOptimizer;
 
+    /**
+     * Fuses a pooling operator into the output stage of this convolution. The
+     * kernel pools each finished output tile in the scratchpad before sending
+     * it back, so the unpooled output never leaves the accelerator. Only
+     * non-overlapping pooling windows (stride equal to the pooling size) are
+     * supported.
+     */
+    void setFusedPooling(OpType type,
+                         std::pair<int, int> size,
+                         std::pair<int, int> stride) {
+        assert((type == OpType::MaxPooling ||
+                type == OpType::AveragePooling) &&
+               "Only max and average pooling can be fused!");
+        assert(size == stride &&
+               "Only non-overlapping pooling windows can be fused!");
+        poolType = type == OpType::MaxPooling ? MAX_POOLING : AVG_POOLING;
+        poolRows = size.first;
+        poolCols = size.second;
+    }
+    bool hasFusedPooling() const { return poolType != NO_POOLING; }
+    pool_type getPoolType() const { return poolType; }
+    int getPoolRows() const { return poolRows; }
+    int getPoolCols() const { return poolCols; }
+
+    /** Returns the pooled output shape if a pooling operator is fused. */
+    TensorShape inferOutputShape() const override;
+
+    /** Returns the output shape of the convolution before any pooling. */
+    TensorShape inferConvOutputShape() const {
+        return ConvolutionOp<SmvBackend>::inferOutputShape();
+    }
+
+    /**
+     * Returns the estimated cycles of the last run on the native systolic
+     * array, if it ran there.
+     */
+    const smv::SystolicArray::Cycles& getSystolicArrayCycles() const {
+        return systolicArrayCycles;
+    }
+
   protected:
    /**
     * Tiling scheduler for this operator.
@@ -38,8 +81,15 @@ class SmvConvolutionOp : public ConvolutionOp<SmvBackend> {
    void runNHWC(TiledTensor& inputs,
                 TiledTensor& weights,
                 TiledTensor& outputs);
+   /**
+    * Invokes the systolic array on a tile. In simulation, this starts the
+    * gem5 model and returns its finish flag. Otherwise, the tile runs on
+    * nativeArray, which stands for the accelerator, and its cycles are added
+    * to systolicArrayCycles.
+    */
    std::unique_ptr<volatile int> invokeSystolicArrayKernel(
            unsigned accelId,
+           smv::SystolicArray* nativeArray,
            float16* inputs,
            float16* weights,
            float16* outputs,
@@ -60,6 +110,12 @@ class SmvConvolutionOp : public ConvolutionOp<SmvBackend> {
            ActivationInfo* actInfo);
 
    std::array<TiledTensor, 3> tiledTensors;
+
+   smv::SystolicArray::Cycles systolicArrayCycles;
+
+   pool_type poolType = NO_POOLING;
+   int poolRows = 0;
+   int poolCols = 0;
 };
 
 }  // namespace smaug
@@ -2,9 +2,11 @@
 #include "smaug/core/backend.h"
 #include "smaug/core/tensor.h"
 #include "smaug/core/smaug_test.h"
+#include "smaug/operators/pooling_op.h"
 #include "smaug/operators/smv/smv_test_common.h"
 #include "smaug/operators/smv/smv_convolution_op.h"
 #include "smaug/operators/smv/smv_convolution_tiling.h"
+#include "smaug/operators/smv/smv_systolic_array.h"
 
 using namespace smaug;
 
@@ -34,13 +36,34 @@ class SmvConvolutionOpTest : public SmaugTest {
         refConvOp->createAllTensors();
         refConvOp->getOutput(0)->allocateStorage<float>();
         refConvOp->run();
-        return convertFp32ToFp16Tensor(refConvOp->getOutput(0), workspace());
+        if (!convOp->hasFusedPooling())
+            return convertFp32ToFp16Tensor(refConvOp->getOutput(0),
+                                           workspace());
+
+        // The fused pooling is checked against a reference pooling operator
+        // run on the unpooled outputs.
+        PoolingOp<ReferenceBackend>* refPoolOp;
+        if (convOp->getPoolType() == MAX_POOLING)
+            refPoolOp = new MaxPoolingOp<ReferenceBackend>("ref_pool",
+                                                           workspace());
+        else
+            refPoolOp = new AvgPoolingOp<ReferenceBackend>("ref_pool",
+                                                           workspace());
+        refPoolOp->setPoolingSize(
+                convOp->getPoolRows(), convOp->getPoolCols());
+        refPoolOp->setPoolingStride(
+                convOp->getPoolRows(), convOp->getPoolCols());
+        refPoolOp->setInput(refConvOp->getOutput(0), 0);
+        refPoolOp->createAllTensors();
+        refPoolOp->getOutput(0)->allocateStorage<float>();
+        refPoolOp->run();
+        return convertFp32ToFp16Tensor(refPoolOp->getOutput(0), workspace());
     }
 
-    void doTest(std::vector<int> inputDims,
-                std::vector<int> kernelDims,
-                PaddingType padding = SamePadding,
-                std::vector<int> strides = { 1, 1 }) {
+    SmvConvolutionOp* doTest(std::vector<int> inputDims,
+                             std::vector<int> kernelDims,
+                             PaddingType padding = SamePadding,
+                             std::vector<int> strides = { 1, 1 }) {
         auto convOp = new SmvConvolutionOp("conv", workspace());
         convOp->setStride(strides[0], strides[1]);
         convOp->setPadding(padding);
@@ -56,6 +79,7 @@ class SmvConvolutionOpTest : public SmaugTest {
         auto outputs = convOp->getOutput(0);
         auto refOutputs = getReferenceOutput(convOp);
         verifyOutputs<float16>(outputs, refOutputs);
+        return convOp;
     }
 
     void doFusionTest(
@@ -81,6 +105,97 @@ class SmvConvolutionOpTest : public SmaugTest {
         auto refOutputs = getReferenceOutput(convOp);
         verifyOutputs<float16>(outputs, refOutputs);
     }
+
+    void doPoolingFusionTest(std::vector<int> inputDims,
+                             std::vector<int> kernelDims,
+                             OpType poolType = OpType::MaxPooling,
+                             std::pair<int, int> poolSize = { 2, 2 }) {
+        auto convOp = new SmvConvolutionOp("conv", workspace());
+        convOp->setActivation(ActivationInfo(activation_type::RELU));
+        convOp->setStride(1, 1);
+        convOp->setPadding(SamePadding);
+        convOp->setFusedPooling(poolType, poolSize, poolSize);
+        TensorShape inputShape(inputDims, NHWC, SmvBackend::Alignment);
+        Tensor* inputs = new Tensor("input", inputShape);
+        inputs->allocateStorage<float16>();
+        workspace()->addTensor(inputs);
+        convOp->setInput(inputs, 0);
+        convOp->setWeightDims(kernelDims[1], kernelDims[2], kernelDims[0]);
+        createAndFillTensorsWithData<float16>(convOp, fillTensorWithRandomData);
+        convOp->tile();
+        convOp->run();
+        auto outputs = convOp->getOutput(0);
+        REQUIRE(outputs->getShape()[1] ==
+                convOp->inferConvOutputShape()[1] / poolSize.first);
+        auto refOutputs = getReferenceOutput(convOp);
+        // Compare the values rather than the fp16 bits, which differ a lot
+        // relatively for the tiny outputs where the summation order matters.
+        verifyOutputs<float>(convertFp16ToFp32Tensor(outputs, workspace()),
+                             convertFp16ToFp32Tensor(refOutputs, workspace()));
+    }
+
+    // Runs the convolution on the native systolic array, and returns its
+    // estimated cycles.
+    smv::SystolicArray::Cycles doSystolicArrayTest(
+            std::vector<int> inputDims,
+            std::vector<int> kernelDims,
+            ActivationInfo actInfo = ActivationInfo(),
+            PaddingType padding = SamePadding,
+            std::vector<int> strides = { 1, 1 }) {
+        useSystolicArrayWhenAvailable = true;
+        auto convOp = new SmvConvolutionOp("conv", workspace());
+        convOp->setActivation(actInfo);
+        convOp->setStride(strides[0], strides[1]);
+        convOp->setPadding(padding);
+        TensorShape inputShape(inputDims, NHWC, SmvBackend::Alignment);
+        Tensor* inputs = new Tensor("input", inputShape);
+        inputs->allocateStorage<float16>();
+        workspace()->addTensor(inputs);
+        convOp->setInput(inputs, 0);
+        convOp->setWeightDims(kernelDims[1], kernelDims[2], kernelDims[0]);
+        createAndFillTensorsWithData<float16>(convOp, fillTensorWithRandomData);
+        convOp->tile();
+        convOp->run();
+        auto outputs = convOp->getOutput(0);
+        auto refOutputs = getReferenceOutput(convOp);
+        verifyOutputs<float>(convertFp16ToFp32Tensor(outputs, workspace()),
+                             convertFp16ToFp32Tensor(refOutputs, workspace()));
+        REQUIRE(smv::SystolicArray::getRecords().back().name == "conv");
+        return convOp->getSystolicArrayCycles();
+    }
+
+    // Runs the convolution on post-ReLU inputs, where the second half of the
+    // rows and of the channels are also all zero, with an occupancy bitmap.
+    void doSparseTest(std::vector<int> inputDims,
+                      std::vector<int> kernelDims,
+                      ActivationInfo actInfo = ActivationInfo()) {
+        auto convOp = new SmvConvolutionOp("conv", workspace());
+        convOp->setActivation(actInfo);
+        convOp->setStride(1, 1);
+        convOp->setPadding(SamePadding);
+        TensorShape inputShape(inputDims, NHWC, SmvBackend::Alignment);
+        Tensor* inputs = new Tensor("input", inputShape);
+        inputs->allocateStorage<float16>();
+        workspace()->addTensor(inputs);
+        convOp->setInput(inputs, 0);
+        convOp->setWeightDims(kernelDims[1], kernelDims[2], kernelDims[0]);
+        createAndFillTensorsWithData<float16>(convOp, fillTensorWithRandomData);
+        float16* inputData = inputs->data<float16>();
+        for (auto idx = inputs->startIndex(); !idx.end(); ++idx) {
+            if (idx.currentIndex(1) >= inputDims[1] / 2 ||
+                idx.currentIndex(3) >= inputDims[3] / 2 ||
+                fp32(inputData[idx]) < 0)
+                inputData[idx] = fp16(0);
+        }
+        inputs->computeOccupancy();
+        inputs->incrDataVersion();
+        REQUIRE(inputs->hasOccupancy());
+        convOp->tile();
+        convOp->run();
+        auto outputs = convOp->getOutput(0);
+        auto refOutputs = getReferenceOutput(convOp);
+        verifyOutputs<float16>(outputs, refOutputs);
+    }
 };
 
 }  // namespace smaug
@@ -340,3 +455,109 @@ TEST_CASE_METHOD(SmvConvolutionOpTest, "Stride size tests", "[smvconv]") {
         }
     }
 }
+
+TEST_CASE_METHOD(SmvConvolutionOpTest,
+                 "SMV convolution retaining the halo rows of input tiles",
+                 "[smvconv]") {
+    // Use a smaller scratchpad, so that the inputs are tiled rowwise and the
+    // consecutive row tiles share the halo rows of the kernel window.
+    int spadSize = smv::kSpadSize;
+    smv::kSpadSize = 32 * 1024;
+    SmvConvolutionOp* convOp = nullptr;
+    SECTION("3x3 kernels") {
+        convOp = doTest({ 1, 64, 64, 32 }, { 8, 3, 3, 32 });
+    }
+    SECTION("5x5 kernels, valid padding") {
+        convOp = doTest({ 1, 64, 64, 32 }, { 8, 5, 5, 32 }, ValidPadding);
+    }
+    SECTION("3x3 kernels, 2x2 strides") {
+        convOp = doTest(
+                { 1, 64, 64, 32 }, { 8, 3, 3, 32 }, SamePadding, { 2, 2 });
+    }
+    auto config = smv::conv::TilingOptimizer::computeBasicTileShapes(convOp);
+    REQUIRE(config.inputTilingDims == smv::DimNH);
+    REQUIRE(config.inputs[1] < 64);
+    smv::kSpadSize = spadSize;
+}
+
+TEST_CASE_METHOD(SmvConvolutionOpTest,
+                 "SMV convolution skipping zero activations",
+                 "[smvconv]") {
+    SECTION("No tiling required") {
+        doSparseTest({ 1, 8, 8, 8 }, { 8, 3, 3, 8 });
+    }
+    SECTION("Inputs DimNH tiled") {
+        doSparseTest({ 1, 32, 32, 32 }, { 8, 3, 3, 32 });
+    }
+    SECTION("Inputs and weights have 4 channelwise tiles") {
+        doSparseTest({ 1, 16, 16, 256 }, { 8, 5, 5, 256 });
+    }
+    SECTION("Inputs are not tiled channelwise, weights have 2 channelwise "
+            "tiles") {
+        doSparseTest({ 1, 8, 8, 256 }, { 8, 3, 3, 256 });
+    }
+    SECTION("Fused sigmoid on output tiles with only all-zero inputs") {
+        doSparseTest({ 1, 32, 32, 32 },
+                     { 8, 3, 3, 32 },
+                     ActivationInfo(activation_type::SIGMOID));
+    }
+}
+
+TEST_CASE_METHOD(SmvConvolutionOpTest,
+                 "SMV convolution with fused pooling",
+                 "[smvconv]") {
+    SECTION("No tiling required") {
+        doPoolingFusionTest({ 1, 8, 8, 8 }, { 8, 3, 3, 8 });
+    }
+    SECTION("Odd output dims drop the partial windows") {
+        doPoolingFusionTest({ 1, 9, 9, 8 }, { 8, 3, 3, 8 });
+    }
+    SECTION("Average pooling") {
+        doPoolingFusionTest(
+                { 1, 32, 32, 32 }, { 8, 3, 3, 32 }, OpType::AveragePooling);
+    }
+    SECTION("Inputs DimNH tiled") {
+        doPoolingFusionTest({ 1, 256, 256, 64 }, { 8, 3, 3, 64 });
+    }
+    SECTION("Inputs DimNH tiled with 3x3 pooling") {
+        doPoolingFusionTest({ 1, 256, 256, 64 },
+                            { 8, 3, 3, 64 },
+                            OpType::MaxPooling,
+                            { 3, 3 });
+    }
+}
+
+TEST_CASE_METHOD(SmvConvolutionOpTest,
+                 "SMV convolution on the native systolic array",
+                 "[smvconv][systolic]") {
+    SECTION("No tiling required") {
+        auto cycles = doSystolicArrayTest({ 1, 8, 8, 8 }, { 8, 3, 3, 8 });
+        // 8 folds of 64 output pixels on the 8x8 array, each streaming the
+        // 3x3 window of one channel vector, plus filling and draining the
+        // array.
+        REQUIRE(cycles.compute == 8 * (9 + 8 + 8 - 2));
+        // The inputs, weights and results, 2 bytes each, 32 bytes per cycle.
+        REQUIRE(cycles.memory == (512 + 576 + 512) * 2 / 32);
+    }
+    SECTION("Fused activation") {
+        doSystolicArrayTest({ 1, 16, 16, 16 },
+                            { 16, 3, 3, 16 },
+                            ActivationInfo(activation_type::RELU));
+    }
+    SECTION("Valid padding, 2x2 strides") {
+        doSystolicArrayTest({ 1, 16, 16, 24 },
+                            { 16, 3, 3, 24 },
+                            ActivationInfo(),
+                            ValidPadding,
+                            { 2, 2 });
+    }
+    SECTION("Weights with more kernels than an output tile") {
+        doSystolicArrayTest({ 1, 32, 32, 8 }, { 256, 1, 1, 8 });
+    }
+    SECTION("Channelwise tiled weights") {
+        doSystolicArrayTest({ 1, 4, 4, 512 }, { 8, 3, 3, 512 });
+    }
+    SECTION("Rowwise and channelwise tiled inputs") {
+        doSystolicArrayTest({ 1, 32, 32, 192 }, { 32, 4, 4, 192 });
+    }
+}
@@ -4,6 +4,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/smv/smv_convolution_op.h"
 #include "smaug/operators/smv/smv_convolution_tiling.h"
+#include "smaug/utility/autotuner.h"
 #include "smaug/utility/debug_stream.h"
 
 namespace smaug {
@@ -54,10 +55,16 @@ std::array<TilingDims, 3> TilingOptimizer::determineBestTilingDims(
     return { bestInputTilingDims, bestWeightTilingDims, bestOutputTilingDims };
 }
 
-TilingConfig TilingOptimizer::computeBasicTileShapes(SmvConvolutionOp* op) {
+std::vector<TilingConfig> TilingOptimizer::enumerateTileShapes(
+        SmvConvolutionOp* op) {
     Tensor* inputs = op->getInput(op->Inputs);
     Tensor* weights = op->getInput(op->Kernels);
     Tensor* outputs = op->getOutput(op->Outputs);
+    // With a fused pooling operator, the scratchpad holds the unpooled
+    // results, so the outputs are tiled as if there were no pooling.
+    Tensor convOutputs(outputs->getName(), op->inferConvOutputShape());
+    if (op->hasFusedPooling())
+        outputs = &convOutputs;
     int maxTileSize = SmvBackend::SpadSize() / inputs->getDataTypeSize();
     std::array<TilingDims, 3> strategies =
             determineBestTilingDims(inputs, weights, outputs, maxTileSize);
@@ -86,6 +93,10 @@ TilingConfig TilingOptimizer::computeBasicTileShapes(SmvConvolutionOp* op) {
     //    tile shapes, the output tile shape is completely determined.
     // For all tiling strategy, compute the total SRAM utilization. The highest
     // one is the chosen one.
+    // A rowwise input tile must produce at least one pooling window.
+    int minInputRows = weightsShape[1];
+    if (op->hasFusedPooling())
+        minInputRows += (op->getPoolRows() - 1) * op->getRowStride();
     std::vector<TensorShape> inputConfigs;
     if (inputTilingDims == DimN) {
         std::vector<int> minShape = inputsShape.dims();
@@ -107,14 +118,14 @@ TilingConfig TilingOptimizer::computeBasicTileShapes(SmvConvolutionOp* op) {
     } else if (inputTilingDims == DimNH) {
         std::vector<int> minShape = inputsShape.dims();
         minShape[0] = 1;
-        minShape[1] = weightsShape[1];
+        minShape[1] = minInputRows;
         enum4DTensorTilingConfigs(inputsShape,
                                   maxTileSize,
                                   minShape,
                                   { 1, op->getRowStride(), 1, 1 },
                                   inputConfigs);
     } else if (inputTilingDims == DimNCH) {
-        std::vector<int> minShape = { 1, weightsShape[1], inputsShape[2],
+        std::vector<int> minShape = { 1, minInputRows, inputsShape[2],
                                       kNumMaccsPerPE };
         std::vector<int> strides = { 1, op->getRowStride(), 1, kNumMaccsPerPE };
         enum4DTensorTilingConfigs(
@@ -235,18 +246,24 @@ TilingConfig TilingOptimizer::computeBasicTileShapes(SmvConvolutionOp* op) {
             << "\n";
     for (auto& config : fullConfigs)
         dout(2) << "    " << config << "\n";
-    auto maxIt = std::max_element(
-            fullConfigs.begin(),
-            fullConfigs.end(),
+    assert(!fullConfigs.empty() && "No tiling configurations found!");
+    // Fill in the tiling dims.
+    for (auto& config : fullConfigs) {
+        config.inputTilingDims = inputTilingDims;
+        config.weightTilingDims = weightTilingDims;
+        config.outputTilingDims = outputTilingDims;
+    }
+    return fullConfigs;
+}
+
+TilingConfig TilingOptimizer::computeBasicTileShapes(SmvConvolutionOp* op) {
+    std::vector<TilingConfig> configs = enumerateTileShapes(op);
+    return *std::max_element(
+            configs.begin(),
+            configs.end(),
             [](const TilingConfig& c1, const TilingConfig& c2) {
                 return c1.getTotalSize() < c2.getTotalSize();
             });
-    assert(maxIt != fullConfigs.end() && "Failed to get best tiling config!");
-    // Fill in the tiling dims.
-    (*maxIt).inputTilingDims = inputTilingDims;
-    (*maxIt).weightTilingDims = weightTilingDims;
-    (*maxIt).outputTilingDims = outputTilingDims;
-    return *maxIt;
 }
 
 TiledTensor TilingOptimizer::generateRowwiseOutputTiledTensor(
@@ -345,11 +362,195 @@ TiledTensor TilingOptimizer::generateRowwiseOutputTiledTensor(
     return outputTiledTensor;
 }
 
+std::array<TiledTensor, 2>
+TilingOptimizer::generatePoolAlignedRowwiseTiledTensors(
+        SmvConvolutionOp* op,
+        const TilingConfig& config,
+        const TiledTensor& weightsTiledTensor) {
+    Tensor* input = op->getInput(SmvConvolutionOp::Inputs);
+    Tensor* output = op->getOutput(SmvConvolutionOp::Outputs);
+    const TensorShape& inputShape = input->getShape();
+    const TensorShape& outputShape = output->getShape();
+    const TensorShape& weightsShape = weightsTiledTensor.getShape();
+    int maxTileSize = SmvBackend::SpadSize() / input->getDataTypeSize();
+    int weightRows = op->getWeightRows();
+    int rowStride = op->getRowStride();
+    int poolRows = op->getPoolRows();
+    int poolCols = op->getPoolCols();
+    int topRowPad = op->getInputPadding()[0];
+    TensorShape convShape = op->inferConvOutputShape();
+    int convRows = convShape[1];
+    int convCols = convShape[2];
+    // The output rows that can be computed without the bottom padding.
+    int unpaddedRows = op->computeOutputDim(
+            inputShape[1] + topRowPad, weightRows, rowStride, ValidPadding);
+    // Scratchpad sizes of a single input row and a single unpooled output
+    // row.
+    int inputRowSize = TensorShape({ config.inputs[0], 1, inputShape[2],
+                                     config.inputs[3] },
+                                   inputShape.getLayout(),
+                                   SmvBackend::Alignment)
+                               .storageSize();
+    int outputRowSize = TensorShape({ config.inputs[0], 1, convCols,
+                                      config.outputs[3] },
+                                    outputShape.getLayout(),
+                                    SmvBackend::Alignment)
+                                .storageSize();
+    // Start with the largest multiple of the pooling rows that the basic input
+    // tile produces. The last tile takes the remaining rows, and if they don't
+    // fit in the scratchpads, shrink the basic tile until they do.
+    int tileRows = op->computeOutputDim(
+            config.inputs[1], weightRows, rowStride, ValidPadding);
+    tileRows = std::min(tileRows, maxTileSize / outputRowSize);
+    tileRows = tileRows / poolRows * poolRows;
+    // The [start, end) unpooled output rows of each row tile.
+    std::vector<std::pair<int, int>> rowTiles;
+    for (; tileRows >= poolRows; tileRows -= poolRows) {
+        rowTiles.clear();
+        int start = 0;
+        while (start + tileRows + poolRows <= convRows &&
+               start + tileRows <= unpaddedRows) {
+            rowTiles.push_back(std::make_pair(start, start + tileRows));
+            start += tileRows;
+        }
+        rowTiles.push_back(std::make_pair(start, convRows));
+        int lastInputRows =
+                inputShape[1] -
+                (rowTiles.size() == 1 ? 0 : start * rowStride - topRowPad);
+        if ((convRows - start) * outputRowSize <= maxTileSize &&
+            lastInputRows * inputRowSize <= maxTileSize)
+            break;
+    }
+    assert(tileRows >= poolRows &&
+           "No rowwise tiling aligns with the pooling windows!");
+
+    int numRowTiles = rowTiles.size();
+    int numBatchTiles = FRAC_CEIL(inputShape[0], config.inputs[0]);
+    int numInputChanTiles = FRAC_CEIL(inputShape[3], config.inputs[3]);
+    int numOutputChanTiles = weightsShape[0];
+    TiledTensor inputTiledTensor(
+            TensorShape({ numBatchTiles, numRowTiles, 1, numInputChanTiles },
+                        inputShape.getLayout()),
+            input);
+    TiledTensor outputTiledTensor(
+            TensorShape({ numBatchTiles, numRowTiles, 1, numOutputChanTiles },
+                        outputShape.getLayout()),
+            output);
+    auto weightIndex = weightsTiledTensor.startIndex();
+    for (auto tileIndex = inputTiledTensor.startIndex(); !tileIndex.end();
+         ++tileIndex) {
+        if (inputTiledTensor.size() == 1) {
+            inputTiledTensor[0] = input;
+            break;
+        }
+        int n = tileIndex.currentIndex(0) * config.inputs[0];
+        int h = tileIndex.currentIndex(1);
+        int c = tileIndex.currentIndex(3) * config.inputs[3];
+        int startRow = h == 0 ? 0 : rowTiles[h].first * rowStride - topRowPad;
+        int endRow = h == numRowTiles - 1 ? inputShape[1]
+                                          : (rowTiles[h].second - 1) *
+                                                            rowStride -
+                                                    topRowPad + weightRows;
+        assert(startRow >= 0 && "The input row tile starts in the padding!");
+        TensorShape tileShape(
+                { std::min(config.inputs[0], inputShape[0] - n),
+                  endRow - startRow, inputShape[2],
+                  std::min(config.inputs[3], inputShape[3] - c) },
+                inputShape.getLayout(), SmvBackend::Alignment);
+        assert(tileShape.storageSize() <= maxTileSize &&
+               "Pooling aligned input tiles are larger than the max tile "
+               "size!");
+        std::string tileName = op->getName() + ":" + input->getName() +
+                               "/tile:" + std::to_string((int)tileIndex);
+        Tensor* tile = new Tensor(tileName, tileShape);
+        tile->allocateStorage(input->getDataType());
+        inputTiledTensor.setTile(
+                tileIndex, { n, startRow, 0, c }, tile, false);
+    }
+    int outputChanOrigin = 0;
+    for (auto tileIndex = outputTiledTensor.startIndex(); !tileIndex.end();
+         ++tileIndex) {
+        if (outputTiledTensor.size() == 1) {
+            outputTiledTensor[0] = output;
+            break;
+        }
+        int n = tileIndex.currentIndex(0) * config.inputs[0];
+        int h = tileIndex.currentIndex(1);
+        int c = tileIndex.currentIndex(3);
+        if (c == 0)
+            outputChanOrigin = 0;
+        int unpooledRows = rowTiles[h].second - rowTiles[h].first;
+        int tileChans =
+                weightsTiledTensor[weightIndex(c, 0, 0, 0)]->getShape()[0];
+        TensorShape tileShape({ std::min(config.inputs[0], inputShape[0] - n),
+                                unpooledRows / poolRows, convCols / poolCols,
+                                tileChans },
+                              outputShape.getLayout(),
+                              SmvBackend::Alignment);
+        assert(TensorShape({ tileShape[0], unpooledRows, convCols, tileChans },
+                           outputShape.getLayout(),
+                           SmvBackend::Alignment)
+                               .storageSize() <= maxTileSize &&
+               "Pooling aligned output tiles are larger than the max tile "
+               "size before pooling!");
+        std::string tileName = op->getName() + ":" + output->getName() +
+                               "/tile:" + std::to_string((int)tileIndex);
+        Tensor* tile = new Tensor(tileName, tileShape);
+        tile->allocateStorage(output->getDataType());
+        outputTiledTensor.setTile(
+                tileIndex,
+                { n, rowTiles[h].first / poolRows, 0, outputChanOrigin },
+                tile, false);
+        outputChanOrigin += tileChans;
+    }
+    op->getWorkspace()->addTiledTensor(inputTiledTensor);
+    op->getWorkspace()->addTiledTensor(outputTiledTensor);
+    dout(1) << "  Tiled Tensors " << input->getName() << ", "
+            << output->getName() << " (pooling aligned rowwise):\n"
+            << "    unpooled output rows per tile: " << tileRows << "\n"
+            << "    number of row tiles: " << numRowTiles << "\n";
+    return { inputTiledTensor, outputTiledTensor };
+}
+
+TilingConfig TilingOptimizer::autotuneTileShapes(SmvConvolutionOp* op) {
+    std::string params = "stride=" + std::to_string(op->getRowStride()) +
+                         "x" + std::to_string(op->getColStride()) +
+                         " padding=" + PaddingType_Name(op->getPadding());
+    if (op->hasFusedPooling()) {
+        params += " pool=" + std::to_string(op->getPoolRows()) + "x" +
+                  std::to_string(op->getPoolCols());
+    }
+    return tuneTilingConfig(
+            op,
+            getTuningKey(op, params),
+            enumerateTileShapes(op),
+            [op](const TilingConfig& config) {
+                op->tiledTensors = doTiling(op, config);
+            });
+}
+
 std::array<TiledTensor, 3> TilingOptimizer::doTiling(SmvConvolutionOp* op) {
+    if (Autotuner::enabled())
+        return doTiling(op, autotuneTileShapes(op));
+    return doTiling(op, computeBasicTileShapes(op));
+}
+
+std::array<TiledTensor, 3> TilingOptimizer::doTiling(
+        SmvConvolutionOp* op, const TilingConfig& tileConfig) {
     auto input = op->getInput(SmvConvolutionOp::Inputs);
     auto kernels = op->getInput(SmvConvolutionOp::Kernels);
     auto output = op->getOutput(SmvConvolutionOp::Outputs);
-    TilingConfig tileConfig = TilingOptimizer::computeBasicTileShapes(op);
+    // Pack and copy data for the weight tiles since the data is read-only.
+    // Operators that consume the same weights share the tiles.
+    TiledTensor tiledWeights =
+            generatePackedTiledTensor(kernels, tileConfig.weights, op);
+    if (op->hasFusedPooling() &&
+        needsHwiseTiling(tileConfig.outputTilingDims)) {
+        std::array<TiledTensor, 2> tiledInputsOutputs =
+                generatePoolAlignedRowwiseTiledTensors(
+                        op, tileConfig, tiledWeights);
+        return { tiledInputsOutputs[0], tiledWeights, tiledInputsOutputs[1] };
+    }
     TiledTensor tiledInputs =
             generateTiledTensorWithStrideAndPadding(input,
                                                     tileConfig.inputs,
@@ -359,10 +560,6 @@ std::array<TiledTensor, 3> TilingOptimizer::doTiling(SmvConvolutionOp* op) {
                                                     op->getRowStride(),
                                                     op->getColStride(),
                                                     op->getPadding());
-    // Copy data for the weight tiles since the data is read-only.
-    TiledTensor tiledWeights =
-            generateTiledTensor(kernels, tileConfig.weights,
-			        op, /* copyData */ true);
     TiledTensor tiledOutputs;
     if (needsHwiseTiling(tileConfig.outputTilingDims)) {
         tiledOutputs = TilingOptimizer::generateRowwiseOutputTiledTensor(
@@ -372,6 +569,13 @@ std::array<TiledTensor, 3> TilingOptimizer::doTiling(SmvConvolutionOp* op) {
                 tileConfig.outputs,
                 output,
                 false);
+    } else if (op->hasFusedPooling()) {
+        // The output tiles hold the pooled results of the unpooled tiles the
+        // config describes.
+        TensorShape outputTileShape = tileConfig.outputs;
+        outputTileShape[1] /= op->getPoolRows();
+        outputTileShape[2] /= op->getPoolCols();
+        tiledOutputs = generateTiledTensor(output, outputTileShape, op);
     } else {
         tiledOutputs =
                 generateTiledTensor(output, tileConfig.outputs, op);
@@ -20,6 +20,10 @@ class TilingOptimizer : public TilingOptimizerBase {
    public:
     static std::array<TiledTensor, 3> doTiling(SmvConvolutionOp* op);
 
+    /** Tiles the tensors of the operator with the given tiling config. */
+    static std::array<TiledTensor, 3> doTiling(SmvConvolutionOp* op,
+                                               const TilingConfig& config);
+
     /**
      * Determine the best basic tiling shape for this convolution layer.
      *
@@ -46,6 +50,18 @@ class TilingOptimizer : public TilingOptimizerBase {
      */
     static TilingConfig computeBasicTileShapes(SmvConvolutionOp* op);
 
+    /**
+     * Enumerates all the valid tiling configs for this convolution layer, among
+     * which computeBasicTileShapes() picks the best.
+     */
+    static std::vector<TilingConfig> enumerateTileShapes(SmvConvolutionOp* op);
+
+    /**
+     * Picks the tiling config that runs fastest on this machine, among those
+     * from enumerateTileShapes(). See tuneTilingConfig().
+     */
+    static TilingConfig autotuneTileShapes(SmvConvolutionOp* op);
+
     /**
      * A specialized output tiling function when the output is tiled rowwise.
      *
@@ -60,6 +76,21 @@ class TilingOptimizer : public TilingOptimizerBase {
             Tensor* outputTensor,
             bool copyData = false);
 
+    /**
+     * Tiles the inputs and outputs rowwise when a pooling operator is fused
+     * into the convolution.
+     *
+     * Every output row tile, except the last, covers a multiple of the
+     * pooling rows, so that the kernel can pool each tile on its own. Only
+     * the last row tile is given the bottom zero-padding.
+     *
+     * @returns A 2-element array of the input and output tiled tensors.
+     */
+    static std::array<TiledTensor, 2> generatePoolAlignedRowwiseTiledTensors(
+            SmvConvolutionOp* op,
+            const TilingConfig& config,
+            const TiledTensor& weightsTiledTensor);
+
    protected:
     /**
      * Determine the best tiling dimensions for running convolution on SMV.
@@ -16,24 +16,47 @@ const int kNumMaccsPerPE = 32;
 }  // namespace fc
 }  // namespace smv
 
+namespace {
+
+// An input activation-wise tile and the weight activation-wise tile it is
+// multiplied with, accumulating into the same output tile.
+struct ActivationTiles {
+    int iC;
+    int wC;
+    int actStart;
+};
+
+}  // namespace
+
 // This function iterates the tiles generated by the tiling optimizer and send a
 // tile triplet to the hardware kernel for computation. The tile iteration is in
 // the following order:
 // 1) N: batch-wise tiles in the inputs.
 // 2) W: neuron-wise tiles in the weights.
 // 3) A: activation-wise tiles in the inputs/weights.
-void SmvInnerProductOp::runNWA(TiledTensor& inputs,
-                               TiledTensor& weights,
-                               TiledTensor& outputs) {
-    // Ordinarily, we don't need to tile the outputs. If this fails, it means
-    // the inner product has uncommonly large outputs, let's add the output
-    // iteration when that happens.
-    assert(outputs.size() == 1 &&
-           "Inner product outputs tiling not implemented yet!");
+// If weightStationary is set, the first two levels are swapped (WNA), so that
+// a weight tile stays in the scratchpad of one accelerator while all the
+// batch-wise tiles stream through it.
+void SmvInnerProductOp::runTiles(TiledTensor& inputs,
+                                 TiledTensor& weights,
+                                 TiledTensor& outputs,
+                                 bool weightStationary) {
     int inputNumTiles = inputs.getShape()[0];
     int inputActTiles = inputs.getShape()[1];
     int weightActTiles = weights.getShape()[1];
     int weightNeuronTiles = weights.getShape()[0];
+    // The outputs are tiled batch-wise the same way as the inputs. Neuron-wise,
+    // an output tile either holds all the neurons, in which case the weight
+    // tiles write to it at an offset, or exactly one weight tile's worth of
+    // neurons.
+    int outputNumTiles = outputs.getShape()[0];
+    int outputNeuronTiles = outputs.getShape()[1];
+    assert(outputNumTiles == inputNumTiles &&
+           "Outputs must be tiled batch-wise the same way as the inputs!");
+    assert((outputNeuronTiles == 1 || outputNeuronTiles == weightNeuronTiles) &&
+           "Output neuron-wise tiles must match the weight tiles!");
+    assert((!weightStationary || outputNeuronTiles == weightNeuronTiles) &&
+           "Weight stationary order needs an output tile per weight tile!");
     auto inputIdx = inputs.startIndex();
     auto weightIdx = weights.startIndex();
     auto outputIdx = outputs.startIndex();
@@ -45,103 +68,148 @@ void SmvInnerProductOp::runNWA(TiledTensor& inputs,
         setArrayMemTypeIfSimulating(
                 smv::kInnerProductHw + i, "host_results", getOutputsMemType());
     }
+    // Usually we are constrained by weights whereas outputs can fit in the
+    // scratchpad. This keeps track of finished neurons before each weight
+    // tile and will be used by the kernel for correct offset in the outputs
+    // scratchpad.
+    std::vector<int> finishedNeurons(weightNeuronTiles, 0);
+    for (int W = 1; W < weightNeuronTiles; W++) {
+        finishedNeurons[W] = finishedNeurons[W - 1] +
+                             weights[weightIdx(W - 1, 0)]->getShape()[0];
+    }
+    // The (N, W) pairs in the order they are run.
+    std::vector<std::pair<int, int>> tileOrder;
+    if (weightStationary) {
+        for (int W = 0; W < weightNeuronTiles; W++) {
+            for (int N = 0; N < inputNumTiles; N++)
+                tileOrder.push_back({ N, W });
+        }
+    } else {
+        for (int N = 0; N < inputNumTiles; N++) {
+            for (int W = 0; W < weightNeuronTiles; W++)
+                tileOrder.push_back({ N, W });
+        }
+    }
     SmvAcceleratorPool accelPool(numAcceleratorsAvailable);
     std::vector<int> lastReadInputTileIdx(numAcceleratorsAvailable, -1);
+    std::vector<int> lastReadWeightTileIdx(numAcceleratorsAvailable, -1);
     int currAccelIdx = 0;
-    for (int N = 0; N < inputNumTiles; N++) {
-        // Usually we are constrained by weights whereas outputs can fit in the
-        // scratchpad. This keeps track of finished neurons and will be used by
-        // the kernel for correct offset in the outputs scratchpad.
-        int finishedNeurons = 0;
-        for (int W = 0; W < weightNeuronTiles; W++) {
-            // Up to this point, the loop nests do not have data dependency
-            // among themselves, and therefore we can run them in parallel. The
-            // loop nests beyond this level will need to run in serial, because
-            // the input/weight channelwise tiles iteration accumulate results
-            // to the same output tile.
-            int outputTileIdx = outputIdx(N, 0);
-            Tensor* outputTile = outputs[outputTileIdx];
-            const TensorShape& outputShape = outputTile->getShape();
-            mapArrayToAccel(smv::kInnerProductHw + currAccelIdx, "host_results",
-                            outputTile->data<float16>(),
-                            outputShape.storageSize() * sizeof(float16));
-            int iC = 0, wC = 0;
-            // This keeps track of the activation offset of the inputs.
-            int actOffset = 0;
-            while (iC < inputActTiles && wC < weightActTiles) {
-                int inputTileIdx = inputIdx(N, iC);
-                int weightTileIdx = weightIdx(W, wC);
-                // There is one condition on which the input tile has different
-                // number of activations from the weight tile: the inputs don't
-                // need tiling on activations while the weights do. In that
-                // case, we send the input tile once and keep the input tile
-                // stationary in the scrachpad, finishing the weight
-                // activation-wise tiles with multiple invocations.
-                dout(1) << "Input: " << inputTileIdx
-                        << ", weights: " << weightTileIdx
-                        << ", output: " << outputTileIdx << "\n";
-                Tensor* inputTile = inputs.getTileWithData(inputTileIdx);
-                Tensor* weightsTile = weights.getTileWithData(weightTileIdx);
-                const TensorShape& inputShape = inputTile->getShape();
-                const TensorShape& weightsShape = weightsTile->getShape();
-                mapArrayToAccel(smv::kInnerProductHw + currAccelIdx, "host_a",
-                                inputTile->data<float16>(),
-                                inputShape.storageSize() * sizeof(float16));
-                mapArrayToAccel(smv::kInnerProductHw + currAccelIdx, "host_b",
-                                weightsTile->data<float16>(),
-                                weightsShape.storageSize() * sizeof(float16));
-                int inputDims[2] = { inputShape[0], inputShape[1] };
-                int weightsDims[2] = { weightsShape[0], weightsShape[1] };
-                int outputDims[2] = { outputShape[0], outputShape[1] };
-                // If the input and weight tiles belong to the same channel
-                // group, then their data will be loaded at the same time into
-                // the spads, so we start from the beginning of the tile.
-                // Otherwise, we start from the last place we left off from.
-                int actStart = (iC == wC) ? 0 : actOffset;
-                // If the weights are tiled on activations, this should be set
-                // to true for non-first weight tiles to avoid resetting the
-                // result buffer.
-                bool accumulate = wC > 0;
-                // If this is a new input tile, then we need to read it.
-                bool readInputs = false;
-                if (inputTileIdx != lastReadInputTileIdx[currAccelIdx]) {
-                    readInputs = true;
-                    lastReadInputTileIdx[currAccelIdx] = inputTileIdx;
-                }
-                // We only need to send the results back to host memory in the
-                // very last invocation.
-                bool sendOutputs = (N == inputNumTiles - 1) &&
-                                   (W == weightNeuronTiles - 1) &&
-                                   (wC == weightActTiles - 1);
-
-                std::unique_ptr<volatile int> finishFlag = invokeKernelNoBlock(
-                        currAccelIdx, smv::kInnerProductHw + currAccelIdx,
-                        smv_matrix_multiply_transpose_nc_vec_fxp,
-                        inputTile->data<float16>(),
-                        weightsTile->data<float16>(),
-                        outputTile->data<float16>(), smv::spad0, smv::spad1,
-                        smv::spad2, inputDims, weightsDims, outputDims,
-                        inputShape.getPadding(1), weightsShape.getPadding(1),
-                        outputShape.getPadding(1), actStart, finishedNeurons,
-                        accumulate, readInputs, sendOutputs, actInfo.function,
-                        actInfo.params, &sampling);
-                accelPool.addFinishFlag(currAccelIdx, std::move(finishFlag));
+    for (int t = 0; t < tileOrder.size(); t++) {
+        int N = tileOrder[t].first;
+        int W = tileOrder[t].second;
+        // Up to this point, the loop nests do not have data dependency
+        // among themselves, and therefore we can run them in parallel. The
+        // loop nests beyond this level will need to run in serial, because
+        // the input/weight channelwise tiles iteration accumulate results
+        // to the same output tile.
+        bool perWeightOutputs = outputNeuronTiles > 1;
+        int outputTileIdx = outputIdx(N, perWeightOutputs ? W : 0);
+        int resultStart = perWeightOutputs ? 0 : finishedNeurons[W];
+        Tensor* outputTile = outputs[outputTileIdx];
+        const TensorShape& outputShape = outputTile->getShape();
+        mapArrayToAccel(smv::kInnerProductHw + currAccelIdx, "host_results",
+                        outputTile->data<float16>(),
+                        outputShape.storageSize() * sizeof(float16));
+        // There is one condition on which the input tile has different
+        // number of activations from the weight tile: the inputs don't
+        // need tiling on activations while the weights do. In that case,
+        // we send the input tile once and keep the input tile stationary
+        // in the scrachpad, finishing the weight activation-wise tiles
+        // with multiple invocations.
+        std::vector<ActivationTiles> actTiles;
+        int iC = 0, wC = 0;
+        // This keeps track of the activation offset of the inputs.
+        int actOffset = 0;
+        while (iC < inputActTiles && wC < weightActTiles) {
+            // If the input and weight tiles belong to the same channel
+            // group, then their data will be loaded at the same time into
+            // the spads, so we start from the beginning of the tile.
+            // Otherwise, we start from the last place we left off from.
+            int actStart = (iC == wC) ? 0 : actOffset;
+            // An all-zero input tile (e.g. after a ReLU) adds nothing to
+            // the results, so we skip it along with the transfer of its
+            // data.
+            if (!inputs.isTileZero(inputIdx(N, iC)))
+                actTiles.push_back({ iC, wC, actStart });
+            actOffset += weights[weightIdx(W, wC)]->getShape()[1];
+            if (inputActTiles == weightActTiles) {
+                iC++;
+                wC++;
+            } else if (inputActTiles == 1) {
+                wC++;
+            } else {
+                assert(false && "The input/weight tiles can have different "
+                                "number of channels only when the inputs "
+                                "don't need activation-wise tiling.");
+            }
+        }
+        // We still need one invocation to reset the results, and to run
+        // the activation function and send them back at the end.
+        if (actTiles.empty())
+            actTiles.push_back({ 0, 0, 0 });
 
-                actOffset += weightsTile->getShape()[1];
-                if (inputActTiles == weightActTiles) {
-                    iC++;
-                    wC++;
-                } else if (inputActTiles == 1) {
-                    wC++;
-                } else {
-                    assert(false && "The input/weight tiles can have different "
-                                    "number of channels only when the inputs "
-                                    "don't need activation-wise tiling.");
-                }
+        for (int i = 0; i < actTiles.size(); i++) {
+            int inputTileIdx = inputIdx(N, actTiles[i].iC);
+            int weightTileIdx = weightIdx(W, actTiles[i].wC);
+            dout(1) << "Input: " << inputTileIdx
+                    << ", weights: " << weightTileIdx
+                    << ", output: " << outputTileIdx << "\n";
+            Tensor* inputTile = inputs.getTileWithData(inputTileIdx);
+            Tensor* weightsTile = weights.getTileWithData(weightTileIdx);
+            const TensorShape& inputShape = inputTile->getShape();
+            const TensorShape& weightsShape = weightsTile->getShape();
+            mapArrayToAccel(smv::kInnerProductHw + currAccelIdx, "host_a",
+                            inputTile->data<float16>(),
+                            inputShape.storageSize() * sizeof(float16));
+            mapArrayToAccel(smv::kInnerProductHw + currAccelIdx, "host_b",
+                            weightsTile->data<float16>(),
+                            weightsShape.storageSize() * sizeof(float16));
+            int inputDims[2] = { inputShape[0], inputShape[1] };
+            int weightsDims[2] = { weightsShape[0], weightsShape[1] };
+            int outputDims[2] = { outputShape[0], outputShape[1] };
+            int actStart = actTiles[i].actStart;
+            // If the weights are tiled on activations, this should be set
+            // to true for non-first weight tiles to avoid resetting the
+            // result buffer.
+            bool accumulate = i > 0;
+            // If this is a new input tile, then we need to read it.
+            bool readInputs = false;
+            if (inputTileIdx != lastReadInputTileIdx[currAccelIdx]) {
+                readInputs = true;
+                lastReadInputTileIdx[currAccelIdx] = inputTileIdx;
             }
-            finishedNeurons += weights[weightIdx(W, 0)]->getShape()[0];
-            currAccelIdx = accelPool.getNextAvailableAccelerator(currAccelIdx);
+            // Likewise for the weights, which in the weight stationary
+            // order are read once for all the batch-wise tiles.
+            bool readWeights = false;
+            if (weightTileIdx != lastReadWeightTileIdx[currAccelIdx]) {
+                readWeights = true;
+                lastReadWeightTileIdx[currAccelIdx] = weightTileIdx;
+            }
+            // We only need to send the results back to host memory in the
+            // very last invocation on an output tile.
+            bool sendOutputs =
+                    (perWeightOutputs || W == weightNeuronTiles - 1) &&
+                    (i == actTiles.size() - 1);
+
+            std::unique_ptr<volatile int> finishFlag = invokeKernelNoBlock(
+                    currAccelIdx, smv::kInnerProductHw + currAccelIdx,
+                    smv_matrix_multiply_transpose_nc_vec_fxp,
+                    inputTile->data<float16>(),
+                    weightsTile->data<float16>(),
+                    outputTile->data<float16>(), smv::spad0, smv::spad1,
+                    smv::spad2, inputDims, weightsDims, outputDims,
+                    inputShape.getPadding(1), weightsShape.getPadding(1),
+                    outputShape.getPadding(1), actStart, resultStart,
+                    accumulate, readInputs, readWeights, sendOutputs,
+                    actInfo.function, actInfo.params, &sampling);
+            accelPool.addFinishFlag(currAccelIdx, std::move(finishFlag));
         }
+        // In the weight stationary order, all the batch-wise tiles of a weight
+        // tile go to the same accelerator so the weights stay resident.
+        bool lastOfWeightTile = t == tileOrder.size() - 1 ||
+                                tileOrder[t + 1].second != W;
+        if (!weightStationary || lastOfWeightTile)
+            currAccelIdx = accelPool.getNextAvailableAccelerator(currAccelIdx);
     }
     // Before we leave, make sure all the accelerators have finished.
     accelPool.joinAll();
@@ -173,13 +241,16 @@ void SmvInnerProductOp::run() {
         tiledTensors[1].copyDataToAllTiles();
     }
 
-    runNWA(tiledTensors[0], tiledTensors[1], tiledTensors[2]);
+    runTiles(tiledTensors[0], tiledTensors[1], tiledTensors[2],
+             smv::fc::TilingOptimizer::useWeightStationaryOrder(
+                     tiledTensors[0], tiledTensors[1]));
 
     {
         auto stats = gem5::ScopedStats(
                 stats::kTensorFinalStart, stats::kTensorFinalEnd);
         tiledTensors[2].untile();
     }
+    updateOutputOccupancy(outputs);
 }
 
 }  // namespace smaug
@@ -33,7 +33,17 @@ class SmvInnerProductOp : public InnerProductOp<SmvBackend> {
     friend class smv::fc::TilingOptimizer;
 
   protected:
-   void runNWA(TiledTensor& inputs, TiledTensor& weights, TiledTensor& outputs);
+   /**
+    * Runs all the tile triplets on the accelerators. The batch-wise (N) and
+    * neuron-wise (W) tiles are visited in NW order by default, or in WN order
+    * if weightStationary is set, so that each weight tile is loaded into the
+    * scratchpad once and reused across all the batch tiles. The
+    * activation-wise (A) tiles are always innermost.
+    */
+   void runTiles(TiledTensor& inputs,
+                 TiledTensor& weights,
+                 TiledTensor& outputs,
+                 bool weightStationary);
 
    std::array<TiledTensor, 3> tiledTensors;
 };
@@ -117,3 +117,98 @@ TEST_CASE_METHOD(SmvInnerProductOpTest,
         doFusionTest({ 1, 32768 }, 256);
     }
 }
+
+TEST_CASE_METHOD(SmvInnerProductOpTest,
+                 "SMV inner products sharing weights",
+                 "[smvfc]") {
+    // Like the timesteps of an unrolled RNN, two operators consume the same
+    // weights. Use a smaller scratchpad so that the weights are tiled.
+    int spadSize = smv::kSpadSize;
+    smv::kSpadSize = 32 * 1024;
+    std::vector<SmvInnerProductOp*> fcOps;
+    Tensor* weights = nullptr;
+    for (int i = 0; i < 2; i++) {
+        auto fcOp = new SmvInnerProductOp("fc" + std::to_string(i),
+                                          workspace());
+        TensorShape inputShape(
+                { 1, 4096 }, DataLayout::NC, SmvBackend::Alignment);
+        Tensor* inputs = new Tensor("input" + std::to_string(i), inputShape);
+        workspace()->addTensor(inputs);
+        fcOp->setInput(inputs, 0);
+        if (weights)
+            fcOp->setInput(weights, 1);
+        fcOp->setNumOutputs(128);
+        createAndFillTensorsWithData<float16>(fcOp, fillTensorWithRandomData);
+        weights = fcOp->getInput(1);
+        fcOps.push_back(fcOp);
+    }
+    for (auto fcOp : fcOps)
+        fcOp->tile();
+    // The weight tiles are shared.
+    auto tiledWeights0 = smv::fc::TilingOptimizer::doTiling(fcOps[0])[1];
+    auto tiledWeights1 = smv::fc::TilingOptimizer::doTiling(fcOps[1])[1];
+    REQUIRE(tiledWeights0.size() == 32);
+    for (int i = 0; i < tiledWeights0.size(); i++)
+        REQUIRE(tiledWeights0[i] == tiledWeights1[i]);
+    for (auto fcOp : fcOps) {
+        fcOp->run();
+        verifyOutputs<float16>(fcOp->getOutput(0), getReferenceOutput(fcOp));
+    }
+    smv::kSpadSize = spadSize;
+}
+
+TEST_CASE_METHOD(SmvInnerProductOpTest,
+                 "SMV tiled inner product with batch-wise tiling",
+                 "[smvfc]") {
+    // Use a smaller scratchpad so that modest batches need batch-wise tiling.
+    int spadSize = smv::kSpadSize;
+    smv::kSpadSize = 32 * 1024;
+
+    SECTION("NWA order: weights are larger than inputs") {
+        // Inputs are tiled into 4 batch-wise tiles and weights into 8
+        // neuron-wise tiles.
+        doTest({ 64, 1024 }, 128);
+    }
+
+    SECTION("WNA order: inputs are larger than weights") {
+        // Inputs are tiled into 8 batch-wise tiles and weights into 4
+        // neuron-wise tiles, so each weight tile stays in the scratchpad.
+        doTest({ 128, 1024 }, 64);
+    }
+
+    SECTION("WNA order with fused activation") {
+        doFusionTest({ 128, 1024 }, 64);
+    }
+
+    SECTION("Loop order is chosen from tile counts") {
+        auto fcOp = new SmvInnerProductOp("fc", workspace());
+        TensorShape inputShape(
+                { 128, 1024 }, DataLayout::NC, SmvBackend::Alignment);
+        Tensor* inputs = new Tensor("input", inputShape);
+        workspace()->addTensor(inputs);
+        fcOp->setInput(inputs, 0);
+        fcOp->setNumOutputs(64);
+        inputs->allocateStorage<float16>();
+        createAndFillTensorsWithData<float16>(fcOp, fillTensorWithRandomData);
+        auto tiledTensors = smv::fc::TilingOptimizer::doTiling(fcOp);
+        REQUIRE(tiledTensors[0].getShape()[0] == 8);
+        REQUIRE(tiledTensors[1].getShape()[0] == 4);
+        REQUIRE(smv::fc::TilingOptimizer::useWeightStationaryOrder(
+                tiledTensors[0], tiledTensors[1]));
+        // Outputs get one tile per batch-wise and neuron-wise tile pair.
+        REQUIRE(tiledTensors[2].getShape()[0] == 8);
+        REQUIRE(tiledTensors[2].getShape()[1] == 4);
+
+        // With more neurons, re-reading the weight tiles for each batch-wise
+        // tile is cheaper than re-reading the inputs.
+        auto fcOp2 = new SmvInnerProductOp("fc2", workspace());
+        fcOp2->setInput(inputs, 0);
+        fcOp2->setNumOutputs(256);
+        createAndFillTensorsWithData<float16>(fcOp2, fillTensorWithRandomData);
+        tiledTensors = smv::fc::TilingOptimizer::doTiling(fcOp2);
+        REQUIRE_FALSE(smv::fc::TilingOptimizer::useWeightStationaryOrder(
+                tiledTensors[0], tiledTensors[1]));
+    }
+
+    smv::kSpadSize = spadSize;
+}
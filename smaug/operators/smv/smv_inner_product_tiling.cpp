@@ -4,6 +4,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/smv/smv_inner_product_op.h"
 #include "smaug/operators/smv/smv_inner_product_tiling.h"
+#include "smaug/utility/autotuner.h"
 #include "smaug/utility/debug_stream.h"
 
 namespace smaug {
@@ -32,7 +33,8 @@ std::array<TilingDims, 3> TilingOptimizer::determineBestTilingDims(
     return { bestInputTilingDims, bestWeightTilingDims, bestOutputTilingDims };
 }
 
-TilingConfig TilingOptimizer::computeBasicTileShapes(SmvInnerProductOp* op) {
+std::vector<TilingConfig> TilingOptimizer::enumerateTileShapes(
+        SmvInnerProductOp* op) {
     Tensor* inputs = op->getInput(op->Inputs);
     Tensor* weights = op->getInput(op->Weights);
     Tensor* outputs = op->getOutput(op->Outputs);
@@ -181,33 +183,89 @@ TilingConfig TilingOptimizer::computeBasicTileShapes(SmvInnerProductOp* op) {
             << "\n";
     for (auto& config : fullConfigs)
         dout(2) << "    " << config << "\n";
-    auto maxIt = std::max_element(
-            fullConfigs.begin(),
-            fullConfigs.end(),
+    assert(!fullConfigs.empty() && "No tiling configurations found!");
+    // Fill in the tiling dims.
+    for (auto& config : fullConfigs) {
+        config.inputTilingDims = inputTilingDims;
+        config.weightTilingDims = weightTilingDims;
+        config.outputTilingDims = outputTilingDims;
+    }
+    return fullConfigs;
+}
+
+TilingConfig TilingOptimizer::computeBasicTileShapes(SmvInnerProductOp* op) {
+    std::vector<TilingConfig> configs = enumerateTileShapes(op);
+    return *std::max_element(
+            configs.begin(),
+            configs.end(),
             [](const TilingConfig& c1, const TilingConfig& c2) {
                 return c1.getTotalSize() < c2.getTotalSize();
             });
-    assert(maxIt != fullConfigs.end() && "Failed to get best tiling config!");
-    // Fill in the tiling dims.
-    maxIt->inputTilingDims = inputTilingDims;
-    maxIt->weightTilingDims = weightTilingDims;
-    maxIt->outputTilingDims = outputTilingDims;
-    return *maxIt;
+}
+
+TilingConfig TilingOptimizer::autotuneTileShapes(SmvInnerProductOp* op) {
+    return tuneTilingConfig(
+            op,
+            getTuningKey(op, ""),
+            enumerateTileShapes(op),
+            [op](const TilingConfig& config) {
+                op->tiledTensors = doTiling(op, config);
+            });
+}
+
+namespace {
+
+int64_t totalStorageSize(const TiledTensor& tiledTensor) {
+    int64_t size = 0;
+    for (int i = 0; i < tiledTensor.size(); i++)
+        size += tiledTensor[i]->getShape().storageSize();
+    return size;
+}
+
+}  // namespace
+
+bool TilingOptimizer::useWeightStationaryOrder(const TiledTensor& inputs,
+                                               const TiledTensor& weights) {
+    int inputNumTiles = inputs.getShape()[0];
+    int weightNeuronTiles = weights.getShape()[0];
+    int weightActTiles = weights.getShape()[1];
+    if (inputNumTiles == 1 || weightNeuronTiles == 1 || weightActTiles > 1)
+        return false;
+    int64_t inputSize = totalStorageSize(inputs);
+    int64_t weightSize = totalStorageSize(weights);
+    int64_t nwaTraffic = inputSize + inputNumTiles * weightSize;
+    int64_t wnaTraffic = weightNeuronTiles * inputSize + weightSize;
+    return wnaTraffic < nwaTraffic;
 }
 
 std::array<TiledTensor, 3> TilingOptimizer::doTiling(SmvInnerProductOp* op) {
+    if (Autotuner::enabled())
+        return doTiling(op, autotuneTileShapes(op));
+    return doTiling(op, computeBasicTileShapes(op));
+}
+
+std::array<TiledTensor, 3> TilingOptimizer::doTiling(
+        SmvInnerProductOp* op, const TilingConfig& tileConfig) {
     auto input = op->getInput(SmvInnerProductOp::Inputs);
     auto kernels = op->getInput(SmvInnerProductOp::Weights);
     auto output = op->getOutput(SmvInnerProductOp::Outputs);
-    TilingConfig tileConfig = TilingOptimizer::computeBasicTileShapes(op);
     TiledTensor tiledInputs =
             generateTiledTensor(input, tileConfig.inputs, op, /* copy_data*/ false);
-    // Copy data for the weight tiles since the data is read-only.
+    // Pack and copy data for the weight tiles since the data is read-only.
+    // Operators that consume the same weights share the tiles.
     TiledTensor tiledWeights =
-            generateTiledTensor(kernels, tileConfig.weights, op);
-    tiledWeights.copyDataToAllTiles();
+            generatePackedTiledTensor(kernels, tileConfig.weights, op);
+    // In the weight stationary order, each output tile is finished by a single
+    // weight tile before the next batch-wise tile evicts it from the
+    // scratchpad, so the outputs are tiled neuron-wise like the weights.
+    TensorShape outputTileShape = tileConfig.outputs;
+    if (useWeightStationaryOrder(tiledInputs, tiledWeights)) {
+        outputTileShape = TensorShape(
+                { tileConfig.inputs[0], tileConfig.weights[0] },
+                output->getShape().getLayout(), SmvBackend::Alignment);
+    }
     TiledTensor tiledOutputs =
-            generateTiledTensor(output, tileConfig.outputs, op, /* copy_data */ false);
+            generateTiledTensor(output, outputTileShape, op, /* copy_data */ false);
     return { tiledInputs, tiledWeights, tiledOutputs };
 }
 
@@ -20,6 +20,10 @@ class TilingOptimizer : public TilingOptimizerBase {
    public:
     static std::array<TiledTensor, 3> doTiling(SmvInnerProductOp* op);
 
+    /** Tiles the tensors of the operator with the given tiling config. */
+    static std::array<TiledTensor, 3> doTiling(SmvInnerProductOp* op,
+                                               const TilingConfig& config);
+
     /**
      * Determine the best basic tiling shape for this fc layer without bias.
      *
@@ -46,6 +50,32 @@ class TilingOptimizer : public TilingOptimizerBase {
      */
     static TilingConfig computeBasicTileShapes(SmvInnerProductOp* op);
 
+    /**
+     * Enumerates all the valid tiling configs for this fc layer, among
+     * which computeBasicTileShapes() picks the best.
+     */
+    static std::vector<TilingConfig> enumerateTileShapes(SmvInnerProductOp* op);
+
+    /**
+     * Picks the tiling config that runs fastest on this machine, among those
+     * from enumerateTileShapes(). See tuneTilingConfig().
+     */
+    static TilingConfig autotuneTileShapes(SmvInnerProductOp* op);
+
+    /**
+     * Returns true if the tiles should be run in the weight stationary (WNA)
+     * order rather than the default NWA order.
+     *
+     * In NWA order, the inputs are read once but every weight tile is read
+     * again for each batch-wise input tile; in WNA order, the weights are read
+     * once but the inputs are read again for each neuron-wise weight tile.
+     * The order with less data transferred into the scratchpads is chosen.
+     * This only applies when the weights are not tiled on activations, as
+     * otherwise no weight tile can stay resident.
+     */
+    static bool useWeightStationaryOrder(const TiledTensor& inputs,
+                                         const TiledTensor& weights);
+
    protected:
     /**
      * Determine the best tiling dimensions for running inner product on SMV.
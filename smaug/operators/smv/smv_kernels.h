@@ -26,12 +26,32 @@ void smv_conv3d_nhwc_vec_fxp(float16* host_inputs,
                              int kern_start,
                              bool accumulate,
                              bool read_inputs,
+                             int retained_start,
+                             int retained_rows,
                              bool read_weights,
                              bool send_results,
                              activation_type act_function,
                              activation_param_t act_params,
+                             pool_type pool_function,
+                             int pool_rows,
+                             int pool_cols,
                              SamplingInfo* sampling);
 
+void smv_systolic_array_conv3d_nhwc_vec(float* inputs,
+                                        float* weights,
+                                        float* results,
+                                        int inputs_dims[4],
+                                        int weights_dims[4],
+                                        int results_dims[4],
+                                        int inputs_halo_pad[4],
+                                        int stride,
+                                        int ifmap_start,
+                                        int kern_start,
+                                        bool accumulate,
+                                        bool send_results,
+                                        activation_type act_function,
+                                        activation_param_t act_params);
+
 void smv_matrix_multiply_transpose_nc_vec_fxp(float16* host_a,
                                               float16* host_b,
                                               float16* host_results,
@@ -48,6 +68,7 @@ void smv_matrix_multiply_transpose_nc_vec_fxp(float16* host_a,
                                               int result_start,
                                               bool accumulate,
                                               bool read_inputs,
+                                              bool read_weights,
                                               bool send_results,
                                               activation_type act_function,
                                               activation_param_t act_params,
@@ -142,6 +163,19 @@ void smv_softmax_nc_vec_fxp(float16* host_inputs,
                             int input_size,
                             int input_pad);
 
+void smv_attention_nc_vec_fxp(float16* host_query,
+                              float16* host_keys,
+                              float16* host_values,
+                              float16* host_weights,
+                              float16* host_results,
+                              float* keys,
+                              float* values,
+                              float* local,
+                              int time_steps,
+                              int depth,
+                              int depth_pad,
+                              bool read_weights);
+
 void smv_eltwise_add_nc_vec_fxp(float16* host_inputs0,
                                 float16* host_inputs1,
                                 float16* host_results,
@@ -189,6 +223,19 @@ void smv_greater_equal_nc_vec_fxp(float16* host_inputs0,
                                   float* inputs1,
                                   bool* results,
                                   int inputs_size);
+
+void host_load_fp16(float* local_data,
+                    float16* remote_data,
+                    int num_elems,
+                    int local_offset,
+                    int remote_offset);
+
+void host_store_fp16(float* local_data,
+                     float16* remote_data,
+                     int num_elems,
+                     int local_offset,
+                     int remote_offset);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,6 +5,7 @@
 #include "smaug/operators/smv/smv_test_common.h"
 #include "smaug/operators/smv/smv_pooling_op.h"
 #include "smaug/operators/smv/smv_pooling_tiling.h"
+#include "smaug/utility/autotuner.h"
 
 using namespace smaug;
 
@@ -125,3 +126,47 @@ TEST_CASE_METHOD(SmvPoolingOpTest, "SMV Tiled Pooling", "[smvpool]") {
     }
 }
 
+
+TEST_CASE_METHOD(SmvPoolingOpTest, "SMV autotuned pooling", "[smvpool]") {
+    std::string dbFile = "smv_pooling_tuning_db.txt";
+    std::remove(dbFile.c_str());
+    REQUIRE(Autotuner::enable(dbFile));
+    auto poolOp = new SmvMaxPoolingOp("pool", workspace());
+    poolOp->setPoolingSize(2, 2);
+    poolOp->setPoolingStride(2, 2);
+    // Inputs/outputs can be tiled into 8 or more rowwise tiles.
+    doTest(poolOp, { 1, 64, 64, 32 });
+    std::string key = smv::getTuningKey(poolOp, "pool=2x2 stride=2x2");
+    std::string winner = Autotuner::lookup(key);
+    REQUIRE(!winner.empty());
+
+    // The tuning database is reused by later runs.
+    REQUIRE(Autotuner::saveDatabase());
+    Autotuner::disable();
+    REQUIRE(Autotuner::enable(dbFile));
+    REQUIRE(Autotuner::lookup(key) == winner);
+
+    // Tuning runs on scratch tensors, so it never writes the real outputs.
+    auto tunedOp = new SmvMaxPoolingOp("tuned_pool", workspace());
+    tunedOp->setPoolingSize(2, 2);
+    tunedOp->setPoolingStride(2, 2);
+    TensorShape inputShape({ 1, 32, 64, 32 }, NHWC, SmvBackend::Alignment);
+    Tensor* input = workspace()->addTensor(new Tensor("input2", inputShape));
+    tunedOp->setInput(input, 0);
+    createAndFillTensorsWithData<float16>(tunedOp, fillTensorWithRandomData);
+    Tensor* output = tunedOp->getOutput(0);
+    output->fillZeros();
+    tunedOp->tile();
+    REQUIRE(!Autotuner::lookup(smv::getTuningKey(
+                                       tunedOp, "pool=2x2 stride=2x2"))
+                     .empty());
+    REQUIRE(tunedOp->getInput(0) == input);
+    REQUIRE(tunedOp->getOutput(0) == output);
+    float16* outputData = output->data<float16>();
+    for (int i = 0; i < output->getShape().storageSize(); i++)
+        REQUIRE(outputData[i] == 0);
+    tunedOp->run();
+    verifyOutputs<float16>(output, getReferenceOutput(tunedOp));
+    Autotuner::disable();
+    std::remove(dbFile.c_str());
+}
@@ -4,6 +4,7 @@
 #include "smaug/operators/common.h"
 #include "smaug/operators/smv/smv_pooling_op.h"
 #include "smaug/operators/smv/smv_pooling_tiling.h"
+#include "smaug/utility/autotuner.h"
 #include "smaug/utility/debug_stream.h"
 
 namespace smaug {
@@ -49,7 +50,8 @@ std::array<TilingDims, 2> TilingOptimizer::determineBestTilingDims(
     return { bestInputTilingDims, bestOutputTilingDims };
 }
 
-TilingConfig TilingOptimizer::computeBasicTileShapes(SmvPoolingOp* op) {
+std::vector<TilingConfig> TilingOptimizer::enumerateTileShapes(
+        SmvPoolingOp* op) {
     Tensor* inputs = op->getInput(op->Inputs);
     Tensor* outputs = op->getOutput(op->Outputs);
     int maxTileSize = SmvBackend::SpadSize() / inputs->getDataTypeSize();
@@ -161,23 +163,51 @@ TilingConfig TilingOptimizer::computeBasicTileShapes(SmvPoolingOp* op) {
             << "\n";
     for (auto& config : fullConfigs)
         dout(2) << "    " << config << "\n";
-    auto maxIt = std::max_element(
-            fullConfigs.begin(),
-            fullConfigs.end(),
+    assert(!fullConfigs.empty() && "No tiling configurations found!");
+    // Fill in the tiling dims.
+    for (auto& config : fullConfigs) {
+        config.inputTilingDims = inputTilingDims;
+        config.outputTilingDims = outputTilingDims;
+    }
+    return fullConfigs;
+}
+
+TilingConfig TilingOptimizer::computeBasicTileShapes(SmvPoolingOp* op) {
+    std::vector<TilingConfig> configs = enumerateTileShapes(op);
+    return *std::max_element(
+            configs.begin(),
+            configs.end(),
             [](const TilingConfig& c1, const TilingConfig& c2) {
                 return c1.getTotalSize() < c2.getTotalSize();
             });
-    assert(maxIt != fullConfigs.end() && "Failed to get best tiling config!");
-    // Fill in the tiling dims.
-    maxIt->inputTilingDims = inputTilingDims;
-    maxIt->outputTilingDims = outputTilingDims;
-    return *maxIt;
+}
+
+TilingConfig TilingOptimizer::autotuneTileShapes(SmvPoolingOp* op) {
+    std::pair<int, int> poolSize = op->getPoolingSize();
+    std::pair<int, int> poolStride = op->getPoolingStride();
+    std::string params = "pool=" + std::to_string(poolSize.first) + "x" +
+                         std::to_string(poolSize.second) +
+                         " stride=" + std::to_string(poolStride.first) + "x" +
+                         std::to_string(poolStride.second);
+    return tuneTilingConfig(
+            op,
+            getTuningKey(op, params),
+            enumerateTileShapes(op),
+            [op](const TilingConfig& config) {
+                op->tiledTensors = doTiling(op, config);
+            });
 }
 
 std::array<TiledTensor, 2> TilingOptimizer::doTiling(SmvPoolingOp* op) {
+    if (Autotuner::enabled())
+        return doTiling(op, autotuneTileShapes(op));
+    return doTiling(op, computeBasicTileShapes(op));
+}
+
+std::array<TiledTensor, 2> TilingOptimizer::doTiling(
+        SmvPoolingOp* op, const TilingConfig& tileConfig) {
     auto input = op->getInput(SmvPoolingOp::Inputs);
     auto output = op->getOutput(SmvPoolingOp::Outputs);
-    TilingConfig tileConfig = TilingOptimizer::computeBasicTileShapes(op);
     int poolRowSize, poolColSize, poolRowStride, poolColStride;
     std::tie(poolRowSize, poolColSize) = op->getPoolingSize();
     std::tie(poolRowStride, poolColStride) = op->getPoolingStride();
@@ -20,6 +20,10 @@ class TilingOptimizer : public TilingOptimizerBase {
    public:
     static std::array<TiledTensor, 2> doTiling(SmvPoolingOp* op);
 
+    /** Tiles the tensors of the operator with the given tiling config. */
+    static std::array<TiledTensor, 2> doTiling(SmvPoolingOp* op,
+                                               const TilingConfig& config);
+
     /**
      * Determine the best basic tiling shape for this pooling layer.
      *
@@ -45,6 +49,18 @@ class TilingOptimizer : public TilingOptimizerBase {
      */
     static TilingConfig computeBasicTileShapes(SmvPoolingOp* op);
 
+    /**
+     * Enumerates all the valid tiling configs for this pooling layer, among
+     * which computeBasicTileShapes() picks the best.
+     */
+    static std::vector<TilingConfig> enumerateTileShapes(SmvPoolingOp* op);
+
+    /**
+     * Picks the tiling config that runs fastest on this machine, among those
+     * from enumerateTileShapes(). See tuneTilingConfig().
+     */
+    static TilingConfig autotuneTileShapes(SmvPoolingOp* op);
+
    protected:
 
     /**
@@ -13,7 +13,12 @@ class SmvReluOp : public ReluOp<SmvBackend> {
    public:
     using ReluOp<SmvBackend>::ReluOp;
     void tile() override { tiledTensors = smv::unary::doTiling(this, false); }
-    void run() override { smv::unary::run(this, tiledTensors); };
+    void run() override {
+        smv::unary::run(this, tiledTensors);
+        // Most of the outputs are zero, which consumers can skip.
+        if (slope == 0)
+            getOutput(Outputs)->computeOccupancy();
+    };
 
    protected:
     std::array<TiledTensor, 2> tiledTensors;
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstring>
+
+#include <boost/format.hpp>
+
+#include "smaug/core/tensor_utils.h"
+#include "smaug/operators/smv/smv_kernels.h"
+#include "smaug/operators/smv/smv_systolic_array.h"
+#include "smaug/utility/utils.h"
+
+namespace smaug {
+namespace smv {
+
+thread_local SystolicArray::Config SystolicArray::config;
+thread_local std::vector<SystolicArray::Record> SystolicArray::records;
+
+static int64_t product(const int dims[4]) {
+    return (int64_t)dims[0] * dims[1] * dims[2] * dims[3];
+}
+
+static int64_t ceilDiv(int64_t a, int64_t b) { return (a + b - 1) / b; }
+
+SystolicArray::SystolicArray(SystolicArray&& other)
+        : inputs(other.inputs), weights(other.weights),
+          results(other.results) {
+    other.inputs = Spad();
+    other.weights = Spad();
+    other.results = Spad();
+}
+
+SystolicArray::~SystolicArray() {
+    free(inputs.data);
+    free(weights.data);
+    free(results.data);
+}
+
+float* SystolicArray::reserve(Spad& spad, int size) {
+    if (size <= spad.size)
+        return spad.data;
+    // The results of the last invocation may still be accumulated into.
+    float* data = (float*)malloc_aligned(size * sizeof(float), true);
+    if (spad.data) {
+        std::memcpy(data, spad.data, spad.size * sizeof(float));
+        free(spad.data);
+    }
+    spad.data = data;
+    spad.size = size;
+    return data;
+}
+
+SystolicArray::Cycles SystolicArray::invoke(
+        const systolic_array_params_t& params) {
+    int inputsDims[4], weightsDims[4], resultsDims[4], haloPad[4];
+    std::memcpy(inputsDims, params.input_dims, sizeof(inputsDims));
+    std::memcpy(weightsDims, params.weight_dims, sizeof(weightsDims));
+    std::memcpy(resultsDims, params.output_dims, sizeof(resultsDims));
+    std::memcpy(haloPad, params.input_halo_pad, sizeof(haloPad));
+    int inputsSize = product(inputsDims);
+    int weightsSize = product(weightsDims);
+    int resultsSize = product(resultsDims);
+    float* localInputs = reserve(inputs, inputsSize);
+    float* localWeights = reserve(weights, weightsSize);
+    float* localResults = reserve(results, resultsSize);
+    if (params.read_inputs) {
+        convertFp16ToFp32(
+                reinterpret_cast<const float16*>(params.input_base_addr),
+                localInputs, inputsSize);
+    }
+    if (params.read_weights) {
+        convertFp16ToFp32(
+                reinterpret_cast<const float16*>(params.weight_base_addr),
+                localWeights, weightsSize);
+    }
+    // The activation is passed through the params as it is in gem5.
+    activation_type actFunction;
+    activation_param_t actParams;
+    std::memcpy(&actFunction, &params.act_type, sizeof(activation_type));
+    std::memcpy(&actParams, &params.act_params, sizeof(activation_param_t));
+    smv_systolic_array_conv3d_nhwc_vec(
+            localInputs, localWeights, localResults, inputsDims, weightsDims,
+            resultsDims, haloPad, params.stride, params.ifmap_start,
+            params.kern_start, params.accum_results, params.send_results,
+            actFunction, actParams);
+    if (params.send_results) {
+        convertFp32ToFp16(
+                localResults,
+                reinterpret_cast<float16*>(params.output_base_addr),
+                resultsSize);
+    }
+    return estimateCycles(params);
+}
+
+SystolicArray::Cycles SystolicArray::estimateCycles(
+        const systolic_array_params_t& params) {
+    const int* inputsDims = params.input_dims;
+    const int* weightsDims = params.weight_dims;
+    const int* resultsDims = params.output_dims;
+    int64_t outputPixels =
+            (int64_t)resultsDims[0] * resultsDims[1] * resultsDims[2];
+    int64_t numKernels = std::max(
+            0, std::min(weightsDims[0] - params.kern_start, resultsDims[3]));
+    int64_t chanGroups = ceilDiv(
+            std::min(weightsDims[3], inputsDims[3] - params.ifmap_start),
+            VECTOR_SIZE);
+    int64_t streamCycles = weightsDims[1] * weightsDims[2] * chanGroups;
+    int64_t folds = ceilDiv(outputPixels, config.rows) *
+                    ceilDiv(numKernels, config.cols);
+    Cycles cycles;
+    cycles.compute =
+            folds * (streamCycles + config.rows + config.cols - 2);
+    int64_t elements = 0;
+    if (params.read_inputs)
+        elements += product(inputsDims);
+    if (params.read_weights)
+        elements += product(weightsDims);
+    if (params.send_results)
+        elements += product(resultsDims);
+    cycles.memory = ceilDiv(elements * sizeof(float16), config.lineBytes);
+    return cycles;
+}
+
+void SystolicArray::printReport(std::ostream& os) {
+    static const std::string hline(
+            "______________________________________________"
+            "______________________________________________");
+    static const char* kFormat = "%-40s %16s %16s %16s\n";
+    os << "======================================================\n";
+    os << "      Estimated cycles of the native systolic array\n";
+    os << "      (" << config.rows << "x" << config.cols << " PEs, "
+       << config.lineBytes << " bytes per cycle).\n";
+    os << "======================================================\n";
+    os << boost::format(kFormat) % "Layer" % "Compute" % "Memory" % "Total";
+    os << hline << "\n";
+    Cycles total;
+    for (const auto& record : records) {
+        os << boost::format(kFormat) % record.name % record.cycles.compute %
+                        record.cycles.memory % record.cycles.total();
+        total += record.cycles;
+    }
+    os << hline << "\n";
+    os << boost::format(kFormat) % "Total" % total.compute % total.memory %
+                    total.total();
+}
+
+}  // namespace smv
+}  // namespace smaug
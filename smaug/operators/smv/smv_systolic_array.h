@@ -0,0 +1,125 @@
+#ifndef _OPERATORS_SMV_SMV_SYSTOLIC_ARRAY_H_
+#define _OPERATORS_SMV_SMV_SYSTOLIC_ARRAY_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "smaug/operators/common.h"
+
+namespace smaug {
+
+class ExecutionContext;
+
+namespace smv {
+
+/**
+ * A native stand-in for the systolic array of gem5, so that the systolic
+ * array dataflow can run (and be compared against the DLA-like kernel)
+ * without a simulation.
+ *
+ * It implements the same systolic_array_params_t contract as the gem5 model.
+ * The scratchpads persist across the invocations of an accelerator, so that
+ * read_inputs and read_weights reuse the data of the last invocation,
+ * accum_results adds to its results, and only send_results applies the
+ * activation function and writes the results back. The convolution itself
+ * runs in smv_systolic_array_conv3d_nhwc_vec.
+ *
+ * Every invocation also gets a cycle estimate. The array is output
+ * stationary: each row of PEs computes one output pixel and each column one
+ * output kernel, while the kernel window streams through, one vector of
+ * VECTOR_SIZE input channels per cycle. Covering the outputs of a tile takes
+ * a number of folds of the array, each of which also pays for filling and
+ * draining the diagonal wavefront. On top of that, the data loaded into and
+ * sent from the scratchpads moves at one line per cycle, without overlap
+ * with the computation.
+ */
+class SystolicArray {
+   public:
+    /** The modeled hardware, which only affects the cycle estimates. */
+    struct Config {
+        int rows = 8;
+        int cols = 8;
+        int lineBytes = 32;
+    };
+
+    /** The estimated cycles of one or more invocations. */
+    struct Cycles {
+        int64_t compute = 0;
+        int64_t memory = 0;
+
+        int64_t total() const { return compute + memory; }
+        Cycles& operator+=(const Cycles& other) {
+            compute += other.compute;
+            memory += other.memory;
+            return *this;
+        }
+    };
+
+    /** The estimated cycles of a layer that ran on the systolic array. */
+    struct Record {
+        std::string name;
+        Cycles cycles;
+    };
+
+    SystolicArray() = default;
+    SystolicArray(const SystolicArray&) = delete;
+    SystolicArray& operator=(const SystolicArray&) = delete;
+    SystolicArray(SystolicArray&& other);
+    ~SystolicArray();
+
+    /**
+     * Runs one invocation on the host, reading from and writing to the host
+     * memory of the params. Returns its estimated cycles.
+     */
+    Cycles invoke(const systolic_array_params_t& params);
+
+    /** Estimates the cycles of an invocation. */
+    static Cycles estimateCycles(const systolic_array_params_t& params);
+
+    static void setConfig(const Config& _config) { config = _config; }
+    static const Config& getConfig() { return config; }
+
+    /** Records the cycles of a layer for the report. */
+    static void recordLayer(const std::string& name, const Cycles& cycles) {
+        records.push_back({ name, cycles });
+    }
+
+    /** Returns the cycles of all the layers run so far in this run. */
+    static const std::vector<Record>& getRecords() { return records; }
+
+    /** Prints the estimated cycles of every layer and of the network. */
+    static void printReport(std::ostream& os);
+
+    /** Discards all the recorded cycles. */
+    static void clear() { records.clear(); }
+
+   protected:
+    /** A scratchpad of the array, which only grows. */
+    struct Spad {
+        float* data = nullptr;
+        int size = 0;
+    };
+
+    /** Returns the scratchpad with room for at least size elements. */
+    static float* reserve(Spad& spad, int size);
+
+    Spad inputs;
+    Spad weights;
+    Spad results;
+
+    /**
+     * The configuration and the recorded cycles belong to the thread that
+     * runs the network, and are carried by its ExecutionContext.
+     */
+    static thread_local Config config;
+    static thread_local std::vector<Record> records;
+
+    friend class smaug::ExecutionContext;
+};
+
+}  // namespace smv
+}  // namespace smaug
+
+#endif
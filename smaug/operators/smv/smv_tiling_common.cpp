@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <sstream>
+
 #include "smaug/operators/smv/smv_tiling_common.h"
+#include "smaug/core/backend.h"
 #include "smaug/core/tensor_utils.h"
+#include "smaug/core/workspace.h"
+#include "smaug/utility/autotuner.h"
 
 namespace smaug {
 namespace smv {
@@ -67,5 +75,98 @@ bool needsWwiseTiling(TilingDims dim) {
     return (dim == DimNW) || (dim == DimNHW) || (dim == DimNCW);
 }
 
+std::string getTuningKey(const Operator* op, const std::string& params) {
+    std::ostringstream key;
+    key << OpType_Name(op->getOpType()) << " spad=" << SmvBackend::SpadSize();
+    for (const auto& tensors : { op->getInputs(), op->getOutputs() }) {
+        for (TensorBase* tensor : tensors) {
+            key << " " << tensor->getShape() << ":"
+                << DataLayout_Name(tensor->getShape().getLayout()) << ":"
+                << DataType_Name(tensor->getDataType());
+        }
+    }
+    if (!params.empty())
+        key << " " << params;
+    return key.str();
+}
+
+namespace {
+
+// Returns a tensor with the shape and data type of this one. If random is
+// true, its floating point data is random, like a produced activation.
+Tensor* createScratchTensor(TensorBase* tensor, bool random) {
+    static std::mt19937 generator(0);
+    std::uniform_real_distribution<float> dist(-1, 1);
+    Tensor* scratch = new Tensor(tensor->getName(), tensor->getShape());
+    scratch->allocateStorage(tensor->getDataType());
+    if (!random)
+        return scratch;
+    int size = scratch->getShape().storageSize();
+    std::vector<float> data(size);
+    for (int i = 0; i < size; i++)
+        data[i] = dist(generator);
+    if (scratch->getDataType() == Float16) {
+        convertFp32ToFp16(data.data(), scratch->data<float16>(), size);
+    } else if (scratch->getDataType() == Float32) {
+        std::copy(data.begin(), data.end(), scratch->data<float>());
+    }
+    return scratch;
+}
+
+}  // namespace
+
+TilingConfig tuneTilingConfig(
+        Operator* op,
+        const std::string& key,
+        std::vector<TilingConfig> configs,
+        const std::function<void(const TilingConfig&)>& tile) {
+    static const int kMaxTuningCandidates = 8;
+    std::stable_sort(configs.begin(),
+                     configs.end(),
+                     [](const TilingConfig& c1, const TilingConfig& c2) {
+                         return c1.getTotalSize() > c2.getTotalSize();
+                     });
+    if (configs.size() > kMaxTuningCandidates)
+        configs.resize(kMaxTuningCandidates);
+    std::vector<std::string> variants;
+    for (const auto& config : configs) {
+        std::ostringstream variant;
+        variant << config;
+        variants.push_back(variant.str());
+    }
+    // Swap in the scratch tensors only if the configs are timed.
+    std::vector<TensorBase*> inputs = op->getInputs();
+    std::vector<TensorBase*> outputs = op->getOutputs();
+    std::vector<std::unique_ptr<Tensor>> scratches;
+    int tiled = -1;
+    int best = Autotuner::tune(key, variants, [&](int i) {
+        if (scratches.empty()) {
+            for (int j = 0; j < inputs.size(); j++) {
+                scratches.emplace_back(createScratchTensor(inputs[j], true));
+                op->setInput(scratches.back().get(), j);
+            }
+            for (int j = 0; j < outputs.size(); j++) {
+                scratches.emplace_back(createScratchTensor(outputs[j], false));
+                op->setOutput(scratches.back().get(), j);
+            }
+        }
+        if (i != tiled) {
+            tile(configs[i]);
+            tiled = i;
+        }
+        op->run();
+    });
+    if (!scratches.empty()) {
+        for (int j = 0; j < inputs.size(); j++)
+            op->setInput(inputs[j], j);
+        for (int j = 0; j < outputs.size(); j++)
+            op->setOutput(outputs[j], j);
+        // The scratch weights must not be shared with later operators.
+        for (const auto& scratch : scratches)
+            op->getWorkspace()->uncacheTiledTensors(scratch.get());
+    }
+    return configs[best];
+}
+
 }  // namespace smv
 }  // namespace smaug
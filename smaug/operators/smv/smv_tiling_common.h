@@ -1,6 +1,11 @@
 #ifndef _OPERATORS_SMV_TILING_COMMON_H_
 #define _OPERATORS_SMV_TILING_COMMON_H_
 
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "smaug/core/operator.h"
 #include "smaug/core/tensor.h"
 
 namespace smaug {
@@ -57,6 +62,34 @@ bool needsHwiseTiling(TilingDims dim);
 
 bool needsWwiseTiling(TilingDims dim);
 
+/**
+ * Returns the key under which the tiling of this operator is autotuned: the
+ * operator type, the shapes, layouts and data types of its tensors, the
+ * scratchpad size, and any operator parameters that affect performance.
+ */
+std::string getTuningKey(const Operator* op, const std::string& params);
+
+/**
+ * Autotunes the choice among several valid tiling configs of an operator.
+ *
+ * Only the configs with the largest total tile sizes are timed, as smaller
+ * tiles only add overhead per tile. The operator runs on scratch copies of
+ * its tensors, with random inputs, so that the timings don't depend on
+ * whether its real inputs were produced yet, and its real outputs are never
+ * written. The operator must be tiled again once this returns.
+ *
+ * @param op The operator to tune.
+ * @param key The tuning key of the operator, from getTuningKey().
+ * @param configs All the valid tiling configs.
+ * @param tile Tiles the current tensors of the operator with a config.
+ * @returns The fastest config.
+ */
+TilingConfig tuneTilingConfig(
+        Operator* op,
+        const std::string& key,
+        std::vector<TilingConfig> configs,
+        const std::function<void(const TilingConfig&)>& tile);
+
 }  // namespace smv
 }  // namespace smaug
 
@@ -73,16 +73,13 @@ class SplitOp : public Operator {
 
     void run() override {
         Tensor* input = getInput(0);
-        int ndims = input->ndims();
-        std::vector<int> srcOrigin(ndims, 0);
+        int srcStart = 0;
         for (int i = 0; i < getOutputs().size(); i++) {
             Tensor* output = getOutput(i);
-            copyTensorRegion(output,
-                             input,
-                             std::vector<int>(ndims, 0),
-                             srcOrigin,
-                             output->getShape().dims());
-            srcOrigin[splitAxis] += output->dim(splitAxis);
+            int numSlices = output->dim(splitAxis);
+            copyTensorSlices(
+                    output, input, splitAxis, 0, srcStart, numSlices);
+            srcStart += numSlices;
         }
     }
 
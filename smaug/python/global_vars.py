@@ -56,6 +56,7 @@ backend_layouts = {
         Softmax: OperatorLayouts([NC], NC),
         EltwiseAdd: OperatorLayouts([X], X),
         EltwiseMul: OperatorLayouts([X], X),
+        Attention: OperatorLayouts([NC, NTC, NTC, NC], NC),
     },
     "SMV": {
         Convolution3d: OperatorLayouts([NHWC, NHWC], NHWC),
@@ -75,6 +76,7 @@ backend_layouts = {
         Softmax: OperatorLayouts([NC], NC),
         EltwiseAdd: OperatorLayouts([X], X),
         EltwiseMul: OperatorLayouts([X], X),
+        Attention: OperatorLayouts([NC, NTC, NTC, NC], NC),
     }
 }
 
@@ -7,6 +7,8 @@ from smaug.core import graph_pb2
 from smaug.core import types_pb2
 from smaug.core import tensor_pb2
 from smaug.python import global_vars
+from smaug.python import param_codec
+from smaug.python import tensor_utils
 from smaug.python.node import Node
 from smaug.python.tensor import Tensor
 
@@ -20,11 +22,15 @@ class Graph:
     self._backend = backend
     self._mem_policy = mem_policy
     self._nodes = []
+    # Nodes indexed by their names, for constant-time lookups.
+    self._nodes_by_name = {}
     self._node_names = {}
     self._alignment = global_vars.backend_alignment[self._backend]
     # Layout transformation is enabled by default.
     self._layout_trans_enabled = True
     self._parent_graph = None
+    # Pairs of (state, update) tensors of the persistent state variables.
+    self._state_variables = []
 
   def __enter__(self):
     self._parent_graph = global_vars.get_graph()
@@ -56,11 +62,14 @@ class Graph:
   def merge(self, other):
     """Merge another graph into this."""
     for node in other.get_nodes():
-      if self.get_node(node.name) is not None:
+      if node.name in self._nodes_by_name:
         raise ValueError(
             "The graph to be merged contains a node with the same name as one "
             "in the current graph. Possibly merging a graph more than once?")
-    self.get_nodes().extend(other.get_nodes())
+    self._nodes.extend(other.get_nodes())
+    self._nodes_by_name.update(other._nodes_by_name)
+    for state, update in other._state_variables:
+      self.add_state_variable(state, update)
 
   def add_node(
       self, name, op, input_tensors, output_tensors_dims,
@@ -86,6 +95,7 @@ class Graph:
     name = self.create_unique_name(name)
     node = Node(name, op, params)
     self._nodes.append(node)
+    self._nodes_by_name[name] = node
 
     # Add every input tensor to the node.
     for i,tensor in enumerate(input_tensors):
@@ -108,6 +118,26 @@ class Graph:
 
     return output_tensors
 
+  def add_state_variable(self, state, update):
+    """Mark a tensor as a state variable that persists across runs.
+
+    At the end of every run, the value of `update` is written back into
+    `state`, which then becomes the initial value of the next run. Binding a
+    state that is already a state variable replaces its update tensor.
+
+    Args:
+      state: A `Tensor` holding the initial value of the state. It must be
+        consumed by some node in the graph.
+      update: A `Tensor` produced by a node, which carries the final value of
+        the state.
+    """
+    if update.source is None:
+      raise ValueError(
+          "The update of state %s must be produced by a node!" % state.name)
+    self._state_variables = [
+        (s, u) for s, u in self._state_variables if s is not state]
+    self._state_variables.append((state, update))
+
   def get_node(self, node_name, recursive=False):
     """Return a node in the graph by its name.
 
@@ -118,9 +148,9 @@ class Graph:
     Returns:
       A `Node` if we find the node or None is returned.
     """
-    for node in self._nodes:
-      if node.name == node_name:
-        return node
+    node = self._nodes_by_name.get(node_name)
+    if node is not None:
+      return node
     if recursive and self._parent_graph is not None:
       return self._parent_graph.get_node(node_name, True)
     return None
@@ -167,36 +197,91 @@ class Graph:
     """Enable automatic layout transformation."""
     self._layout_trans_enabled = True
 
-  def to_proto(self):
-    """Serialize the graph.
+  def _graph_proto(self):
+    """Serialize everything in the graph but its nodes.
 
     Returns:
-      A tuple of (`GraphProto`, `TensorDataArray`).
+      A `GraphProto` without nodes.
     """
     graph_proto = graph_pb2.GraphProto()
     graph_proto.name = self._name
     graph_proto.backend = self._backend
     graph_proto.mem_policy = self._mem_policy
-    tensor_data_array = tensor_pb2.TensorDataArray()
+    for state, update in self._state_variables:
+      # The state is held by the data node created for it.
+      state_output = state if state.source is not None else (
+          tensor_utils.get_tensor_data_op(state))
+      if state_output is None or state_output.source.op != types_pb2.Data:
+        raise ValueError(
+            "State %s is not held by a data node in the graph!" % state.name)
+      var_proto = graph_proto.state_variables.add()
+      var_proto.state_node = state_output.source.name
+      var_proto.update_node = update.source.name
+      var_proto.update_output_index = update.source_index
+    return graph_proto
+
+  def _node_protos(self, encode_params):
+    """Serialize the nodes one at a time.
+
+    Args:
+      encode_params: If true, the parameters are stored in their smallest
+        compact encoding (see `param_codec`).
+
+    Yields:
+      A tuple of (`NodeProto`, `TensorDataArray`) for every node, where the
+      `TensorDataArray` holds the parameters of the node.
+    """
     for node in self._nodes:
-      graph_proto.nodes.append(node.to_proto(tensor_data_array))
+      tensor_data_array = tensor_pb2.TensorDataArray()
+      node_proto = node.to_proto(tensor_data_array)
+      if encode_params:
+        for tensor_data in tensor_data_array.data_array:
+          param_codec.encode_tensor_data(tensor_data)
+      yield node_proto, tensor_data_array
+
+  def to_proto(self, encode_params=False):
+    """Serialize the graph.
+
+    Args:
+      encode_params: If true, the parameters are stored in their smallest
+        compact encoding (see `param_codec`).
+
+    Returns:
+      A tuple of (`GraphProto`, `TensorDataArray`).
+    """
+    graph_proto = self._graph_proto()
+    tensor_data_array = tensor_pb2.TensorDataArray()
+    for node_proto, node_data in self._node_protos(encode_params):
+      graph_proto.nodes.append(node_proto)
+      tensor_data_array.data_array.extend(node_data.data_array)
     return graph_proto, tensor_data_array
 
-  def write_graph(self, name=None):
+  def write_graph(self, name=None, encode_params=False):
     """Serialize the graph to a protobuf file.
 
+    The nodes and their parameters are written one at a time, so the whole
+    serialized graph is never held in memory. This relies on repeated fields
+    of concatenated protobuf messages being merged when they are parsed, in
+    both the text and the binary formats.
+
     Args:
       name: Name of the output protobuf file. If not specified, use the graph's
             name instead.
+      encode_params: If true, the parameters are stored in a compact encoding,
+            which is decoded when the model is loaded.
     """
-    graph_proto, tensor_data_array = self.to_proto()
     if name is None:
       name = self._name
     topo_name = name + "_topo.pbtxt"
     params_name = name + "_params.pb"
+    graph_proto = self._graph_proto()
     with open(topo_name, "w") as f_topo, open(params_name, "wb") as f_params:
       f_topo.write(text_format.MessageToString(graph_proto))
-      f_params.write(tensor_data_array.SerializeToString())
+      for node_proto, node_data in self._node_protos(encode_params):
+        graph_proto.Clear()
+        graph_proto.nodes.append(node_proto)
+        f_topo.write(text_format.MessageToString(graph_proto))
+        f_params.write(node_data.SerializeToString())
 
   def print_summary(self):
     """Print the summary of the graph.
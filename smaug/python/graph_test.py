@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+
+""" This tests the lookup and serialization of nodes in the Graph class."""
+
+import os
+import shutil
+import tempfile
+import unittest
+import numpy as np
+from google.protobuf import text_format
+
+from smaug.core import graph_pb2
+from smaug.core import tensor_pb2
+from smaug.core import types_pb2
+from smaug.python.tensor import Tensor
+from smaug.python.graph import Graph
+from smaug.python.ops import math_ops
+from smaug.python.ops import nn_ops
+
+backend = "Reference"
+
+class GraphTest(unittest.TestCase):
+  def setUp(self):
+    self.tmp_dir = tempfile.mkdtemp()
+
+  def tearDown(self):
+    shutil.rmtree(self.tmp_dir)
+
+  def build_graph(self, num_layers):
+    x = Tensor(
+        data_layout=types_pb2.NC,
+        tensor_data=np.random.rand(2, 16).astype(np.float32))
+    with Graph("test_graph", backend) as graph:
+      for i in range(num_layers):
+        w = Tensor(
+            data_layout=types_pb2.NC,
+            tensor_data=np.zeros((16, 16), dtype=np.float32))
+        x = math_ops.add(nn_ops.mat_mul(x, w), x)
+    return graph
+
+  def test_get_node(self):
+    graph = self.build_graph(3)
+    for node in graph.get_nodes():
+      self.assertIs(graph.get_node(node.name), node)
+    self.assertIsNone(graph.get_node("nonexistent"))
+    with Graph("parent_graph", backend) as parent_graph:
+      with Graph("child_graph", backend) as child_graph:
+        math_ops.add(
+            Tensor(data_layout=types_pb2.N, tensor_data=np.ones(4)),
+            Tensor(data_layout=types_pb2.N, tensor_data=np.ones(4)),
+            name="add")
+    self.assertIs(
+        parent_graph.get_node("add"), child_graph.get_node("add"))
+    with self.assertRaises(ValueError):
+      parent_graph.merge(child_graph)
+
+  def test_write_graph(self):
+    """Test that the streamed files hold the same protos as `to_proto`."""
+    graph = self.build_graph(5)
+    for encode_params in [False, True]:
+      name = os.path.join(self.tmp_dir, "graph%d" % encode_params)
+      graph.write_graph(name, encode_params=encode_params)
+      graph_proto, tensor_data_array = graph.to_proto(encode_params)
+      written_graph = graph_pb2.GraphProto()
+      with open(name + "_topo.pbtxt") as f:
+        text_format.Parse(f.read(), written_graph)
+      written_data = tensor_pb2.TensorDataArray()
+      with open(name + "_params.pb", "rb") as f:
+        written_data.ParseFromString(f.read())
+      self.assertEqual(written_graph, graph_proto)
+      self.assertEqual(written_data, tensor_data_array)
+      self.assertEqual(len(written_data.data_array), 6)
+
+if __name__ == "__main__":
+  unittest.main()
@@ -1,4 +1,5 @@
 from smaug.core import types_pb2
+from smaug.python import global_vars
 from smaug.python.ops import nn_ops
 from smaug.python.ops import math_ops
 from smaug.python.ops import array_ops
@@ -44,6 +45,10 @@ class AttentionBase:
   def __call__(self, query):
     """ Invoke the attention layer to compute the attention vector."""
 
+    context = self._fused_attention(query)
+    if context is not None:
+      return context
+
     # Compute alignments shaped [batch, time].
     alignment = self._compute_alignment(query)
 
@@ -74,6 +79,15 @@ class AttentionBase:
     alignment = activation_ops.softmax(score, name=self.name + "softmax")
     return alignment
 
+  def _fused_attention(self, query):
+    """Compute the context with a single fused operator.
+
+    Returns:
+      The context, or None if there is no fused operator for this attention
+      on the backend of the active graph.
+    """
+    return None
+
   def compute_score(self, query):
     raise NotImplementedError(
         "This class should be overridden by child classes.")
@@ -92,10 +106,29 @@ class BahdanauAttention(AttentionBase):
                w_encoder,
                w_decoder,
                w_alignment,
-               name="bahdanau_attention"):
+               name="bahdanau_attention",
+               use_fused_op=True):
+    """Construct a Bahdanau attention.
+
+    Args:
+      w_alignment: The alignment weight shaped [1, depth].
+      use_fused_op: Compute the attention with the fused `Attention` operator
+        if the backend supports it, instead of a dozen or so operators per
+        decoder step.
+    """
     AttentionBase.__init__(self, memory, w_encoder, w_decoder, name)
     # Alignment weight shaped [1, depth].
     self.w_alignment = w_alignment
+    self.use_fused_op = use_fused_op
+
+  def _fused_attention(self, query):
+    backend = global_vars.get_graph().backend
+    if (not self.use_fused_op
+        or types_pb2.Attention not in global_vars.backend_layouts[backend]):
+      return None
+    return nn_ops.additive_attention(
+        self._query_layer(query), self.keys, self.memory, self.w_alignment,
+        name=self.name + "fused")
 
   def compute_score(self, query):
     # The score is computed as tanh(query + keys) * w_alignments.
@@ -23,6 +23,12 @@ class AttentionTest(SmaugTest):
   in conjunction with an RNN cell.
   """
   def test_bahdanau_attention(self):
+    self._test_bahdanau_attention(use_fused_op=True)
+
+  def test_unfused_bahdanau_attention(self):
+    self._test_bahdanau_attention(use_fused_op=False)
+
+  def _test_bahdanau_attention(self, use_fused_op):
     # Build and run an Bahdanau layer in TF.
     batch = 2
     units = 32
@@ -57,7 +63,7 @@ class AttentionTest(SmaugTest):
       # Create an LSTM and an attention, and perform one step.
       sg_cell = LSTM([w, u])
       sg_attention = BahdanauAttention(memory, w_encoder, w_decoder,
-                                       w_alignment)
+                                       w_alignment, use_fused_op=use_fused_op)
       sg_initial_attention = Tensor(
           data_layout=types_pb2.NC, tensor_data=np.zeros((batch, units),
                                                          dtype=self.dtype))
@@ -191,3 +191,35 @@ def mat_mul(
       input_tensors=[input_tensor, weight_tensor],
       output_tensors_dims=[output_tensor_dims],
       output_tensor_layout=types_pb2.NC, params=params)[0]
+
+def additive_attention(
+    query, keys, values, alignment_weights, name="attention"):
+  """Compute fused additive (Bahdanau) attention for one decoder step.
+
+  The alignment is softmax(tanh(query + keys) * alignment_weights) along the
+  time dimension, and the result is the alignment-weighted sum of `values`.
+
+  Args:
+    query: A 2D `Tensor` shaped [batch, depth] in `NC`, already projected by
+      the query layer.
+    keys: A 3D `Tensor` shaped [batch, time, depth] in `NTC`.
+    values: A 3D `Tensor` shaped as `keys`; usually the attention memory.
+    alignment_weights: A 2D `Tensor` shaped [1, depth] in `NC`.
+    name: Operator name (optional).
+
+  Returns:
+    The context `Tensor` shaped [batch, depth].
+  """
+  query, keys, values, alignment_weights = (
+      array_ops.check_and_add_layout_transform(
+          name=name, op=types_pb2.Attention,
+          input_tensors=[query, keys, values, alignment_weights]))
+  batch, _, depth = keys.shape.dims
+  assert (values.shape.dims == keys.shape.dims
+          and query.shape.dims == [batch, depth]
+          and alignment_weights.shape.dims == [1, depth])
+  return common.add_node(
+      name=name, op=types_pb2.Attention,
+      input_tensors=[query, keys, values, alignment_weights],
+      output_tensors_dims=[[batch, depth]],
+      output_tensor_layout=types_pb2.NC)[0]
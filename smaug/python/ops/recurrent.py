@@ -1,6 +1,7 @@
 import numpy as np
 
 from smaug.core import types_pb2
+from smaug.python import global_vars
 from smaug.python.tensor import Tensor
 from smaug.python.ops import nn_ops
 from smaug.python.ops import math_ops
@@ -10,17 +11,21 @@ from smaug.python.ops import activation_ops
 class LSTM:
   def __init__(
       self, weight_tensors, activation="tanh", activation_params=dict(),
-      name="lstm"):
+      name="lstm", stateful=False):
     """ An LSTM layer.
 
     Args:
       weight_tensors: A list of two weights.
       activation: Activation function used in LSTM.
       activation_params: kwargs for the activation function.
+      stateful: If true, the `h` and `c` states are state variables of the
+        graph: their final values of a run are used as the initial states of
+        the next run. This allows a long sequence to be fed in chunks.
     """
     assert len(weight_tensors) == 2
     self.name = name + ":"
     self.kernel, self.recurrent_kernel = weight_tensors
+    self.stateful = stateful
     self.prepare_states()
     self.activation = activation_ops.get_activation_op(activation)
     self.activation_params = activation_params
@@ -37,6 +42,8 @@ class LSTM:
     self.c = Tensor(
         name=self.name + "/c", data_layout=types_pb2.NC, tensor_data=np.zeros(
             (1, num_units), dtype=data_type))
+    self.initial_h = self.h
+    self.initial_c = self.c
 
   def _concat_output_steps(self, outputs):
     outputs_expand = []
@@ -76,6 +83,10 @@ class LSTM:
     for i in range(num_steps):
       output, state = self.step(input_steps[i], i)
       output_steps.append(output)
+    if self.stateful:
+      graph = global_vars.get_graph()
+      graph.add_state_variable(self.initial_h, self.h)
+      graph.add_state_variable(self.initial_c, self.c)
     if concat_output:
       return self._concat_output_steps(output_steps), state
     return output_steps, state
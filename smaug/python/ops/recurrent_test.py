@@ -75,6 +75,35 @@ class LSTMTest(SmaugTest):
 
     self.runAndValidate(graph, tf_output)
 
+  def test_stateful_lstm(self):
+    # Run an LSTM layer in TF over the whole sequence.
+    tf.keras.backend.set_floatx(
+        global_vars.backend_datatype[self.backend].__name__)
+    inputs = tf.random.normal([1, 8, 32],
+                              dtype=global_vars.backend_datatype[self.backend])
+    tf_lstm = tf.keras.layers.LSTM(32, use_bias=False, unit_forget_bias=False)
+    tf_chunk0_output = tf_lstm(inputs[:, :4])
+    tf_output = tf_lstm(inputs)
+
+    # Feed the same sequence to SMAUG in two chunks. The states of the first
+    # chunk are saved and then loaded by the second chunk.
+    for chunk in range(2):
+      w, u = createSmaugWeights(tf_lstm)
+      chunk_tensor = Tensor(
+          data_layout=types_pb2.NTC,
+          tensor_data=inputs[:, chunk * 4:(chunk + 1) * 4].numpy())
+      with Graph(name=self.graph_name, backend=self.backend) as graph:
+        chunk_inputs = input_data(chunk_tensor)
+        sg_lstm = LSTM([w, u], stateful=True)
+        sg_lstm(chunk_inputs)
+      graph_proto, _ = graph.to_proto()
+      self.assertEqual(len(graph_proto.state_variables), 2)
+      if chunk == 0:
+        self.runAndValidate(
+            graph, tf_chunk0_output, flags="--save-states=states.pb")
+      else:
+        self.runAndValidate(graph, tf_output, flags="--load-states=states.pb")
+
   def test_bidirectional_lstm(self):
     # Build and run an BidirectionalLSTM layer in TF.
     tf.keras.backend.set_floatx(
@@ -0,0 +1,144 @@
+"""Compact encodings of the parameters in a `TensorDataArray`.
+
+This produces the same format as smaug/core/param_codec.h, which decodes the
+parameters when the model is loaded. The elements of a tensor are split into
+chunks that are encoded independently, so that they can be decoded in
+parallel. In every chunk, the bytes of the elements are shuffled so that the
+i-th bytes of all the elements are stored together, then optionally delta
+coded, and then optionally run-length encoded.
+"""
+
+import numpy as np
+
+from smaug.core import types_pb2
+from smaug.core import tensor_pb2
+
+DEFAULT_CHUNK_ELEMENTS = 65536
+
+# The shortest run worth a run token, and the longest run one token covers.
+_MIN_RUN = 3
+_MAX_RUN = 130
+# The longest literal sequence one token covers.
+_MAX_LITERALS = 128
+
+# The data field of a `TensorData` proto, its data type and its numpy type.
+# Float16 elements are packed in pairs into int32, so they are unpacked by
+# viewing the int32 elements as uint16.
+_data_fields = [
+    ("half_data", types_pb2.Float16, np.dtype("<i4"), np.dtype("<u2")),
+    ("float_data", types_pb2.Float32, np.dtype("<f4"), None),
+    ("double_data", types_pb2.Float64, np.dtype("<f8"), None),
+    ("int_data", types_pb2.Int32, np.dtype("<i4"), None),
+    ("int64_data", types_pb2.Int64, np.dtype("<i8"), None),
+    ("bool_data", types_pb2.Bool, np.dtype(np.bool_), None),
+]
+
+def _rle_encode(data):
+  """Run-length encode a uint8 array.
+
+  A control byte c < 128 is followed by c + 1 literal bytes, and any other
+  control byte is followed by one byte that is repeated c - 125 times.
+  """
+  out = bytearray()
+  raw = data.tobytes()
+  size = len(raw)
+  if size == 0:
+    return bytes(out)
+  starts = np.concatenate(([0], np.flatnonzero(data[1:] != data[:-1]) + 1))
+  lengths = np.diff(np.append(starts, size))
+  literal_start = 0
+
+  def flush_literals(end):
+    nonlocal literal_start
+    while literal_start < end:
+      n = min(_MAX_LITERALS, end - literal_start)
+      out.append(n - 1)
+      out.extend(raw[literal_start:literal_start + n])
+      literal_start += n
+
+  for run in np.flatnonzero(lengths >= _MIN_RUN):
+    start, length = int(starts[run]), int(lengths[run])
+    flush_literals(start)
+    # The tail of a long run that is too short for a run token of its own
+    # becomes literals.
+    while length >= _MIN_RUN:
+      n = min(length, _MAX_RUN)
+      out.append(n + _MAX_LITERALS - _MIN_RUN)
+      out.append(raw[start])
+      start += n
+      length -= n
+    literal_start = start
+  flush_literals(size)
+  return bytes(out)
+
+def encode_elements(elements, data_type, encoding,
+                    chunk_elements=DEFAULT_CHUNK_ELEMENTS):
+  """Encode a flat numpy array of elements.
+
+  Args:
+    elements: A 1-D numpy array of little-endian elements.
+    data_type: The SMAUG data type of the elements.
+    encoding: A `ParamEncoding`.
+    chunk_elements: Number of elements in each chunk.
+
+  Returns:
+    An `EncodedTensorData` proto.
+  """
+  encoded = tensor_pb2.EncodedTensorData()
+  encoded.encoding = encoding
+  encoded.data_type = data_type
+  encoded.num_elements = elements.size
+  encoded.chunk_elements = chunk_elements
+  elem_size = elements.dtype.itemsize
+  raw = np.frombuffer(elements.tobytes(), dtype=np.uint8)
+  for first in range(0, elements.size, chunk_elements):
+    n = min(chunk_elements, elements.size - first)
+    chunk = raw[first * elem_size:(first + n) * elem_size]
+    shuffled = chunk.reshape(n, elem_size).T.flatten()
+    if encoding == types_pb2.ShuffleDeltaRleEncoding:
+      shuffled = np.diff(shuffled, prepend=np.uint8(0))
+    if encoding == types_pb2.ShuffleEncoding:
+      encoded.chunks.append(shuffled.tobytes())
+    else:
+      encoded.chunks.append(_rle_encode(shuffled))
+  return encoded
+
+def encode_tensor_data(tensor_data, encoding=None,
+                       chunk_elements=DEFAULT_CHUNK_ELEMENTS):
+  """Replace the data of a `TensorData` proto with its compact encoding.
+
+  Args:
+    tensor_data: The `TensorData` proto to encode in place.
+    encoding: A `ParamEncoding`. If None, the smallest encoding of the tensor
+      is used.
+    chunk_elements: Number of elements in each chunk.
+
+  Returns:
+    True if the data was encoded. The data is left as is if no encoding is
+    smaller than it.
+  """
+  for field, data_type, dtype, unpacked_dtype in _data_fields:
+    values = getattr(tensor_data, field)
+    if len(values) > 0:
+      break
+  else:
+    return False
+  elements = np.array(values, dtype=dtype)
+  if unpacked_dtype is not None:
+    elements = elements.view(unpacked_dtype)
+  if encoding is None:
+    candidates = [
+        encode_elements(elements, data_type, e, chunk_elements) for e in
+        types_pb2.ParamEncoding.values()
+    ]
+    encoded = min(candidates, key=lambda c: c.ByteSize())
+  else:
+    encoded = encode_elements(elements, data_type, encoding, chunk_elements)
+  encoded_tensor_data = tensor_pb2.TensorData()
+  encoded_tensor_data.CopyFrom(tensor_data)
+  encoded_tensor_data.ClearField(field)
+  encoded_tensor_data.encoded_data.CopyFrom(encoded)
+  if encoded_tensor_data.ByteSize() >= tensor_data.ByteSize():
+    return False
+  tensor_data.CopyFrom(encoded_tensor_data)
+  return True
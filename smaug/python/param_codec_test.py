@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+
+"""Tests for python/param_codec.py."""
+
+import unittest
+import numpy as np
+
+from smaug.python import datatypes
+from smaug.python import param_codec
+from smaug.python.tensor_utils import get_tensor_data
+from smaug.python.graph import Graph, get_node_proto
+from smaug.python.tensor import Tensor
+from smaug.python.ops.data_op import input_data
+from smaug.core import types_pb2
+from smaug.core import tensor_pb2
+
+def decode(encoded):
+  """A reference decoder of the encoded bytes, for the tests only."""
+  elem_size = {
+      types_pb2.Float16: 2, types_pb2.Float32: 4, types_pb2.Float64: 8,
+      types_pb2.Int32: 4, types_pb2.Int64: 8, types_pb2.Bool: 1
+  }[encoded.data_type]
+  out = bytearray()
+  for i, chunk in enumerate(encoded.chunks):
+    n = min(encoded.chunk_elements,
+            encoded.num_elements - i * encoded.chunk_elements)
+    if encoded.encoding == types_pb2.ShuffleEncoding:
+      shuffled = bytearray(chunk)
+    else:
+      shuffled = bytearray()
+      pos = 0
+      while pos < len(chunk):
+        control = chunk[pos]
+        if control < 128:
+          shuffled.extend(chunk[pos + 1:pos + control + 2])
+          pos += control + 2
+        else:
+          shuffled.extend(bytes([chunk[pos + 1]]) * (control - 125))
+          pos += 2
+    shuffled = np.frombuffer(bytes(shuffled), dtype=np.uint8)
+    if encoded.encoding == types_pb2.ShuffleDeltaRleEncoding:
+      shuffled = np.cumsum(shuffled, dtype=np.uint8)
+    out.extend(shuffled.reshape(elem_size, n).T.tobytes())
+  return bytes(out)
+
+class ParamCodecTest(unittest.TestCase):
+  def test_rle_format(self):
+    """Test the run-length encoding of runs and literals."""
+    data = np.array([7] * 3 + [1, 2] + [0] * 132 + [5], dtype=np.uint8)
+    self.assertEqual(
+        param_codec._rle_encode(data),
+        bytes([128, 7, 1, 1, 2, 255, 0, 2, 0, 0, 5]))
+
+  def test_round_trip(self):
+    """Test that all the encodings of all the data types round trip."""
+    for dtype in [np.float16, np.float32, np.float64, np.int32, np.int64]:
+      elements = np.random.rand(1000).astype(dtype)
+      elements[100:400] = 0
+      for encoding in types_pb2.ParamEncoding.values():
+        encoded = param_codec.encode_elements(
+            elements, datatypes.np_to_smaug_type[dtype], encoding,
+            chunk_elements=300)
+        self.assertEqual(len(encoded.chunks), 4)
+        self.assertEqual(decode(encoded), elements.tobytes())
+
+  def test_encode_graph_params(self):
+    """Test that the parameters of a graph are encoded if it saves space."""
+    weights = np.zeros((64, 64), dtype=np.float16)
+    weights[0, :] = np.random.rand(64)
+    small = np.random.rand(2).astype(np.float32)
+    with Graph("test_graph", "Reference") as test_graph:
+      input_data(Tensor(data_layout=types_pb2.NC, tensor_data=weights), "w")
+      input_data(Tensor(data_layout=types_pb2.N, tensor_data=small), "s")
+    graph_proto, tensor_data_array = test_graph.to_proto(encode_params=True)
+    weights_proto = get_tensor_data(
+        tensor_data_array, get_node_proto(graph_proto, "w").input_tensors[0].name)
+    self.assertEqual(len(weights_proto.half_data), 0)
+    encoded = weights_proto.encoded_data
+    self.assertEqual(encoded.data_type, types_pb2.Float16)
+    self.assertEqual(encoded.num_elements, weights.size)
+    self.assertEqual(decode(encoded), weights.tobytes())
+    # Encoding two random floats doesn't pay off.
+    small_proto = get_tensor_data(
+        tensor_data_array, get_node_proto(graph_proto, "s").input_tensors[0].name)
+    self.assertFalse(small_proto.HasField("encoded_data"))
+    self.assertEqual(len(small_proto.float_data), 2)
+
+if __name__ == "__main__":
+  unittest.main()
@@ -42,12 +42,16 @@ class SmaugTest(unittest.TestCase):
 
     return returncode
 
-  def runAndValidate(self, graph, expected_output, decimal=3):
-    """ Run the test and validate the results. """
+  def runAndValidate(self, graph, expected_output, decimal=3, flags=""):
+    """ Run the test and validate the results.
+
+    Args:
+      flags: Additional command line flags passed to the SMAUG binary.
+    """
     os.chdir(self.run_dir)
     graph.write_graph()
-    cmd = "%s %s_topo.pbtxt %s_params.pb --print-last-output=proto" % (
-        self.binary, self.graph_name, self.graph_name)
+    cmd = "%s %s_topo.pbtxt %s_params.pb --print-last-output=proto %s" % (
+        self.binary, self.graph_name, self.graph_name, flags)
     returncode = self.launchSubprocess(cmd)
     self.assertEqual(returncode, 0, msg="Test returned nonzero exit code!")
 
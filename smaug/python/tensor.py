@@ -150,7 +150,7 @@ class Tensor:
       # Serialize the data into the proto.
       tensor_data_proto = tensor_data_array.data_array.add()
       tensor_data_proto.name = tensor_proto.name
-      data_list = [x for x in np.nditer(self._tensor_data)]
+      data_list = self._tensor_data.ravel().tolist()
       if self._data_type == types_pb2.Float16:
         tensor_data_proto.half_data.extend(data_list)
       elif self._data_type == types_pb2.Float32:
@@ -1,14 +1,20 @@
 #include <fstream>
+#include <memory>
 #include <string>
 
 #include <boost/program_options.hpp>
 
 #include "core/backend.h"
+#include "core/backend_placement.h"
 #include "core/globals.h"
+#include "core/row_band_scheduler.h"
 #include "core/scheduler.h"
 #include "core/network_builder.h"
 #include "operators/common.h"
+#include "operators/smv/smv_systolic_array.h"
+#include "utility/autotuner.h"
 #include "utility/debug_stream.h"
+#include "utility/perf_projection.h"
 #include "utility/utils.h"
 #include "utility/thread_pool.h"
 
@@ -28,7 +34,22 @@ int main(int argc, char* argv[]) {
     sampling.num_sample_iterations = 1;
     numAcceleratorsAvailable = 1;
     int numThreads = -1;
+    std::string pinThreads;
     useSystolicArrayWhenAvailable = false;
+    smv::SystolicArray::Config systolicArrayConfig;
+    useFp16ReferenceStorage = false;
+    std::string loadStatesFile;
+    std::string saveStatesFile;
+    std::string placement = "graph";
+    std::string placementCostsFile;
+    std::string profilePlacementFile;
+    std::string tuningDbFile;
+    std::string scheduling = "fifo";
+    bool reportMemory = false;
+    int64_t memoryBudget = 0;
+    int bandRows = 0;
+    bool pipelineBands = false;
+    std::string branchStatsFile;
     po::options_description options(
             "SMAUG Usage:  ./smaug model_topo.pbtxt model_params.pb [options]");
     // clang-format off
@@ -52,7 +73,9 @@ int main(int argc, char* argv[]) {
          "Set the sampling level. By default, SMAUG doesn't do any sampling. "
          "There are five options of sampling: no, low, medium, high and "
          "very_high. With more sampling, the simulation speed can be greatly "
-         "improved at the expense of accuracy loss.")
+         "improved at the expense of accuracy loss. In a native run, sampling "
+         "turns the run into a performance projection: the sampled kernels "
+         "are timed and extrapolated, and the network output is not valid.")
         ("sample-num",
           po::value(&(sampling.num_sample_iterations))->implicit_value(1),
          "Set the number of sample iterations used by every sampling enabled "
@@ -67,9 +90,88 @@ int main(int argc, char* argv[]) {
         ("num-threads",
          po::value(&numThreads)->implicit_value(1),
          "Number of threads in the thread pool.")
+        ("pin-threads", po::value(&pinThreads),
+         "Pin the threads of the thread pool to these host cores, given as a "
+         "list like 0-15 or 0,2,4-7. Thread i runs on the i-th listed core. "
+         "Only applies to native runs.")
         ("use-systolic-array",
          po::value(&useSystolicArrayWhenAvailable)->implicit_value(true),
-         "If the backend contains a systolic array, use it whenever possible.");
+         "If the backend contains a systolic array, use it whenever possible. "
+         "Outside of gem5, the systolic array runs natively, and the "
+         "estimated cycles of every layer on it are printed.")
+        ("systolic-array-rows", po::value(&systolicArrayConfig.rows),
+         "The number of PE rows of the systolic array in the native cycle "
+         "estimates (default 8). In simulation, the gem5 configuration "
+         "decides.")
+        ("systolic-array-cols", po::value(&systolicArrayConfig.cols),
+         "The number of PE columns of the systolic array in the native cycle "
+         "estimates (default 8).")
+        ("ref-fp16",
+         po::value(&useFp16ReferenceStorage)->implicit_value(true),
+         "Store the tensors of the operators on the Reference backend in fp16, "
+         "like the SMV backend, instead of fp32. The operators still compute "
+         "in fp32, and their results are rounded to fp16. Parameters stored "
+         "in fp32 in the model are rounded to fp16 when they are loaded.")
+        ("load-states", po::value(&loadStatesFile),
+         "Initialize the state variables of the network (e.g. RNN states) "
+         "from this snapshot file instead of their values in the model "
+         "parameters. Used to continue a sequence from a previous run.")
+        ("save-states", po::value(&saveStatesFile),
+         "Write the final values of the state variables of the network to "
+         "this snapshot file, which can be loaded by --load-states.")
+        ("placement", po::value(&placement),
+         "How to place the operators on backends. With 'graph' (default), "
+         "every operator runs on the backend of the graph unless its node "
+         "names another one. With 'auto', every operator that can run on "
+         "several backends is placed where it is estimated to be fastest, "
+         "with conversions inserted between backends.")
+        ("placement-costs", po::value(&placementCostsFile),
+         "Read the costs of the operators on each backend, used by "
+         "--placement=auto, from this file instead of using the defaults.")
+        ("profile-placement", po::value(&profilePlacementFile),
+         "Time every operator of this run and write the resulting costs of "
+         "the operators on their backends to this file, which can be read "
+         "by --placement-costs.")
+        ("tuning-db", po::value(&tuningDbFile),
+         "Autotune the tiling of the SMV convolution, inner product and "
+         "pooling operators: the candidate tilings of every new operator "
+         "shape are timed on this machine, and the fastest is recorded in "
+         "this tuning database file, which later runs reuse. Only applies to "
+         "native runs.")
+        ("scheduling", po::value(&scheduling),
+         "The order in which to run the operators that are ready. With "
+         "'fifo' (default), they run in the order they become ready. With "
+         "'greedy', the one that frees the most memory runs first. With "
+         "'min-memory', they follow a precomputed order that minimizes the "
+         "peak memory of the live activations. The computation is the same "
+         "with every policy.")
+        ("report-memory", po::value(&reportMemory)->implicit_value(true),
+         "Print the peak memory of the live activations of this run, and the "
+         "estimates for every scheduling policy.")
+        ("memory-budget", po::value(&memoryBudget),
+         "A budget in bytes for the live activations. If the scheduling "
+         "policy alone exceeds it, the outputs of cheap operators "
+         "(elementwise, activation and reorder) are released between their "
+         "uses and recomputed before the later ones, and every activation is "
+         "released after its last use. The plan is printed, with the bytes "
+         "saved and the extra FLOPs.")
+        ("band-rows", po::value(&bandRows),
+         "Run a fully convolutional network (Reference backend, NHWC) in "
+         "horizontal bands of this many output rows. Each intermediate "
+         "activation only keeps the rows that the current band needs, "
+         "including the halo rows of the receptive fields, instead of the "
+         "whole tensor. Networks with other operators run on whole tensors.")
+        ("pipeline-bands", po::value(&pipelineBands)->implicit_value(true),
+         "With --band-rows, start every operator on a band as soon as its "
+         "producers have written the rows it needs, so that the bands of "
+         "different operators run concurrently on the --num-threads worker "
+         "threads. The row windows hold one more band each.")
+        ("branch-stats", po::value(&branchStatsFile),
+         "Count the branches taken by the Switch operators in this file, "
+         "across runs. The branches taken at least half of the time are "
+         "tiled at startup, prefetching their weights; the others are only "
+         "tiled when they are first taken, so a branch that is never taken "
+         "costs nothing.");
     // clang-format on
 
     po::options_description hidden;
@@ -129,8 +231,35 @@ int main(int argc, char* argv[]) {
         std::cout << "Sampling level: " << samplingLevel
                   << ", number of sample iterations: "
                   << sampling.num_sample_iterations << "\n";
+        // Outside of simulation, sampling is used to project the performance
+        // of the network.
+        if (!runningInSimulation) {
+            std::cout << "Sampling in a native run: reporting a performance "
+                         "projection. The network output is NOT numerically "
+                         "valid.\n";
+            PerfProjection::enable();
+        }
+    }
+
+    if (!tuningDbFile.empty()) {
+        if (runningInSimulation) {
+            std::cout << "Autotuning is not supported in simulation!\n";
+            exit(1);
+        }
+        if (!Autotuner::enable(tuningDbFile)) {
+            std::cout << "Failed to read the tuning database "
+                      << tuningDbFile << "!\n";
+            exit(1);
+        }
     }
 
+    if (systolicArrayConfig.rows <= 0 || systolicArrayConfig.cols <= 0) {
+        std::cout << "The systolic array must have at least one row and one "
+                     "column!\n";
+        exit(1);
+    }
+    smv::SystolicArray::setConfig(systolicArrayConfig);
+
     if (numAcceleratorsAvailable > maxNumAccelerators) {
         std::cout << "The number of accelerators exceeds the max number!\n";
         exit(1);
@@ -145,11 +274,44 @@ int main(int argc, char* argv[]) {
     if (numThreads != -1) {
         std::cout << "Using a thread pool, size: " << numThreads << ".\n";
         threadPool = new ThreadPool(numThreads);
+        if (!pinThreads.empty()) {
+            std::vector<int> cpus = parseCpuList(pinThreads);
+            if (cpus.empty()) {
+                std::cout << "Invalid list of cores to pin threads to: "
+                          << pinThreads << "\n";
+                exit(1);
+            }
+            threadPool->setCpuAffinity(cpus);
+        }
+        // The CPU IDs of the workers only matter in simulation, so a native
+        // run can start the pool right away and decode the parameters on it.
+        if (!runningInSimulation)
+            threadPool->initThreadPool();
     }
 
+    GraphProto graph;
+    TensorDataArray tensorDataArray;
+    loadModel(modelTopo, modelParams, &graph, &tensorDataArray);
+    PlacementCostTable placementCosts;
+    if (!placementCostsFile.empty() &&
+        !placementCosts.load(placementCostsFile)) {
+        std::cout << "Failed to read the placement costs from "
+                  << placementCostsFile << "!\n";
+        exit(1);
+    }
+    if (placement == "auto") {
+        placeOperators(&graph, placementCosts);
+    } else if (placement != "graph") {
+        std::cout << "Doesn't support the specified placement option: "
+                  << placement << "\n";
+        exit(1);
+    }
+    if (!profilePlacementFile.empty())
+        PerfProjection::enable();
+
     Workspace* workspace = new Workspace();
     Network* network =
-            buildNetwork(modelTopo, modelParams, sampling, workspace);
+            buildNetwork(graph, tensorDataArray, sampling, workspace);
     ReferenceBackend::initGlobals();
     SmvBackend::initGlobals();
 
@@ -159,8 +321,104 @@ int main(int argc, char* argv[]) {
     if (!network->validate())
         return -1;
 
-    Scheduler scheduler(network, workspace);
-    Tensor* output = scheduler.runNetwork();
+    if (!loadStatesFile.empty()) {
+        TensorProtoArray snapshot;
+        std::fstream infile(loadStatesFile, std::ios::in | std::ios::binary);
+        if (!infile || !snapshot.ParseFromIstream(&infile)) {
+            std::cerr << "Failed to read the state snapshot from "
+                      << loadStatesFile << "!\n";
+            return 1;
+        }
+        if (!network->restoreStates(snapshot)) {
+            std::cerr << "The state snapshot " << loadStatesFile
+                      << " doesn't match the network!\n";
+            return 1;
+        }
+    }
+
+    RowBandScheduler* bandScheduler = nullptr;
+    std::unique_ptr<Scheduler> scheduler;
+    if (bandRows > 0 && RowBandScheduler::canStream(network)) {
+        bandScheduler = new RowBandScheduler(network, workspace, bandRows);
+        bandScheduler->setPipelined(pipelineBands);
+        scheduler.reset(bandScheduler);
+    } else {
+        if (bandRows > 0) {
+            std::cout << "The network can't run in row bands, so it runs "
+                         "on whole tensors.\n";
+        }
+        scheduler.reset(new Scheduler(network, workspace));
+    }
+    if (scheduling == "fifo") {
+        scheduler->setPolicy(FifoScheduling);
+    } else if (scheduling == "greedy") {
+        scheduler->setPolicy(GreedyMemoryScheduling);
+    } else if (scheduling == "min-memory") {
+        scheduler->setPolicy(MinMemoryScheduling);
+    } else {
+        std::cout << "Doesn't support the specified scheduling option: "
+                  << scheduling << "\n";
+        exit(1);
+    }
+    scheduler->setMemoryBudget(memoryBudget);
+    if (!branchStatsFile.empty() &&
+        !scheduler->loadBranchStats(branchStatsFile)) {
+        std::cout << "Failed to read the branch statistics from "
+                  << branchStatsFile << "!\n";
+        exit(1);
+    }
+    Tensor* output = scheduler->runNetwork();
+
+    if (memoryBudget > 0 && !bandScheduler)
+        scheduler->getRecomputePlan().print(std::cout);
+    if (reportMemory && bandScheduler) {
+        std::cout << "Peak bytes of the row bands of this run: "
+                  << bandScheduler->getPeakBandBytes() << "\n";
+    } else if (reportMemory) {
+        std::cout << "Peak live bytes of this run ("
+                  << getSchedulingPolicyName(scheduler->getPolicy())
+                  << "): " << scheduler->getPeakLiveBytes() << "\n";
+        scheduler->printMemoryReport(std::cout);
+    }
+
+    if (PerfProjection::enabled() && sampling.level > NoSampling)
+        PerfProjection::printReport(std::cout);
+    if (!smv::SystolicArray::getRecords().empty())
+        smv::SystolicArray::printReport(std::cout);
+
+    if (!profilePlacementFile.empty()) {
+        placementCosts.updateFromProfile(graph, PerfProjection::getRecords());
+        if (!placementCosts.save(profilePlacementFile)) {
+            std::cerr << "Failed to write the placement costs to "
+                      << profilePlacementFile << "!\n";
+            return 1;
+        }
+    }
+
+    if (!branchStatsFile.empty() &&
+        !scheduler->saveBranchStats(branchStatsFile)) {
+        std::cerr << "Failed to write the branch statistics to "
+                  << branchStatsFile << "!\n";
+        return 1;
+    }
+
+    if (Autotuner::enabled() && !Autotuner::saveDatabase()) {
+        std::cerr << "Failed to write the tuning database to " << tuningDbFile
+                  << "!\n";
+        return 1;
+    }
+
+    if (!saveStatesFile.empty()) {
+        TensorProtoArray snapshot;
+        network->snapshotStates(&snapshot);
+        std::fstream outfile(saveStatesFile, std::ios::out | std::ios::trunc |
+                                                     std::ios::binary);
+        if (!snapshot.SerializeToOstream(&outfile)) {
+            std::cerr << "Failed to write the state snapshot to "
+                      << saveStatesFile << "!\n";
+            return 1;
+        }
+    }
 
     if (!lastOutputFile.empty()) {
         if (lastOutputFile == "stdout") {
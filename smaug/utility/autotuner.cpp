@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "smaug/utility/autotuner.h"
+#include "smaug/utility/debug_stream.h"
+
+namespace smaug {
+
+bool Autotuner::active = false;
+std::string Autotuner::dbFile;
+std::map<std::string, std::string> Autotuner::database;
+std::mutex Autotuner::mutex;
+
+// The database has one "<key>\t<variant>" entry per line.
+bool Autotuner::enable(const std::string& _dbFile) {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = true;
+    dbFile = _dbFile;
+    database.clear();
+    std::ifstream file(dbFile);
+    if (!file)
+        return true;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty())
+            continue;
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos)
+            return false;
+        database[line.substr(0, tab)] = line.substr(tab + 1);
+    }
+    return true;
+}
+
+void Autotuner::disable() {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = false;
+    database.clear();
+}
+
+bool Autotuner::saveDatabase() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream file(dbFile, std::ios::out | std::ios::trunc);
+    if (!file)
+        return false;
+    for (const auto& entry : database)
+        file << entry.first << "\t" << entry.second << "\n";
+    return static_cast<bool>(file);
+}
+
+std::string Autotuner::lookup(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = database.find(key);
+    return it == database.end() ? "" : it->second;
+}
+
+void Autotuner::record(const std::string& key, const std::string& variant) {
+    std::lock_guard<std::mutex> lock(mutex);
+    database[key] = variant;
+}
+
+int Autotuner::tune(const std::string& key,
+                    const std::vector<std::string>& variants,
+                    const std::function<void(int)>& run) {
+    assert(!variants.empty() && "Nothing to tune!");
+    auto recorded = std::find(variants.begin(), variants.end(), lookup(key));
+    if (recorded != variants.end())
+        return recorded - variants.begin();
+    if (variants.size() == 1) {
+        record(key, variants[0]);
+        return 0;
+    }
+
+    dout(1) << "Autotuning " << key << ", " << variants.size()
+            << " variants.\n";
+    int best = 0;
+    double bestTime = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < variants.size(); i++) {
+        // The first run warms up the caches and isn't timed.
+        run(i);
+        double time = std::numeric_limits<double>::infinity();
+        for (int r = 0; r < kNumTimedRuns; r++) {
+            auto start = std::chrono::steady_clock::now();
+            run(i);
+            time = std::min(time,
+                            std::chrono::duration<double>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count());
+        }
+        dout(2) << "  " << variants[i] << ": " << time * 1e3 << " ms\n";
+        if (time < bestTime) {
+            bestTime = time;
+            best = i;
+        }
+    }
+    record(key, variants[best]);
+    return best;
+}
+
+}  // namespace smaug
@@ -0,0 +1,75 @@
+#ifndef _UTILITY_AUTOTUNER_H_
+#define _UTILITY_AUTOTUNER_H_
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace smaug {
+
+/**
+ * Picks the fastest of several implementations of a kernel by timing them on
+ * the host.
+ *
+ * Every tuning problem is identified by a key, which describes everything
+ * that affects the performance of the variants (e.g. the operator type and
+ * the shapes, layouts and data types of its tensors). The first time a key is
+ * seen, every variant is run and timed, and the winner is recorded in a
+ * tuning database. Later lookups of the same key, in this run or, through the
+ * database file, in later runs on the same machine, reuse the winner without
+ * timing anything.
+ *
+ * Autotuning is opt-in and only meaningful in native runs. Networks running
+ * on several threads share the database.
+ */
+class Autotuner {
+   public:
+    /** Returns true if operators should tune their implementations. */
+    static bool enabled() { return active; }
+
+    /**
+     * Enables autotuning, and loads the results of earlier runs from this
+     * database file if it exists. Returns false if it can't be parsed.
+     */
+    static bool enable(const std::string& dbFile);
+    static void disable();
+
+    /** Writes all the tuning results to the database file. */
+    static bool saveDatabase();
+
+    /** Returns the variant recorded for this key, or an empty string. */
+    static std::string lookup(const std::string& key);
+    /** Records the winning variant for this key. */
+    static void record(const std::string& key, const std::string& variant);
+
+    /**
+     * Returns the index of the fastest of the variants for this key.
+     *
+     * If a variant of this list was recorded for the key, it is returned.
+     * Otherwise, every variant is timed by calling run with its index, and
+     * the fastest is recorded.
+     *
+     * @param key Identifies the tuning problem.
+     * @param variants Unique descriptions of the variants, which are stored
+     * in the database.
+     * @param run Runs the variant with the given index once.
+     */
+    static int tune(const std::string& key,
+                    const std::vector<std::string>& variants,
+                    const std::function<void(int)>& run);
+
+   protected:
+    /** How many times a variant runs; the fastest run is kept. */
+    static const int kNumTimedRuns = 3;
+
+    static bool active;
+    static std::string dbFile;
+    static std::map<std::string, std::string> database;
+    static std::mutex mutex;
+};
+
+}  // namespace smaug
+
+#endif
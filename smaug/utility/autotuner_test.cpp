@@ -0,0 +1,52 @@
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "catch.hpp"
+#include "smaug/utility/autotuner.h"
+
+using namespace smaug;
+
+TEST_CASE("Autotuner picks and records the fastest variant", "[autotuner]") {
+    std::string dbFile = "autotuner_test_db.txt";
+    std::remove(dbFile.c_str());
+    REQUIRE(Autotuner::enable(dbFile));
+    std::vector<std::string> variants = { "slow", "fast", "slower" };
+    std::vector<int> numRuns(variants.size(), 0);
+    auto run = [&](int i) {
+        numRuns[i]++;
+        int sleepMs[] = { 4, 1, 8 };
+        std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs[i]));
+    };
+    REQUIRE(Autotuner::tune("conv (1, 8, 8, 8)", variants, run) == 1);
+    REQUIRE(numRuns[0] > 0);
+    REQUIRE(Autotuner::lookup("conv (1, 8, 8, 8)") == "fast");
+
+    SECTION("A recorded key isn't tuned again") {
+        std::fill(numRuns.begin(), numRuns.end(), 0);
+        REQUIRE(Autotuner::tune("conv (1, 8, 8, 8)", variants, run) == 1);
+        REQUIRE(numRuns == std::vector<int>{ 0, 0, 0 });
+    }
+
+    SECTION("A stale recorded variant is retuned") {
+        std::vector<std::string> newVariants = { "slower", "slow" };
+        REQUIRE(Autotuner::tune("conv (1, 8, 8, 8)", newVariants, [&](int i) {
+            run(i == 0 ? 2 : 0);
+        }) == 1);
+        REQUIRE(Autotuner::lookup("conv (1, 8, 8, 8)") == "slow");
+    }
+
+    SECTION("The database persists across runs") {
+        Autotuner::record("pool (1, 4, 4, 8)", "tiles: (1, 2, 4, 8)");
+        REQUIRE(Autotuner::saveDatabase());
+        Autotuner::disable();
+        REQUIRE(Autotuner::lookup("conv (1, 8, 8, 8)").empty());
+        REQUIRE(Autotuner::enable(dbFile));
+        REQUIRE(Autotuner::lookup("conv (1, 8, 8, 8)") == "fast");
+        REQUIRE(Autotuner::lookup("pool (1, 4, 4, 8)") ==
+                "tiles: (1, 2, 4, 8)");
+    }
+
+    Autotuner::disable();
+    std::remove(dbFile.c_str());
+}
@@ -0,0 +1,95 @@
+#include <boost/format.hpp>
+
+#include "smaug/operators/common.h"
+#include "smaug/utility/perf_projection.h"
+
+namespace smaug {
+
+thread_local bool PerfProjection::active = false;
+thread_local PerfProjection::Clock PerfProjection::clock =
+        PerfProjection::steadyClock;
+thread_local float PerfProjection::kernelFactor = 1;
+thread_local double PerfProjection::opKernelTime = 0;
+thread_local double PerfProjection::opProjectedKernelTime = 0;
+thread_local std::vector<PerfProjection::Record> PerfProjection::records;
+
+static double secondsBetween(std::chrono::steady_clock::time_point start,
+                             std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double>(end - start).count();
+}
+
+PerfProjection::ScopedKernel::ScopedKernel() {
+    if (!active)
+        return;
+    kernelFactor = 1;
+    start = clock();
+}
+
+PerfProjection::ScopedKernel::~ScopedKernel() {
+    if (!active)
+        return;
+    double elapsed = secondsBetween(start, clock());
+    opKernelTime += elapsed;
+    opProjectedKernelTime += elapsed * kernelFactor;
+}
+
+PerfProjection::ScopedOperator::ScopedOperator(const std::string& _name,
+                                               const std::string& _type)
+        : name(_name), type(_type) {
+    if (!active)
+        return;
+    opKernelTime = 0;
+    opProjectedKernelTime = 0;
+    start = clock();
+}
+
+PerfProjection::ScopedOperator::~ScopedOperator() {
+    if (!active)
+        return;
+    double elapsed = secondsBetween(start, clock());
+    records.push_back({ name, type, elapsed,
+                        elapsed - opKernelTime + opProjectedKernelTime });
+}
+
+double PerfProjection::totalMeasuredTime() {
+    double total = 0;
+    for (const auto& record : records)
+        total += record.measured;
+    return total;
+}
+
+double PerfProjection::totalProjectedTime() {
+    double total = 0;
+    for (const auto& record : records)
+        total += record.projected;
+    return total;
+}
+
+void PerfProjection::printReport(std::ostream& os) {
+    static const std::string hline(
+            "______________________________________________"
+            "______________________________________________");
+    static const char* kFormat = "%-40s %-20s %14s %14s\n";
+    os << "======================================================\n";
+    os << "      Performance projection (sampled native run).\n";
+    os << "      The network output is NOT numerically valid.\n";
+    os << "======================================================\n";
+    os << boost::format(kFormat) % "Layer" % "Type" % "Measured (ms)" %
+                    "Projected (ms)";
+    os << hline << "\n";
+    for (const auto& record : records) {
+        os << boost::format(kFormat) % record.name % record.type %
+                        (boost::format("%.3f") % (record.measured * 1e3)) %
+                        (boost::format("%.3f") % (record.projected * 1e3));
+    }
+    os << hline << "\n";
+    os << boost::format(kFormat) % "Total" % "" %
+                    (boost::format("%.3f") % (totalMeasuredTime() * 1e3)) %
+                    (boost::format("%.3f") % (totalProjectedTime() * 1e3));
+}
+
+}  // namespace smaug
+
+extern "C" void accumulateSamplingFactor(float factor) {
+    smaug::PerfProjection::accumulateFactor(factor);
+}
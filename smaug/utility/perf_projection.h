@@ -0,0 +1,115 @@
+#ifndef _UTILITY_PERF_PROJECTION_H_
+#define _UTILITY_PERF_PROJECTION_H_
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace smaug {
+
+class ExecutionContext;
+
+/**
+ * Projects the runtime of a network from a native run with sampled kernels.
+ *
+ * Sampled kernels only execute a subset of the iterations of their loops and
+ * report how much they skipped through SET_SAMPLING_FACTOR. In gem5, Aladdin
+ * uses these factors to extrapolate the simulated latency. In a native run,
+ * the wall time of every kernel invocation is scaled by the product of the
+ * factors it reported (the sampled loops are nested), and the rest of an
+ * operator's time is counted as is. Since the kernels skip work, the outputs
+ * of such a run are not valid; only the projected times are meaningful.
+ *
+ * The projection belongs to the thread that runs the network: whether it is
+ * enabled and the times collected so far are carried by the ExecutionContext
+ * bound to that thread, so concurrent inferences each get their own.
+ */
+class PerfProjection {
+   public:
+    /** Returns true if a projection is being collected. */
+    static bool enabled() { return active; }
+    static void enable() { active = true; }
+
+    /** Multiplies a factor into the projection of the running kernel. */
+    static void accumulateFactor(float factor) { kernelFactor *= factor; }
+
+    /** Returns the total wall time of the sampled run, in seconds. */
+    static double totalMeasuredTime();
+
+    /** Returns the total projected time of the full run, in seconds. */
+    static double totalProjectedTime();
+
+    /** Prints the projected time of every operator and the whole network. */
+    static void printReport(std::ostream& os);
+
+    /** Discards all the collected times. */
+    static void clear() { records.clear(); }
+
+    /** A clock that returns the current time. */
+    typedef std::chrono::steady_clock::time_point (*Clock)();
+
+    /** Measures the times with the given clock instead, e.g. in tests. */
+    static void setClock(Clock _clock) { clock = _clock; }
+
+    /**
+     * A RAII helper which measures a native kernel invocation and scales it
+     * by its sampling factors.
+     */
+    class ScopedKernel {
+       public:
+        ScopedKernel();
+        ~ScopedKernel();
+
+       protected:
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /**
+     * A RAII helper which measures the run of an operator, including all the
+     * kernels it invokes.
+     */
+    class ScopedOperator {
+       public:
+        ScopedOperator(const std::string& _name, const std::string& _type);
+        ~ScopedOperator();
+
+       protected:
+        std::string name;
+        std::string type;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    /** The times collected for one run of an operator. */
+    struct Record {
+        std::string name;
+        std::string type;
+        /** Wall time of the sampled run, in seconds. */
+        double measured;
+        /** Extrapolated time of the full run, in seconds. */
+        double projected;
+    };
+
+    /** Returns the times of all the operators run so far in this run. */
+    static const std::vector<Record>& getRecords() { return records; }
+
+   protected:
+    static std::chrono::steady_clock::time_point steadyClock() {
+        return std::chrono::steady_clock::now();
+    }
+
+    static thread_local bool active;
+    static thread_local Clock clock;
+    /** The product of the sampling factors of the running kernel. */
+    static thread_local float kernelFactor;
+    /** Measured and projected time of the kernels of the running operator. */
+    static thread_local double opKernelTime;
+    static thread_local double opProjectedKernelTime;
+    static thread_local std::vector<Record> records;
+
+    friend class ExecutionContext;
+};
+
+}  // namespace smaug
+
+#endif
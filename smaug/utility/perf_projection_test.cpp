@@ -0,0 +1,70 @@
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+#include "smaug/core/execution_context.h"
+#include "smaug/operators/common.h"
+#include "smaug/utility/perf_projection.h"
+
+using namespace smaug;
+
+namespace {
+
+// A fake clock, which only advances when the test says so. Every thread has
+// its own.
+thread_local std::chrono::steady_clock::time_point fakeTime;
+
+std::chrono::steady_clock::time_point fakeClock() { return fakeTime; }
+
+void advance(int milliseconds) {
+    fakeTime += std::chrono::milliseconds(milliseconds);
+}
+
+}  // namespace
+
+TEST_CASE("Performance projection of sampled kernels", "[projection]") {
+    PerfProjection::enable();
+    PerfProjection::setClock(fakeClock);
+    PerfProjection::clear();
+    {
+        auto op = PerfProjection::ScopedOperator("conv", "Convolution3d");
+        // The time outside of the kernels is not scaled.
+        advance(5);
+        auto kernel = PerfProjection::ScopedKernel();
+        // Two nested sampled loops, which together skipped 7/8 of the work.
+        accumulateSamplingFactor(4);
+        accumulateSamplingFactor(2);
+        advance(20);
+    }
+    REQUIRE(PerfProjection::totalMeasuredTime() == Approx(0.025));
+    REQUIRE(PerfProjection::totalProjectedTime() == Approx(0.005 + 8 * 0.02));
+    PerfProjection::clear();
+    REQUIRE(PerfProjection::totalProjectedTime() == 0);
+}
+
+TEST_CASE("Performance projections are kept per context", "[projection]") {
+    constexpr int kNumContexts = 2;
+    std::vector<ExecutionContext> contexts(kNumContexts);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumContexts; i++) {
+        contexts[i].perfProjectionEnabled = true;
+        contexts[i].perfProjectionRecords.clear();
+        threads.emplace_back([&, i]() {
+            auto scope = ExecutionContext::Scope(&contexts[i]);
+            PerfProjection::setClock(fakeClock);
+            auto op = PerfProjection::ScopedOperator(
+                    "op" + std::to_string(i), "ReLU");
+            advance(i + 1);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (int i = 0; i < kNumContexts; i++) {
+        const auto& records = contexts[i].perfProjectionRecords;
+        REQUIRE(records.size() == 1);
+        REQUIRE(records[0].name == "op" + std::to_string(i));
+        REQUIRE(records[0].measured == Approx(0.001 * (i + 1)));
+    }
+}
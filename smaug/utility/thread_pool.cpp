@@ -1,3 +1,10 @@
+#include <climits>
+#include <sched.h>
+#include <sstream>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include "smaug/utility/thread_pool.h"
 #include "smaug/utility/utils.h"
 #include "smaug/core/globals.h"
@@ -5,17 +12,43 @@
 
 namespace smaug {
 
-ThreadPool::ThreadPool(int nthreads) : workers(nthreads) {}
+// Blocks until the futex word no longer holds the expected value.
+static void futexWait(std::atomic<uint32_t>* word, uint32_t expected) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE,
+            expected, NULL, NULL, 0);
+}
+
+// Wakes up to count threads waiting on the futex word.
+static void futexWake(std::atomic<uint32_t>* word, int count) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE,
+            count, NULL, NULL, 0);
+}
+
+static inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+ThreadPool::ThreadPool(int nthreads)
+        : workers(nthreads), initialized(false), nativeMode(false),
+          generation(0), parkedWorkers(0), pendingJobs(0), mainParked(false),
+          shuttingDown(false) {}
 
 ThreadPool::~ThreadPool() {
     // Shutdown the thread pool and free all resources.
-    for (int i = 0; i < workers.size(); i++) {
-        WorkerThread* worker = &workers[i];
-        gem5::wakeCpu(worker->cpuid);
-        pthread_mutex_lock(&worker->statusMutex);
-        worker->exit = true;
-        pthread_cond_signal(&worker->wakeupCond);
-        pthread_mutex_unlock(&worker->statusMutex);
+    if (nativeMode) {
+        shuttingDown = true;
+        wakeWorkers();
+    } else {
+        for (int i = 0; i < workers.size(); i++) {
+            WorkerThread* worker = &workers[i];
+            gem5::wakeCpu(worker->cpuid);
+            pthread_mutex_lock(&worker->statusMutex);
+            worker->exit = true;
+            pthread_cond_signal(&worker->wakeupCond);
+            pthread_mutex_unlock(&worker->statusMutex);
+        }
     }
     for (int i = 0; i < workers.size(); i++) {
         WorkerThread* worker = &workers[i];
@@ -28,6 +61,7 @@ ThreadPool::~ThreadPool() {
 
 void* ThreadPool::workerLoop(void* args) {
     ThreadInitArgs* initArgs = reinterpret_cast<ThreadInitArgs*>(args);
+    ThreadPool* pool = initArgs->pool;
     WorkerThread* worker = initArgs->worker;
     // Notify the main thread about this thread's cpuid. This can only be done
     // after the thread context is created.
@@ -37,6 +71,11 @@ void* ThreadPool::workerLoop(void* args) {
     pthread_cond_signal(&initArgs->cpuidCond);
     pthread_mutex_unlock(&initArgs->cpuidMutex);
 
+    if (pool->nativeMode) {
+        pool->nativeWorkerLoop(worker);
+        pthread_exit(NULL);
+    }
+
     do {
         gem5::quiesce();
         pthread_mutex_lock(&worker->statusMutex);
@@ -63,13 +102,52 @@ void* ThreadPool::workerLoop(void* args) {
     pthread_exit(NULL);
 }
 
+void ThreadPool::nativeWorkerLoop(WorkerThread* worker) {
+    while (true) {
+        // Any job or shutdown after this bumps the generation again.
+        uint32_t seen = generation.load();
+        if (worker->hasWork.load(std::memory_order_acquire)) {
+            worker->func(worker->args);
+            worker->hasWork.store(false, std::memory_order_release);
+            // Only a parked main thread needs the futex wakeup.
+            if (pendingJobs.fetch_sub(1) == 1 && mainParked.load())
+                futexWake(&pendingJobs, INT_MAX);
+            continue;
+        }
+        if (shuttingDown.load(std::memory_order_acquire))
+            break;
+        // Spin for a while waiting for a new generation, then park until it
+        // comes. Counting ourselves as parked before futexWait checks the
+        // generation ensures the main thread can't miss waking us up.
+        uint32_t current = generation.load(std::memory_order_acquire);
+        for (int i = 0; i < kSpinIterations && current == seen; i++) {
+            cpuRelax();
+            current = generation.load(std::memory_order_acquire);
+        }
+        if (current == seen) {
+            parkedWorkers.fetch_add(1);
+            futexWait(&generation, seen);
+            parkedWorkers.fetch_sub(1);
+        }
+    }
+}
+
 void ThreadPool::initThreadPool() {
+    assert(!initialized && "The thread pool is already initialized!");
+    initialized = true;
+    nativeMode = !runningInSimulation;
     // Initialize the CPU ID for each worker thread.
     for (int i = 0; i < workers.size(); i++) {
         WorkerThread* worker = &workers[i];
-        ThreadInitArgs initArgs(worker);
+        ThreadInitArgs initArgs(this, worker);
         pthread_create(
                 &worker->thread, NULL, &ThreadPool::workerLoop, &initArgs);
+        if (nativeMode && !pinnedCpus.empty()) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(pinnedCpus[i % pinnedCpus.size()], &cpuset);
+            pthread_setaffinity_np(worker->thread, sizeof(cpu_set_t), &cpuset);
+        }
 
         // Fill in the CPU ID of the worker thread.
         pthread_mutex_lock(&initArgs.cpuidMutex);
@@ -82,7 +160,35 @@ void ThreadPool::initThreadPool() {
     }
 }
 
+void ThreadPool::assignWork(WorkerThread* worker,
+                            WorkerThreadFunc func,
+                            void* args) {
+    worker->func = func;
+    worker->args = args;
+    pendingJobs.fetch_add(1, std::memory_order_relaxed);
+    worker->hasWork.store(true, std::memory_order_release);
+}
+
+void ThreadPool::wakeWorkers() {
+    // Spinning workers see the new generation. The futex wakeup is only
+    // needed if some worker is parked.
+    generation.fetch_add(1);
+    if (parkedWorkers.load() != 0)
+        futexWake(&generation, INT_MAX);
+}
+
 int ThreadPool::dispatchThread(WorkerThreadFunc func, void* args) {
+    if (nativeMode) {
+        for (int i = 0; i < workers.size(); i++) {
+            WorkerThread* worker = &workers[i];
+            if (!worker->hasWork.load(std::memory_order_acquire)) {
+                assignWork(worker, func, args);
+                wakeWorkers();
+                return i;
+            }
+        }
+        return -1;
+    }
     for (int i = 0; i < workers.size(); i++) {
         WorkerThread* worker = &workers[i];
         pthread_mutex_lock(&worker->statusMutex);
@@ -100,7 +206,47 @@ int ThreadPool::dispatchThread(WorkerThreadFunc func, void* args) {
     return -1;
 }
 
+int ThreadPool::dispatchThreads(WorkerThreadFunc func,
+                                const std::vector<void*>& args) {
+    int numDispatched = 0;
+    if (nativeMode) {
+        for (int i = 0; i < workers.size() && numDispatched < args.size();
+             i++) {
+            WorkerThread* worker = &workers[i];
+            if (!worker->hasWork.load(std::memory_order_acquire))
+                assignWork(worker, func, args[numDispatched++]);
+        }
+        if (numDispatched > 0)
+            wakeWorkers();
+        return numDispatched;
+    }
+    for (; numDispatched < args.size(); numDispatched++) {
+        if (dispatchThread(func, args[numDispatched]) == -1)
+            break;
+    }
+    return numDispatched;
+}
+
 void ThreadPool::joinThreadPool() {
+    if (nativeMode) {
+        uint32_t pending = pendingJobs.load(std::memory_order_acquire);
+        for (int i = 0; i < kSpinIterations && pending != 0; i++) {
+            cpuRelax();
+            pending = pendingJobs.load(std::memory_order_acquire);
+        }
+        if (pending == 0)
+            return;
+        // The workers only wake us up once we are marked as parked, so the
+        // pending jobs are counted again after that.
+        mainParked.store(true);
+        pending = pendingJobs.load();
+        while (pending != 0) {
+            futexWait(&pendingJobs, pending);
+            pending = pendingJobs.load();
+        }
+        mainParked.store(false);
+        return;
+    }
     // There is no need to call wakeCpu here. If the CPU is quiesced, then
     // it cannot possibly be running anything, so its status will be Idle, and
     // this will move on to the next CPU.
@@ -113,4 +259,25 @@ void ThreadPool::joinThreadPool() {
     }
 }
 
+std::vector<int> parseCpuList(const std::string& cpuList) {
+    std::vector<int> cpus;
+    std::stringstream stream(cpuList);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        int first, last;
+        char dash;
+        std::stringstream rangeStream(range);
+        if (!(rangeStream >> first))
+            return {};
+        last = first;
+        if (rangeStream >> dash && (dash != '-' || !(rangeStream >> last)))
+            return {};
+        if (first < 0 || last < first || !rangeStream.eof())
+            return {};
+        for (int cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
 }  // namespace smaug
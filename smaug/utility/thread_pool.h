@@ -2,6 +2,9 @@
 #define _UTILITY_THREAD_POOL_H_
 
 #include <pthread.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
 #include <vector>
 
 namespace smaug {
@@ -19,6 +22,13 @@ namespace smaug {
  * To prevent wasting simulation time with spinloops, this thread pool
  * implementation quiesces all inactive CPUs and wakes them up only when there
  * is work to do. This is done via magic gem5 instructions.
+ *
+ * When running natively, the handoff through mutexes and condition variables
+ * costs more than the small tile copying jobs it dispatches. In that case,
+ * idle workers instead spin for a short while on a futex word shared by the
+ * whole pool before parking on it. A dispatch bumps that word once after
+ * handing out its jobs, and issues a single futex wakeup if any worker is
+ * parked. The workers can also be pinned to host cores.
  */
 class ThreadPool {
    public:
@@ -37,6 +47,13 @@ class ThreadPool {
     /** Returns the number of worker threads. */
     int size() const { return workers.size(); }
 
+    /**
+     * Pin the worker threads to the given host cores. Worker i runs on
+     * cpus[i % cpus.size()]. This only applies to native runs, and must be
+     * called before initThreadPool().
+     */
+    void setCpuAffinity(const std::vector<int>& cpus) { pinnedCpus = cpus; }
+
     /**
      * Initialize the thread pool.
      *
@@ -47,9 +64,24 @@ class ThreadPool {
      */
     void initThreadPool();
 
-    /** Dispatch the function to a worker in the thread pool. */
+    /** Returns true if initThreadPool() has been called. */
+    bool isInitialized() const { return initialized; }
+
+    /**
+     * Dispatch the function to a worker in the thread pool. Returns the
+     * index of the worker, or -1 if all workers are busy.
+     */
     int dispatchThread(WorkerThreadFunc func, void* args);
 
+    /**
+     * Dispatch the function once for every element of args, each to a
+     * different worker. When running natively, all the workers are woken up
+     * at once by a single bump of the pool's generation word. Returns the
+     * number of dispatched jobs, which is less than args.size() if there are
+     * not enough idle workers.
+     */
+    int dispatchThreads(WorkerThreadFunc func, const std::vector<void*>& args);
+
     /** Wait for all threads in the pool to finish work. */
     void joinThreadPool();
 
@@ -87,12 +119,19 @@ class ThreadPool {
         pthread_cond_t statusCond;
         /** The gem5 simulation CPU ID assigned to this worker thread. */
         int cpuid;
+        /**
+         * In native mode, this replaces valid and is accessed without holding
+         * statusMutex. The main thread sets it after filling in func and
+         * args; the worker clears it once the function returns.
+         */
+        std::atomic<bool> hasWork;
 
         WorkerThread() {
             func = NULL;
             args = NULL;
             exit = false;
             valid = false;
+            hasWork = false;
             status = Uninitialized;
             pthread_mutex_init(&statusMutex, NULL);
             pthread_cond_init(&wakeupCond, NULL);
@@ -101,12 +140,14 @@ class ThreadPool {
     };
 
     struct ThreadInitArgs {
+        ThreadPool* pool;
         WorkerThread* worker;
         pthread_mutex_t cpuidMutex;
         pthread_cond_t cpuidCond;
         int cpuid;
 
-        ThreadInitArgs(WorkerThread* _worker) : worker(_worker) {
+        ThreadInitArgs(ThreadPool* _pool, WorkerThread* _worker)
+                : pool(_pool), worker(_worker) {
             pthread_mutex_init(&cpuidMutex, NULL);
             pthread_cond_init(&cpuidCond, NULL);
             cpuid = -1;
@@ -116,10 +157,64 @@ class ThreadPool {
     /** The main event loop executed by all worker threads. */
     static void* workerLoop(void* args);
 
+    /** The event loop of the worker threads in native mode. */
+    void nativeWorkerLoop(WorkerThread* worker);
+
+    /**
+     * Hand a job to an idle worker in native mode. The worker only notices it
+     * after the next call to wakeWorkers().
+     */
+    void assignWork(WorkerThread* worker, WorkerThreadFunc func, void* args);
+
+    /** Wakes up all native workers to check for work or for the shutdown. */
+    void wakeWorkers();
+
+    /**
+     * Number of times an idle worker (or the main thread in joinThreadPool)
+     * polls before it parks on a futex.
+     */
+    static constexpr int kSpinIterations = 20000;
+
     /** Worker threads. */
     std::vector<WorkerThread> workers;
+
+    /** True once the worker threads have been created. */
+    bool initialized;
+
+    /** True if the pool uses the spin-then-park protocol. */
+    bool nativeMode;
+
+    /** Host cores to pin the workers to. Empty if not pinned. */
+    std::vector<int> pinnedCpus;
+
+    /**
+     * In native mode, the main thread bumps this futex word once per dispatch
+     * and for the shutdown. Idle workers spin on it and then park on it.
+     */
+    std::atomic<uint32_t> generation;
+
+    /** Number of workers parked on generation. */
+    std::atomic<uint32_t> parkedWorkers;
+
+    /**
+     * Number of dispatched jobs that haven't finished. joinThreadPool() waits
+     * on this futex word in native mode.
+     */
+    std::atomic<uint32_t> pendingJobs;
+
+    /** True while the main thread is parked on pendingJobs. */
+    std::atomic<bool> mainParked;
+
+    /** Set to true when the shutdown of the pool starts. */
+    std::atomic<bool> shuttingDown;
 };
 
+/**
+ * Parses a list of CPUs like "0-3,8,10-11" into a list of CPU numbers.
+ * Returns an empty list if the string is malformed.
+ */
+std::vector<int> parseCpuList(const std::string& cpuList);
+
 }  // namespace smaug
 
 #endif
@@ -0,0 +1,65 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "catch.hpp"
+#include "smaug/core/globals.h"
+#include "smaug/core/smaug_test.h"
+#include "smaug/utility/thread_pool.h"
+
+using namespace smaug;
+
+static void* incrementCounter(void* args) {
+    reinterpret_cast<std::atomic<int>*>(args)->fetch_add(1);
+    return nullptr;
+}
+
+TEST_CASE_METHOD(SmaugTest, "Native thread pool", "[threadpool]") {
+    ThreadPool pool(4);
+    pool.initThreadPool();
+    std::atomic<int> counters[4];
+    for (auto& counter : counters)
+        counter = 0;
+
+    SECTION("Dispatch one job at a time") {
+        for (int round = 0; round < 100; round++) {
+            for (int i = 0; i < 4; i++)
+                REQUIRE(pool.dispatchThread(incrementCounter, &counters[i]) !=
+                        -1);
+            pool.joinThreadPool();
+        }
+        for (auto& counter : counters)
+            REQUIRE(counter == 100);
+    }
+
+    SECTION("Dispatch jobs in batches") {
+        std::vector<void*> args;
+        for (auto& counter : counters)
+            args.push_back(&counter);
+        for (int round = 0; round < 100; round++) {
+            REQUIRE(pool.dispatchThreads(incrementCounter, args) == 4);
+            pool.joinThreadPool();
+        }
+        for (auto& counter : counters)
+            REQUIRE(counter == 100);
+    }
+
+    SECTION("Wake up parked workers for fewer jobs than workers") {
+        for (int round = 0; round < 20; round++) {
+            // Give the workers and the main thread time to park.
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            REQUIRE(pool.dispatchThread(incrementCounter, &counters[0]) != -1);
+            pool.joinThreadPool();
+        }
+        REQUIRE(counters[0] == 20);
+    }
+}
+
+TEST_CASE("Parse lists of CPUs", "[threadpool]") {
+    REQUIRE(parseCpuList("0-3") == std::vector<int>{ 0, 1, 2, 3 });
+    REQUIRE(parseCpuList("5") == std::vector<int>{ 5 });
+    REQUIRE(parseCpuList("0,2,4-6") == std::vector<int>{ 0, 2, 4, 5, 6 });
+    REQUIRE(parseCpuList("3-1").empty());
+    REQUIRE(parseCpuList("a-b").empty());
+    REQUIRE(parseCpuList("1-").empty());
+}
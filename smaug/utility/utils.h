@@ -10,9 +10,8 @@
 
 namespace smaug {
 
-// TODO: Allow these to take rvalue references.
 template <typename T>
-int product(std::vector<T> array) {
+int product(const std::vector<T>& array) {
     int prod = 1;
     for (auto val : array)
         prod *= val;
@@ -24,7 +23,8 @@ int product(std::vector<T> array) {
  * size.
  */
 template <typename T>
-std::vector<T> sum(std::vector<T> array0, std::vector<T> array1) {
+std::vector<T> sum(const std::vector<T>& array0,
+                   const std::vector<T>& array1) {
     assert(array0.size() == array1.size());
     std::vector<T> sum(array0.size());
     for (int i = 0; i < array0.size(); i++)